@@ -3,6 +3,8 @@ plugins {
     alias(libs.plugins.spring.dependency.management)
     alias(libs.plugins.kotlin.jvm)
     alias(libs.plugins.kotlin.spring)
+    alias(libs.plugins.jmh)
+    `java-test-fixtures`
 }
 
 group = "com.internal"
@@ -68,6 +70,10 @@ dependencies {
     testImplementation(sourceSets["bpfGenerator"].output)
     testImplementation("dev.ebpf:kotlin-ebpf-dsl")
 
+    // JMH benchmarks and load harness (src/jmh); fakes shared with tests live in src/testFixtures
+    jmhImplementation(libs.mockk)
+    jmhImplementation(testFixtures(project))
+
     // bpfGenerator source set
     "bpfGeneratorImplementation"("dev.ebpf:kotlin-ebpf-dsl")
     "bpfGeneratorImplementation"("org.jetbrains.kotlin:kotlin-stdlib")
@@ -83,6 +89,26 @@ tasks.withType<Test> {
     useJUnitPlatform()
 }
 
+// ./gradlew jmh [-PjmhIncludes=CollectorBenchmark]; results in build/reports/jmh/results.json
+jmh {
+    jmhVersion.set(libs.versions.jmh)
+    resultFormat.set("JSON")
+    resultsFile.set(layout.buildDirectory.file("reports/jmh/results.json"))
+    profilers.add("gc")
+    providers.gradleProperty("jmhIncludes").orNull?.let { includes.add(it) }
+}
+
+// ./gradlew loadHarness [-Ppods=1000 -PhttpSeries=50000 -PtcpPeers=10000 -Pcycles=20 ...]
+tasks.register<JavaExec>("loadHarness") {
+    group = "verification"
+    description = "Runs collection cycles for a simulated node against the in-memory BPF bridge."
+    classpath = sourceSets["jmh"].runtimeClasspath
+    mainClass.set("com.internal.kpodmetrics.bench.LoadHarness")
+    maxHeapSize = providers.gradleProperty("harnessHeap").getOrElse("1g")
+    args = listOf("pods", "httpSeries", "tcpPeers", "keysPerMap", "eventsPerSecond", "cpus", "cycles", "warmup", "interval")
+        .mapNotNull { name -> providers.gradleProperty(name).orNull?.let { "--$name=$it" } }
+}
+
 val generateBpf = tasks.register<JavaExec>("generateBpf") {
     classpath = sourceSets["bpfGenerator"].runtimeClasspath
     mainClass.set("com.internal.kpodmetrics.bpf.programs.GenerateBpfKt")
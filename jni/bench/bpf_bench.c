@@ -0,0 +1,646 @@
+/*
+ * kpod_bpf_bench — per-program cost of the generated BPF objects.
+ *
+ * For every program in each .bpf.o given on the command line:
+ *   - verifier statistics: verified instructions (kernel 5.16+), translated
+ *     instructions and JIT image size;
+ *   - per-invocation cost:
+ *       raw_tracepoint / socket_filter programs are driven directly with
+ *       bpf_prog_test_run_opts (zeroed context / minimal packet);
+ *       kprobe / tracepoint programs the kernel cannot test-run are attached
+ *       and their hook is fired from user space (pipe ping-pong for
+ *       sched_switch, loopback TCP/UDP for the socket hooks, page faults,
+ *       getppid for sys_enter/sys_exit). Cost per run comes from the kernel's
+ *       own run_time_ns/run_cnt (BPF_ENABLE_STATS), and the wall-clock delta
+ *       against the same loop with nothing attached gives the latency the
+ *       program adds to the hooked event, kprobe/trampoline overhead included;
+ *   - map-contention scaling: the same measurement with 1, 2, 4, ... workers
+ *       pinned to distinct CPUs firing concurrently. All workers run in the
+ *       benchmark's cgroup, so per-cgroup maps see one hot key: the worst case.
+ *
+ * Programs whose hook has no trigger here report verifier statistics only.
+ *
+ * Usage: kpod_bpf_bench [-n ITER] [-t MAX_THREADS] [-V] [-j] [-v] OBJ.bpf.o...
+ *   -n  events per worker per measurement (default 200000)
+ *   -t  largest worker count for the scaling sweep (default: online CPUs, max 64)
+ *   -V  verifier statistics only; nothing is attached or run
+ *   -j  one JSON object per program instead of the table
+ *   -v  libbpf debug output
+ *
+ * Requires CAP_BPF + CAP_PERFMON (or root).
+ */
+#define _GNU_SOURCE
+#include <bpf/bpf.h>
+#include <bpf/libbpf.h>
+#include <linux/bpf.h>
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_THREADS 64
+
+static long iterations = 200000;
+static int max_threads;
+static int verbose;
+static int json;
+
+static int libbpf_print(enum libbpf_print_level level, const char *fmt, va_list args) {
+    if (level == LIBBPF_DEBUG && !verbose) return 0;
+    return vfprintf(stderr, fmt, args);
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static int pin_to_cpu(int cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Triggers: user-space actions that fire a kernel hook once per call.        */
+/* ------------------------------------------------------------------------- */
+
+/*
+ * Start barrier whose party count can shrink: if a worker thread fails to start,
+ * the ones already waiting are released once the rest have arrived.
+ */
+struct start_gate {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int expected;
+    int arrived;
+};
+
+static void gate_init(struct start_gate *g, int parties) {
+    pthread_mutex_init(&g->lock, NULL);
+    pthread_cond_init(&g->cond, NULL);
+    g->expected = parties;
+    g->arrived = 0;
+}
+
+static void gate_wait(struct start_gate *g) {
+    pthread_mutex_lock(&g->lock);
+    g->arrived++;
+    pthread_cond_broadcast(&g->cond);
+    while (g->arrived < g->expected) pthread_cond_wait(&g->cond, &g->lock);
+    pthread_mutex_unlock(&g->lock);
+}
+
+static void gate_shrink(struct start_gate *g, int parties) {
+    pthread_mutex_lock(&g->lock);
+    g->expected = parties;
+    pthread_cond_broadcast(&g->cond);
+    pthread_mutex_unlock(&g->lock);
+}
+
+static void gate_destroy(struct start_gate *g) {
+    pthread_cond_destroy(&g->cond);
+    pthread_mutex_destroy(&g->lock);
+}
+
+struct worker {
+    int cpu;
+    int fds[4];
+    void *buf;
+    pthread_t partner;
+    int partner_running;
+    int prog_fd;            /* test-run workers only */
+    const struct trigger *trigger;
+    struct start_gate *start;
+    uint64_t elapsed_ns;
+    int error;
+};
+
+struct trigger {
+    const char *name;
+    const char *const *hooks;   /* substrings of the section name this trigger fires */
+    int (*setup)(struct worker *w);
+    void (*fire)(struct worker *w);
+    void (*teardown)(struct worker *w);
+};
+
+static void close_fds(struct worker *w) {
+    for (int i = 0; i < 4; i++) {
+        if (w->fds[i] >= 0) close(w->fds[i]);
+        w->fds[i] = -1;
+    }
+}
+
+/* getppid: the cheapest syscall that is never served from the vDSO. */
+static int syscall_setup(struct worker *w) { (void)w; return 0; }
+static void syscall_fire(struct worker *w) { (void)w; syscall(SYS_getppid); }
+static void noop_teardown(struct worker *w) { (void)w; }
+
+/* Pipe ping-pong with a partner pinned to the same CPU: two switches and a wakeup per call. */
+static void *pingpong_partner(void *arg) {
+    struct worker *w = arg;
+    char c;
+    pin_to_cpu(w->cpu);
+    while (read(w->fds[0], &c, 1) == 1) {
+        if (write(w->fds[3], &c, 1) != 1) break;
+    }
+    return NULL;
+}
+
+static int pingpong_setup(struct worker *w) {
+    if (pipe(w->fds) < 0 || pipe(w->fds + 2) < 0) return -errno;
+    if (pthread_create(&w->partner, NULL, pingpong_partner, w) != 0) return -EAGAIN;
+    w->partner_running = 1;
+    return 0;
+}
+
+static void pingpong_fire(struct worker *w) {
+    char c = 1;
+    if (write(w->fds[1], &c, 1) == 1 && read(w->fds[2], &c, 1) == 1) return;
+    w->error = errno;
+}
+
+static void pingpong_teardown(struct worker *w) {
+    close(w->fds[1]);
+    w->fds[1] = -1;
+    if (w->partner_running) pthread_join(w->partner, NULL);
+    w->partner_running = 0;
+    close_fds(w);
+}
+
+static int loopback_listener(int type, struct sockaddr_in *addr) {
+    socklen_t len = sizeof(*addr);
+    int fd = socket(AF_INET, type, 0);
+    if (fd < 0) return -errno;
+    memset(addr, 0, sizeof(*addr));
+    addr->sin_family = AF_INET;
+    addr->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(fd, (struct sockaddr *)addr, sizeof(*addr)) < 0 ||
+        (type == SOCK_STREAM && listen(fd, 128) < 0) ||
+        getsockname(fd, (struct sockaddr *)addr, &len) < 0) {
+        int err = -errno;
+        close(fd);
+        return err;
+    }
+    return fd;
+}
+
+/* Established loopback TCP pair; one byte client to server per call (sendmsg + recvmsg). */
+static int tcp_rr_setup(struct worker *w) {
+    struct sockaddr_in addr;
+    int lfd = loopback_listener(SOCK_STREAM, &addr);
+    if (lfd < 0) return lfd;
+    w->fds[0] = lfd;
+    w->fds[1] = socket(AF_INET, SOCK_STREAM, 0);
+    if (w->fds[1] < 0 || connect(w->fds[1], (struct sockaddr *)&addr, sizeof(addr)) < 0) return -errno;
+    w->fds[2] = accept(lfd, NULL, NULL);
+    return w->fds[2] < 0 ? -errno : 0;
+}
+
+static void tcp_rr_fire(struct worker *w) {
+    char c = 1;
+    if (send(w->fds[1], &c, 1, 0) == 1 && recv(w->fds[2], &c, 1, 0) == 1) return;
+    w->error = errno;
+}
+
+/* Full connect/accept/close; SO_LINGER 0 resets the client so no TIME_WAIT piles up. */
+static int tcp_connect_setup(struct worker *w) {
+    struct sockaddr_in addr;
+    int lfd = loopback_listener(SOCK_STREAM, &addr);
+    if (lfd < 0) return lfd;
+    w->fds[0] = lfd;
+    w->buf = malloc(sizeof(addr));
+    if (!w->buf) return -ENOMEM;
+    memcpy(w->buf, &addr, sizeof(addr));
+    return 0;
+}
+
+static void tcp_connect_fire(struct worker *w) {
+    struct linger lg = { .l_onoff = 1, .l_linger = 0 };
+    int c = socket(AF_INET, SOCK_STREAM, 0);
+    if (c < 0) { w->error = errno; return; }
+    setsockopt(c, SOL_SOCKET, SO_LINGER, &lg, sizeof(lg));
+    if (connect(c, (struct sockaddr *)w->buf, sizeof(struct sockaddr_in)) < 0) {
+        w->error = errno;
+        close(c);
+        return;
+    }
+    int s = accept(w->fds[0], NULL, NULL);
+    close(c);
+    if (s >= 0) close(s);
+    else w->error = errno;
+}
+
+static void tcp_connect_teardown(struct worker *w) {
+    free(w->buf);
+    w->buf = NULL;
+    close_fds(w);
+}
+
+/* Two bound loopback UDP sockets; one datagram per call. */
+static int udp_setup(struct worker *w) {
+    struct sockaddr_in addr;
+    int rfd = loopback_listener(SOCK_DGRAM, &addr);
+    if (rfd < 0) return rfd;
+    w->fds[0] = rfd;
+    w->fds[1] = socket(AF_INET, SOCK_DGRAM, 0);
+    if (w->fds[1] < 0 || connect(w->fds[1], (struct sockaddr *)&addr, sizeof(addr)) < 0) return -errno;
+    return 0;
+}
+
+static void udp_fire(struct worker *w) {
+    char c = 1;
+    if (send(w->fds[1], &c, 1, 0) == 1 && recv(w->fds[0], &c, 1, 0) == 1) return;
+    w->error = errno;
+}
+
+/* One anonymous page: map, touch (fault), unmap. */
+static int fault_setup(struct worker *w) { (void)w; return 0; }
+
+static void fault_fire(struct worker *w) {
+    char *p = mmap(NULL, 4096, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) { w->error = errno; return; }
+    *(volatile char *)p = 1;
+    munmap(p, 4096);
+}
+
+/* Page-cache hit: pread of the first page of our own binary. */
+static int pagecache_setup(struct worker *w) {
+    w->fds[0] = open("/proc/self/exe", O_RDONLY);
+    w->buf = malloc(4096);
+    return w->fds[0] < 0 ? -errno : (w->buf ? 0 : -ENOMEM);
+}
+
+static void pagecache_fire(struct worker *w) {
+    if (pread(w->fds[0], w->buf, 4096, 0) < 0) w->error = errno;
+}
+
+static void free_and_close(struct worker *w) {
+    free(w->buf);
+    w->buf = NULL;
+    close_fds(w);
+}
+
+static const char *const syscall_hooks[] = { "sys_enter", "sys_exit", NULL };
+static const char *const sched_hooks[] = { "sched_switch", "sched_wakeup", NULL };
+static const char *const tcp_rr_hooks[] = { "tcp_sendmsg", "tcp_recvmsg", "tcp_probe", "tcp_rcv", NULL };
+static const char *const tcp_connect_hooks[] = { "tcp_connect", "inet_sock_set_state", "tcp_v4_connect", NULL };
+static const char *const udp_hooks[] = { "udp_sendmsg", "udp_recvmsg", NULL };
+static const char *const fault_hooks[] = { "handle_mm_fault", "page_fault", NULL };
+static const char *const pagecache_hooks[] = { "mark_page_accessed", "folio_mark_accessed", NULL };
+
+static const struct trigger triggers[] = {
+    { "getppid", syscall_hooks, syscall_setup, syscall_fire, noop_teardown },
+    { "pipe-pingpong", sched_hooks, pingpong_setup, pingpong_fire, pingpong_teardown },
+    { "tcp-rr", tcp_rr_hooks, tcp_rr_setup, tcp_rr_fire, close_fds },
+    { "tcp-connect", tcp_connect_hooks, tcp_connect_setup, tcp_connect_fire, tcp_connect_teardown },
+    { "udp-rr", udp_hooks, udp_setup, udp_fire, close_fds },
+    { "page-fault", fault_hooks, fault_setup, fault_fire, noop_teardown },
+    { "pagecache-read", pagecache_hooks, pagecache_setup, pagecache_fire, free_and_close },
+};
+
+static const struct trigger *trigger_for(const char *section) {
+    for (size_t i = 0; i < sizeof(triggers) / sizeof(triggers[0]); i++) {
+        for (const char *const *h = triggers[i].hooks; *h; h++) {
+            if (strstr(section, *h)) return &triggers[i];
+        }
+    }
+    return NULL;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Workers                                                                    */
+/* ------------------------------------------------------------------------- */
+
+static uint8_t raw_tp_ctx[6 * sizeof(uint64_t)];
+static uint8_t packet[64];
+
+static int test_run_once(int prog_fd, enum bpf_prog_type type) {
+    LIBBPF_OPTS(bpf_test_run_opts, opts);
+    if (type == BPF_PROG_TYPE_RAW_TRACEPOINT) {
+        opts.ctx_in = raw_tp_ctx;
+        opts.ctx_size_in = sizeof(raw_tp_ctx);
+    } else {
+        opts.data_in = packet;
+        opts.data_size_in = sizeof(packet);
+    }
+    return bpf_prog_test_run_opts(prog_fd, &opts);
+}
+
+static enum bpf_prog_type test_run_type;
+
+static void *worker_main(void *arg) {
+    struct worker *w = arg;
+    if (pin_to_cpu(w->cpu) != 0) w->error = EINVAL;
+    if (!w->error && w->trigger) {
+        int err = w->trigger->setup(w);
+        if (err < 0) w->error = -err;
+    }
+    gate_wait(w->start);
+    if (!w->error) {
+        uint64_t start = now_ns();
+        if (w->trigger) {
+            for (long i = 0; i < iterations && !w->error; i++) w->trigger->fire(w);
+        } else {
+            for (long i = 0; i < iterations; i++) {
+                if (test_run_once(w->prog_fd, test_run_type) < 0) { w->error = errno; break; }
+            }
+        }
+        w->elapsed_ns = now_ns() - start;
+    }
+    if (w->trigger) w->trigger->teardown(w);
+    return NULL;
+}
+
+/*
+ * Runs [threads] workers on CPUs 0..threads-1 and returns the mean wall-clock
+ * nanoseconds per event per worker, or a negative errno.
+ */
+static double run_workers(int threads, const struct trigger *trigger, int prog_fd) {
+    struct worker workers[MAX_THREADS];
+    pthread_t tids[MAX_THREADS];
+    struct start_gate start;
+    int started = 0;
+    int error = 0;
+    gate_init(&start, threads);
+    for (int i = 0; i < threads; i++) {
+        memset(&workers[i], 0, sizeof(workers[i]));
+        for (int f = 0; f < 4; f++) workers[i].fds[f] = -1;
+        workers[i].cpu = i;
+        workers[i].trigger = trigger;
+        workers[i].prog_fd = prog_fd;
+        workers[i].start = &start;
+        if (pthread_create(&tids[i], NULL, worker_main, &workers[i]) != 0) {
+            error = EAGAIN;
+            gate_shrink(&start, started);
+            break;
+        }
+        started++;
+    }
+    uint64_t total = 0;
+    for (int i = 0; i < started; i++) {
+        pthread_join(tids[i], NULL);
+        total += workers[i].elapsed_ns;
+        if (workers[i].error) error = workers[i].error;
+    }
+    gate_destroy(&start);
+    if (error) return -(double)error;
+    return (double)total / threads / (double)iterations;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Per-program measurement                                                    */
+/* ------------------------------------------------------------------------- */
+
+struct scaling_point {
+    int threads;
+    double ns_per_run;
+};
+
+struct result {
+    const char *object;
+    const char *program;
+    const char *section;
+    const char *type;
+    __u32 verified_insns;
+    __u32 xlated_insns;
+    __u32 jited_bytes;
+    const char *method;     /* "test_run", "attach" or "none" */
+    const char *trigger;
+    const char *note;
+    double ns_per_run;      /* in-program cost; < 0 when not measured */
+    double added_ns;        /* wall-clock added per hooked event; < 0 when not measured */
+    int npoints;
+    struct scaling_point points[8];
+};
+
+static int prog_info(int fd, struct bpf_prog_info *info) {
+    __u32 len = sizeof(*info);
+    memset(info, 0, sizeof(*info));
+    return bpf_obj_get_info_by_fd(fd, info, &len);
+}
+
+/* In-kernel ns per run over one worker sweep, from run_time_ns/run_cnt deltas. */
+static double kernel_ns_per_run(int prog_fd, int threads, const struct trigger *trigger, double *wall) {
+    struct bpf_prog_info before, after;
+    *wall = -1;
+    if (prog_info(prog_fd, &before) < 0) return -1;
+    *wall = run_workers(threads, trigger, trigger ? -1 : prog_fd);
+    if (*wall < 0 || prog_info(prog_fd, &after) < 0) return -1;
+    __u64 runs = after.run_cnt - before.run_cnt;
+    if (runs == 0) return -1;
+    return (double)(after.run_time_ns - before.run_time_ns) / (double)runs;
+}
+
+static int noop_raw_tp_fd = -1;
+
+/* Test-run cost of an empty raw_tp program: the syscall floor subtracted from test_run timings. */
+static double test_run_floor(int threads) {
+    if (noop_raw_tp_fd < 0) {
+        struct bpf_insn insns[] = {
+            { .code = BPF_ALU64 | BPF_MOV | BPF_K, .dst_reg = BPF_REG_0, .imm = 0 },
+            { .code = BPF_JMP | BPF_EXIT },
+        };
+        noop_raw_tp_fd = bpf_prog_load(BPF_PROG_TYPE_RAW_TRACEPOINT, "kpod_bench_noop", "GPL",
+                                       insns, 2, NULL);
+        if (noop_raw_tp_fd < 0) return 0;
+    }
+    enum bpf_prog_type saved = test_run_type;
+    test_run_type = BPF_PROG_TYPE_RAW_TRACEPOINT;
+    double floor = run_workers(threads, NULL, noop_raw_tp_fd);
+    test_run_type = saved;
+    return floor > 0 ? floor : 0;
+}
+
+static void measure(struct bpf_program *prog, struct result *r) {
+    int fd = bpf_program__fd(prog);
+    enum bpf_prog_type type = bpf_program__type(prog);
+    r->ns_per_run = -1;
+    r->added_ns = -1;
+    r->method = "none";
+
+    if (type == BPF_PROG_TYPE_RAW_TRACEPOINT || type == BPF_PROG_TYPE_SOCKET_FILTER) {
+        test_run_type = type;
+        if (test_run_once(fd, type) < 0) {
+            r->note = "test_run unsupported by kernel";
+            return;
+        }
+        r->method = "test_run";
+        for (int t = 1; t <= max_threads && r->npoints < 8; t *= 2) {
+            double wall;
+            double ns = kernel_ns_per_run(fd, t, NULL, &wall);
+            /* raw_tp test runs are not counted in run_cnt; fall back to wall time over the floor */
+            if (ns < 0 && wall > 0) ns = wall - test_run_floor(t);
+            r->points[r->npoints++] = (struct scaling_point){ t, ns };
+        }
+        r->ns_per_run = r->points[0].ns_per_run;
+        return;
+    }
+
+    const struct trigger *trigger = trigger_for(r->section);
+    if (!trigger) {
+        r->note = "no trigger for hook";
+        return;
+    }
+    r->trigger = trigger->name;
+
+    double base = run_workers(1, trigger, -1);
+    struct bpf_link *link = bpf_program__attach(prog);
+    if (!link) {
+        r->note = "attach failed (hook missing on this kernel?)";
+        return;
+    }
+    r->method = "attach";
+    for (int t = 1; t <= max_threads && r->npoints < 8; t *= 2) {
+        double wall;
+        double ns = kernel_ns_per_run(fd, t, trigger, &wall);
+        if (t == 1 && wall > 0 && base > 0) r->added_ns = wall - base;
+        r->points[r->npoints++] = (struct scaling_point){ t, ns };
+    }
+    bpf_link__destroy(link);
+    r->ns_per_run = r->points[0].ns_per_run;
+    if (r->ns_per_run < 0) r->note = "program did not run (hook not hit by trigger)";
+}
+
+/* ------------------------------------------------------------------------- */
+/* Output                                                                     */
+/* ------------------------------------------------------------------------- */
+
+static void print_result(const struct result *r) {
+    if (json) {
+        printf("{\"object\":\"%s\",\"program\":\"%s\",\"section\":\"%s\",\"type\":\"%s\","
+               "\"verified_insns\":%u,\"xlated_insns\":%u,\"jited_bytes\":%u,\"method\":\"%s\"",
+               r->object, r->program, r->section, r->type,
+               r->verified_insns, r->xlated_insns, r->jited_bytes, r->method);
+        if (r->trigger) printf(",\"trigger\":\"%s\"", r->trigger);
+        if (r->ns_per_run >= 0) printf(",\"ns_per_run\":%.1f", r->ns_per_run);
+        if (r->added_ns >= 0) printf(",\"added_ns_per_event\":%.1f", r->added_ns);
+        if (r->npoints) {
+            printf(",\"scaling\":[");
+            for (int i = 0; i < r->npoints; i++) {
+                printf("%s{\"threads\":%d,\"ns_per_run\":%.1f}", i ? "," : "",
+                       r->points[i].threads, r->points[i].ns_per_run);
+            }
+            printf("]");
+        }
+        if (r->note) printf(",\"note\":\"%s\"", r->note);
+        printf("}\n");
+        return;
+    }
+    printf("%-16s %-24s %-40s %8u %8u %8u  ", r->object, r->program, r->section,
+           r->verified_insns, r->xlated_insns, r->jited_bytes);
+    if (r->ns_per_run >= 0) printf("%8.1f", r->ns_per_run); else printf("%8s", "-");
+    if (r->added_ns >= 0) printf(" %8.1f", r->added_ns); else printf(" %8s", "-");
+    for (int i = 0; i < r->npoints; i++) {
+        printf(" %d:%.0f", r->points[i].threads, r->points[i].ns_per_run);
+    }
+    if (r->note) printf("  (%s)", r->note);
+    printf("\n");
+}
+
+static int bench_object(const char *path, int verifier_only) {
+    const char *base = strrchr(path, '/');
+    base = base ? base + 1 : path;
+    char object[64];
+    snprintf(object, sizeof(object), "%s", base);
+    char *dot = strstr(object, ".bpf.o");
+    if (dot) *dot = '\0';
+
+    struct bpf_object *obj = bpf_object__open_file(path, NULL);
+    if (!obj) {
+        fprintf(stderr, "%s: open failed: %s\n", path, strerror(errno));
+        return 1;
+    }
+    if (bpf_object__load(obj)) {
+        fprintf(stderr, "%s: load failed: %s\n", path, strerror(errno));
+        bpf_object__close(obj);
+        return 1;
+    }
+
+    struct bpf_program *prog;
+    bpf_object__for_each_program(prog, obj) {
+        struct result r = {
+            .object = object,
+            .program = bpf_program__name(prog),
+            .section = bpf_program__section_name(prog),
+            .type = libbpf_bpf_prog_type_str(bpf_program__type(prog)),
+            .ns_per_run = -1,
+            .added_ns = -1,
+            .method = "none",
+        };
+        if (!r.type) r.type = "unknown";
+        struct bpf_prog_info info;
+        if (prog_info(bpf_program__fd(prog), &info) == 0) {
+            r.verified_insns = info.verified_insns;
+            r.xlated_insns = info.xlated_prog_len / sizeof(struct bpf_insn);
+            r.jited_bytes = info.jited_prog_len;
+        }
+        if (!verifier_only) measure(prog, &r);
+        print_result(&r);
+        fflush(stdout);
+    }
+    bpf_object__close(obj);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    int verifier_only = 0;
+    int opt;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    max_threads = cpus > MAX_THREADS ? MAX_THREADS : (int)cpus;
+
+    while ((opt = getopt(argc, argv, "n:t:Vjv")) != -1) {
+        switch (opt) {
+        case 'n': iterations = atol(optarg); break;
+        case 't': max_threads = atoi(optarg); break;
+        case 'V': verifier_only = 1; break;
+        case 'j': json = 1; break;
+        case 'v': verbose = 1; break;
+        default:
+            fprintf(stderr, "usage: %s [-n ITER] [-t MAX_THREADS] [-V] [-j] [-v] OBJ.bpf.o...\n", argv[0]);
+            return 2;
+        }
+    }
+    if (optind >= argc || iterations <= 0 || max_threads < 1 || max_threads > MAX_THREADS || max_threads > cpus) {
+        fprintf(stderr, "usage: %s [-n ITER] [-t MAX_THREADS<=%ld] [-V] [-j] [-v] OBJ.bpf.o...\n",
+                argv[0], cpus < MAX_THREADS ? cpus : MAX_THREADS);
+        return 2;
+    }
+
+    libbpf_set_print(libbpf_print);
+    packet[12] = 0x08; /* ethertype IPv4 */
+
+    int stats_fd = -1;
+    if (!verifier_only) {
+        stats_fd = bpf_enable_stats(BPF_STATS_RUN_TIME);
+        if (stats_fd < 0) {
+            fprintf(stderr, "BPF_ENABLE_STATS failed (%s); in-program ns/run will be missing\n",
+                    strerror(errno));
+        }
+    }
+
+    if (!json) {
+        printf("%-16s %-24s %-40s %8s %8s %8s  %8s %8s %s\n", "object", "program", "section",
+               "verified", "xlated", "jited", "ns/run", "added", "threads:ns/run");
+    }
+    int failed = 0;
+    for (int i = optind; i < argc; i++) failed |= bench_object(argv[i], verifier_only);
+
+    if (stats_fd >= 0) close(stats_fd);
+    if (noop_raw_tp_fd >= 0) close(noop_raw_tp_fd);
+    return failed;
+}
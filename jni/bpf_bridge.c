@@ -1,3 +1,4 @@
+#define _GNU_SOURCE
 #include "bpf_bridge.h"
 #include <bpf/libbpf.h>
 #include <bpf/bpf.h>
@@ -8,8 +9,17 @@
 #include <stdarg.h>
 #include <stdint.h>
 #include <linux/perf_event.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <linux/if_link.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/epoll.h>
 #include <sys/ioctl.h>
+#include <sys/socket.h>
 #include <sys/syscall.h>
+#include <sys/time.h>
 #include <unistd.h>
 
 #define MAX_BPF_LINKS 32
@@ -392,6 +402,102 @@ JNIEXPORT jlongArray JNICALL Java_com_internal_kpodmetrics_bpf_BpfBridge_nativeG
     return result;
 }
 
+/*
+ * Program names and attach points (section names) for every program in an
+ * object, flattened as [name0, section0, name1, section1, ...] in the same
+ * order nativeGetProgramStats reports them.
+ */
+JNIEXPORT jobjectArray JNICALL Java_com_internal_kpodmetrics_bpf_BpfBridge_nativeGetProgramNames(
+    JNIEnv *env, jobject self, jlong ptr) {
+    (void)self;
+    if (ptr == 0) {
+        throw_load_exception(env, "Null BPF object pointer");
+        return NULL;
+    }
+    struct bpf_obj_wrapper *wrapper = (struct bpf_obj_wrapper *)(uintptr_t)ptr;
+
+    int count = 0;
+    struct bpf_program *prog;
+    bpf_object__for_each_program(prog, wrapper->obj) count++;
+
+    jclass string_class = (*env)->FindClass(env, "java/lang/String");
+    if (!string_class) return NULL;
+    jobjectArray result = (*env)->NewObjectArray(env, count * 2, string_class, NULL);
+    if (!result) return NULL;
+
+    int i = 0;
+    bpf_object__for_each_program(prog, wrapper->obj) {
+        const char *section = bpf_program__section_name(prog);
+        jstring name = (*env)->NewStringUTF(env, bpf_program__name(prog));
+        jstring sec = (*env)->NewStringUTF(env, section ? section : "");
+        if (!name || !sec) return NULL;
+        (*env)->SetObjectArrayElement(env, result, i++, name);
+        (*env)->SetObjectArrayElement(env, result, i++, sec);
+        (*env)->DeleteLocalRef(env, name);
+        (*env)->DeleteLocalRef(env, sec);
+    }
+    return result;
+}
+
+/*
+ * Per-program stats: [run_time_ns, run_cnt, recursion_misses] for each program,
+ * in nativeGetProgramNames order. Programs without an fd report zeros.
+ * recursion_misses needs kernel 5.12+.
+ */
+JNIEXPORT jlongArray JNICALL Java_com_internal_kpodmetrics_bpf_BpfBridge_nativeGetProgramStats(
+    JNIEnv *env, jobject self, jlong ptr) {
+    (void)self;
+    if (ptr == 0) {
+        throw_load_exception(env, "Null BPF object pointer");
+        return NULL;
+    }
+    struct bpf_obj_wrapper *wrapper = (struct bpf_obj_wrapper *)(uintptr_t)ptr;
+
+    int count = 0;
+    struct bpf_program *prog;
+    bpf_object__for_each_program(prog, wrapper->obj) count++;
+
+    jlong *vals = calloc((size_t)count * 3 + 1, sizeof(jlong));
+    if (!vals) return NULL;
+    int i = 0;
+    bpf_object__for_each_program(prog, wrapper->obj) {
+        int fd = bpf_program__fd(prog);
+        struct bpf_prog_info info = {};
+        __u32 info_len = sizeof(info);
+        if (fd >= 0 && bpf_obj_get_info_by_fd(fd, &info, &info_len) == 0) {
+            vals[i * 3] = (jlong)info.run_time_ns;
+            vals[i * 3 + 1] = (jlong)info.run_cnt;
+            vals[i * 3 + 2] = (jlong)info.recursion_misses;
+        }
+        i++;
+    }
+
+    jlongArray result = (*env)->NewLongArray(env, count * 3);
+    if (result) {
+        (*env)->SetLongArrayRegion(env, result, 0, count * 3, vals);
+    }
+    free(vals);
+    return result;
+}
+
+/*
+ * BPF_ENABLE_STATS(BPF_STATS_RUN_TIME): run-time stats stay enabled while the
+ * returned fd is open, without touching kernel.bpf_stats_enabled. Kernel 5.8+.
+ * Returns the fd, or -errno when unsupported.
+ */
+JNIEXPORT jint JNICALL Java_com_internal_kpodmetrics_bpf_BpfBridge_nativeEnableStats(
+    JNIEnv *env, jobject self) {
+    (void)env; (void)self;
+    int fd = bpf_enable_stats(BPF_STATS_RUN_TIME);
+    return fd < 0 ? -errno : fd;
+}
+
+JNIEXPORT void JNICALL Java_com_internal_kpodmetrics_bpf_BpfBridge_nativeCloseFd(
+    JNIEnv *env, jobject self, jint fd) {
+    (void)env; (void)self;
+    if (fd >= 0) close(fd);
+}
+
 static int rb_callback(void *ctx_ptr, void *data, size_t data_sz) {
     struct rb_wrapper *w = (struct rb_wrapper *)ctx_ptr;
     if (w->count >= w->max_events)
@@ -470,3 +576,331 @@ JNIEXPORT void JNICALL Java_com_internal_kpodmetrics_bpf_BpfBridge_nativeRingBuf
     ring_buffer__free(w->rb);
     free(w);
 }
+
+/* --- Interface stats via rtnetlink --- */
+
+#define LINK_NAME_SIZE 16   /* IFNAMSIZ */
+#define LINK_RECORD_SIZE (LINK_NAME_SIZE + 8 * 8)
+#define NETLINK_RECV_SIZE 32768
+
+struct netns_socket_req {
+    const char *ns_path;
+    int result;
+};
+
+static void *netns_socket_thread(void *arg) {
+    struct netns_socket_req *req = (struct netns_socket_req *)arg;
+    int target_ns = open(req->ns_path, O_RDONLY | O_CLOEXEC);
+    if (target_ns < 0) {
+        req->result = -errno;
+        return NULL;
+    }
+    if (setns(target_ns, CLONE_NEWNET) < 0) {
+        req->result = -errno;
+    } else {
+        int sock = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+        req->result = sock < 0 ? -errno : sock;
+    }
+    close(target_ns);
+    return NULL;
+}
+
+/*
+ * Opens an rtnetlink socket in the network namespace at ns_path. setns() moves
+ * only the calling thread, so it is done on a short-lived thread that exits in
+ * the pod's namespace: the JVM thread never leaves its own, even when a move
+ * back would fail. The socket stays bound to the namespace it was created in
+ * and its fd is shared by the whole process. Returns the fd or -errno.
+ */
+static int netlink_socket_in_netns(const char *ns_path) {
+    struct netns_socket_req req = { .ns_path = ns_path, .result = -EIO };
+    pthread_t thread;
+    int err = pthread_create(&thread, NULL, netns_socket_thread, &req);
+    if (err != 0) return -err;
+    pthread_join(thread, NULL);
+    return req.result;
+}
+
+/* Appends one record per link carrying IFLA_STATS64; returns the new count or -errno. */
+static int parse_links(const uint8_t *buf, size_t len, uint8_t *out, int cap, int count, int *done) {
+    size_t off = 0;
+    while (off + sizeof(struct nlmsghdr) <= len) {
+        const struct nlmsghdr *nh = (const struct nlmsghdr *)(buf + off);
+        size_t msg_len = nh->nlmsg_len;
+        if (msg_len < sizeof(*nh) || msg_len > len - off) break;
+        if (nh->nlmsg_type == NLMSG_DONE) {
+            *done = 1;
+            return count;
+        }
+        if (nh->nlmsg_type == NLMSG_ERROR) {
+            const struct nlmsgerr *e = (const struct nlmsgerr *)NLMSG_DATA(nh);
+            *done = 1;
+            return e->error < 0 ? e->error : -EIO;
+        }
+        size_t hdr = NLMSG_HDRLEN + NLMSG_ALIGN(sizeof(struct ifinfomsg));
+        if (nh->nlmsg_type == RTM_NEWLINK && msg_len >= hdr) {
+            const char *name = NULL;
+            struct rtnl_link_stats64 st;
+            int have_stats = 0;
+            size_t aoff = hdr;
+            while (aoff + sizeof(struct rtattr) <= msg_len) {
+                const struct rtattr *rta = (const struct rtattr *)((const uint8_t *)nh + aoff);
+                size_t rta_len = rta->rta_len;
+                if (rta_len < sizeof(*rta) || rta_len > msg_len - aoff) break;
+                const uint8_t *data = (const uint8_t *)rta + RTA_ALIGN(sizeof(*rta));
+                size_t data_len = rta_len - RTA_ALIGN(sizeof(*rta));
+                if (rta->rta_type == IFLA_IFNAME && data_len > 0) {
+                    name = (const char *)data;
+                } else if (rta->rta_type == IFLA_STATS64 && data_len >= sizeof(st)) {
+                    memcpy(&st, data, sizeof(st)); /* attribute data is only 4-byte aligned */
+                    have_stats = 1;
+                }
+                aoff += RTA_ALIGN(rta_len);
+            }
+            if (name && have_stats) {
+                if (count >= cap) return -ENOSPC;
+                uint8_t *rec = out + (size_t)count * LINK_RECORD_SIZE;
+                memset(rec, 0, LINK_NAME_SIZE);
+                strncpy((char *)rec, name, LINK_NAME_SIZE - 1);
+                uint64_t vals[8] = {
+                    st.rx_bytes, st.rx_packets, st.rx_errors, st.rx_dropped,
+                    st.tx_bytes, st.tx_packets, st.tx_errors, st.tx_dropped
+                };
+                memcpy(rec + LINK_NAME_SIZE, vals, sizeof(vals));
+                count++;
+            }
+        }
+        off += NLMSG_ALIGN(msg_len);
+    }
+    return count;
+}
+
+/*
+ * RTM_GETLINK dump of the network namespace at nsPath (e.g. /proc/<pid>/ns/net).
+ * Fills out with records of [name: char[16], rx_bytes, rx_packets, rx_errors,
+ * rx_dropped, tx_bytes, tx_packets, tx_errors, tx_dropped: u64 little-endian]
+ * from IFLA_STATS64. Returns the record count, -ENOSPC if out is too small, or
+ * -errno. Needs CAP_SYS_ADMIN for setns().
+ */
+JNIEXPORT jint JNICALL Java_com_internal_kpodmetrics_bpf_BpfBridge_nativeNetnsLinkStats(
+    JNIEnv *env, jobject self, jstring nsPath, jbyteArray out) {
+    (void)self;
+    const char *path = (*env)->GetStringUTFChars(env, nsPath, NULL);
+    if (!path) return -ENOMEM;
+    int sock = netlink_socket_in_netns(path);
+    (*env)->ReleaseStringUTFChars(env, nsPath, path);
+    if (sock < 0) return sock;
+
+    struct timeval tv = { .tv_sec = 2, .tv_usec = 0 };
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    struct {
+        struct nlmsghdr nh;
+        struct ifinfomsg ifm;
+    } req;
+    memset(&req, 0, sizeof(req));
+    req.nh.nlmsg_len = NLMSG_LENGTH(sizeof(struct ifinfomsg));
+    req.nh.nlmsg_type = RTM_GETLINK;
+    req.nh.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    req.nh.nlmsg_seq = 1;
+    req.ifm.ifi_family = AF_UNSPEC;
+
+    jsize out_len = (*env)->GetArrayLength(env, out);
+    int cap = out_len / LINK_RECORD_SIZE;
+    uint8_t *records = malloc((size_t)cap * LINK_RECORD_SIZE + 1);
+    uint8_t *buf = malloc(NETLINK_RECV_SIZE);
+    int count = 0;
+    int done = 0;
+    if (!records || !buf) {
+        count = -ENOMEM;
+        goto out;
+    }
+    if (send(sock, &req, req.nh.nlmsg_len, 0) < 0) {
+        count = -errno;
+        goto out;
+    }
+    while (!done) {
+        ssize_t len = recv(sock, buf, NETLINK_RECV_SIZE, 0);
+        if (len < 0) {
+            if (errno == EINTR) continue;
+            count = -errno;
+            break;
+        }
+        if (len == 0) break;
+        count = parse_links(buf, (size_t)len, records, cap, count, &done);
+        if (count < 0) break;
+    }
+    if (count > 0) {
+        (*env)->SetByteArrayRegion(env, out, 0, count * LINK_RECORD_SIZE, (jbyte *)records);
+    }
+out:
+    free(buf);
+    free(records);
+    close(sock);
+    return count;
+}
+
+#define PSI_MAX_EVENTS 64
+
+JNIEXPORT jint JNICALL Java_com_internal_kpodmetrics_bpf_BpfBridge_nativePsiEpollCreate(
+    JNIEnv *env, jobject self) {
+    (void)env; (void)self;
+    int fd = epoll_create1(EPOLL_CLOEXEC);
+    return fd < 0 ? -errno : fd;
+}
+
+/*
+ * Opens a cgroup v2 pressure file (cpu.pressure, memory.pressure, io.pressure),
+ * arms the PSI trigger in it, e.g. "some 150000 1000000" (150ms of stall within
+ * any 1s window), and adds it to epollFd for EPOLLPRI. Returns the trigger fd,
+ * which disarms the trigger when closed, or -errno.
+ */
+JNIEXPORT jint JNICALL Java_com_internal_kpodmetrics_bpf_BpfBridge_nativePsiTriggerAdd(
+    JNIEnv *env, jobject self, jint epollFd, jstring path, jstring trigger) {
+    (void)self;
+    const char *p = (*env)->GetStringUTFChars(env, path, NULL);
+    if (!p) return -ENOMEM;
+    int fd = open(p, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    int err = errno;
+    (*env)->ReleaseStringUTFChars(env, path, p);
+    if (fd < 0) return -err;
+
+    const char *t = (*env)->GetStringUTFChars(env, trigger, NULL);
+    if (!t) {
+        close(fd);
+        return -ENOMEM;
+    }
+    ssize_t written = write(fd, t, strlen(t) + 1);
+    err = errno;
+    (*env)->ReleaseStringUTFChars(env, trigger, t);
+    if (written < 0) {
+        close(fd);
+        return -err;
+    }
+
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLPRI;
+    ev.data.fd = fd;
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        err = errno;
+        close(fd);
+        return -err;
+    }
+    return fd;
+}
+
+/*
+ * Waits up to timeoutMs for PSI trigger events on epollFd. Fills out with
+ * [fd, revents] pairs and returns the pair count, 0 on timeout or EINTR, or
+ * -errno. EPOLLPRI means the threshold was crossed; EPOLLERR that the cgroup
+ * is gone.
+ */
+JNIEXPORT jint JNICALL Java_com_internal_kpodmetrics_bpf_BpfBridge_nativePsiWait(
+    JNIEnv *env, jobject self, jint epollFd, jintArray out, jint timeoutMs) {
+    (void)self;
+    int max = (*env)->GetArrayLength(env, out) / 2;
+    if (max <= 0) return -EINVAL;
+    if (max > PSI_MAX_EVENTS) max = PSI_MAX_EVENTS;
+
+    struct epoll_event events[PSI_MAX_EVENTS];
+    int n = epoll_wait(epollFd, events, max, timeoutMs);
+    if (n < 0) return errno == EINTR ? 0 : -errno;
+
+    jint pairs[PSI_MAX_EVENTS * 2];
+    for (int i = 0; i < n; i++) {
+        pairs[i * 2] = events[i].data.fd;
+        pairs[i * 2 + 1] = (jint)events[i].events;
+    }
+    if (n > 0) (*env)->SetIntArrayRegion(env, out, 0, n * 2, pairs);
+    return n;
+}
+
+/*
+ * Attaches the cgroup iterator program progName of the object to the cgroup
+ * directory at cgroupPath, walking it and its descendants in pre-order. The
+ * link is kept with the object. Returns the link fd, or -errno (-ENOENT if the
+ * object has no such program).
+ */
+JNIEXPORT jint JNICALL Java_com_internal_kpodmetrics_bpf_BpfBridge_nativeIterAttachCgroup(
+    JNIEnv *env, jobject self, jlong objPtr, jstring progName, jstring cgroupPath) {
+    (void)self;
+    if (objPtr == 0) return -EINVAL;
+    struct bpf_obj_wrapper *wrapper = (struct bpf_obj_wrapper *)(uintptr_t)objPtr;
+    if (wrapper->link_count >= MAX_BPF_LINKS) return -E2BIG;
+
+    const char *name = (*env)->GetStringUTFChars(env, progName, NULL);
+    if (!name) return -ENOMEM;
+    struct bpf_program *prog = bpf_object__find_program_by_name(wrapper->obj, name);
+    (*env)->ReleaseStringUTFChars(env, progName, name);
+    if (!prog) return -ENOENT;
+
+    const char *path = (*env)->GetStringUTFChars(env, cgroupPath, NULL);
+    if (!path) return -ENOMEM;
+    int cg_fd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    int err = errno;
+    (*env)->ReleaseStringUTFChars(env, cgroupPath, path);
+    if (cg_fd < 0) return -err;
+
+    union bpf_iter_link_info linfo;
+    memset(&linfo, 0, sizeof(linfo));
+    linfo.cgroup.cgroup_fd = (__u32)cg_fd;
+    linfo.cgroup.order = BPF_CGROUP_ITER_DESCENDANTS_PRE;
+    LIBBPF_OPTS(bpf_iter_attach_opts, opts,
+        .link_info = &linfo,
+        .link_info_len = sizeof(linfo));
+    struct bpf_link *link = bpf_program__attach_iter(prog, &opts);
+    err = errno;
+    /* The link holds its own reference to the cgroup */
+    close(cg_fd);
+    if (!link) return -err;
+    wrapper->links[wrapper->link_count++] = link;
+    return bpf_link__fd(link);
+}
+
+/*
+ * Runs one pass of the iterator behind linkFd and copies its output into out.
+ * Returns the byte count, -ENOSPC if out is too small, or -errno.
+ */
+JNIEXPORT jint JNICALL Java_com_internal_kpodmetrics_bpf_BpfBridge_nativeIterRead(
+    JNIEnv *env, jobject self, jint linkFd, jbyteArray out) {
+    (void)self;
+    jsize cap = (*env)->GetArrayLength(env, out);
+    int iter_fd = bpf_iter_create(linkFd);
+    if (iter_fd < 0) return -errno;
+
+    uint8_t *buf = malloc((size_t)cap + 1);
+    jint total = 0;
+    if (!buf) {
+        total = -ENOMEM;
+        goto out;
+    }
+    for (;;) {
+        /* One spare byte tells a full buffer from a truncated pass */
+        ssize_t n = read(iter_fd, buf + total, (size_t)(cap + 1 - total));
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            total = -errno;
+            break;
+        }
+        if (n == 0) break;
+        total += (jint)n;
+        if (total > cap) {
+            total = -ENOSPC;
+            break;
+        }
+    }
+    if (total > 0) {
+        (*env)->SetByteArrayRegion(env, out, 0, total, (jbyte *)buf);
+    }
+out:
+    free(buf);
+    close(iter_fd);
+    return total;
+}
+
+JNIEXPORT jint JNICALL Java_com_internal_kpodmetrics_bpf_BpfBridge_nativePageSize(
+    JNIEnv *env, jobject self) {
+    (void)env; (void)self;
+    return (jint)sysconf(_SC_PAGESIZE);
+}
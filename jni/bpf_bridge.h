@@ -33,6 +33,14 @@ JNIEXPORT jint JNICALL Java_com_internal_kpodmetrics_bpf_BpfBridge_nativePerfEve
     JNIEnv *env, jobject self, jlong objPtr, jstring progName, jint sampleFreq);
 JNIEXPORT jlongArray JNICALL Java_com_internal_kpodmetrics_bpf_BpfBridge_nativeGetProgStats(
     JNIEnv *env, jobject self, jlong objPtr);
+JNIEXPORT jobjectArray JNICALL Java_com_internal_kpodmetrics_bpf_BpfBridge_nativeGetProgramNames(
+    JNIEnv *env, jobject self, jlong objPtr);
+JNIEXPORT jlongArray JNICALL Java_com_internal_kpodmetrics_bpf_BpfBridge_nativeGetProgramStats(
+    JNIEnv *env, jobject self, jlong objPtr);
+JNIEXPORT jint JNICALL Java_com_internal_kpodmetrics_bpf_BpfBridge_nativeEnableStats(
+    JNIEnv *env, jobject self);
+JNIEXPORT void JNICALL Java_com_internal_kpodmetrics_bpf_BpfBridge_nativeCloseFd(
+    JNIEnv *env, jobject self, jint fd);
 JNIEXPORT void JNICALL Java_com_internal_kpodmetrics_bpf_BpfBridge_nativeMapUpdate(
     JNIEnv *env, jobject self, jint mapFd, jbyteArray key, jbyteArray value, jlong flags);
 JNIEXPORT jlong JNICALL Java_com_internal_kpodmetrics_bpf_BpfBridge_nativeRingBufNew(
@@ -41,6 +49,20 @@ JNIEXPORT jbyteArray JNICALL Java_com_internal_kpodmetrics_bpf_BpfBridge_nativeR
     JNIEnv *env, jobject self, jlong rbPtr, jint maxEvents, jint eventSize);
 JNIEXPORT void JNICALL Java_com_internal_kpodmetrics_bpf_BpfBridge_nativeRingBufFree(
     JNIEnv *env, jobject self, jlong rbPtr);
+JNIEXPORT jint JNICALL Java_com_internal_kpodmetrics_bpf_BpfBridge_nativeNetnsLinkStats(
+    JNIEnv *env, jobject self, jstring nsPath, jbyteArray out);
+JNIEXPORT jint JNICALL Java_com_internal_kpodmetrics_bpf_BpfBridge_nativePsiEpollCreate(
+    JNIEnv *env, jobject self);
+JNIEXPORT jint JNICALL Java_com_internal_kpodmetrics_bpf_BpfBridge_nativePsiTriggerAdd(
+    JNIEnv *env, jobject self, jint epollFd, jstring path, jstring trigger);
+JNIEXPORT jint JNICALL Java_com_internal_kpodmetrics_bpf_BpfBridge_nativePsiWait(
+    JNIEnv *env, jobject self, jint epollFd, jintArray out, jint timeoutMs);
+JNIEXPORT jint JNICALL Java_com_internal_kpodmetrics_bpf_BpfBridge_nativeIterAttachCgroup(
+    JNIEnv *env, jobject self, jlong objPtr, jstring progName, jstring cgroupPath);
+JNIEXPORT jint JNICALL Java_com_internal_kpodmetrics_bpf_BpfBridge_nativeIterRead(
+    JNIEnv *env, jobject self, jint linkFd, jbyteArray out);
+JNIEXPORT jint JNICALL Java_com_internal_kpodmetrics_bpf_BpfBridge_nativePageSize(
+    JNIEnv *env, jobject self);
 
 #ifdef __cplusplus
 }
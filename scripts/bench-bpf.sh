@@ -0,0 +1,42 @@
+#!/usr/bin/env bash
+# bench-bpf.sh — Build the generated BPF objects and run kpod_bpf_bench on them
+#
+# Usage:
+#   scripts/bench-bpf.sh                      # per-program cost + scaling, table output
+#   scripts/bench-bpf.sh -V -j > insns.jsonl  # verifier instruction counts only, JSON lines
+#   scripts/bench-bpf.sh -n 50000 -t 8        # any kpod_bpf_bench flags are passed through
+#
+# Environment:
+#   EBPF_DSL_PATH  kotlin-ebpf-dsl checkout for generateBpf (default ../kotlin-ebpf-dsl)
+#   OUT_DIR        where objects and the benchmark binary go (default build/bpf-bench)
+#   BUILD_ONLY=1   build objects and the benchmark, do not run it
+#
+# Requires: JDK 21, clang, libbpf-dev, libelf-dev, cmake; root/CAP_BPF to run.
+
+set -euo pipefail
+
+ROOT="$(cd "$(dirname "$0")/.." && pwd)"
+OUT_DIR="${OUT_DIR:-$ROOT/build/bpf-bench}"
+EBPF_DSL_PATH="${EBPF_DSL_PATH:-$ROOT/../kotlin-ebpf-dsl}"
+
+# Same -D__TARGET_ARCH_<arch> values as the Dockerfile
+case "$(uname -m)" in
+    aarch64) BPF_ARCH=arm64 ;;
+    *) BPF_ARCH="$(uname -m)" ;;
+esac
+
+(cd "$ROOT" && ./gradlew -q -PebpfDslPath="$EBPF_DSL_PATH" generateBpf) >&2
+
+mkdir -p "$OUT_DIR/obj"
+for f in "$ROOT"/build/generated/bpf/*.bpf.c; do
+    name=$(basename "$f" .bpf.c)
+    clang -O2 -g -target bpf -D__TARGET_ARCH_${BPF_ARCH} \
+        -I"$ROOT/bpf" -I"$ROOT/build/generated/bpf" -c "$f" -o "$OUT_DIR/obj/${name}.bpf.o" >&2 || \
+        echo "WARNING: compile failed for ${name}" >&2
+done
+
+cmake -S "$ROOT/jni" -B "$OUT_DIR/cmake" -DKPOD_BPF_BENCH=ON -DCMAKE_BUILD_TYPE=Release >&2
+cmake --build "$OUT_DIR/cmake" --target kpod_bpf_bench >&2
+
+[ "${BUILD_ONLY:-0}" = 1 ] && exit 0
+exec "$OUT_DIR/cmake/kpod_bpf_bench" "$@" "$OUT_DIR"/obj/*.bpf.o
@@ -20,6 +20,8 @@ val cachestatProgram = ebpf("cachestat") {
     license("GPL")
     targetKernel("5.3")
 
+    preamble(COMMON_PREAMBLE + "\n\nDEFINE_STATS_MAP(cache_stats)")
+
     // Emit the conditional dirtied probe as raw C after struct/map definitions
     postamble("""
 #ifdef LEGACY_IOVEC
@@ -33,12 +35,14 @@ int kprobe_folio_account_dirtied(struct pt_regs *ctx)
     __u64 cgroup_id = bpf_get_current_cgroup_id();
     struct cgroup_key key = { .cgroup_id = cgroup_id };
     struct cache_stats *e = bpf_map_lookup_elem(&cache_stats, &key);
-    if (e) {
-        __sync_fetch_and_add(&e->dirtied, 1ULL);
-    } else {
+    if (!e) {
         struct cache_stats v = { .dirtied = 1ULL };
-        bpf_map_update_elem(&cache_stats, &key, &v, 1);
+        // Another CPU inserted the key first: add to its entry instead
+        if (map_insert(&cache_stats, &cache_stats_stats, &key, &v) != -EEXIST) return 0;
+        e = bpf_map_lookup_elem(&cache_stats, &key);
+        if (!e) return 0;
     }
+    __sync_fetch_and_add(&e->dirtied, 1ULL);
     return 0;
 }
 """.trimIndent())
@@ -53,7 +57,7 @@ int kprobe_folio_account_dirtied(struct pt_regs *ctx)
             e[CacheStats.accesses].atomicAdd(literal(1u, BpfScalar.U64))
         }.elseThen {
             val newVal = stackVar(CacheStats) { it[CacheStats.accesses] = literal(1u, BpfScalar.U64) }
-            cacheStats.update(key, newVal, flags = BPF_NOEXIST)
+            declareVar("_ins", raw(mapInsert("cache_stats", key.expr, newVal.expr), BpfScalar.S64))
         }
         returnValue(literal(0, BpfScalar.S32))
     }
@@ -66,7 +70,7 @@ int kprobe_folio_account_dirtied(struct pt_regs *ctx)
             e[CacheStats.additions].atomicAdd(literal(1u, BpfScalar.U64))
         }.elseThen {
             val newVal = stackVar(CacheStats) { it[CacheStats.additions] = literal(1u, BpfScalar.U64) }
-            cacheStats.update(key, newVal, flags = BPF_NOEXIST)
+            declareVar("_ins", raw(mapInsert("cache_stats", key.expr, newVal.expr), BpfScalar.S64))
         }
         returnValue(literal(0, BpfScalar.S32))
     }
@@ -81,7 +85,7 @@ int kprobe_folio_account_dirtied(struct pt_regs *ctx)
             e[CacheStats.bufDirtied].atomicAdd(literal(1u, BpfScalar.U64))
         }.elseThen {
             val newVal = stackVar(CacheStats) { it[CacheStats.bufDirtied] = literal(1u, BpfScalar.U64) }
-            cacheStats.update(key, newVal, flags = BPF_NOEXIST)
+            declareVar("_ins", raw(mapInsert("cache_stats", key.expr, newVal.expr), BpfScalar.S64))
         }
         returnValue(literal(0, BpfScalar.S32))
     }
@@ -19,10 +19,9 @@ import dev.ebpf.dsl.types.BpfScalar
  *   - tp/sched/sched_wakeup:  records wakeup timestamp per PID
  *   - tp/sched/sched_switch:  counts context switches and computes run-queue latency histogram
  *
- * Note: Stats tracking (STATS_INC/STATS_DEC) in the else branches is omitted from
- * the DSL logic. The DEFINE_STATS_MAP macros are included in the preamble so the
- * stats maps are still created (for compatibility), but are not written to by the
- * generated program body.
+ * New keys are inserted through map_insert() (see COMMON_PREAMBLE), which counts
+ * successful and failed inserts in each map's DEFINE_STATS_MAP companion for
+ * BpfMapStatsCollector's lost-update and eviction accounting.
  */
 val cpuSchedProgram = ebpf("cpu_sched") {
     license("GPL")
@@ -68,7 +67,7 @@ val cpuSchedProgram = ebpf("cpu_sched") {
             val newVal = stackVar(CounterValue) {
                 it[CounterValue.count] = literal(1u, BpfScalar.U64)
             }
-            ctxSwitches.update(ckey, newVal, flags = BPF_NOEXIST)
+            declareVar("_ins_ctx", raw(mapInsert("ctx_switches", ckey.expr, newVal.expr), BpfScalar.S64))
         }
 
         // ── Part 2: Look up wakeup timestamp for next_pid ───────────────
@@ -104,7 +103,7 @@ val cpuSchedProgram = ebpf("cpu_sched") {
                     "_arr_set",
                     raw("($newHvalName.slots[slot2] = 1ULL, (__s32)0)", BpfScalar.S32)
                 )
-                runqLatency.update(hkey, newHval, flags = BPF_NOEXIST)
+                declareVar("_ins_runq", raw(mapInsert("runq_latency", hkey.expr, newHval.expr), BpfScalar.S64))
             }
         }
 
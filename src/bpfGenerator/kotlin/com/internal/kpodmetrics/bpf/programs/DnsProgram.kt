@@ -83,15 +83,17 @@ static __always_inline int read_u16(void *dst, void *src) {
 // Helper functions that reference struct types must go in the postamble
 // (emitted after struct/map definitions, before programs).
 private val DNS_POSTAMBLE = """
-static __always_inline void inc_counter(void *map, void *key)
+static __always_inline void inc_counter(void *map, void *stats, void *key)
 {
     struct counter_value *val = bpf_map_lookup_elem(map, key);
-    if (val) {
-        __sync_fetch_and_add(&val->count, 1);
-    } else {
+    if (!val) {
         struct counter_value one = { .count = 1 };
-        bpf_map_update_elem(map, key, &one, BPF_NOEXIST);
+        // Another CPU inserted the key first: add to its entry instead
+        if (map_insert(map, stats, key, &one) != -EEXIST) return;
+        val = bpf_map_lookup_elem(map, key);
+        if (!val) return;
     }
+    __sync_fetch_and_add(&val->count, 1);
 }
 """.trimIndent()
 
@@ -189,7 +191,7 @@ val dnsProgram = ebpf("dns") {
     __u16 _qt = 0;
     if (pkt_off + 1 < MAX_DNS_PACKET)
         _qt = ((__u16)((__u8)__buf_0[pkt_off]) << 8) | ((__u8)__buf_0[pkt_off + 1]);
-    inc_counter(&dns_domains, &dk);
+    inc_counter(&dns_domains, &dns_domains_stats, &dk);
     _qt;
 })""", BpfScalar.U16))
 
@@ -201,14 +203,14 @@ val dnsProgram = ebpf("dns") {
         val tsVal = stackVar(TsValue) {
             it[TsValue.ts] = ktimeGetNs()
         }
-        dnsInflight.update(txidKey, tsVal, flags = BPF_NOEXIST)
+        declareVar("_ins_inflight", raw(mapInsert("dns_inflight", txidKey.expr, tsVal.expr), BpfScalar.S64))
 
         // Increment dns_requests
         val reqKey = stackVar(DnsReqKey) {
             it[DnsReqKey.cgroupId] = cgroupId
             it[DnsReqKey.qtype] = raw("qtype", BpfScalar.U16)
         }
-        declareVar("_inc", raw("(inc_counter(&dns_requests, &${(reqKey.expr as BpfExpr.VarRef).variable.name}), (__s32)0)", BpfScalar.S32))
+        declareVar("_inc", raw("(inc_counter(&dns_requests, &dns_requests_stats, &${(reqKey.expr as BpfExpr.VarRef).variable.name}), (__s32)0)", BpfScalar.S32))
 
         returnValue(literal(0, BpfScalar.S32))
     }
@@ -298,10 +300,10 @@ val dnsProgram = ebpf("dns") {
                         it[HistValue.sumNs] = latencyNs
                     }
                     declareVar("_arr", raw("(${(newHist.expr as BpfExpr.VarRef).variable.name}.slots[slot2] = 1ULL, (__s32)0)", BpfScalar.S32))
-                    dnsLatency.update(hkey, newHist, flags = BPF_NOEXIST)
+                    declareVar("_ins_latency", raw(mapInsert("dns_latency", hkey.expr, newHist.expr), BpfScalar.S64))
                 }
 
-                dnsInflight.delete(txidKey)
+                declareVar("_del", raw(mapDelete("dns_inflight", txidKey.expr), BpfScalar.S64))
             }
 
             // Error counter
@@ -311,7 +313,7 @@ val dnsProgram = ebpf("dns") {
                     it[DnsErrKey.cgroupId] = cgroupId
                     it[DnsErrKey.rcode] = cast(rcode, BpfScalar.U8)
                 }
-                declareVar("_inc_e", raw("(inc_counter(&dns_errors, &${(errKey.expr as BpfExpr.VarRef).variable.name}), (__s32)0)", BpfScalar.S32))
+                declareVar("_inc_e", raw("(inc_counter(&dns_errors, &dns_errors_stats, &${(errKey.expr as BpfExpr.VarRef).variable.name}), (__s32)0)", BpfScalar.S32))
             }
         }
 
@@ -0,0 +1,141 @@
+package com.internal.kpodmetrics.bpf.programs
+
+import java.io.File
+
+/**
+ * Emits allocation-free flyweight views (subclasses of `bpf.StructView`) for every
+ * struct a program defines, including the C-only programs that get no MapReader.
+ *
+ * Layouts are taken from the program's generated C, so offsets are exactly what
+ * the kernel side compiles against: each BpfStruct is emitted there as a plain
+ * `struct name { __uN field; ... };`. Structs containing anything other than
+ * fixed-width scalars, scalar arrays and `char` arrays (kernel types, pointers,
+ * unions) get no view. Generation fails if such a struct is a map key or value,
+ * and warns about the others (tracepoint contexts, ring buffer records).
+ */
+data class CField(val name: String, val elemSize: Int, val signed: Boolean, val count: Int, val offset: Int) {
+    val isArray: Boolean get() = count > 1
+}
+
+data class CStruct(val name: String, val fields: List<CField>, val size: Int)
+
+private val STRUCT_RE = Regex("""struct\s+(\w+)\s*\{([^{}]*)\}\s*;""")
+private val STRUCT_DEF_RE = Regex("""\bstruct\s+(\w+)\s*\{""")
+private val MAP_STRUCT_RE = Regex("""__type\(\s*(?:key|value)\s*,\s*struct\s+(\w+)\s*\)""")
+private val FIELD_RE = Regex("""^(__[us](?:8|16|32|64)|char)\s+(\w+)\s*(?:\[\s*(\d+)\s*])?$""")
+
+fun parseCStructs(c: String): List<CStruct> {
+    val seen = LinkedHashMap<String, CStruct>()
+    for (match in STRUCT_RE.findAll(c)) {
+        val name = match.groupValues[1]
+        if (name in seen) continue
+        val body = match.groupValues[2].replace(Regex("""/\*.*?\*/|//[^\n]*"""), "")
+        val decls = body.split(';').map { it.trim() }.filter { it.isNotEmpty() }
+        if (decls.isEmpty()) continue
+
+        val fields = mutableListOf<CField>()
+        var offset = 0
+        var maxAlign = 1
+        var supported = true
+        for (decl in decls) {
+            val f = FIELD_RE.matchEntire(decl.replace(Regex("""\s+"""), " "))
+            if (f == null) {
+                supported = false
+                break
+            }
+            val type = f.groupValues[1]
+            // char arrays (comm, names) are byte arrays
+            val elemSize = if (type == "char") 1 else type.substring(3).toInt() / 8
+            val count = f.groupValues[3].ifEmpty { "1" }.toInt()
+            offset = align(offset, elemSize)
+            maxAlign = maxOf(maxAlign, elemSize)
+            fields += CField(f.groupValues[2], elemSize, type[2] == 's', count, offset)
+            offset += elemSize * count
+        }
+        if (supported) seen[name] = CStruct(name, fields, align(offset, maxAlign))
+    }
+    return seen.values.toList()
+}
+
+/** Structs defined in [c] that [parseCStructs] cannot lay out. */
+fun unparsedCStructs(c: String): List<String> {
+    val parsed = parseCStructs(c).mapTo(HashSet()) { it.name }
+    return STRUCT_DEF_RE.findAll(c).map { it.groupValues[1] }.distinct().filter { it !in parsed }.toList()
+}
+
+/** Names of the structs used as a map key or value in [c]. */
+fun mapStructNames(c: String): Set<String> =
+    MAP_STRUCT_RE.findAll(c).mapTo(LinkedHashSet()) { it.groupValues[1] }
+
+private fun align(offset: Int, alignment: Int): Int = (offset + alignment - 1) / alignment * alignment
+
+private fun camel(snake: String, upperFirst: Boolean): String {
+    val parts = snake.split('_').filter { it.isNotEmpty() }
+    val joined = parts.joinToString("") { it.replaceFirstChar(Char::uppercaseChar) }
+    return if (upperFirst) joined else joined.replaceFirstChar(Char::lowercaseChar)
+}
+
+private fun isPadding(name: String): Boolean = name.trimStart('_').startsWith("pad")
+
+private fun reader(field: CField): Pair<String, String> = when (field.elemSize) {
+    1 -> (if (field.signed) "s8" else "u8") to "Int"
+    2 -> (if (field.signed) "s16" else "u16") to "Int"
+    4 -> (if (field.signed) "s32" else "u32") to (if (field.signed) "Int" else "Long")
+    else -> (if (field.signed) "s64" else "u64") to "Long"
+}
+
+fun generateViews(programName: String, structs: List<CStruct>, kotlinPackage: String): String {
+    val objectName = camel(programName, upperFirst = true) + "Views"
+    val sb = StringBuilder()
+    sb.appendLine("// Generated by GenerateBpf from the $programName program's C structs. Do not edit.")
+    sb.appendLine("package $kotlinPackage")
+    sb.appendLine()
+    sb.appendLine("import com.internal.kpodmetrics.bpf.StructView")
+    sb.appendLine()
+    sb.appendLine("object $objectName {")
+    for ((i, struct) in structs.withIndex()) {
+        if (i > 0) sb.appendLine()
+        val className = camel(struct.name, upperFirst = true) + "View"
+        sb.appendLine("    /** Flyweight over `struct ${struct.name}` (${struct.size} bytes). */")
+        sb.appendLine("    class $className : StructView<$className>() {")
+        sb.appendLine("        override val size: Int get() = SIZE")
+        for (field in struct.fields) {
+            if (isPadding(field.name)) continue
+            val prop = camel(field.name, upperFirst = false)
+            val (fn, type) = reader(field)
+            if (field.isArray) {
+                sb.appendLine("        fun $prop(index: Int): $type = $fn(${field.offset} + index * ${field.elemSize})")
+            } else {
+                sb.appendLine("        val $prop: $type get() = $fn(${field.offset})")
+            }
+        }
+        sb.appendLine()
+        sb.appendLine("        companion object {")
+        sb.appendLine("            const val SIZE = ${struct.size}")
+        for (field in struct.fields) {
+            if (isPadding(field.name)) continue
+            val constName = field.name.trimStart('_').uppercase()
+            sb.appendLine("            const val ${constName}_OFFSET = ${field.offset}")
+            if (field.isArray) sb.appendLine("            const val ${constName}_LENGTH = ${field.count}")
+        }
+        sb.appendLine("        }")
+        sb.appendLine("    }")
+    }
+    sb.appendLine("}")
+    return sb.toString()
+}
+
+fun writeViews(programName: String, c: String, kotlinDir: String, kotlinPackage: String) {
+    val skipped = unparsedCStructs(c)
+    val skippedMapStructs = skipped.filter { it in mapStructNames(c) }
+    if (skippedMapStructs.isNotEmpty()) {
+        error("$programName: cannot lay out map struct(s) ${skippedMapStructs.joinToString()} for a view")
+    }
+    if (skipped.isNotEmpty()) println("  WARNING: $programName: no view for struct(s) ${skipped.joinToString()}")
+    val structs = parseCStructs(c)
+    if (structs.isEmpty()) return
+    val objectName = camel(programName, upperFirst = true) + "Views"
+    val file = File(kotlinDir, kotlinPackage.replace('.', '/') + "/$objectName.kt")
+    file.parentFile.mkdirs()
+    file.writeText(generateViews(programName, structs, kotlinPackage))
+}
@@ -15,7 +15,9 @@ fun main() {
         tcpPeerProgram, redisProgram, mysqlProgram, kafkaProgram, mongoProgram,
         // BCC-style tools (cachestat, tcpdrop overridden for kernel compat)
         biolatency(), cachestatProgram, tcpdropProgram,
-        hardirqs(), softirqs(), execsnoop()
+        hardirqs(), softirqs(), execsnoop(),
+        // cgroup iterator for bulk cgroup stats
+        cgroupStatsProgram
     )
 
     // Validate all programs
@@ -30,24 +32,34 @@ fun main() {
     }
 
     // Emit C + Kotlin
+    val kotlinDir = "build/generated/kotlin"
+    val kotlinPackage = "com.internal.kpodmetrics.bpf.generated"
     val config = OutputConfig(
         cDir = "build/generated/bpf",
-        kotlinDir = "build/generated/kotlin",
-        kotlinPackage = "com.internal.kpodmetrics.bpf.generated",
+        kotlinDir = kotlinDir,
+        kotlinPackage = kotlinPackage,
         bridgeImport = "com.internal.kpodmetrics.bpf.BpfBridge"
     )
     // DNS and HTTP programs use raw() heavily; their generated Kotlin MapReaders
     // have type mismatches (shared value types across maps with different key shapes).
     // The existing collectors use the raw JNI bridge, so we only need the C output.
-    val cOnlyPrograms = setOf("dns", "http", "cpu_profile", "tcp_peer", "redis", "mysql", "kafka", "mongo")
+    val cOnlyPrograms = setOf("dns", "http", "cpu_profile", "tcp_peer", "redis", "mysql", "kafka", "mongo", "cgroup_stats")
+    // L7 programs whose collectors are driven by generated MapMetricSpecs
+    val metricSchemas = listOf(
+        httpMetricSchema, redisMetricSchema, mysqlMetricSchema, kafkaMetricSchema, mongoMetricSchema
+    ).associateBy { it.program }
     programs.forEach { prog ->
+        val c = prog.generateC()
         if (prog.name in cOnlyPrograms) {
             val cFile = File(config.cDir, "${prog.name}.bpf.c")
             cFile.parentFile.mkdirs()
-            cFile.writeText(prog.generateC())
+            cFile.writeText(c)
         } else {
             prog.emit(config)
         }
+        // Flyweight views for every program, C-only ones included
+        writeViews(prog.name, c, kotlinDir, kotlinPackage)
+        metricSchemas[prog.name]?.let { writeMetricSchema(it, c, kotlinDir, kotlinPackage) }
     }
 
     println("Generated ${programs.size} BPF programs")
@@ -181,12 +181,12 @@ static __always_inline void parse_url_path(const __u8 *buf, __u32 buf_len, __u8
 """.trimIndent()
 
 private val HTTP_POSTAMBLE = """
-static __always_inline void update_hist(void *map, void *key, __u64 val_ns)
+static __always_inline void update_hist(void *map, void *stats, void *key, __u64 val_ns)
 {
     struct hist_value *hist = bpf_map_lookup_elem(map, key);
     if (!hist) {
         struct hist_value new_hist = {};
-        bpf_map_update_elem(map, key, &new_hist, BPF_NOEXIST);
+        map_insert(map, stats, key, &new_hist);
         hist = bpf_map_lookup_elem(map, key);
         if (!hist) return;
     }
@@ -209,15 +209,17 @@ static __always_inline int check_http_port(struct sock *sk)
     return 0;
 }
 
-static __always_inline void inc_http_event(void *map, void *key)
+static __always_inline void inc_http_event(void *map, void *stats, void *key)
 {
     struct http_event_val *ev = bpf_map_lookup_elem(map, key);
-    if (ev) {
-        __sync_fetch_and_add(&ev->count, 1);
-    } else {
+    if (!ev) {
         struct http_event_val one = { .count = 1 };
-        bpf_map_update_elem(map, key, &one, BPF_NOEXIST);
+        // Another CPU inserted the key first: add to its entry instead
+        if (map_insert(map, stats, key, &one) != -EEXIST) return;
+        ev = bpf_map_lookup_elem(map, key);
+        if (!ev) return;
     }
+    __sync_fetch_and_add(&ev->count, 1);
 }
 
 static __always_inline void maybe_emit_span(
@@ -313,13 +315,13 @@ val httpProgram = ebpf("http") {
             .direction = direction,
             .status_code = 0,
         };
-        inc_http_event(&http_events, &ev_key);
+        inc_http_event(&http_events, &http_events_stats, &ev_key);
         struct http_inflight_val inf_val = {
             .ts = bpf_ktime_get_ns(),
             .method = method,
             .direction = direction,
         };
-        bpf_map_update_elem(&http_inflight, &inf_key, &inf_val, BPF_NOEXIST);
+        map_insert(&http_inflight, &http_inflight_stats, &inf_key, &inf_val);
         return 0;
     }
 
@@ -339,14 +341,14 @@ val httpProgram = ebpf("http") {
         .direction = req_dir,
         .status_code = status,
     };
-    inc_http_event(&http_events, &ev_key);
+    inc_http_event(&http_events, &http_events_stats, &ev_key);
 
     struct http_latency_key lat_key = {
         .cgroup_id = cgroup_id,
         .method = req_method,
         .direction = req_dir,
     };
-    update_hist(&http_latency, &lat_key, latency_ns);
+    update_hist(&http_latency, &http_latency_stats, &lat_key, latency_ns);
     {
         __u32 dst_ip = 0;
         bpf_probe_read(&dst_ip, sizeof(dst_ip), &sk->__sk_common.skc_daddr);
@@ -358,7 +360,7 @@ val httpProgram = ebpf("http") {
             PROTO_HTTP, req_method, status, req_dir,
             buf, to_read);
     }
-    bpf_map_delete_elem(&http_inflight, &inf_key);
+    map_delete(&http_inflight, &http_inflight_stats, &inf_key);
     (__s32)0;
 })""", BpfScalar.S32))
         returnValue(literal(0, BpfScalar.S32))
@@ -430,13 +432,13 @@ val httpProgram = ebpf("http") {
             .direction = direction,
             .status_code = 0,
         };
-        inc_http_event(&http_events, &ev_key);
+        inc_http_event(&http_events, &http_events_stats, &ev_key);
         struct http_inflight_val inf_val = {
             .ts = bpf_ktime_get_ns(),
             .method = method,
             .direction = direction,
         };
-        bpf_map_update_elem(&http_inflight, &inf_key, &inf_val, BPF_NOEXIST);
+        map_insert(&http_inflight, &http_inflight_stats, &inf_key, &inf_val);
         return 0;
     }
 
@@ -456,14 +458,14 @@ val httpProgram = ebpf("http") {
         .direction = req_dir,
         .status_code = status,
     };
-    inc_http_event(&http_events, &ev_key);
+    inc_http_event(&http_events, &http_events_stats, &ev_key);
 
     struct http_latency_key lat_key = {
         .cgroup_id = cgroup_id,
         .method = req_method,
         .direction = req_dir,
     };
-    update_hist(&http_latency, &lat_key, latency_ns);
+    update_hist(&http_latency, &http_latency_stats, &lat_key, latency_ns);
     {
         __u32 dst_ip = 0;
         bpf_probe_read(&dst_ip, sizeof(dst_ip), &sk->__sk_common.skc_daddr);
@@ -473,9 +475,26 @@ val httpProgram = ebpf("http") {
             PROTO_HTTP, req_method, status, req_dir,
             buf, to_read);
     }
-    bpf_map_delete_elem(&http_inflight, &inf_key);
+    map_delete(&http_inflight, &http_inflight_stats, &inf_key);
     (__s32)0;
 })""", BpfScalar.S32))
         returnValue(literal(0, BpfScalar.S32))
     }
 }
+
+// ── HTTP metric schema ───────────────────────────────────────────────
+
+val httpMetricSchema = metricSchema("http") {
+    table("method", "UNKNOWN", "GET", "POST", "PUT", "DELETE", "PATCH", "HEAD")
+    table("direction", "outbound", "inbound", unknown = "unknown")
+
+    counter("kpod.http.requests", "http_events", key = "http_event_key", value = "http_event_val") {
+        label("method", table = "method")
+        label("status_code")
+        label("direction", table = "direction")
+    }
+    averageLatency("kpod.http.request.duration", "http_latency", key = "http_latency_key") {
+        label("method", table = "method")
+        label("direction", table = "direction")
+    }
+}
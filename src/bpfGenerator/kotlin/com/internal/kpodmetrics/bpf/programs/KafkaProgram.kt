@@ -237,12 +237,12 @@ static __always_inline void read_sock_addr(struct sock *sk, __u16 *dport, __u16
 """.trimIndent()
 
 private val KAFKA_POSTAMBLE = """
-static __always_inline void update_hist(void *map, void *key, __u64 val_ns)
+static __always_inline void update_hist(void *map, void *stats, void *key, __u64 val_ns)
 {
     struct hist_value *hist = bpf_map_lookup_elem(map, key);
     if (!hist) {
         struct hist_value new_hist = {};
-        bpf_map_update_elem(map, key, &new_hist, BPF_NOEXIST);
+        map_insert(map, stats, key, &new_hist);
         hist = bpf_map_lookup_elem(map, key);
         if (!hist) return;
     }
@@ -265,15 +265,17 @@ static __always_inline int check_kafka_port(struct sock *sk)
     return 0;
 }
 
-static __always_inline void inc_kafka_event(void *map, void *key)
+static __always_inline void inc_kafka_event(void *map, void *stats, void *key)
 {
     struct counter_value *ev = bpf_map_lookup_elem(map, key);
-    if (ev) {
-        __sync_fetch_and_add(&ev->count, 1);
-    } else {
+    if (!ev) {
         struct counter_value one = { .count = 1 };
-        bpf_map_update_elem(map, key, &one, BPF_NOEXIST);
+        // Another CPU inserted the key first: add to its entry instead
+        if (map_insert(map, stats, key, &one) != -EEXIST) return;
+        ev = bpf_map_lookup_elem(map, key);
+        if (!ev) return;
     }
+    __sync_fetch_and_add(&ev->count, 1);
 }
 
 static __always_inline void maybe_emit_span(
@@ -365,13 +367,13 @@ val kafkaProgram = ebpf("kafka") {
             .api_key = api_key,
             .direction = direction,
         };
-        inc_kafka_event(&kafka_events, &ev_key);
+        inc_kafka_event(&kafka_events, &kafka_events_stats, &ev_key);
         struct kafka_inflight_val inf_val = {
             .ts = bpf_ktime_get_ns(),
             .api_key = api_key,
             .direction = direction,
         };
-        bpf_map_update_elem(&kafka_inflight, &inf_key, &inf_val, BPF_NOEXIST);
+        map_insert(&kafka_inflight, &kafka_inflight_stats, &inf_key, &inf_val);
         return 0;
     }
 
@@ -389,12 +391,12 @@ val kafkaProgram = ebpf("kafka") {
             .api_key = req_api_key,
             .direction = req_dir,
         };
-        update_hist(&kafka_latency, &lat_key, latency_ns);
+        update_hist(&kafka_latency, &kafka_latency_stats, &lat_key, latency_ns);
 
         __u16 err_code = extract_kafka_error(buf, to_read, req_api_key);
         if (err_code != 0) {
             struct kafka_err_key ek = { .cgroup_id = cgroup_id, .err_code = err_code };
-            inc_kafka_event(&kafka_errors, &ek);
+            inc_kafka_event(&kafka_errors, &kafka_errors_stats, &ek);
         }
         {
             __u32 dst_ip = 0;
@@ -408,7 +410,7 @@ val kafkaProgram = ebpf("kafka") {
                 NULL, 0);
         }
 
-        bpf_map_delete_elem(&kafka_inflight, &inf_key);
+        map_delete(&kafka_inflight, &kafka_inflight_stats, &inf_key);
     }
     (__s32)0;
 })""", BpfScalar.S32))
@@ -475,13 +477,13 @@ val kafkaProgram = ebpf("kafka") {
             .api_key = api_key,
             .direction = direction,
         };
-        inc_kafka_event(&kafka_events, &ev_key);
+        inc_kafka_event(&kafka_events, &kafka_events_stats, &ev_key);
         struct kafka_inflight_val inf_val = {
             .ts = bpf_ktime_get_ns(),
             .api_key = api_key,
             .direction = direction,
         };
-        bpf_map_update_elem(&kafka_inflight, &inf_key, &inf_val, BPF_NOEXIST);
+        map_insert(&kafka_inflight, &kafka_inflight_stats, &inf_key, &inf_val);
         return 0;
     }
 
@@ -499,12 +501,12 @@ val kafkaProgram = ebpf("kafka") {
             .api_key = req_api_key,
             .direction = req_dir,
         };
-        update_hist(&kafka_latency, &lat_key, latency_ns);
+        update_hist(&kafka_latency, &kafka_latency_stats, &lat_key, latency_ns);
 
         __u16 err_code = extract_kafka_error(buf, to_read, req_api_key);
         if (err_code != 0) {
             struct kafka_err_key ek = { .cgroup_id = cgroup_id, .err_code = err_code };
-            inc_kafka_event(&kafka_errors, &ek);
+            inc_kafka_event(&kafka_errors, &kafka_errors_stats, &ek);
         }
         {
             __u32 dst_ip = 0;
@@ -518,10 +520,34 @@ val kafkaProgram = ebpf("kafka") {
                 NULL, 0);
         }
 
-        bpf_map_delete_elem(&kafka_inflight, &inf_key);
+        map_delete(&kafka_inflight, &kafka_inflight_stats, &inf_key);
     }
     (__s32)0;
 })""", BpfScalar.S32))
         returnValue(literal(0, BpfScalar.S32))
     }
 }
+
+// ── Kafka metric schema ──────────────────────────────────────────────
+
+val kafkaMetricSchema = metricSchema("kafka") {
+    table("api_key", mapOf(
+        0 to "Produce", 1 to "Fetch", 2 to "ListOffsets", 3 to "Metadata",
+        8 to "OffsetCommit", 9 to "OffsetFetch", 10 to "FindCoordinator",
+        11 to "JoinGroup", 12 to "Heartbeat", 13 to "LeaveGroup", 14 to "SyncGroup",
+        18 to "ApiVersions", 19 to "CreateTopics", 20 to "DeleteTopics", 0xFFFF to "Other"
+    ), unknown = "Unknown(%d)")
+    table("direction", "client", "server", unknown = "unknown")
+
+    counter("kpod.kafka.requests", "kafka_events", key = "kafka_event_key", emitUnresolved = true) {
+        label("api_key", table = "api_key")
+        label("direction", table = "direction")
+    }
+    averageLatency("kpod.kafka.request.duration", "kafka_latency", key = "kafka_latency_key") {
+        label("api_key", table = "api_key")
+        label("direction", table = "direction")
+    }
+    counter("kpod.kafka.errors", "kafka_errors", key = "kafka_err_key") {
+        label("error_code", field = "err_code")
+    }
+}
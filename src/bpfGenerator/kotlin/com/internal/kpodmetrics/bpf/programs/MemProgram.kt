@@ -11,10 +11,9 @@ import dev.ebpf.dsl.types.BpfScalar
  *   - tp/oom/mark_victim: counts OOM kills per cgroup
  *   - kprobe/handle_mm_fault: counts major page faults per cgroup
  *
- * Note: Stats tracking (STATS_INC/STATS_DEC) in the else branch is omitted from
- * the DSL logic. The DEFINE_STATS_MAP macros are included in the preamble so the
- * stats maps are still created (for compatibility), but are not written to by
- * the generated program body. Stats tracking can be added later if needed.
+ * New keys are inserted through map_insert() (see COMMON_PREAMBLE), which counts
+ * successful and failed inserts in each map's DEFINE_STATS_MAP companion for
+ * BpfMapStatsCollector's lost-update and eviction accounting.
  */
 val memProgram = ebpf("mem") {
     license("GPL")
@@ -37,7 +36,7 @@ val memProgram = ebpf("mem") {
             val newVal = stackVar(CounterValue) {
                 it[CounterValue.count] = literal(1u, BpfScalar.U64)
             }
-            oomKills.update(key, newVal, flags = BPF_NOEXIST)
+            declareVar("_ins", raw(mapInsert("oom_kills", key.expr, newVal.expr), BpfScalar.S64))
         }
         returnValue(literal(0, BpfScalar.S32))
     }
@@ -61,7 +60,7 @@ val memProgram = ebpf("mem") {
             val newVal = stackVar(CounterValue) {
                 it[CounterValue.count] = literal(1u, BpfScalar.U64)
             }
-            majorFaults.update(key, newVal, flags = BPF_NOEXIST)
+            declareVar("_ins", raw(mapInsert("major_faults", key.expr, newVal.expr), BpfScalar.S64))
         }
         returnValue(literal(0, BpfScalar.S32))
     }
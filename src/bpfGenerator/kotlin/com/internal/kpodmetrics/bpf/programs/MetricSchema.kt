@@ -0,0 +1,167 @@
+package com.internal.kpodmetrics.bpf.programs
+
+import java.io.File
+
+/**
+ * Declarative description of how a program's maps become metrics: which key
+ * fields become which labels (optionally through an enum table) and whether the
+ * value is a counter or a latency histogram.
+ *
+ * `GenerateBpf` resolves field names against the program's C structs and emits a
+ * `<Program>Metrics` object of `collector.MapMetricSpec`s, which the shared
+ * `collector.MapMetricEmitter` drains, decodes and publishes. Each spec decodes
+ * through the program's generated `<Program>Views` (see [generateViews]), so the
+ * schema-driven collectors and the hand-written ones share one decoding path.
+ */
+class MetricSchema(val program: String) {
+    sealed interface Table
+    data class DenseTable(val names: List<String>, val unknown: String) : Table
+    data class SparseTable(val names: Map<Int, String>, val unknown: String) : Table
+
+    data class Label(val name: String, val field: String, val table: String?)
+
+    data class MapMetric(
+        val metric: String,
+        val map: String,
+        val keyStruct: String,
+        val valueStruct: String,
+        val latency: Boolean,
+        val countField: String,
+        val sumField: String?,
+        val sumScale: Double,
+        val emitUnresolved: Boolean,
+        val labels: List<Label>
+    )
+
+    class LabelsBuilder {
+        internal val labels = mutableListOf<Label>()
+
+        /** Key [field] becomes label [name]; without [table] the raw number is used. */
+        fun label(name: String, field: String = name, table: String? = null) {
+            labels += Label(name, field, table)
+        }
+    }
+
+    val tables = LinkedHashMap<String, Table>()
+    val maps = mutableListOf<MapMetric>()
+
+    /** Enum table indexed by value: `names[value]`, [unknown] otherwise. */
+    fun table(name: String, vararg names: String, unknown: String = "UNKNOWN") {
+        tables[name] = DenseTable(names.toList(), unknown)
+    }
+
+    /** Sparse enum table; [unknown] may contain one `%d`/`%x` for the raw value. */
+    fun table(name: String, names: Map<Int, String>, unknown: String) {
+        tables[name] = SparseTable(names, unknown)
+    }
+
+    fun counter(
+        metric: String, map: String, key: String, value: String = "counter_value",
+        countField: String = "count", emitUnresolved: Boolean = false,
+        labels: LabelsBuilder.() -> Unit
+    ) {
+        maps += MapMetric(metric, map, key, value, false, countField, null, 1.0,
+            emitUnresolved, LabelsBuilder().apply(labels).labels)
+    }
+
+    /** `hist_value`-style map published as average latency in seconds. */
+    fun averageLatency(
+        metric: String, map: String, key: String, value: String = "hist_value",
+        sumField: String = "sum_ns", sumScale: Double = 1e-9,
+        labels: LabelsBuilder.() -> Unit
+    ) {
+        maps += MapMetric(metric, map, key, value, true, "count", sumField, sumScale,
+            false, LabelsBuilder().apply(labels).labels)
+    }
+}
+
+fun metricSchema(program: String, block: MetricSchema.() -> Unit): MetricSchema =
+    MetricSchema(program).apply(block)
+
+private fun camelName(snake: String): String =
+    snake.split('_').filter { it.isNotEmpty() }.joinToString("") { it.replaceFirstChar(Char::uppercaseChar) }
+
+private fun kotlinString(s: String): String =
+    "\"" + s.replace("\\", "\\\\").replace("\"", "\\\"").replace("$", "\\$") + "\""
+
+fun generateMetricSchema(schema: MetricSchema, structs: List<CStruct>, kotlinPackage: String): String {
+    val byName = structs.associateBy { it.name }
+    fun struct(name: String): CStruct =
+        byName[name] ?: error("${schema.program}: struct $name not found in generated C")
+    fun field(struct: CStruct, name: String): CField =
+        struct.fields.firstOrNull { it.name == name && !it.isArray }
+            ?: error("${schema.program}: ${struct.name} has no scalar field $name")
+
+    val objectName = camelName(schema.program) + "Metrics"
+    val viewsName = camelName(schema.program) + "Views"
+    fun view(struct: CStruct): String = "{ $viewsName.${camelName(struct.name)}View() }"
+    val sb = StringBuilder()
+    sb.appendLine("// Generated by GenerateBpf from the ${schema.program} metric schema. Do not edit.")
+    sb.appendLine("package $kotlinPackage")
+    sb.appendLine()
+    sb.appendLine("import com.internal.kpodmetrics.collector.LabelSpec")
+    sb.appendLine("import com.internal.kpodmetrics.collector.LabelTable")
+    sb.appendLine("import com.internal.kpodmetrics.collector.MapMetricSpec")
+    sb.appendLine("import com.internal.kpodmetrics.collector.MetricKind")
+    sb.appendLine()
+    sb.appendLine("object $objectName {")
+    for ((name, table) in schema.tables) {
+        val constName = name.uppercase()
+        when (table) {
+            is MetricSchema.DenseTable -> sb.appendLine(
+                "    val $constName = LabelTable.dense(arrayOf(" +
+                    table.names.joinToString(", ") { kotlinString(it) } +
+                    "), ${kotlinString(table.unknown)})"
+            )
+            is MetricSchema.SparseTable -> sb.appendLine(
+                "    val $constName = LabelTable.sparse(mapOf(" +
+                    table.names.entries.joinToString(", ") { "${it.key} to ${kotlinString(it.value)}" } +
+                    "), ${kotlinString(table.unknown)})"
+            )
+        }
+    }
+    for (m in schema.maps) {
+        val key = struct(m.keyStruct)
+        val value = struct(m.valueStruct)
+        sb.appendLine()
+        sb.appendLine("    val ${m.map.uppercase()} = MapMetricSpec(")
+        sb.appendLine("        program = ${kotlinString(schema.program)},")
+        sb.appendLine("        map = ${kotlinString(m.map)},")
+        sb.appendLine("        keyView = ${view(key)},")
+        sb.appendLine("        valueView = ${view(value)},")
+        sb.appendLine("        keySize = ${key.size},")
+        sb.appendLine("        valueSize = ${value.size},")
+        sb.appendLine("        cgroupIdOffset = ${field(key, "cgroup_id").offset},")
+        sb.appendLine("        metric = ${kotlinString(m.metric)},")
+        sb.appendLine("        kind = MetricKind.${if (m.latency) "AVERAGE_LATENCY" else "COUNTER"},")
+        sb.appendLine("        labels = listOf(")
+        m.labels.forEachIndexed { i, label ->
+            val f = field(key, label.field)
+            val table = label.table?.let {
+                require(it in schema.tables) { "${schema.program}: unknown table $it" }
+                it.uppercase()
+            } ?: "LabelTable.numeric()"
+            val sep = if (i < m.labels.size - 1) "," else ""
+            sb.appendLine("            LabelSpec(${kotlinString(label.name)}, ${f.offset}, ${f.elemSize}, $table)$sep")
+        }
+        sb.appendLine("        ),")
+        sb.appendLine("        countOffset = ${field(value, m.countField).offset},")
+        if (m.sumField != null) {
+            sb.appendLine("        sumOffset = ${field(value, m.sumField).offset},")
+            sb.appendLine("        sumScale = ${m.sumScale},")
+        }
+        sb.appendLine("        emitUnresolved = ${m.emitUnresolved}")
+        sb.appendLine("    )")
+    }
+    sb.appendLine()
+    sb.appendLine("    val ALL = listOf(${schema.maps.joinToString(", ") { it.map.uppercase() }})")
+    sb.appendLine("}")
+    return sb.toString()
+}
+
+fun writeMetricSchema(schema: MetricSchema, c: String, kotlinDir: String, kotlinPackage: String) {
+    val objectName = camelName(schema.program) + "Metrics"
+    val file = File(kotlinDir, kotlinPackage.replace('.', '/') + "/$objectName.kt")
+    file.parentFile.mkdirs()
+    file.writeText(generateMetricSchema(schema, parseCStructs(c), kotlinPackage))
+}
@@ -297,12 +297,12 @@ static __always_inline void read_sock_addr(struct sock *sk, __u16 *dport, __u16
 """.trimIndent()
 
 private val MONGO_POSTAMBLE = """
-static __always_inline void update_hist(void *map, void *key, __u64 val_ns)
+static __always_inline void update_hist(void *map, void *stats, void *key, __u64 val_ns)
 {
     struct hist_value *hist = bpf_map_lookup_elem(map, key);
     if (!hist) {
         struct hist_value new_hist = {};
-        bpf_map_update_elem(map, key, &new_hist, BPF_NOEXIST);
+        map_insert(map, stats, key, &new_hist);
         hist = bpf_map_lookup_elem(map, key);
         if (!hist) return;
     }
@@ -325,15 +325,17 @@ static __always_inline int check_mongo_port(struct sock *sk)
     return 0;
 }
 
-static __always_inline void inc_mongo_event(void *map, void *key)
+static __always_inline void inc_mongo_event(void *map, void *stats, void *key)
 {
     struct counter_value *ev = bpf_map_lookup_elem(map, key);
-    if (ev) {
-        __sync_fetch_and_add(&ev->count, 1);
-    } else {
+    if (!ev) {
         struct counter_value one = { .count = 1 };
-        bpf_map_update_elem(map, key, &one, BPF_NOEXIST);
+        // Another CPU inserted the key first: add to its entry instead
+        if (map_insert(map, stats, key, &one) != -EEXIST) return;
+        ev = bpf_map_lookup_elem(map, key);
+        if (!ev) return;
     }
+    __sync_fetch_and_add(&ev->count, 1);
 }
 
 static __always_inline void maybe_emit_span(
@@ -418,7 +420,7 @@ val mongoProgram = ebpf("mongo") {
             .cgroup_id = cgroup_id,
             .command = command,
         };
-        inc_mongo_event(&mongo_events, &ev_key);
+        inc_mongo_event(&mongo_events, &mongo_events_stats, &ev_key);
         struct mongo_inflight_key inf_key = {
             .cgroup_id = cgroup_id,
             .request_id = request_id,
@@ -429,7 +431,7 @@ val mongoProgram = ebpf("mongo") {
             .request_id = request_id,
             .command = command,
         };
-        bpf_map_update_elem(&mongo_inflight, &inf_key, &inf_val, BPF_NOEXIST);
+        map_insert(&mongo_inflight, &mongo_inflight_stats, &inf_key, &inf_val);
         return 0;
     }
 
@@ -451,12 +453,12 @@ val mongoProgram = ebpf("mongo") {
             .cgroup_id = cgroup_id,
             .command = req_cmd,
         };
-        update_hist(&mongo_latency, &lat_key, latency_ns);
+        update_hist(&mongo_latency, &mongo_latency_stats, &lat_key, latency_ns);
 
         __u8 err = detect_mongo_error(buf, to_read);
         if (err) {
             struct mongo_err_key ek = { .cgroup_id = cgroup_id, .err_type = err };
-            inc_mongo_event(&mongo_errors, &ek);
+            inc_mongo_event(&mongo_errors, &mongo_errors_stats, &ek);
         }
         {
             __u32 dst_ip = 0;
@@ -470,7 +472,7 @@ val mongoProgram = ebpf("mongo") {
                 NULL, 0);
         }
 
-        bpf_map_delete_elem(&mongo_inflight, &inf_key);
+        map_delete(&mongo_inflight, &mongo_inflight_stats, &inf_key);
     }
     (__s32)0;
 })""", BpfScalar.S32))
@@ -530,7 +532,7 @@ val mongoProgram = ebpf("mongo") {
             .cgroup_id = cgroup_id,
             .command = command,
         };
-        inc_mongo_event(&mongo_events, &ev_key);
+        inc_mongo_event(&mongo_events, &mongo_events_stats, &ev_key);
         struct mongo_inflight_key inf_key = {
             .cgroup_id = cgroup_id,
             .request_id = request_id,
@@ -541,7 +543,7 @@ val mongoProgram = ebpf("mongo") {
             .request_id = request_id,
             .command = command,
         };
-        bpf_map_update_elem(&mongo_inflight, &inf_key, &inf_val, BPF_NOEXIST);
+        map_insert(&mongo_inflight, &mongo_inflight_stats, &inf_key, &inf_val);
         return 0;
     }
 
@@ -563,12 +565,12 @@ val mongoProgram = ebpf("mongo") {
             .cgroup_id = cgroup_id,
             .command = req_cmd,
         };
-        update_hist(&mongo_latency, &lat_key, latency_ns);
+        update_hist(&mongo_latency, &mongo_latency_stats, &lat_key, latency_ns);
 
         __u8 err = detect_mongo_error(buf, to_read);
         if (err) {
             struct mongo_err_key ek = { .cgroup_id = cgroup_id, .err_type = err };
-            inc_mongo_event(&mongo_errors, &ek);
+            inc_mongo_event(&mongo_errors, &mongo_errors_stats, &ek);
         }
         {
             __u32 dst_ip = 0;
@@ -582,10 +584,28 @@ val mongoProgram = ebpf("mongo") {
                 NULL, 0);
         }
 
-        bpf_map_delete_elem(&mongo_inflight, &inf_key);
+        map_delete(&mongo_inflight, &mongo_inflight_stats, &inf_key);
     }
     (__s32)0;
 })""", BpfScalar.S32))
         returnValue(literal(0, BpfScalar.S32))
     }
 }
+
+// ── MongoDB metric schema ────────────────────────────────────────────
+
+val mongoMetricSchema = metricSchema("mongo") {
+    table("command", "UNKNOWN", "find", "insert", "update", "delete",
+        "aggregate", "getMore", "count", "distinct", "Other")
+    table("error", "UNKNOWN", "cmd_failure")
+
+    counter("kpod.mongo.requests", "mongo_events", key = "mongo_event_key", emitUnresolved = true) {
+        label("command", table = "command")
+    }
+    averageLatency("kpod.mongo.request.duration", "mongo_latency", key = "mongo_latency_key") {
+        label("command", table = "command")
+    }
+    counter("kpod.mongo.errors", "mongo_errors", key = "mongo_err_key") {
+        label("error_type", field = "err_type", table = "error")
+    }
+}
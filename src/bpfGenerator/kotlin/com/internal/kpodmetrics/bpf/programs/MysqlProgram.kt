@@ -245,12 +245,12 @@ static __always_inline void read_sock_addr(struct sock *sk, __u16 *dport, __u16
 """.trimIndent()
 
 private val MYSQL_POSTAMBLE = """
-static __always_inline void update_hist(void *map, void *key, __u64 val_ns)
+static __always_inline void update_hist(void *map, void *stats, void *key, __u64 val_ns)
 {
     struct hist_value *hist = bpf_map_lookup_elem(map, key);
     if (!hist) {
         struct hist_value new_hist = {};
-        bpf_map_update_elem(map, key, &new_hist, BPF_NOEXIST);
+        map_insert(map, stats, key, &new_hist);
         hist = bpf_map_lookup_elem(map, key);
         if (!hist) return;
     }
@@ -273,15 +273,17 @@ static __always_inline int check_mysql_port(struct sock *sk)
     return 0;
 }
 
-static __always_inline void inc_mysql_event(void *map, void *key)
+static __always_inline void inc_mysql_event(void *map, void *stats, void *key)
 {
     struct counter_value *ev = bpf_map_lookup_elem(map, key);
-    if (ev) {
-        __sync_fetch_and_add(&ev->count, 1);
-    } else {
+    if (!ev) {
         struct counter_value one = { .count = 1 };
-        bpf_map_update_elem(map, key, &one, BPF_NOEXIST);
+        // Another CPU inserted the key first: add to its entry instead
+        if (map_insert(map, stats, key, &one) != -EEXIST) return;
+        ev = bpf_map_lookup_elem(map, key);
+        if (!ev) return;
     }
+    __sync_fetch_and_add(&ev->count, 1);
 }
 
 static __always_inline void maybe_emit_span(
@@ -376,14 +378,14 @@ val mysqlProgram = ebpf("mysql") {
             .stmt_type = stmt_type,
             .direction = direction,
         };
-        inc_mysql_event(&mysql_events, &ev_key);
+        inc_mysql_event(&mysql_events, &mysql_events_stats, &ev_key);
         struct mysql_inflight_val inf_val = {
             .ts = bpf_ktime_get_ns(),
             .command = cmd,
             .stmt_type = stmt_type,
             .direction = direction,
         };
-        bpf_map_update_elem(&mysql_inflight, &inf_key, &inf_val, BPF_NOEXIST);
+        map_insert(&mysql_inflight, &mysql_inflight_stats, &inf_key, &inf_val);
         return 0;
     }
 
@@ -404,13 +406,13 @@ val mysqlProgram = ebpf("mysql") {
             .stmt_type = req_stmt,
             .direction = req_dir,
         };
-        update_hist(&mysql_latency, &lat_key, latency_ns);
+        update_hist(&mysql_latency, &mysql_latency_stats, &lat_key, latency_ns);
 
         __u16 err_code = 0;
         if (resp == MYSQL_ERR) {
             err_code = extract_mysql_error_code(buf, to_read);
             struct mysql_err_key ek = { .cgroup_id = cgroup_id, .err_code = err_code };
-            inc_mysql_event(&mysql_errors, &ek);
+            inc_mysql_event(&mysql_errors, &mysql_errors_stats, &ek);
         }
         {
             __u32 dst_ip = 0;
@@ -424,7 +426,7 @@ val mysqlProgram = ebpf("mysql") {
                 NULL, 0);
         }
 
-        bpf_map_delete_elem(&mysql_inflight, &inf_key);
+        map_delete(&mysql_inflight, &mysql_inflight_stats, &inf_key);
     }
     (__s32)0;
 })""", BpfScalar.S32))
@@ -494,14 +496,14 @@ val mysqlProgram = ebpf("mysql") {
             .stmt_type = stmt_type,
             .direction = direction,
         };
-        inc_mysql_event(&mysql_events, &ev_key);
+        inc_mysql_event(&mysql_events, &mysql_events_stats, &ev_key);
         struct mysql_inflight_val inf_val = {
             .ts = bpf_ktime_get_ns(),
             .command = cmd,
             .stmt_type = stmt_type,
             .direction = direction,
         };
-        bpf_map_update_elem(&mysql_inflight, &inf_key, &inf_val, BPF_NOEXIST);
+        map_insert(&mysql_inflight, &mysql_inflight_stats, &inf_key, &inf_val);
         return 0;
     }
 
@@ -522,13 +524,13 @@ val mysqlProgram = ebpf("mysql") {
             .stmt_type = req_stmt,
             .direction = req_dir,
         };
-        update_hist(&mysql_latency, &lat_key, latency_ns);
+        update_hist(&mysql_latency, &mysql_latency_stats, &lat_key, latency_ns);
 
         __u16 err_code = 0;
         if (resp == MYSQL_ERR) {
             err_code = extract_mysql_error_code(buf, to_read);
             struct mysql_err_key ek = { .cgroup_id = cgroup_id, .err_code = err_code };
-            inc_mysql_event(&mysql_errors, &ek);
+            inc_mysql_event(&mysql_errors, &mysql_errors_stats, &ek);
         }
         {
             __u32 dst_ip = 0;
@@ -542,10 +544,35 @@ val mysqlProgram = ebpf("mysql") {
                 NULL, 0);
         }
 
-        bpf_map_delete_elem(&mysql_inflight, &inf_key);
+        map_delete(&mysql_inflight, &mysql_inflight_stats, &inf_key);
     }
     (__s32)0;
 })""", BpfScalar.S32))
         returnValue(literal(0, BpfScalar.S32))
     }
 }
+
+// ── MySQL metric schema ──────────────────────────────────────────────
+
+val mysqlMetricSchema = metricSchema("mysql") {
+    table("command", mapOf(
+        0x03 to "COM_QUERY", 0x16 to "COM_STMT_PREPARE", 0x17 to "COM_STMT_EXECUTE",
+        0x0e to "COM_PING", 0x01 to "COM_QUIT", 0x02 to "COM_INIT_DB"
+    ), unknown = "UNKNOWN(0x%x)")
+    table("stmt_type", "UNKNOWN", "SELECT", "INSERT", "UPDATE", "DELETE", "BEGIN", "COMMIT", "OTHER")
+    table("direction", "client", "server", unknown = "unknown")
+
+    counter("kpod.mysql.requests", "mysql_events", key = "mysql_event_key", emitUnresolved = true) {
+        label("command", table = "command")
+        label("stmt_type", table = "stmt_type")
+        label("direction", table = "direction")
+    }
+    averageLatency("kpod.mysql.request.duration", "mysql_latency", key = "mysql_latency_key") {
+        label("command", table = "command")
+        label("stmt_type", table = "stmt_type")
+        label("direction", table = "direction")
+    }
+    counter("kpod.mysql.errors", "mysql_errors", key = "mysql_err_key") {
+        label("error_code", field = "err_code")
+    }
+}
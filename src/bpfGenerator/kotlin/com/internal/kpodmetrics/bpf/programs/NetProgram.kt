@@ -35,10 +35,9 @@ object TcpStats : BpfStruct("tcp_stats") {
  *   - tp/sock/inet_sock_set_state:  if newstate==1 (TCP_ESTABLISHED), atomicAdd connections by 1
  *   - tp/tcp/tcp_probe:             atomicAdd rtt_sum_us and rtt_count; histogram update on rtt_hist
  *
- * Note: Stats tracking (STATS_INC/STATS_DEC) in the else branches is omitted from
- * the DSL logic. The DEFINE_STATS_MAP macros are included in the preamble so the
- * stats maps are still created (for compatibility), but are not written to by the
- * generated program body.
+ * New keys are inserted through map_insert() (see COMMON_PREAMBLE), which counts
+ * successful and failed inserts in each map's DEFINE_STATS_MAP companion for
+ * BpfMapStatsCollector's lost-update and eviction accounting.
  */
 val netProgram = ebpf("net") {
     license("GPL")
@@ -67,7 +66,7 @@ val netProgram = ebpf("net") {
             val newVal = stackVar(TcpStats) {
                 it[TcpStats.bytesSent] = size
             }
-            tcpStatsMap.update(key, newVal, flags = BPF_NOEXIST)
+            declareVar("_ins", raw(mapInsert("tcp_stats_map", key.expr, newVal.expr), BpfScalar.S64))
         }
         returnValue(literal(0, BpfScalar.S32))
     }
@@ -86,7 +85,7 @@ val netProgram = ebpf("net") {
             val newVal = stackVar(TcpStats) {
                 it[TcpStats.bytesReceived] = len
             }
-            tcpStatsMap.update(key, newVal, flags = BPF_NOEXIST)
+            declareVar("_ins", raw(mapInsert("tcp_stats_map", key.expr, newVal.expr), BpfScalar.S64))
         }
         returnValue(literal(0, BpfScalar.S32))
     }
@@ -104,7 +103,7 @@ val netProgram = ebpf("net") {
             val newVal = stackVar(TcpStats) {
                 it[TcpStats.retransmits] = literal(1u, BpfScalar.U64)
             }
-            tcpStatsMap.update(key, newVal, flags = BPF_NOEXIST)
+            declareVar("_ins", raw(mapInsert("tcp_stats_map", key.expr, newVal.expr), BpfScalar.S64))
         }
         returnValue(literal(0, BpfScalar.S32))
     }
@@ -129,7 +128,7 @@ val netProgram = ebpf("net") {
                 val newVal = stackVar(TcpStats) {
                     it[TcpStats.connections] = literal(1u, BpfScalar.U64)
                 }
-                tcpStatsMap.update(key, newVal, flags = BPF_NOEXIST)
+                declareVar("_ins", raw(mapInsert("tcp_stats_map", key.expr, newVal.expr), BpfScalar.S64))
             }
         }
         returnValue(literal(0, BpfScalar.S32))
@@ -182,7 +181,7 @@ val netProgram = ebpf("net") {
                 "_arr_set",
                 raw("($newHvalName.slots[slot2] = 1ULL, (__s32)0)", BpfScalar.S32)
             )
-            rttHist.update(hkey, newHval, flags = BPF_NOEXIST)
+            declareVar("_ins", raw(mapInsert("rtt_hist", hkey.expr, newHval.expr), BpfScalar.S64))
         }
 
         returnValue(literal(0, BpfScalar.S32))
@@ -228,12 +228,12 @@ static __always_inline void read_sock_addr(struct sock *sk, __u16 *dport, __u16
 """.trimIndent()
 
 private val REDIS_POSTAMBLE = """
-static __always_inline void update_hist(void *map, void *key, __u64 val_ns)
+static __always_inline void update_hist(void *map, void *stats, void *key, __u64 val_ns)
 {
     struct hist_value *hist = bpf_map_lookup_elem(map, key);
     if (!hist) {
         struct hist_value new_hist = {};
-        bpf_map_update_elem(map, key, &new_hist, BPF_NOEXIST);
+        map_insert(map, stats, key, &new_hist);
         hist = bpf_map_lookup_elem(map, key);
         if (!hist) return;
     }
@@ -264,15 +264,17 @@ static __always_inline int is_redis_sport(struct sock *sk)
     return bpf_map_lookup_elem(&redis_ports, &pk) ? 1 : 0;
 }
 
-static __always_inline void inc_redis_event(void *map, void *key)
+static __always_inline void inc_redis_event(void *map, void *stats, void *key)
 {
     struct counter_value *ev = bpf_map_lookup_elem(map, key);
-    if (ev) {
-        __sync_fetch_and_add(&ev->count, 1);
-    } else {
+    if (!ev) {
         struct counter_value one = { .count = 1 };
-        bpf_map_update_elem(map, key, &one, BPF_NOEXIST);
+        // Another CPU inserted the key first: add to its entry instead
+        if (map_insert(map, stats, key, &one) != -EEXIST) return;
+        ev = bpf_map_lookup_elem(map, key);
+        if (!ev) return;
     }
+    __sync_fetch_and_add(&ev->count, 1);
 }
 
 static __always_inline void maybe_emit_span(
@@ -364,13 +366,13 @@ val redisProgram = ebpf("redis") {
             .command = cmd,
             .direction = direction,
         };
-        inc_redis_event(&redis_events, &ev_key);
+        inc_redis_event(&redis_events, &redis_events_stats, &ev_key);
         struct redis_inflight_val inf_val = {
             .ts = bpf_ktime_get_ns(),
             .command = cmd,
             .direction = direction,
         };
-        bpf_map_update_elem(&redis_inflight, &inf_key, &inf_val, BPF_NOEXIST);
+        map_insert(&redis_inflight, &redis_inflight_stats, &inf_key, &inf_val);
         return 0;
     }
 
@@ -388,7 +390,7 @@ val redisProgram = ebpf("redis") {
             .command = req_cmd,
             .direction = req_dir,
         };
-        update_hist(&redis_latency, &lat_key, latency_ns);
+        update_hist(&redis_latency, &redis_latency_stats, &lat_key, latency_ns);
         {
             __u32 dst_ip = 0;
             bpf_probe_read(&dst_ip, sizeof(dst_ip), &sk->__sk_common.skc_daddr);
@@ -405,10 +407,10 @@ val redisProgram = ebpf("redis") {
         __u8 err = detect_redis_error(buf, to_read);
         if (err) {
             struct redis_err_key ek = { .cgroup_id = cgroup_id, .err_type = err };
-            inc_redis_event(&redis_errors, &ek);
+            inc_redis_event(&redis_errors, &redis_errors_stats, &ek);
         }
 
-        bpf_map_delete_elem(&redis_inflight, &inf_key);
+        map_delete(&redis_inflight, &redis_inflight_stats, &inf_key);
     }
     (__s32)0;
 })""", BpfScalar.S32))
@@ -474,13 +476,13 @@ val redisProgram = ebpf("redis") {
             .command = cmd,
             .direction = direction,
         };
-        inc_redis_event(&redis_events, &ev_key);
+        inc_redis_event(&redis_events, &redis_events_stats, &ev_key);
         struct redis_inflight_val inf_val = {
             .ts = bpf_ktime_get_ns(),
             .command = cmd,
             .direction = direction,
         };
-        bpf_map_update_elem(&redis_inflight, &inf_key, &inf_val, BPF_NOEXIST);
+        map_insert(&redis_inflight, &redis_inflight_stats, &inf_key, &inf_val);
         return 0;
     }
 
@@ -498,7 +500,7 @@ val redisProgram = ebpf("redis") {
             .command = req_cmd,
             .direction = req_dir,
         };
-        update_hist(&redis_latency, &lat_key, latency_ns);
+        update_hist(&redis_latency, &redis_latency_stats, &lat_key, latency_ns);
         {
             __u32 dst_ip = 0;
             bpf_probe_read(&dst_ip, sizeof(dst_ip), &sk->__sk_common.skc_daddr);
@@ -515,13 +517,34 @@ val redisProgram = ebpf("redis") {
         __u8 err = detect_redis_error(buf, to_read);
         if (err) {
             struct redis_err_key ek = { .cgroup_id = cgroup_id, .err_type = err };
-            inc_redis_event(&redis_errors, &ek);
+            inc_redis_event(&redis_errors, &redis_errors_stats, &ek);
         }
 
-        bpf_map_delete_elem(&redis_inflight, &inf_key);
+        map_delete(&redis_inflight, &redis_inflight_stats, &inf_key);
     }
     (__s32)0;
 })""", BpfScalar.S32))
         returnValue(literal(0, BpfScalar.S32))
     }
 }
+
+// ── Redis metric schema ──────────────────────────────────────────────
+
+val redisMetricSchema = metricSchema("redis") {
+    table("command", "UNKNOWN", "GET", "SET", "DEL", "HGET", "HSET",
+        "LPUSH", "RPUSH", "SADD", "ZADD", "EXPIRE", "INCR", "OTHER")
+    table("error", "UNKNOWN", "ERR", "WRONGTYPE", "MOVED", "OTHER")
+    table("direction", "client", "server", unknown = "unknown")
+
+    counter("kpod.redis.requests", "redis_events", key = "redis_event_key", emitUnresolved = true) {
+        label("command", table = "command")
+        label("direction", table = "direction")
+    }
+    averageLatency("kpod.redis.request.duration", "redis_latency", key = "redis_latency_key") {
+        label("command", table = "command")
+        label("direction", table = "direction")
+    }
+    counter("kpod.redis.errors", "redis_errors", key = "redis_err_key") {
+        label("error_type", field = "err_type", table = "error")
+    }
+}
@@ -1,5 +1,6 @@
 package com.internal.kpodmetrics.bpf.programs
 
+import dev.ebpf.dsl.ir.BpfExpr
 import dev.ebpf.dsl.types.BpfScalar
 import dev.ebpf.dsl.types.BpfStruct
 
@@ -24,6 +25,9 @@ object HistValue : BpfStruct("hist_value") {
 val COMMON_PREAMBLE = """
 #define MAX_ENTRIES 10240
 #define MAX_SLOTS 27
+#ifndef EEXIST
+#define EEXIST 17
+#endif
 
 enum map_stat_idx {
     MAP_STAT_ENTRIES = 0,
@@ -51,6 +55,34 @@ struct { \
     if (_v) __sync_fetch_and_add(_v, -1); \
 } while(0)
 
+/*
+ * Inserts a new key with BPF_NOEXIST and accounts for it in the map's _stats
+ * companion: ENTRIES counts successful inserts (net of in-kernel deletes via
+ * map_delete), UPDATE_ERRORS counts failed ones. User space compares ENTRIES
+ * with what its drains removed to infer LRU evictions. -EEXIST is not an error:
+ * another CPU inserted the same key first, and callers add to that entry.
+ */
+static __always_inline long map_insert(void *map, void *stats, const void *key, const void *val)
+{
+    long ret = bpf_map_update_elem(map, key, val, BPF_NOEXIST);
+    if (ret == -EEXIST) return ret;
+    __u32 idx = ret == 0 ? MAP_STAT_ENTRIES : MAP_STAT_UPDATE_ERRORS;
+    __s64 *cnt = bpf_map_lookup_elem(stats, &idx);
+    if (cnt) __sync_fetch_and_add(cnt, 1);
+    return ret;
+}
+
+static __always_inline long map_delete(void *map, void *stats, const void *key)
+{
+    long ret = bpf_map_delete_elem(map, key);
+    if (ret == 0) {
+        __u32 idx = MAP_STAT_ENTRIES;
+        __s64 *cnt = bpf_map_lookup_elem(stats, &idx);
+        if (cnt) __sync_fetch_and_add(cnt, -1);
+    }
+    return ret;
+}
+
 struct span_event {
     __u64 ts_ns;
     __u64 latency_ns;
@@ -76,3 +108,16 @@ static __always_inline __u32 log2l(__u64 v) {
     return r;
 }
 """.trimIndent()
+
+/**
+ * C for inserting `&value` under `&key` into [map] through map_insert(), for DSL
+ * programs whose maps have a DEFINE_STATS_MAP companion. Wrap it in `raw(..., BpfScalar.S64)`.
+ */
+fun mapInsert(map: String, key: BpfExpr, value: BpfExpr, stats: String = "${map}_stats"): String =
+    "map_insert(&$map, &$stats, &${varName(key)}, &${varName(value)})"
+
+/** C for deleting `&key` from [map] through map_delete(). */
+fun mapDelete(map: String, key: BpfExpr): String =
+    "map_delete(&$map, &${map}_stats, &${varName(key)})"
+
+private fun varName(expr: BpfExpr): String = (expr as BpfExpr.VarRef).variable.name
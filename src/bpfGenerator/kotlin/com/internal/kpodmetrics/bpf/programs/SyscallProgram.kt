@@ -42,10 +42,9 @@ object SyscallStats : BpfStruct("syscall_stats") {
  *   - raw_tp/sys_enter: checks tracked_syscalls, records timestamp and syscall number
  *   - raw_tp/sys_exit:  computes latency, updates per-syscall stats with histogram
  *
- * Note: Stats tracking (STATS_INC/STATS_DEC) in the else branches is omitted from
- * the DSL logic. The DEFINE_STATS_MAP macros are included in the preamble so the
- * stats maps are still created (for compatibility), but are not written to by the
- * generated program body.
+ * New keys are inserted through map_insert() (see COMMON_PREAMBLE), which counts
+ * successful and failed inserts in each map's DEFINE_STATS_MAP companion for
+ * BpfMapStatsCollector's lost-update and eviction accounting.
  */
 val syscallProgram = ebpf("syscall") {
     license("GPL")
@@ -144,7 +143,7 @@ val syscallProgram = ebpf("syscall") {
                         "_arr_set",
                         raw("($newStatsName.latency_slots[slot2] = 1ULL, (__s32)0)", BpfScalar.S32)
                     )
-                    syscallStatsMap.update(key, newStats, flags = BPF_NOEXIST)
+                    declareVar("_ins", raw(mapInsert("syscall_stats", key.expr, newStats.expr, stats = "syscall_stats_map_stats"), BpfScalar.S64))
                 }
 
                 // Delete from both maps
@@ -40,18 +40,23 @@ private val TCP_PEER_PREAMBLE = """
 #define LOOPBACK_IP4 0x0100007F
 
 $COMMON_PREAMBLE
+
+DEFINE_STATS_MAP(tcp_peer_conns)
+DEFINE_STATS_MAP(tcp_peer_rtt)
 """.trimIndent()
 
 private val TCP_PEER_POSTAMBLE = """
-static __always_inline void inc_counter(void *map, void *key)
+static __always_inline void inc_counter(void *map, void *stats, void *key)
 {
     struct counter_value *val = bpf_map_lookup_elem(map, key);
-    if (val) {
-        __sync_fetch_and_add(&val->count, 1);
-    } else {
+    if (!val) {
         struct counter_value one = { .count = 1 };
-        bpf_map_update_elem(map, key, &one, BPF_NOEXIST);
+        // Another CPU inserted the key first: add to its entry instead
+        if (map_insert(map, stats, key, &one) != -EEXIST) return;
+        val = bpf_map_lookup_elem(map, key);
+        if (!val) return;
     }
+    __sync_fetch_and_add(&val->count, 1);
 }
 """.trimIndent()
 
@@ -89,7 +94,7 @@ val tcpPeerProgram = ebpf("tcp_peer") {
         .remote_port = dport,
         .direction = DIR_CLIENT,
     };
-    inc_counter(&tcp_peer_conns, &key);
+    inc_counter(&tcp_peer_conns, &tcp_peer_conns_stats, &key);
     (__s32)0;
 })""", BpfScalar.S32))
         returnValue(literal(0, BpfScalar.S32))
@@ -116,7 +121,7 @@ val tcpPeerProgram = ebpf("tcp_peer") {
         .remote_port = dport,
         .direction = DIR_SERVER,
     };
-    inc_counter(&tcp_peer_conns, &key);
+    inc_counter(&tcp_peer_conns, &tcp_peer_conns_stats, &key);
     (__s32)0;
 })""", BpfScalar.S32))
         returnValue(literal(0, BpfScalar.S32))
@@ -140,22 +145,22 @@ val tcpPeerProgram = ebpf("tcp_peer") {
         .remote_ip4 = daddr,
         .remote_port = dport,
     };
+    __u32 slot = log2l(rtt_us);
+    if (slot >= HIST_SLOTS) slot = HIST_SLOTS - 1;
     struct tcp_peer_hist_value *hist = bpf_map_lookup_elem(&tcp_peer_rtt, &key);
-    if (hist) {
-        __u32 slot = log2l(rtt_us);
-        if (slot >= HIST_SLOTS) slot = HIST_SLOTS - 1;
-        __sync_fetch_and_add(&hist->slots[slot], 1);
-        __sync_fetch_and_add(&hist->count, 1);
-        __sync_fetch_and_add(&hist->sum_us, rtt_us);
-    } else {
+    if (!hist) {
         struct tcp_peer_hist_value new_hist = {};
-        __u32 slot = log2l(rtt_us);
-        if (slot >= HIST_SLOTS) slot = HIST_SLOTS - 1;
         new_hist.slots[slot] = 1;
         new_hist.count = 1;
         new_hist.sum_us = rtt_us;
-        bpf_map_update_elem(&tcp_peer_rtt, &key, &new_hist, BPF_NOEXIST);
+        // Another CPU inserted the key first: add to its entry instead
+        if (map_insert(&tcp_peer_rtt, &tcp_peer_rtt_stats, &key, &new_hist) != -EEXIST) return 0;
+        hist = bpf_map_lookup_elem(&tcp_peer_rtt, &key);
+        if (!hist) return 0;
     }
+    __sync_fetch_and_add(&hist->slots[slot], 1);
+    __sync_fetch_and_add(&hist->count, 1);
+    __sync_fetch_and_add(&hist->sum_us, rtt_us);
     (__s32)0;
 })""", BpfScalar.S32))
         returnValue(literal(0, BpfScalar.S32))
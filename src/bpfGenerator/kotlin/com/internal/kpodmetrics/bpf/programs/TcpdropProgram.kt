@@ -20,7 +20,7 @@ val tcpdropProgram = ebpf("tcpdrop") {
     license("GPL")
     targetKernel("5.3")
 
-    preamble("#define SKB_DROP_REASON_NOT_SPECIFIED 2")
+    preamble("#define SKB_DROP_REASON_NOT_SPECIFIED 2\n\n$COMMON_PREAMBLE\n\nDEFINE_STATS_MAP(tcp_drops)")
 
     // Emit entire program as conditional raw C
     postamble("""
@@ -35,7 +35,7 @@ int kprobe_tcp_drop(struct pt_regs *ctx)
         __sync_fetch_and_add(&e->count, 1ULL);
     } else {
         struct counter v = { .count = 1ULL };
-        bpf_map_update_elem(&tcp_drops, &key, &v, 1);
+        map_insert(&tcp_drops, &tcp_drops_stats, &key, &v);
     }
     return 0;
 }
@@ -64,7 +64,7 @@ int tp_kfree_skb(struct kfree_skb_args *ctx)
         __sync_fetch_and_add(&e->count, 1ULL);
     } else {
         struct counter v = { .count = 1ULL };
-        bpf_map_update_elem(&tcp_drops, &key, &v, 1);
+        map_insert(&tcp_drops, &tcp_drops_stats, &key, &v);
     }
     return 0;
 }
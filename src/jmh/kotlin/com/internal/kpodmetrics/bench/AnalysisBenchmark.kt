@@ -0,0 +1,100 @@
+package com.internal.kpodmetrics.bench
+
+import com.internal.kpodmetrics.analysis.ChangePoint
+import com.internal.kpodmetrics.analysis.Spike
+import com.internal.kpodmetrics.analysis.TimeSeriesStats
+import com.internal.kpodmetrics.topology.ConnectionRecord
+import com.internal.kpodmetrics.topology.RttRecord
+import com.internal.kpodmetrics.topology.TopologyAggregator
+import com.internal.kpodmetrics.topology.TopologySnapshot
+import org.openjdk.jmh.annotations.Benchmark
+import org.openjdk.jmh.annotations.BenchmarkMode
+import org.openjdk.jmh.annotations.Fork
+import org.openjdk.jmh.annotations.Measurement
+import org.openjdk.jmh.annotations.Mode
+import org.openjdk.jmh.annotations.OutputTimeUnit
+import org.openjdk.jmh.annotations.Param
+import org.openjdk.jmh.annotations.Scope
+import org.openjdk.jmh.annotations.Setup
+import org.openjdk.jmh.annotations.State
+import org.openjdk.jmh.annotations.Warmup
+import java.util.Random
+import java.util.concurrent.TimeUnit
+import kotlin.math.sin
+
+/**
+ * Request-time analysis paths: topology snapshot over a full window of edges and
+ * the [TimeSeriesStats] primitives over one day of one-minute samples.
+ */
+@State(Scope.Benchmark)
+@BenchmarkMode(Mode.AverageTime)
+@OutputTimeUnit(TimeUnit.MICROSECONDS)
+@Warmup(iterations = 3, time = 2)
+@Measurement(iterations = 5, time = 2)
+@Fork(1)
+open class AnalysisBenchmark {
+
+    /** Distinct client→destination edges per collection cycle. */
+    @Param("10000")
+    @JvmField var edges: Int = 0
+
+    @Param("1440")
+    @JvmField var seriesLength: Int = 0
+
+    private lateinit var topology: TopologyAggregator
+    private lateinit var series: List<Double>
+    private lateinit var other: List<Double>
+    private lateinit var sorted: List<Double>
+
+    @Setup
+    fun setup() {
+        val random = Random(42)
+        topology = TopologyAggregator()
+        repeat(10) {
+            topology.ingest(List(edges) { e ->
+                val external = e % 50 == 0
+                ConnectionRecord(
+                    srcNamespace = "ns-${e % 20}", srcPod = "pod-${e % 1000}", srcService = "svc-${e % 300}",
+                    dstId = if (external) "10.${e % 250}.0.1" else "svc-${(e * 7) % 300}",
+                    dstName = if (external) "10.${e % 250}.0.1" else "svc-${(e * 7) % 300}",
+                    dstNamespace = if (external) null else "ns-${e % 20}",
+                    dstType = if (external) "external" else "service",
+                    requestCount = 1L + random.nextInt(100), rttSumUs = random.nextInt(100_000).toLong(),
+                    rttCount = 1L + random.nextInt(100), direction = "client",
+                    remotePort = intArrayOf(80, 443, 6379, 3306, 5432, 9092)[e % 6]
+                )
+            })
+            topology.ingestRtt(List(edges / 10) { e ->
+                RttRecord("svc-${e % 300}", "svc-${(e * 7) % 300}", 1_000, 10,
+                    LongArray(TopologyAggregator.RTT_HISTOGRAM_SLOTS) { random.nextInt(10).toLong() })
+            })
+            topology.ingestTcpDrops(mapOf("svc-1" to 3L, "svc-2" to 7L))
+            topology.advanceWindow()
+        }
+
+        series = List(seriesLength) { i -> 100 + 20 * sin(i / 60.0) + random.nextGaussian() * 5 + if (i == 1000) 80 else 0 }
+        other = series.map { it * 0.5 + random.nextGaussian() }
+        sorted = series.sorted()
+    }
+
+    @Benchmark
+    fun topologySnapshot(): TopologySnapshot = topology.getTopology()
+
+    @Benchmark
+    fun percentile(): Double = TimeSeriesStats.percentile(sorted, 99.0)
+
+    @Benchmark
+    fun rollingMeanStd(): Pair<List<Double>, List<Double>> = TimeSeriesStats.rollingMeanStd(series, 60)
+
+    @Benchmark
+    fun zScoreSpikes(): List<Spike> = TimeSeriesStats.zScoreSpikes(series, 60, 3.0)
+
+    @Benchmark
+    fun cusumChangePoint(): ChangePoint? = TimeSeriesStats.cusumChangePoint(series)
+
+    @Benchmark
+    fun autocorrelation(): List<Double> = TimeSeriesStats.autocorrelation(series, 60)
+
+    @Benchmark
+    fun pearsonCorrelation(): Double = TimeSeriesStats.pearsonCorrelation(series, other)
+}
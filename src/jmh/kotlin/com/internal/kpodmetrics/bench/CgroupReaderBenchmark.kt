@@ -0,0 +1,123 @@
+package com.internal.kpodmetrics.bench
+
+import com.internal.kpodmetrics.cgroup.CgroupReader
+import com.internal.kpodmetrics.cgroup.DiskIOStat
+import com.internal.kpodmetrics.cgroup.MemoryStat
+import com.internal.kpodmetrics.cgroup.NetworkStat
+import com.internal.kpodmetrics.model.CgroupVersion
+import org.openjdk.jmh.annotations.Benchmark
+import org.openjdk.jmh.annotations.BenchmarkMode
+import org.openjdk.jmh.annotations.Fork
+import org.openjdk.jmh.annotations.Measurement
+import org.openjdk.jmh.annotations.Mode
+import org.openjdk.jmh.annotations.OutputTimeUnit
+import org.openjdk.jmh.annotations.Scope
+import org.openjdk.jmh.annotations.Setup
+import org.openjdk.jmh.annotations.State
+import org.openjdk.jmh.annotations.TearDown
+import org.openjdk.jmh.annotations.Warmup
+import java.io.File
+import java.nio.file.Files
+import java.util.concurrent.TimeUnit
+
+/**
+ * Per-container cgroup and procfs parsers over a tmpfs-like fixture tree with
+ * realistic file sizes (full memory.stat, several block devices and interfaces).
+ */
+@State(Scope.Benchmark)
+@BenchmarkMode(Mode.AverageTime)
+@OutputTimeUnit(TimeUnit.MICROSECONDS)
+@Warmup(iterations = 3, time = 2)
+@Measurement(iterations = 5, time = 2)
+@Fork(1)
+open class CgroupReaderBenchmark {
+
+    private lateinit var root: File
+    private lateinit var v2Path: String
+    private lateinit var v1Path: String
+    private lateinit var procRoot: String
+    private val v2 = CgroupReader(CgroupVersion.V2)
+    private val v1 = CgroupReader(CgroupVersion.V1)
+
+    companion object {
+        const val PID = 4242
+
+        private val MEMORY_STAT_KEYS = listOf(
+            "anon", "file", "kernel", "kernel_stack", "pagetables", "sec_pagetables", "percpu", "sock",
+            "vmalloc", "shmem", "zswap", "zswapped", "file_mapped", "file_dirty", "file_writeback",
+            "swapcached", "anon_thp", "file_thp", "shmem_thp", "inactive_anon", "active_anon",
+            "inactive_file", "active_file", "unevictable", "slab_reclaimable", "slab_unreclaimable",
+            "slab", "workingset_refault_anon", "workingset_refault_file", "workingset_activate_anon",
+            "workingset_activate_file", "workingset_restore_anon", "workingset_restore_file",
+            "workingset_nodereclaim", "pgscan", "pgsteal", "pgscan_kswapd", "pgscan_direct",
+            "pgsteal_kswapd", "pgsteal_direct", "pgfault", "pgmajfault", "pgrefill", "pgactivate",
+            "pgdeactivate", "pglazyfree", "pglazyfreed", "thp_fault_alloc", "thp_collapse_alloc"
+        )
+    }
+
+    @Setup
+    fun setup() {
+        root = Files.createTempDirectory("kpod-cgroup-bench").toFile()
+
+        val v2Dir = File(root, "v2").apply { mkdirs() }
+        File(v2Dir, "memory.current").writeText("104857600\n")
+        File(v2Dir, "memory.peak").writeText("209715200\n")
+        File(v2Dir, "memory.swap.current").writeText("0\n")
+        File(v2Dir, "memory.stat").writeText(
+            MEMORY_STAT_KEYS.withIndex().joinToString("") { (i, k) -> "$k ${i * 4096L}\n" }
+        )
+        File(v2Dir, "io.stat").writeText((0 until 8).joinToString("") {
+            "259:$it rbytes=${it * 1_000_000L} wbytes=${it * 2_000_000L} rios=${it * 100} wios=${it * 200} dbytes=0 dios=0\n"
+        })
+        File(v2Dir, "cgroup.procs").writeText("$PID\n${PID + 1}\n")
+        v2Path = v2Dir.path
+
+        val v1Dir = File(root, "v1").apply { mkdirs() }
+        File(v1Dir, "memory.usage_in_bytes").writeText("104857600\n")
+        File(v1Dir, "memory.max_usage_in_bytes").writeText("209715200\n")
+        File(v1Dir, "memory.memsw.usage_in_bytes").writeText("104857600\n")
+        File(v1Dir, "memory.stat").writeText(
+            MEMORY_STAT_KEYS.withIndex().joinToString("") { (i, k) -> "$k ${i * 4096L}\ntotal_$k ${i * 4096L}\n" }
+        )
+        val blkio = (0 until 8).joinToString("") { d ->
+            listOf("Read", "Write", "Sync", "Async", "Discard", "Total")
+                .joinToString("") { op -> "8:$d $op ${d * 1000L}\n" }
+        }
+        File(v1Dir, "blkio.throttle.io_service_bytes").writeText(blkio)
+        File(v1Dir, "blkio.throttle.io_serviced").writeText(blkio)
+        v1Path = v1Dir.path
+
+        val netDir = File(root, "proc/$PID/net").apply { mkdirs() }
+        File(netDir, "dev").writeText(buildString {
+            append("Inter-|   Receive                                                |  Transmit\n")
+            append(" face |bytes    packets errs drop fifo frame compressed multicast|bytes    packets errs drop fifo colls carrier compressed\n")
+            for (iface in listOf("lo", "eth0", "eth1", "veth1a2b3c", "cni0", "flannel.1")) {
+                append("%10s: 123456789 98765 0 1 0 0 0 0 987654321 56789 0 2 0 0 0 0\n".format(iface))
+            }
+        })
+        procRoot = File(root, "proc").path
+    }
+
+    @TearDown
+    fun tearDown() {
+        root.deleteRecursively()
+    }
+
+    @Benchmark
+    fun memoryV2(): MemoryStat? = v2.readMemoryStats(v2Path)
+
+    @Benchmark
+    fun memoryV1(): MemoryStat? = v1.readMemoryStats(v1Path)
+
+    @Benchmark
+    fun diskIOV2(): List<DiskIOStat> = v2.readDiskIO(v2Path)
+
+    @Benchmark
+    fun diskIOV1(): List<DiskIOStat> = v1.readDiskIO(v1Path)
+
+    @Benchmark
+    fun initPid(): Int? = v2.readInitPid(v2Path)
+
+    @Benchmark
+    fun netDev(): List<NetworkStat> = v2.readNetworkStats(procRoot, PID)
+}
@@ -0,0 +1,119 @@
+package com.internal.kpodmetrics.bench
+
+import com.internal.kpodmetrics.bpf.BpfBridge
+import com.internal.kpodmetrics.bpf.BpfProgramManager
+import com.internal.kpodmetrics.bpf.CgroupResolver
+import com.internal.kpodmetrics.bpf.DrainSpec
+import com.internal.kpodmetrics.bpf.MapDrainSnapshot
+import com.internal.kpodmetrics.collector.BiolatencyCollector
+import com.internal.kpodmetrics.collector.CachestatCollector
+import com.internal.kpodmetrics.collector.CpuSchedulingCollector
+import com.internal.kpodmetrics.collector.DnsCollector
+import com.internal.kpodmetrics.collector.ExecsnoopCollector
+import com.internal.kpodmetrics.collector.HardirqsCollector
+import com.internal.kpodmetrics.collector.HttpCollector
+import com.internal.kpodmetrics.collector.KafkaCollector
+import com.internal.kpodmetrics.collector.MongoCollector
+import com.internal.kpodmetrics.collector.MysqlCollector
+import com.internal.kpodmetrics.collector.NetworkCollector
+import com.internal.kpodmetrics.collector.PodIpResolver
+import com.internal.kpodmetrics.collector.RedisCollector
+import com.internal.kpodmetrics.collector.SoftirqsCollector
+import com.internal.kpodmetrics.collector.SyscallCollector
+import com.internal.kpodmetrics.collector.TcpPeerCollector
+import com.internal.kpodmetrics.collector.TcpdropCollector
+import com.internal.kpodmetrics.config.MetricsProperties
+import io.fabric8.kubernetes.client.KubernetesClient
+import io.micrometer.core.instrument.simple.SimpleMeterRegistry
+import io.mockk.every
+import io.mockk.mockk
+import org.openjdk.jmh.annotations.Benchmark
+import org.openjdk.jmh.annotations.BenchmarkMode
+import org.openjdk.jmh.annotations.Fork
+import org.openjdk.jmh.annotations.Measurement
+import org.openjdk.jmh.annotations.Mode
+import org.openjdk.jmh.annotations.OutputTimeUnit
+import org.openjdk.jmh.annotations.Param
+import org.openjdk.jmh.annotations.Scope
+import org.openjdk.jmh.annotations.Setup
+import org.openjdk.jmh.annotations.State
+import org.openjdk.jmh.annotations.Warmup
+import java.util.concurrent.TimeUnit
+
+/**
+ * One collection pass of a BPF collector: drain (served from a snapshot), decode,
+ * cgroup resolution and meter emission. The registry is shared across invocations,
+ * so after warmup this measures the steady state where every series already exists.
+ */
+@State(Scope.Benchmark)
+@BenchmarkMode(Mode.AverageTime)
+@OutputTimeUnit(TimeUnit.MICROSECONDS)
+@Warmup(iterations = 3, time = 2)
+@Measurement(iterations = 5, time = 2)
+@Fork(1)
+open class CollectorBenchmark {
+
+    @Param(
+        "cpu_sched", "net", "syscall", "dns", "tcp_peer", "http", "redis", "mysql", "kafka", "mongo",
+        "biolatency", "cachestat", "tcpdrop", "hardirqs", "softirqs", "execsnoop"
+    )
+    @JvmField var collector: String = ""
+
+    /** Entries per drained map. */
+    @Param("1000", "10000")
+    @JvmField var entries: Int = 0
+
+    @Param("1000")
+    @JvmField var pods: Int = 0
+
+    private lateinit var bridge: BpfBridge
+    private lateinit var collectOnce: () -> Unit
+    private lateinit var recorded: Map<DrainSpec, List<Pair<ByteArray, ByteArray>>>
+
+    @Setup
+    fun setup() {
+        bridge = BpfBridge()
+        val programManager = mockk<BpfProgramManager>()
+        val mapFds = HashMap<Pair<String, String>, Int>()
+        every { programManager.isProgramLoaded(any()) } returns true
+        every { programManager.getMapFd(any(), any()) } answers {
+            mapFds.getOrPut(firstArg<String>() to secondArg<String>()) { 100 + mapFds.size }
+        }
+        val cgroupResolver = CgroupResolver().also { MapSnapshots.registerPods(it, pods) }
+        val registry = SimpleMeterRegistry()
+        val config = MetricsProperties().resolveProfile("comprehensive")
+        val podIpResolver = PodIpResolver(mockk<KubernetesClient>(relaxed = true))
+        val node = "bench-node"
+
+        collectOnce = when (collector) {
+            "cpu_sched" -> CpuSchedulingCollector(bridge, programManager, cgroupResolver, registry, config, node)::collect
+            "net" -> NetworkCollector(bridge, programManager, cgroupResolver, registry, config, node)::collect
+            "syscall" -> SyscallCollector(bridge, programManager, cgroupResolver, registry, config, node)::collect
+            "dns" -> DnsCollector(bridge, programManager, cgroupResolver, registry, config, node)::collect
+            "tcp_peer" -> TcpPeerCollector(bridge, programManager, cgroupResolver, registry, config, node, podIpResolver)::collect
+            "http" -> HttpCollector(bridge, programManager, cgroupResolver, registry, config, node, podIpResolver)::collect
+            "redis" -> RedisCollector(bridge, programManager, cgroupResolver, registry, config, node)::collect
+            "mysql" -> MysqlCollector(bridge, programManager, cgroupResolver, registry, config, node)::collect
+            "kafka" -> KafkaCollector(bridge, programManager, cgroupResolver, registry, config, node)::collect
+            "mongo" -> MongoCollector(bridge, programManager, cgroupResolver, registry, config, node)::collect
+            "biolatency" -> BiolatencyCollector(bridge, programManager, cgroupResolver, registry, config, node)::collect
+            "cachestat" -> CachestatCollector(bridge, programManager, cgroupResolver, registry, config, node)::collect
+            "tcpdrop" -> TcpdropCollector(bridge, programManager, cgroupResolver, registry, config, node)::collect
+            "hardirqs" -> HardirqsCollector(bridge, programManager, cgroupResolver, registry, config, node)::collect
+            "softirqs" -> SoftirqsCollector(bridge, programManager, cgroupResolver, registry, config, node)::collect
+            "execsnoop" -> ExecsnoopCollector(bridge, programManager, cgroupResolver, registry, config, node)::collect
+            else -> throw IllegalArgumentException("unknown collector $collector")
+        }
+        recorded = MapSnapshots.synthesize(MapSnapshots.discover(bridge, collectOnce), entries, pods)
+    }
+
+    @Benchmark
+    fun collect() {
+        bridge.installSnapshot(MapDrainSnapshot(0, recorded))
+        try {
+            collectOnce()
+        } finally {
+            bridge.installSnapshot(null)
+        }
+    }
+}
@@ -0,0 +1,149 @@
+package com.internal.kpodmetrics.bench
+
+import com.internal.kpodmetrics.bpf.BpfProgramManager
+import com.internal.kpodmetrics.bpf.CgroupResolver
+import com.internal.kpodmetrics.bpf.InMemoryBpfBridge
+import com.internal.kpodmetrics.bpf.LoadProfile
+import com.internal.kpodmetrics.bpf.SyntheticLoadGenerator
+import com.internal.kpodmetrics.collector.BiolatencyCollector
+import com.internal.kpodmetrics.collector.BpfMapStatsCollector
+import com.internal.kpodmetrics.collector.BpfOverheadCollector
+import com.internal.kpodmetrics.collector.CachestatCollector
+import com.internal.kpodmetrics.collector.CpuSchedulingCollector
+import com.internal.kpodmetrics.collector.DnsCollector
+import com.internal.kpodmetrics.collector.ExecsnoopCollector
+import com.internal.kpodmetrics.collector.HardirqsCollector
+import com.internal.kpodmetrics.collector.HttpCollector
+import com.internal.kpodmetrics.collector.KafkaCollector
+import com.internal.kpodmetrics.collector.MetricsCollectorService
+import com.internal.kpodmetrics.collector.MongoCollector
+import com.internal.kpodmetrics.collector.MysqlCollector
+import com.internal.kpodmetrics.collector.NetworkCollector
+import com.internal.kpodmetrics.collector.PodIpResolver
+import com.internal.kpodmetrics.collector.RedisCollector
+import com.internal.kpodmetrics.collector.SoftirqsCollector
+import com.internal.kpodmetrics.collector.SyscallCollector
+import com.internal.kpodmetrics.collector.TcpPeerCollector
+import com.internal.kpodmetrics.collector.TcpdropCollector
+import com.internal.kpodmetrics.config.MetricsProperties
+import io.fabric8.kubernetes.client.KubernetesClient
+import io.micrometer.prometheusmetrics.PrometheusConfig
+import io.micrometer.prometheusmetrics.PrometheusMeterRegistry
+import io.mockk.mockk
+import java.lang.management.ManagementFactory
+
+/**
+ * End-to-end collection cycles for a simulated node: every BPF collector wired into
+ * [MetricsCollectorService] against an [InMemoryBpfBridge] that a
+ * [SyntheticLoadGenerator] fills between cycles, scraped by a real Prometheus
+ * registry. Prints one JSON line per cycle and a summary line.
+ *
+ *     ./gradlew loadHarness -Ppods=1000 -PhttpSeries=50000 -PtcpPeers=10000 -Pcycles=20
+ */
+object LoadHarness {
+
+    @JvmStatic
+    fun main(args: Array<String>) {
+        val opts = args.mapNotNull { a -> a.removePrefix("--").split('=', limit = 2).takeIf { it.size == 2 } }
+            .associate { (k, v) -> k to v }
+        val cycles = opts["cycles"]?.toInt() ?: 20
+        require(cycles > 0) { "cycles must be positive" }
+        val warmup = opts["warmup"]?.toInt() ?: 3
+        val intervalSeconds = opts["interval"]?.toDouble() ?: 15.0
+        val profile = LoadProfile(
+            pods = opts["pods"]?.toInt() ?: 1000,
+            eventsPerSecond = opts["eventsPerSecond"]?.toLong() ?: 100_000,
+            cardinality = mapOf(
+                "http" to (opts["httpSeries"]?.toInt() ?: 50_000),
+                "tcp_peer" to (opts["tcpPeers"]?.toInt() ?: 10_000)
+            ),
+            defaultCardinality = opts["keysPerMap"]?.toInt() ?: 2_000
+        )
+
+        val bridge = InMemoryBpfBridge(numCpus = opts["cpus"]?.toInt() ?: 16)
+        val registry = PrometheusMeterRegistry(PrometheusConfig.DEFAULT)
+        val config = MetricsProperties().resolveProfile("comprehensive")
+        val programManager = BpfProgramManager(bridge, "/nonexistent", config, registry).also { it.loadAll() }
+        val cgroupResolver = CgroupResolver().also { SyntheticLoadGenerator.registerPods(it, profile.pods) }
+        val podIpResolver = PodIpResolver(mockk<KubernetesClient>(relaxed = true))
+        val node = "load-node"
+
+        val cpu = CpuSchedulingCollector(bridge, programManager, cgroupResolver, registry, config, node)
+        val net = NetworkCollector(bridge, programManager, cgroupResolver, registry, config, node)
+        val syscall = SyscallCollector(bridge, programManager, cgroupResolver, registry, config, node)
+        val biolatency = BiolatencyCollector(bridge, programManager, cgroupResolver, registry, config, node)
+        val cachestat = CachestatCollector(bridge, programManager, cgroupResolver, registry, config, node)
+        val tcpdrop = TcpdropCollector(bridge, programManager, cgroupResolver, registry, config, node)
+        val hardirqs = HardirqsCollector(bridge, programManager, cgroupResolver, registry, config, node)
+        val softirqs = SoftirqsCollector(bridge, programManager, cgroupResolver, registry, config, node)
+        val execsnoop = ExecsnoopCollector(bridge, programManager, cgroupResolver, registry, config, node)
+        val dns = DnsCollector(bridge, programManager, cgroupResolver, registry, config, node)
+        val tcpPeer = TcpPeerCollector(bridge, programManager, cgroupResolver, registry, config, node, podIpResolver)
+        val http = HttpCollector(bridge, programManager, cgroupResolver, registry, config, node, podIpResolver)
+        val redis = RedisCollector(bridge, programManager, cgroupResolver, registry, config, node)
+        val mysql = MysqlCollector(bridge, programManager, cgroupResolver, registry, config, node)
+        val kafka = KafkaCollector(bridge, programManager, cgroupResolver, registry, config, node)
+        val mongo = MongoCollector(bridge, programManager, cgroupResolver, registry, config, node)
+
+        val layouts = SyntheticLoadGenerator.learn(bridge) {
+            listOf(
+                cpu::collect, net::collect, syscall::collect, biolatency::collect, cachestat::collect,
+                tcpdrop::collect, hardirqs::collect, softirqs::collect, execsnoop::collect, dns::collect,
+                tcpPeer::collect, http::collect, redis::collect, mysql::collect, kafka::collect, mongo::collect
+            ).forEach { it() }
+        }
+        val generator = SyntheticLoadGenerator(bridge, profile, layouts)
+
+        val service = MetricsCollectorService(
+            cpu, net, syscall, biolatency, cachestat, tcpdrop, hardirqs, softirqs, execsnoop,
+            dns, tcpPeer, http, redis, mysql, kafka, mongo,
+            bridge = bridge,
+            programManager = programManager,
+            cgroupResolver = cgroupResolver,
+            bpfMapStatsCollector = BpfMapStatsCollector(bridge, programManager, registry),
+            bpfOverheadCollector = BpfOverheadCollector(bridge, programManager, registry),
+            registry = registry
+        )
+
+        println("""{"maps":${layouts.size},"distinctKeys":${generator.distinctKeys},"profile":"$profile"}""")
+
+        val memory = ManagementFactory.getMemoryMXBean()
+        val gcs = ManagementFactory.getGarbageCollectorMXBeans()
+        val cycleMs = ArrayList<Double>()
+        for (cycle in 0 until warmup + cycles) {
+            val events = generator.tick(intervalSeconds)
+            val gcCountBefore = gcs.sumOf { it.collectionCount }
+            val gcTimeBefore = gcs.sumOf { it.collectionTime }
+
+            val start = System.nanoTime()
+            service.collect()
+            val collectMs = (System.nanoTime() - start) / 1e6
+
+            val scrapeStart = System.nanoTime()
+            val scrapeBytes = registry.scrape().length
+            val scrapeMs = (System.nanoTime() - scrapeStart) / 1e6
+
+            val measured = cycle >= warmup
+            if (measured) cycleMs.add(collectMs)
+            println(
+                """{"cycle":$cycle,"warmup":${!measured},"events":$events,""" +
+                    """"collectMs":${"%.2f".format(collectMs)},"scrapeMs":${"%.2f".format(scrapeMs)},""" +
+                    """"scrapeBytes":$scrapeBytes,"meters":${registry.meters.size},""" +
+                    """"heapUsedMb":${memory.heapMemoryUsage.used shr 20},""" +
+                    """"gcCount":${gcs.sumOf { it.collectionCount } - gcCountBefore},""" +
+                    """"gcMs":${gcs.sumOf { it.collectionTime } - gcTimeBefore}}"""
+            )
+        }
+
+        val evictions = bridge.maps().values.sumOf { it.evictions.get() }
+        cycleMs.sort()
+        println(
+            """{"summary":true,"cycles":${cycleMs.size},""" +
+                """"collectMsP50":${"%.2f".format(cycleMs[cycleMs.size / 2])},""" +
+                """"collectMsMax":${"%.2f".format(cycleMs.last())},""" +
+                """"mapEvictions":$evictions,"meters":${registry.meters.size}}"""
+        )
+        service.close()
+        kotlin.system.exitProcess(0)
+    }
+}
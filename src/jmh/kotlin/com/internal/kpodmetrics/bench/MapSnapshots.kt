@@ -0,0 +1,70 @@
+package com.internal.kpodmetrics.bench
+
+import com.internal.kpodmetrics.bpf.BpfBridge
+import com.internal.kpodmetrics.bpf.CgroupResolver
+import com.internal.kpodmetrics.bpf.DrainSpec
+import com.internal.kpodmetrics.bpf.MapDrainSnapshot
+import com.internal.kpodmetrics.bpf.SyntheticLoadGenerator
+import java.util.Random
+
+/**
+ * Map contents for collector benchmarks. Collectors drain through [BpfBridge], so a
+ * recorded [MapDrainSnapshot] installed on a bridge without the native library feeds
+ * them exactly as live maps would; no JNI call is made.
+ */
+object MapSnapshots {
+
+    /** First cgroup id handed to synthetic pods; ids beyond `pods` are left unresolved. */
+    const val FIRST_CGROUP_ID = SyntheticLoadGenerator.FIRST_CGROUP_ID
+
+    private object Discovered : RuntimeException(null, null, false, false)
+
+    /**
+     * Finds every map [collect] drains. Unknown drains are aborted from the bridge's
+     * drain listener before they reach JNI, then served empty on the next pass, until
+     * a pass completes without a new spec.
+     */
+    fun discover(bridge: BpfBridge, collect: () -> Unit): Set<DrainSpec> {
+        val found = LinkedHashSet<DrainSpec>()
+        while (true) {
+            val before = found.size
+            bridge.installSnapshot(MapDrainSnapshot(0, found.associateWith { emptyList() }))
+            try {
+                bridge.recordDrains({ spec -> if (found.add(spec)) throw Discovered }) { collect() }
+            } catch (_: Discovered) {
+            } finally {
+                bridge.installSnapshot(null)
+            }
+            if (found.size == before) return found
+        }
+    }
+
+    /**
+     * Synthesizes [entries] entries per map: `cgroup_id` (offset 0 in every kpod key)
+     * spread over [pods] pods plus ~5% unknown cgroups, small enum-like values in the
+     * remaining key bytes and small counters in every 8-byte value word.
+     */
+    fun synthesize(
+        specs: Collection<DrainSpec>, entries: Int, pods: Int, seed: Long = 42
+    ): Map<DrainSpec, List<Pair<ByteArray, ByteArray>>> {
+        val random = Random(seed)
+        return specs.associateWith { spec ->
+            List(entries) {
+                val key = ByteArray(spec.keySize)
+                val cgroupId = FIRST_CGROUP_ID + random.nextInt(pods + pods / 20 + 1)
+                for (i in 0 until minOf(8, spec.keySize)) key[i] = (cgroupId ushr (i * 8)).toByte()
+                for (i in 8 until spec.keySize) key[i] = random.nextInt(8).toByte()
+
+                val value = ByteArray(spec.valueSize)
+                for (word in 0 until spec.valueSize / 8) {
+                    val n = 1 + random.nextInt(1000)
+                    value[word * 8] = n.toByte()
+                    value[word * 8 + 1] = (n ushr 8).toByte()
+                }
+                key to value
+            }
+        }
+    }
+
+    fun registerPods(resolver: CgroupResolver, pods: Int) = SyntheticLoadGenerator.registerPods(resolver, pods)
+}
@@ -0,0 +1,97 @@
+package com.internal.kpodmetrics.bench
+
+import com.internal.kpodmetrics.profiling.ElfSymbolResolver
+import com.internal.kpodmetrics.profiling.KallsymsResolver
+import com.internal.kpodmetrics.profiling.PprofBuilder
+import com.internal.kpodmetrics.profiling.ProcMapEntry
+import com.internal.kpodmetrics.profiling.SymbolResolver
+import org.openjdk.jmh.annotations.Benchmark
+import org.openjdk.jmh.annotations.BenchmarkMode
+import org.openjdk.jmh.annotations.Fork
+import org.openjdk.jmh.annotations.Measurement
+import org.openjdk.jmh.annotations.Mode
+import org.openjdk.jmh.annotations.OutputTimeUnit
+import org.openjdk.jmh.annotations.Param
+import org.openjdk.jmh.annotations.Scope
+import org.openjdk.jmh.annotations.Setup
+import org.openjdk.jmh.annotations.State
+import org.openjdk.jmh.annotations.Warmup
+import java.util.Random
+import java.util.concurrent.TimeUnit
+
+/**
+ * Symbol resolution and pprof encoding for one profiling cycle: [samples] stacks
+ * of up to 32 frames drawn from a kallsyms table the size of a stock kernel's.
+ */
+@State(Scope.Benchmark)
+@BenchmarkMode(Mode.AverageTime)
+@OutputTimeUnit(TimeUnit.MICROSECONDS)
+@Warmup(iterations = 3, time = 2)
+@Measurement(iterations = 5, time = 2)
+@Fork(1)
+open class ProfilingBenchmark {
+
+    @Param("5000")
+    @JvmField var samples: Int = 0
+
+    @Param("150000")
+    @JvmField var kernelSymbols: Int = 0
+
+    private lateinit var kallsyms: KallsymsResolver
+    private lateinit var symbolResolver: SymbolResolver
+    private lateinit var elfResolver: ElfSymbolResolver
+    private lateinit var kernelAddrs: LongArray
+    private lateinit var userAddrs: LongArray
+    private lateinit var stacks: List<List<String>>
+    private lateinit var builtProfile: PprofBuilder
+    private var cursor = 0
+
+    companion object {
+        private const val KERNEL_BASE = -0x7e000000L // 0xffffffff82000000
+        private const val USER_BASE = 0x5555_0000_0000L
+    }
+
+    @Setup
+    fun setup() {
+        val random = Random(42)
+        kallsyms = KallsymsResolver.fromLines(List(kernelSymbols) { i ->
+            "%016x T kernel_fn_%d".format(KERNEL_BASE + i * 64L, i)
+        })
+        symbolResolver = SymbolResolver(kallsyms)
+        kernelAddrs = LongArray(4096) { KERNEL_BASE + random.nextInt(kernelSymbols * 64) }
+
+        val maps = List(64) { m ->
+            ProcMapEntry(USER_BASE + m * 0x100000L, USER_BASE + (m + 1) * 0x100000L, 0, "/usr/lib/lib$m.so")
+        }
+        val symtabs = maps.associate { map ->
+            map.pathname to (0 until 2000).associate { s -> s * 0x80L to "${map.pathname.substringAfterLast('/')}_fn_$s" }
+        }
+        elfResolver = ElfSymbolResolver(maps, symtabs)
+        userAddrs = LongArray(4096) { USER_BASE + random.nextInt(64 * 0x100000) }
+
+        stacks = List(samples) {
+            List(4 + random.nextInt(28)) { "kernel_fn_${random.nextInt(2000)}" }
+        }
+        builtProfile = PprofBuilder(10_000_000_000L).also { b -> stacks.forEach { b.addSample(it, 1) } }
+    }
+
+    /** Cached path: the working set of hot kernel frames repeats across cycles. */
+    @Benchmark
+    fun resolveKernelCached(): String = symbolResolver.resolveKernel(kernelAddrs[cursor++ and 4095])
+
+    @Benchmark
+    fun resolveKernelUncached(): String? = kallsyms.resolve(kernelAddrs[cursor++ and 4095])
+
+    @Benchmark
+    fun resolveUser(): String = symbolResolver.resolveUser(userAddrs[cursor++ and 4095], elfResolver)
+
+    @Benchmark
+    fun pprofBuild(): ByteArray = builtProfile.build()
+
+    @Benchmark
+    fun pprofAddAndBuild(): ByteArray {
+        val builder = PprofBuilder(10_000_000_000L)
+        for (stack in stacks) builder.addSample(stack, 1)
+        return builder.build()
+    }
+}
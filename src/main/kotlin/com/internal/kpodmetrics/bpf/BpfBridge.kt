@@ -1,13 +1,34 @@
 package com.internal.kpodmetrics.bpf
 
+import com.internal.kpodmetrics.cgroup.NetworkStat
+import com.internal.kpodmetrics.jfr.MapDrainEvent
 import org.slf4j.LoggerFactory
 
-class BpfBridge {
+/**
+ * JNI bridge to libbpf. Map and stats calls are routed through [nativeExecutor]
+ * (when configured) so virtual-thread collectors do not pin their carriers while
+ * the kernel walks a map.
+ *
+ * The object, map and stats primitives are open so an in-memory implementation
+ * (test fixtures) can stand in for the kernel while the drain, snapshot and
+ * offload logic here stays the same.
+ */
+open class BpfBridge(private val nativeExecutor: NativeCallExecutor? = null) {
     private val log = LoggerFactory.getLogger(BpfBridge::class.java)
     private val handleRegistry = HandleRegistry()
 
+    private val programNames = java.util.concurrent.ConcurrentHashMap<Long, Array<String>>()
+
+    @Volatile private var activeSnapshot: MapDrainSnapshot? = null
+    private val drainListener = ThreadLocal<((DrainSpec) -> Unit)?>()
+    private val drainTallies = java.util.concurrent.ConcurrentHashMap<Int, DrainTally>()
+    private val linkStatsBuffer = ThreadLocal.withInitial { ByteArray(64 * LINK_RECORD_SIZE) }
+
     companion object {
         private var loaded = false
+        private const val LINK_NAME_SIZE = 16
+        private const val LINK_RECORD_SIZE = LINK_NAME_SIZE + 8 * 8
+        private const val ENOSPC = 28
 
         fun loadLibrary() {
             if (!loaded) {
@@ -54,79 +75,202 @@ class BpfBridge {
 
     private external fun nativeGetProgStats(objPtr: Long): LongArray?
 
+    private external fun nativeGetProgramNames(objPtr: Long): Array<String>?
+    private external fun nativeGetProgramStats(objPtr: Long): LongArray?
+    private external fun nativeEnableStats(): Int
+    private external fun nativeCloseFd(fd: Int)
+
     private external fun nativeRingBufNew(mapFd: Int): Long
     private external fun nativeRingBufPoll(rbPtr: Long, maxEvents: Int, eventSize: Int): ByteArray?
     private external fun nativeRingBufFree(rbPtr: Long)
 
+    private external fun nativeNetnsLinkStats(nsPath: String, out: ByteArray): Int
+
+    private external fun nativePsiEpollCreate(): Int
+    private external fun nativePsiTriggerAdd(epollFd: Int, path: String, trigger: String): Int
+    private external fun nativePsiWait(epollFd: Int, out: IntArray, timeoutMs: Int): Int
+
+    private external fun nativeIterAttachCgroup(objPtr: Long, progName: String, cgroupPath: String): Int
+    private external fun nativeIterRead(linkFd: Int, out: ByteArray): Int
+    private external fun nativePageSize(): Int
+
     // --- Public API wrapping JNI with handle safety ---
 
-    fun openObject(path: String): Long {
+    private inline fun <T> offload(crossinline block: () -> T): T {
+        // Charged to the caller's account, measured on the thread that runs the call
+        val cost = NativeCallCost.current()
+        return when {
+            nativeExecutor != null -> nativeExecutor.call { if (cost != null) cost.measure { block() } else block() }
+            cost != null -> cost.measure { block() }
+            else -> block()
+        }
+    }
+
+    protected open fun fetch(spec: DrainSpec): List<Pair<ByteArray, ByteArray>> = when (spec.mode) {
+        DrainMode.BATCH -> batchLookupAndDelete(spec.mapFd, spec.keySize, spec.valueSize, spec.maxEntries)
+        DrainMode.ITERATE -> legacyLookupAndDelete(spec.mapFd, spec.keySize, spec.valueSize)
+    }
+
+    private fun drain(spec: DrainSpec): List<Pair<ByteArray, ByteArray>> {
+        drainListener.get()?.invoke(spec)
+        val entries = activeSnapshot?.take(spec) ?: offload { fetchTallied(spec) }
+        NativeCallCost.current()?.addDrained(entries.size)
+        return entries
+    }
+
+    private fun fetchTallied(spec: DrainSpec): List<Pair<ByteArray, ByteArray>> {
+        val event = MapDrainEvent()
+        event.begin()
+        val entries = fetch(spec)
+        drainTallies.computeIfAbsent(spec.mapFd) { DrainTally() }.record(entries.size)
+        if (event.shouldCommit()) {
+            event.mapFd = spec.mapFd
+            event.mode = spec.mode.name
+            event.entries = entries.size
+            event.commit()
+        }
+        return entries
+    }
+
+    /** What drains have removed from [mapFd] so far, or null if it was never drained. */
+    fun drainTally(mapFd: Int): DrainTally? = drainTallies[mapFd]
+
+    // --- Consistent-snapshot support ---
+
+    /** Drains every map in [specs] back-to-back in one offloaded unit. */
+    fun drainAll(specs: Collection<DrainSpec>): MapDrainSnapshot = offload {
+        val start = System.nanoTime()
+        val entries = LinkedHashMap<DrainSpec, List<Pair<ByteArray, ByteArray>>>(specs.size * 2)
+        for (spec in specs) {
+            entries[spec] = try {
+                fetchTallied(spec)
+            } catch (e: Exception) {
+                log.warn("Snapshot drain of map fd {} failed: {}", spec.mapFd, e.message)
+                continue
+            }
+        }
+        MapDrainSnapshot(System.nanoTime() - start, entries)
+    }
+
+    /** Serves subsequent drain calls from [snapshot]; pass null to go back to live drains. */
+    fun installSnapshot(snapshot: MapDrainSnapshot?) {
+        activeSnapshot = snapshot
+    }
+
+    /** Runs [block] with [listener] notified of every drain the current thread performs. */
+    fun <T> recordDrains(listener: (DrainSpec) -> Unit, block: () -> T): T {
+        val previous = drainListener.get()
+        drainListener.set(listener)
+        try {
+            return block()
+        } finally {
+            drainListener.set(previous)
+        }
+    }
+
+    open fun openObject(path: String): Long {
         val ptr = nativeOpenObject(path)
         return handleRegistry.register(ptr)
     }
 
-    fun loadObject(handle: Long): Int {
+    open fun loadObject(handle: Long): Int {
         val ptr = handleRegistry.resolve(handle)
         return nativeLoadObject(ptr)
     }
 
-    fun attachAll(handle: Long): Int {
+    open fun attachAll(handle: Long): Int {
         val ptr = handleRegistry.resolve(handle)
         return nativeAttachAll(ptr)
     }
 
-    fun destroyObject(handle: Long) {
+    open fun destroyObject(handle: Long) {
         val ptr = handleRegistry.resolve(handle)
         handleRegistry.invalidate(handle)
+        programNames.remove(handle)
         nativeDestroyObject(ptr)
     }
 
-    fun getMapFd(handle: Long, mapName: String): Int {
+    open fun getMapFd(handle: Long, mapName: String): Int {
         val ptr = handleRegistry.resolve(handle)
         return nativeGetMapFd(ptr, mapName)
     }
 
-    fun mapLookup(mapFd: Int, key: ByteArray, valueSize: Int): ByteArray? {
-        return nativeMapLookup(mapFd, key, valueSize)
-    }
+    // Single-element map primitives. They run on whichever thread called them, so the
+    // public wrappers below offload one call or a whole loop of them as one unit.
 
-    fun mapGetNextKey(mapFd: Int, key: ByteArray?, keySize: Int): ByteArray? {
-        return nativeMapGetNextKey(mapFd, key, keySize)
+    protected open fun lookupElem(mapFd: Int, key: ByteArray, valueSize: Int): ByteArray? =
+        nativeMapLookup(mapFd, key, valueSize)
+
+    protected open fun nextKey(mapFd: Int, key: ByteArray?, keySize: Int): ByteArray? =
+        nativeMapGetNextKey(mapFd, key, keySize)
+
+    protected open fun deleteElem(mapFd: Int, key: ByteArray) = nativeMapDelete(mapFd, key)
+
+    protected open fun updateElem(mapFd: Int, key: ByteArray, value: ByteArray, flags: Long) =
+        nativeMapUpdate(mapFd, key, value, flags)
+
+    fun mapLookup(mapFd: Int, key: ByteArray, valueSize: Int): ByteArray? =
+        offload { lookupElem(mapFd, key, valueSize) }
+
+    /** Looks up every key in [keys] in one offloaded unit; null where a key is absent. */
+    fun mapLookupAll(mapFd: Int, keys: List<ByteArray>, valueSize: Int): List<ByteArray?> {
+        if (keys.isEmpty()) return emptyList()
+        return offload { keys.map { lookupElem(mapFd, it, valueSize) } }
     }
 
+    fun mapGetNextKey(mapFd: Int, key: ByteArray?, keySize: Int): ByteArray? =
+        offload { nextKey(mapFd, key, keySize) }
+
     fun mapDelete(mapFd: Int, key: ByteArray) {
-        nativeMapDelete(mapFd, key)
+        offload { deleteElem(mapFd, key) }
     }
 
     fun mapUpdate(mapFd: Int, key: ByteArray, value: ByteArray, flags: Long = 0L) {
-        nativeMapUpdate(mapFd, key, value, flags)
+        offload { updateElem(mapFd, key, value, flags) }
+    }
+
+    /** Writes every (key, value) in [entries] in one offloaded unit. */
+    fun mapUpdateAll(mapFd: Int, entries: List<Pair<ByteArray, ByteArray>>, flags: Long = 0L) {
+        if (entries.isEmpty()) return
+        offload { for ((key, value) in entries) updateElem(mapFd, key, value, flags) }
     }
 
-    fun getNumPossibleCpus(): Int = nativeGetNumPossibleCpus()
+    open fun getNumPossibleCpus(): Int = nativeGetNumPossibleCpus()
 
     /**
      * Lookup a PERCPU_ARRAY element and sum values across all CPUs.
      * Returns the sum as a Long, or null if lookup fails.
      */
-    fun mapLookupPercpuSum(mapFd: Int, key: ByteArray, valueSize: Int): Long? {
+    fun mapLookupPercpuSum(mapFd: Int, key: ByteArray, valueSize: Int): Long? =
+        mapLookupPercpuSums(mapFd, listOf(key), valueSize)[0]
+
+    /** [mapLookupPercpuSum] for several keys of one map, looked up in one offloaded unit. */
+    fun mapLookupPercpuSums(mapFd: Int, keys: List<ByteArray>, valueSize: Int): List<Long?> {
         val numCpus = getNumPossibleCpus()
-        val totalSize = numCpus * valueSize
-        val rawBytes = nativeMapLookup(mapFd, key, totalSize) ?: return null
-        val buf = java.nio.ByteBuffer.wrap(rawBytes).order(java.nio.ByteOrder.LITTLE_ENDIAN)
-        var sum = 0L
-        for (i in 0 until numCpus) {
-            sum += buf.long
+        return mapLookupAll(mapFd, keys, numCpus * valueSize).map { rawBytes ->
+            if (rawBytes == null) return@map null
+            val buf = java.nio.ByteBuffer.wrap(rawBytes).order(java.nio.ByteOrder.LITTLE_ENDIAN)
+            var sum = 0L
+            for (i in 0 until numCpus) {
+                sum += buf.long
+            }
+            sum
         }
-        return sum
     }
 
     /**
      * Batch lookup-and-delete: atomically reads and removes up to maxEntries from a BPF map.
      * Returns a list of (key, value) pairs.
      * Falls back to legacy iterate+lookup+delete if batch is not supported.
+     * The whole drain runs as one offloaded unit.
      */
     fun mapBatchLookupAndDelete(
         mapFd: Int, keySize: Int, valueSize: Int, maxEntries: Int
+    ): List<Pair<ByteArray, ByteArray>> =
+        drain(DrainSpec(mapFd, keySize, valueSize, maxEntries, DrainMode.BATCH))
+
+    private fun batchLookupAndDelete(
+        mapFd: Int, keySize: Int, valueSize: Int, maxEntries: Int
     ): List<Pair<ByteArray, ByteArray>> {
         val keysArray = ByteArray(maxEntries * keySize)
         val valuesArray = ByteArray(maxEntries * valueSize)
@@ -152,41 +296,146 @@ class BpfBridge {
         val keys = mutableListOf<ByteArray>()
         var prevKey: ByteArray? = null
         while (true) {
-            val nextKey = mapGetNextKey(mapFd, prevKey, keySize) ?: break
-            keys.add(nextKey)
-            prevKey = nextKey
+            val next = nextKey(mapFd, prevKey, keySize) ?: break
+            keys.add(next)
+            prevKey = next
         }
         val results = mutableListOf<Pair<ByteArray, ByteArray>>()
         for (k in keys) {
-            val value = mapLookup(mapFd, k, valueSize)
+            val value = lookupElem(mapFd, k, valueSize)
             if (value != null) {
                 results.add(k to value)
             }
-            mapDelete(mapFd, k)
+            deleteElem(mapFd, k)
         }
         return results
     }
 
+    /**
+     * Iterate+lookup+delete for maps where batch ops are unreliable (LRU_HASH batch
+     * returning 0 on some kernels). Keys are collected before lookup so deletions do
+     * not disturb iteration. The whole walk runs as one offloaded unit.
+     */
+    fun mapIterateAndDelete(mapFd: Int, keySize: Int, valueSize: Int): List<Pair<ByteArray, ByteArray>> =
+        drain(DrainSpec(mapFd, keySize, valueSize, 0, DrainMode.ITERATE))
+
     /**
      * Returns [run_time_ns, run_cnt] aggregated across all programs in the object.
      * Requires kernel 5.1+ with bpf_stats_enabled=1 for non-zero values.
      */
-    fun getProgStats(handle: Long): LongArray? {
+    open fun getProgStats(handle: Long): LongArray? {
         val ptr = handleRegistry.resolve(handle)
-        return nativeGetProgStats(ptr)
+        return offload { nativeGetProgStats(ptr) }
     }
 
-    fun perfEventAttach(handle: Long, progName: String, sampleFreq: Int): Int {
+    /**
+     * Per-program stats for every program in the object, with its attach point
+     * (libbpf section name). Names are read once per handle; counters on each call.
+     */
+    open fun getProgramStats(handle: Long): List<BpfProgramStats>? {
+        val ptr = handleRegistry.resolve(handle)
+        val names = programNames.getOrPut(handle) { nativeGetProgramNames(ptr) ?: return null }
+        val stats = offload { nativeGetProgramStats(ptr) } ?: return null
+        return List(minOf(names.size / 2, stats.size / 3)) { i ->
+            BpfProgramStats(
+                name = names[i * 2],
+                attachPoint = names[i * 2 + 1],
+                runTimeNs = stats[i * 3],
+                runCount = stats[i * 3 + 1],
+                recursionMisses = stats[i * 3 + 2]
+            )
+        }
+    }
+
+    /**
+     * Turns on run-time stats via BPF_ENABLE_STATS for as long as the returned fd
+     * stays open (kernel 5.8+). Returns a negative errno when unsupported.
+     */
+    open fun enableStats(): Int = nativeEnableStats()
+
+    open fun closeStatsFd(fd: Int) = nativeCloseFd(fd)
+
+    open fun perfEventAttach(handle: Long, progName: String, sampleFreq: Int): Int {
         val ptr = handleRegistry.resolve(handle)
         return nativePerfEventAttach(ptr, progName, sampleFreq)
     }
 
-    fun ringBufNew(mapFd: Int): Long = nativeRingBufNew(mapFd)
+    open fun ringBufNew(mapFd: Int): Long = nativeRingBufNew(mapFd)
 
-    fun ringBufPoll(rbPtr: Long, maxEvents: Int, eventSize: Int): ByteArray? =
+    open fun ringBufPoll(rbPtr: Long, maxEvents: Int, eventSize: Int): ByteArray? =
         nativeRingBufPoll(rbPtr, maxEvents, eventSize)
 
-    fun ringBufFree(rbPtr: Long) = nativeRingBufFree(rbPtr)
+    open fun ringBufFree(rbPtr: Long) = nativeRingBufFree(rbPtr)
+
+    /**
+     * Interface counters (IFLA_STATS64) of every link in the network namespace at
+     * [nsPath], e.g. `/proc/<pid>/ns/net`, from one RTM_GETLINK netlink dump.
+     * Returns null if the namespace cannot be entered or dumped.
+     */
+    open fun netnsLinkStats(nsPath: String): List<NetworkStat>? = offload {
+        var buf = linkStatsBuffer.get()
+        var count = nativeNetnsLinkStats(nsPath, buf)
+        if (count == -ENOSPC) {
+            buf = ByteArray(buf.size * 4)
+            linkStatsBuffer.set(buf)
+            count = nativeNetnsLinkStats(nsPath, buf)
+        }
+        if (count < 0) {
+            log.debug("Netlink link dump of {} failed: errno {}", nsPath, -count)
+            return@offload null
+        }
+        val bb = java.nio.ByteBuffer.wrap(buf).order(java.nio.ByteOrder.LITTLE_ENDIAN)
+        List(count) { i ->
+            val base = i * LINK_RECORD_SIZE
+            var nameLen = 0
+            while (nameLen < LINK_NAME_SIZE && buf[base + nameLen] != 0.toByte()) nameLen++
+            fun stat(idx: Int) = bb.getLong(base + LINK_NAME_SIZE + idx * 8)
+            NetworkStat(
+                interfaceName = String(buf, base, nameLen, Charsets.US_ASCII),
+                rxBytes = stat(0), rxPackets = stat(1), rxErrors = stat(2), rxDrops = stat(3),
+                txBytes = stat(4), txPackets = stat(5), txErrors = stat(6), txDrops = stat(7)
+            )
+        }
+    }
+
+    /** epoll instance for PSI triggers; returns the fd or a negative errno. */
+    open fun psiEpollCreate(): Int = nativePsiEpollCreate()
+
+    /**
+     * Arms a PSI [trigger] (e.g. `some 150000 1000000`) on the cgroup pressure file
+     * at [path] and adds it to [epollFd]. Returns the trigger fd, closed with
+     * [closeFd] to disarm, or a negative errno.
+     */
+    open fun psiTriggerAdd(epollFd: Int, path: String, trigger: String): Int =
+        nativePsiTriggerAdd(epollFd, path, trigger)
+
+    /**
+     * Blocks up to [timeoutMs] for trigger events; fills [out] with `fd, revents`
+     * pairs and returns the pair count, or a negative errno. Called directly on the
+     * monitor's own thread rather than offloaded, since it blocks by design.
+     */
+    open fun psiWait(epollFd: Int, out: IntArray, timeoutMs: Int): Int =
+        nativePsiWait(epollFd, out, timeoutMs)
+
+    open fun closeFd(fd: Int) = nativeCloseFd(fd)
+
+    /**
+     * Attaches the cgroup iterator program [progName] of the object to the cgroup
+     * directory [cgroupPath], walking its subtree in pre-order. Returns the link fd,
+     * released with the object, or a negative errno.
+     */
+    open fun iterAttachCgroup(handle: Long, progName: String, cgroupPath: String): Int {
+        val ptr = handleRegistry.resolve(handle)
+        return nativeIterAttachCgroup(ptr, progName, cgroupPath)
+    }
+
+    /**
+     * Runs one pass of the iterator behind [linkFd] into [out]. Returns the byte
+     * count, -ENOSPC (-28) if [out] is too small, or a negative errno.
+     */
+    open fun iterRead(linkFd: Int, out: ByteArray): Int = offload { nativeIterRead(linkFd, out) }
+
+    open fun pageSize(): Int = nativePageSize()
 
     fun <T> withBpfObject(path: String, block: (Long) -> T): T {
         val handle = openObject(path)
@@ -7,7 +7,7 @@ import org.slf4j.LoggerFactory
 import java.util.concurrent.atomic.AtomicInteger
 
 class BpfProgramManager(
-    private val bridge: BpfBridge,
+    val bridge: BpfBridge,
     private val programDir: String,
     private val config: ResolvedConfig,
     private val registry: MeterRegistry? = null
@@ -20,6 +20,7 @@ class BpfProgramManager(
     private val loadedCount = AtomicInteger(0)
     private val failedCount = AtomicInteger(0)
     private val resolvedProgramDir: String = detectProgramDir(programDir)
+    @Volatile private var statsFd = -1
 
     init {
         registry?.gauge("kpod.bpf.programs.loaded", loadedCount)
@@ -145,6 +146,36 @@ class BpfProgramManager(
         }
     }
 
+    /**
+     * Loads the cgroup stats iterator and attaches it to [cgroupPath]. Returns the
+     * iterator link fd, or -1 if the kernel has no cgroup iterator (before 6.1,
+     * legacy objects) and the text readers should be used.
+     */
+    fun loadCgroupStatsIter(cgroupPath: String): Int {
+        val path = "$resolvedProgramDir/cgroup_stats.bpf.o"
+        if (!java.io.File(path).exists()) return -1
+        var handle = 0L
+        try {
+            log.info("Loading cgroup stats iterator: {}", path)
+            handle = bridge.openObject(path)
+            bridge.loadObject(handle)
+            val linkFd = bridge.iterAttachCgroup(handle, "dump_cgroup_stats", cgroupPath)
+            if (linkFd < 0) {
+                log.info("Cgroup iterator unavailable (errno {}), reading cgroup stat files", -linkFd)
+                bridge.destroyObject(handle)
+                return -1
+            }
+            loadedPrograms["cgroup_stats"] = handle
+            loadedCount.set(loadedPrograms.size)
+            log.info("Cgroup stats iterator attached to {}", cgroupPath)
+            return linkFd
+        } catch (e: Exception) {
+            log.warn("Failed to load cgroup stats iterator, reading cgroup stat files: {}", e.message)
+            if (handle != 0L) runCatching { bridge.destroyObject(handle) }
+            return -1
+        }
+    }
+
     fun destroyAll() {
         loadedPrograms.forEach { (name, handle) ->
             try {
@@ -155,6 +186,14 @@ class BpfProgramManager(
             }
         }
         loadedPrograms.clear()
+        if (statsFd >= 0) {
+            try {
+                bridge.closeStatsFd(statsFd)
+            } catch (e: Exception) {
+                log.debug("Failed to close BPF stats fd: {}", e.message)
+            }
+            statsFd = -1
+        }
     }
 
     fun getMapFd(programName: String, mapName: String): Int {
@@ -169,7 +208,24 @@ class BpfProgramManager(
 
     fun getHandle(programName: String): Long? = loadedPrograms[programName]
 
+    /**
+     * Prefers the fd-scoped BPF_ENABLE_STATS (kernel 5.8+), which keeps run-time
+     * stats on only while this process holds the fd and leaves the node-wide
+     * sysctl alone. Falls back to kernel.bpf_stats_enabled on older kernels.
+     */
     private fun enableBpfStats() {
+        if (statsFd >= 0) return
+        try {
+            val fd = bridge.enableStats()
+            if (fd >= 0) {
+                statsFd = fd
+                log.info("Enabled BPF program stats via BPF_ENABLE_STATS (fd-scoped)")
+                return
+            }
+            log.debug("BPF_ENABLE_STATS unavailable (errno {}), falling back to sysctl", -fd)
+        } catch (e: Exception) {
+            log.debug("BPF_ENABLE_STATS failed: {}", e.message)
+        }
         try {
             val statsFile = java.io.File("/proc/sys/kernel/bpf_stats_enabled")
             if (statsFile.exists() && statsFile.readText().trim() != "1") {
@@ -183,121 +239,54 @@ class BpfProgramManager(
 
     fun configureDnsPorts(ports: List<Int>) {
         if (!isProgramLoaded("dns")) return
-        val mapFd = getMapFd("dns", "dns_ports")
-        for (port in ports) {
-            val keyBytes = java.nio.ByteBuffer.allocate(8)
-                .order(java.nio.ByteOrder.LITTLE_ENDIAN)
-                .putShort(port.toShort())
-                .putShort(0)  // _pad1
-                .putInt(0)    // _pad2
-                .array()
-            val valueBytes = java.nio.ByteBuffer.allocate(8)
-                .order(java.nio.ByteOrder.LITTLE_ENDIAN)
-                .put(1.toByte())  // enabled
-                .put(ByteArray(7))  // _pad
-                .array()
-            bridge.mapUpdate(mapFd, keyBytes, valueBytes)
-        }
+        writePortFilter(getMapFd("dns", "dns_ports"), ports)
         log.info("DNS port filter configured: {}", ports)
     }
 
     fun configureHttpPorts(ports: List<Int>) {
         if (!isProgramLoaded("http")) return
-        val mapFd = getMapFd("http", "http_ports")
-        for (port in ports) {
-            val keyBytes = java.nio.ByteBuffer.allocate(8)
-                .order(java.nio.ByteOrder.LITTLE_ENDIAN)
-                .putShort(port.toShort())
-                .putShort(0)  // _pad1
-                .putInt(0)    // _pad2
-                .array()
-            val valueBytes = java.nio.ByteBuffer.allocate(8)
-                .order(java.nio.ByteOrder.LITTLE_ENDIAN)
-                .put(1.toByte())  // enabled
-                .put(ByteArray(7))  // _pad
-                .array()
-            bridge.mapUpdate(mapFd, keyBytes, valueBytes)
-        }
+        writePortFilter(getMapFd("http", "http_ports"), ports)
         log.info("HTTP port filter configured: {}", ports)
     }
 
     fun configureRedisPorts(ports: List<Int>) {
         if (!isProgramLoaded("redis")) return
-        val mapFd = getMapFd("redis", "redis_ports")
-        for (port in ports) {
-            val keyBytes = java.nio.ByteBuffer.allocate(8)
-                .order(java.nio.ByteOrder.LITTLE_ENDIAN)
-                .putShort(port.toShort())
-                .putShort(0)  // _pad1
-                .putInt(0)    // _pad2
-                .array()
-            val valueBytes = java.nio.ByteBuffer.allocate(8)
-                .order(java.nio.ByteOrder.LITTLE_ENDIAN)
-                .put(1.toByte())  // enabled
-                .put(ByteArray(7))  // _pad
-                .array()
-            bridge.mapUpdate(mapFd, keyBytes, valueBytes)
-        }
+        writePortFilter(getMapFd("redis", "redis_ports"), ports)
         log.info("Redis port filter configured: {}", ports)
     }
 
     fun configureMysqlPorts(ports: List<Int>) {
         if (!isProgramLoaded("mysql")) return
-        val mapFd = getMapFd("mysql", "mysql_ports")
-        for (port in ports) {
-            val keyBytes = java.nio.ByteBuffer.allocate(8)
-                .order(java.nio.ByteOrder.LITTLE_ENDIAN)
-                .putShort(port.toShort())
-                .putShort(0)  // _pad1
-                .putInt(0)    // _pad2
-                .array()
-            val valueBytes = java.nio.ByteBuffer.allocate(8)
-                .order(java.nio.ByteOrder.LITTLE_ENDIAN)
-                .put(1.toByte())  // enabled
-                .put(ByteArray(7))  // _pad
-                .array()
-            bridge.mapUpdate(mapFd, keyBytes, valueBytes)
-        }
+        writePortFilter(getMapFd("mysql", "mysql_ports"), ports)
         log.info("MySQL port filter configured: {}", ports)
     }
 
     fun configureKafkaPorts(ports: List<Int>) {
         if (!isProgramLoaded("kafka")) return
-        val mapFd = getMapFd("kafka", "kafka_ports")
-        for (port in ports) {
-            val keyBytes = java.nio.ByteBuffer.allocate(8)
-                .order(java.nio.ByteOrder.LITTLE_ENDIAN)
-                .putShort(port.toShort())
-                .putShort(0)  // _pad1
-                .putInt(0)    // _pad2
-                .array()
-            val valueBytes = java.nio.ByteBuffer.allocate(8)
-                .order(java.nio.ByteOrder.LITTLE_ENDIAN)
-                .put(1.toByte())  // enabled
-                .put(ByteArray(7))  // _pad
-                .array()
-            bridge.mapUpdate(mapFd, keyBytes, valueBytes)
-        }
+        writePortFilter(getMapFd("kafka", "kafka_ports"), ports)
         log.info("Kafka port filter configured: {}", ports)
     }
 
     fun configureMongoPorts(ports: List<Int>) {
         if (!isProgramLoaded("mongo")) return
-        val mapFd = getMapFd("mongo", "mongo_ports")
-        for (port in ports) {
-            val keyBytes = java.nio.ByteBuffer.allocate(8)
+        writePortFilter(getMapFd("mongo", "mongo_ports"), ports)
+        log.info("MongoDB port filter configured: {}", ports)
+    }
+
+    /** Enables [ports] in a protocol's `<proto>_ports` filter map, all in one offloaded call. */
+    private fun writePortFilter(mapFd: Int, ports: List<Int>) {
+        val enabled = java.nio.ByteBuffer.allocate(8)
+            .order(java.nio.ByteOrder.LITTLE_ENDIAN)
+            .put(1.toByte())  // enabled
+            .put(ByteArray(7))  // _pad
+            .array()
+        bridge.mapUpdateAll(mapFd, ports.map { port ->
+            java.nio.ByteBuffer.allocate(8)
                 .order(java.nio.ByteOrder.LITTLE_ENDIAN)
                 .putShort(port.toShort())
                 .putShort(0)  // _pad1
                 .putInt(0)    // _pad2
-                .array()
-            val valueBytes = java.nio.ByteBuffer.allocate(8)
-                .order(java.nio.ByteOrder.LITTLE_ENDIAN)
-                .put(1.toByte())  // enabled
-                .put(ByteArray(7))  // _pad
-                .array()
-            bridge.mapUpdate(mapFd, keyBytes, valueBytes)
-        }
-        log.info("MongoDB port filter configured: {}", ports)
+                .array() to enabled
+        })
     }
 }
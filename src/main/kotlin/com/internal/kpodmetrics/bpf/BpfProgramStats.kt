@@ -0,0 +1,13 @@
+package com.internal.kpodmetrics.bpf
+
+/**
+ * Cumulative kernel stats for one BPF program. [attachPoint] is the libbpf section
+ * name, e.g. `tracepoint/sched/sched_switch` or `kprobe/tcp_sendmsg`.
+ */
+data class BpfProgramStats(
+    val name: String,
+    val attachPoint: String,
+    val runTimeNs: Long,
+    val runCount: Long,
+    val recursionMisses: Long
+)
@@ -1,7 +1,7 @@
 package com.internal.kpodmetrics.bpf
 
-import java.time.Instant
-import java.util.concurrent.ConcurrentHashMap
+import java.util.concurrent.atomic.AtomicInteger
+import java.util.concurrent.atomic.AtomicLongArray
 
 data class PodInfo(
     val podUid: String,
@@ -16,18 +16,109 @@ data class CgroupContainerInfo(
     val containerId: String
 )
 
-data class GraceCacheEntry(val podInfo: PodInfo, val deletedAt: Instant)
+/**
+ * Maps cgroup ids (from bpf_get_current_cgroup_id) to pod containers. Every
+ * collector calls [resolve] for every map entry each cycle, so lookups must be cheap
+ * and must not allocate.
+ *
+ * Ids live in an open-addressing table of primitive keys with linear probing; the
+ * probe returns the slot of the container, whose [PodInfo] sits at the same index of
+ * a parallel array. The table is copy-on-write: writers (pod registration and
+ * deletion, rare next to lookups) copy it under a lock and publish the copy through
+ * a volatile field, so [resolve] takes no lock and boxes nothing.
+ *
+ * Deleted containers stay resolvable for a grace period, so in-flight map entries
+ * are still attributed. Ids that miss (system slices, host processes, containers
+ * not registered yet) are kept in a bounded negative cache tagged with the
+ * registration [generation]. Registering a new container starts a new generation and
+ * expires the whole cache, so an id first seen before its pod was registered is not
+ * remembered as a non-pod; [isKnownMiss] tells callers whether retrying an id can
+ * succeed yet. The collectors' UnresolvedBuffer uses it to skip retries that cannot.
+ */
+class CgroupResolver(
+    private val clock: () -> Long = System::currentTimeMillis
+) {
+    private class Table(
+        val keys: LongArray,
+        val infos: Array<PodInfo?>,
+        // 0 for live containers, else when the container was deleted (grace period)
+        val deletedAt: LongArray,
+        val used: Int,
+        val live: Int
+    ) {
+        val mask = keys.size - 1
 
-class CgroupResolver {
-    private val cache = ConcurrentHashMap<Long, PodInfo>()
-    private val graceCache = ConcurrentHashMap<Long, GraceCacheEntry>()
-    // Negative cache: cgroup IDs that are NOT pods (system slices, host processes).
-    // Avoids repeated failed lookups for non-container cgroup IDs (Coroot #158, #222).
-    private val negativeCgroupCache = ConcurrentHashMap.newKeySet<Long>()
+        fun find(cgroupId: Long): Int {
+            var i = slot(cgroupId, mask)
+            while (true) {
+                val k = keys[i]
+                if (k == cgroupId) return i
+                if (k == EMPTY) return -1
+                i = (i + 1) and mask
+            }
+        }
+    }
+
+    /** Ids that missed in one generation; lock-free reads and inserts, at most [limit]. */
+    private class NegativeCache(val generation: Int, capacity: Int) {
+        val keys = AtomicLongArray(capacity)
+        val mask = capacity - 1
+        val count = AtomicInteger()
+        // Half full at most, to keep probes short, and never above the size cap
+        val limit = minOf(capacity / 2, MAX_NEGATIVE_CACHE_SIZE)
+
+        fun contains(cgroupId: Long): Boolean {
+            var i = slot(cgroupId, mask)
+            while (true) {
+                val k = keys.get(i)
+                if (k == cgroupId) return true
+                if (k == EMPTY) return false
+                i = (i + 1) and mask
+            }
+        }
+
+        /** Adds [cgroupId]; false when the cache is at its [limit]. */
+        fun add(cgroupId: Long): Boolean {
+            if (count.get() >= limit) return false
+            var i = slot(cgroupId, mask)
+            while (true) {
+                val k = keys.get(i)
+                if (k == cgroupId) return true
+                if (k == EMPTY) {
+                    if (keys.compareAndSet(i, EMPTY, cgroupId)) {
+                        count.incrementAndGet()
+                        return true
+                    }
+                    continue // lost the slot to a concurrent add, look at it again
+                }
+                i = (i + 1) and mask
+            }
+        }
+    }
+
+    @Volatile
+    private var table = Table(LongArray(INITIAL_CAPACITY), arrayOfNulls(INITIAL_CAPACITY), LongArray(INITIAL_CAPACITY), 0, 0)
+    @Volatile
+    private var negative = NegativeCache(0, INITIAL_NEGATIVE_CAPACITY)
+
+    /** Incremented whenever a new cgroup id is registered. */
+    @Volatile
+    var generation = 0
+        private set
 
     companion object {
         private const val MAX_GRACE_CACHE_SIZE = 10_000
         private const val MAX_NEGATIVE_CACHE_SIZE = 50_000
+        private const val GRACE_PERIOD_MS = 5_000L
+        private const val INITIAL_CAPACITY = 1024
+        private const val INITIAL_NEGATIVE_CAPACITY = 256
+        // Cgroup ids are inode numbers, never 0
+        private const val EMPTY = 0L
+
+        private fun slot(cgroupId: Long, mask: Int): Int {
+            val h = cgroupId * -7046029254386353131L
+            return (h xor (h ushr 32)).toInt() and mask
+        }
 
         private val SYSTEMD_PATTERN = Regex(
             "kubepods-(?:burstable|besteffort|guaranteed)-pod([a-f0-9]+)\\.slice/" +
@@ -56,38 +147,132 @@ class CgroupResolver {
     }
 
     fun register(cgroupId: Long, podInfo: PodInfo) {
-        cache[cgroupId] = podInfo
-        negativeCgroupCache.remove(cgroupId)
+        if (cgroupId == EMPTY) return
+        synchronized(this) {
+            val t = table
+            val i = t.find(cgroupId)
+            if (i >= 0 && t.deletedAt[i] == 0L && t.infos[i] == podInfo) return
+            table = if (i >= 0) {
+                // Same capacity keeps every key at its slot
+                copy(t, t.keys.size, used = t.used, live = if (t.deletedAt[i] == 0L) t.live else t.live + 1).also {
+                    it.infos[i] = podInfo
+                    it.deletedAt[i] = 0L
+                }
+            } else {
+                val capacity = if ((t.used + 1) * 2 > t.keys.size) t.keys.size * 2 else t.keys.size
+                copy(t, capacity, used = t.used + 1, live = t.live + 1).also { insert(it, cgroupId, podInfo, 0L) }
+            }
+            if (i < 0) generation++
+        }
     }
 
     fun resolve(cgroupId: Long): PodInfo? {
-        if (cgroupId in negativeCgroupCache) return null
-        val result = cache[cgroupId] ?: graceCache[cgroupId]?.podInfo
-        if (result == null && negativeCgroupCache.size < MAX_NEGATIVE_CACHE_SIZE) {
-            negativeCgroupCache.add(cgroupId)
-        }
-        return result
+        val t = table
+        val i = t.find(cgroupId)
+        if (i >= 0) return t.infos[i]
+        rememberMiss(cgroupId)
+        return null
+    }
+
+    /** True if [cgroupId] missed since the last registration of a new container. */
+    fun isKnownMiss(cgroupId: Long): Boolean {
+        val n = negative
+        return n.generation == generation && n.contains(cgroupId)
     }
 
     fun evict(cgroupId: Long) {
-        cache.remove(cgroupId)
+        synchronized(this) {
+            val t = table
+            val i = t.find(cgroupId)
+            if (i < 0) return
+            table = rebuild(t, t.keys.size) { j -> j != i }
+        }
     }
 
     fun onPodDeleted(cgroupId: Long) {
-        val podInfo = cache.remove(cgroupId) ?: return
-        graceCache[cgroupId] = GraceCacheEntry(podInfo, Instant.now())
+        synchronized(this) {
+            val t = table
+            val i = t.find(cgroupId)
+            if (i < 0 || t.deletedAt[i] != 0L) return
+            table = copy(t, t.keys.size, used = t.used, live = t.live - 1).also { it.deletedAt[i] = clock() }
+        }
     }
 
     fun pruneGraceCache() {
-        val cutoff = Instant.now().minusSeconds(5)
-        graceCache.entries.removeIf { it.value.deletedAt.isBefore(cutoff) }
-        if (graceCache.size > MAX_GRACE_CACHE_SIZE) {
-            graceCache.entries
-                .sortedBy { it.value.deletedAt }
-                .take(graceCache.size - MAX_GRACE_CACHE_SIZE)
-                .forEach { graceCache.remove(it.key) }
+        synchronized(this) {
+            val t = table
+            val cutoff = clock() - GRACE_PERIOD_MS
+            var graceCount = 0
+            var expired = 0
+            for (i in t.keys.indices) {
+                val d = t.deletedAt[i]
+                if (d == 0L) continue
+                if (d < cutoff) expired++ else graceCount++
+            }
+            if (expired == 0 && graceCount <= MAX_GRACE_CACHE_SIZE) return
+            // Over the cap, keep only the most recently deleted entries
+            val keepAfter = if (graceCount <= MAX_GRACE_CACHE_SIZE) cutoff else {
+                t.deletedAt.filter { it >= cutoff }.sortedDescending()[MAX_GRACE_CACHE_SIZE]
+            }
+            table = rebuild(t, t.keys.size) { j -> t.deletedAt[j] == 0L || t.deletedAt[j] > keepAfter }
         }
     }
 
-    fun size(): Int = cache.size
+    fun size(): Int = table.live
+
+    /** Distinct ids that missed in the current generation. */
+    fun negativeCacheSize(): Int {
+        val n = negative
+        return if (n.generation == generation) n.count.get() else 0
+    }
+
+    private fun rememberMiss(cgroupId: Long) {
+        if (cgroupId == EMPTY) return
+        val gen = generation
+        val n = negative
+        if (n.generation == gen) {
+            if (n.add(cgroupId)) return
+            // At its limit: grow until the limit is the size cap, then stop caching misses
+            if (n.limit >= MAX_NEGATIVE_CACHE_SIZE) return
+        }
+        val capacity = if (n.generation == gen) n.keys.length() * 2 else INITIAL_NEGATIVE_CAPACITY
+        val next = NegativeCache(gen, capacity)
+        if (n.generation == gen) {
+            for (i in 0 until n.keys.length()) {
+                val k = n.keys.get(i)
+                if (k != EMPTY) next.add(k)
+            }
+        }
+        next.add(cgroupId)
+        // A concurrent miss may replace it too; losing a few entries only costs re-adding them
+        negative = next
+    }
+
+    private fun copy(t: Table, capacity: Int, used: Int, live: Int): Table {
+        if (capacity == t.keys.size) {
+            return Table(t.keys.copyOf(), t.infos.copyOf(), t.deletedAt.copyOf(), used, live)
+        }
+        return rebuild(t, capacity) { true }.let { Table(it.keys, it.infos, it.deletedAt, used, live) }
+    }
+
+    private inline fun rebuild(t: Table, capacity: Int, keep: (Int) -> Boolean): Table {
+        val next = Table(LongArray(capacity), arrayOfNulls(capacity), LongArray(capacity), 0, 0)
+        var used = 0
+        var live = 0
+        for (i in t.keys.indices) {
+            if (t.keys[i] == EMPTY || !keep(i)) continue
+            insert(next, t.keys[i], t.infos[i], t.deletedAt[i])
+            used++
+            if (t.deletedAt[i] == 0L) live++
+        }
+        return Table(next.keys, next.infos, next.deletedAt, used, live)
+    }
+
+    private fun insert(t: Table, cgroupId: Long, podInfo: PodInfo?, deletedAt: Long) {
+        var i = slot(cgroupId, t.mask)
+        while (t.keys[i] != EMPTY) i = (i + 1) and t.mask
+        t.keys[i] = cgroupId
+        t.infos[i] = podInfo
+        t.deletedAt[i] = deletedAt
+    }
 }
@@ -0,0 +1,63 @@
+package com.internal.kpodmetrics.bpf
+
+import java.util.concurrent.ConcurrentHashMap
+import java.util.concurrent.atomic.AtomicInteger
+import java.util.concurrent.atomic.AtomicLong
+
+/** How a map is drained: batch lookup-and-delete or iterate+lookup+delete. */
+enum class DrainMode { BATCH, ITERATE }
+
+/** Identifies one drain call; two calls with equal specs read the same data. */
+data class DrainSpec(
+    val mapFd: Int,
+    val keySize: Int,
+    val valueSize: Int,
+    val maxEntries: Int,
+    val mode: DrainMode
+)
+
+/**
+ * Result of draining a set of BPF maps back-to-back. While installed on
+ * [BpfBridge], each drain call whose spec is in the snapshot is served from it
+ * exactly once instead of hitting the kernel.
+ */
+class MapDrainSnapshot(
+    val drainDurationNs: Long,
+    entries: Map<DrainSpec, List<Pair<ByteArray, ByteArray>>>
+) {
+    private val remaining = ConcurrentHashMap<DrainSpec, List<Pair<ByteArray, ByteArray>>>(entries)
+
+    val mapCount: Int = entries.size
+    val entryCount: Int = entries.values.sumOf { it.size }
+
+    fun take(spec: DrainSpec): List<Pair<ByteArray, ByteArray>>? = remaining.remove(spec)
+
+    /** Specs drained in phase 1 but never read back by a collector. */
+    fun unconsumed(): Set<DrainSpec> = remaining.keys.toSet()
+}
+
+/**
+ * Running totals of what drains removed from one map, whether read live or into
+ * a [MapDrainSnapshot]. Compared with the in-kernel insert count this tells how
+ * many entries left the map some other way (LRU eviction).
+ */
+class DrainTally {
+    private val drainCount = AtomicLong()
+    private val entryCount = AtomicLong()
+    private val peak = AtomicInteger()
+
+    /** Number of drains so far. */
+    val drains: Long get() = drainCount.get()
+
+    /** Entries removed by all drains so far. */
+    val entries: Long get() = entryCount.get()
+
+    fun record(drained: Int) {
+        entryCount.addAndGet(drained.toLong())
+        peak.accumulateAndGet(drained) { a, b -> maxOf(a, b) }
+        drainCount.incrementAndGet()
+    }
+
+    /** Largest single drain since the previous call, i.e. the occupancy high-water mark. */
+    fun takePeak(): Int = peak.getAndSet(0)
+}
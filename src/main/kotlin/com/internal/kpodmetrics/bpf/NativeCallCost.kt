@@ -0,0 +1,85 @@
+package com.internal.kpodmetrics.bpf
+
+import java.util.concurrent.atomic.AtomicLong
+
+/**
+ * Wall time, thread CPU time and allocated bytes spent inside native BPF calls made
+ * while this account is [bind]-ed to the calling thread. [BpfBridge] charges each
+ * offloaded call to the caller's account, measured on whichever thread runs it: a
+ * [NativeCallExecutor] platform thread, or the caller itself. The part that ran on
+ * the caller's own thread is kept separately so callers measuring their thread as
+ * a whole can subtract it.
+ *
+ * CPU and allocation are summed only where the JVM can measure them (not on
+ * virtual threads); wall time and call count always are. Map drains also count the
+ * entries they hand back, whether read live or served from a snapshot.
+ */
+class NativeCallCost {
+    private val owner: Thread = Thread.currentThread()
+    private val callCount = AtomicLong()
+    private val wall = AtomicLong()
+    private val cpu = AtomicLong()
+    private val alloc = AtomicLong()
+    private val inlineCpu = AtomicLong()
+    private val inlineAlloc = AtomicLong()
+    private val drained = AtomicLong()
+
+    val calls: Long get() = callCount.get()
+    val wallNs: Long get() = wall.get()
+    val cpuNs: Long get() = cpu.get()
+    val allocatedBytes: Long get() = alloc.get()
+
+    /** Map entries drained while bound. */
+    val entriesDrained: Long get() = drained.get()
+
+    /** CPU of calls that ran on the thread that created this account. */
+    val inlineCpuNs: Long get() = inlineCpu.get()
+
+    /** Allocation of calls that ran on the thread that created this account. */
+    val inlineAllocatedBytes: Long get() = inlineAlloc.get()
+
+    fun addDrained(entries: Int) {
+        drained.addAndGet(entries.toLong())
+    }
+
+    fun <T> measure(block: () -> T): T {
+        val startNs = System.nanoTime()
+        val cpuStart = ThreadCostProbe.cpuTimeNs()
+        val allocStart = ThreadCostProbe.allocatedBytes()
+        try {
+            return block()
+        } finally {
+            val cpuNs = ThreadCostProbe.delta(cpuStart, ThreadCostProbe.cpuTimeNs())
+            val allocBytes = ThreadCostProbe.delta(allocStart, ThreadCostProbe.allocatedBytes())
+            wall.addAndGet(System.nanoTime() - startNs)
+            callCount.incrementAndGet()
+            val inline = Thread.currentThread() === owner
+            if (cpuNs >= 0) {
+                cpu.addAndGet(cpuNs)
+                if (inline) inlineCpu.addAndGet(cpuNs)
+            }
+            if (allocBytes >= 0) {
+                alloc.addAndGet(allocBytes)
+                if (inline) inlineAlloc.addAndGet(allocBytes)
+            }
+        }
+    }
+
+    companion object {
+        private val current = ThreadLocal<NativeCallCost?>()
+
+        /** The account native calls on this thread are charged to, if any. */
+        fun current(): NativeCallCost? = current.get()
+
+        /** Runs [block] with native calls on this thread charged to [cost]. */
+        fun <T> bind(cost: NativeCallCost, block: () -> T): T {
+            val previous = current.get()
+            current.set(cost)
+            try {
+                return block()
+            } finally {
+                current.set(previous)
+            }
+        }
+    }
+}
@@ -0,0 +1,113 @@
+package com.internal.kpodmetrics.bpf
+
+import io.micrometer.core.instrument.Counter
+import io.micrometer.core.instrument.Gauge
+import io.micrometer.core.instrument.MeterRegistry
+import io.micrometer.core.instrument.Timer
+import org.slf4j.LoggerFactory
+import java.util.concurrent.ArrayBlockingQueue
+import java.util.concurrent.Callable
+import java.util.concurrent.ExecutionException
+import java.util.concurrent.RejectedExecutionException
+import java.util.concurrent.ThreadPoolExecutor
+import java.util.concurrent.TimeUnit
+import java.util.concurrent.atomic.AtomicInteger
+
+/**
+ * Bounded platform-thread pool for blocking JNI calls.
+ *
+ * A JNI call made from a virtual thread pins its carrier for the whole native
+ * section. Map drains run for tens of milliseconds, so with ~20 collectors in
+ * flight the carrier pool (shared with the HTTP endpoints) saturates and scrapes
+ * stall. [call] hands the work to one of [poolSize] platform threads and parks
+ * the virtual caller, which releases its carrier. Threads made by
+ * [offloadingThread] (the collector threads) are offloaded the same way, so every
+ * collector's drains share this pool's bound and metrics. Other platform-thread
+ * callers (pool workers, startup, ring-buffer poller) run inline.
+ *
+ * When the queue is full the call runs inline on the caller, and is counted as
+ * pinned if that is a virtual thread, so back-pressure never turns into failed
+ * collections.
+ *
+ * Metrics:
+ * - kpod.bpf.native.queue.depth — calls waiting for a pool thread
+ * - kpod.bpf.native.active — pool threads currently inside a native call
+ * - kpod.bpf.native.queue.wait — time from submit to start on a pool thread
+ * - kpod.bpf.native.pinned.calls.total — native calls that ran on a virtual thread
+ */
+class NativeCallExecutor(
+    private val poolSize: Int = 2,
+    queueCapacity: Int = 64,
+    registry: MeterRegistry? = null
+) : AutoCloseable {
+    private val log = LoggerFactory.getLogger(NativeCallExecutor::class.java)
+    private val threadIndex = AtomicInteger(0)
+
+    private val executor = ThreadPoolExecutor(
+        poolSize, poolSize, 0L, TimeUnit.MILLISECONDS,
+        ArrayBlockingQueue(queueCapacity.coerceAtLeast(1))
+    ) { r ->
+        Thread(r, "bpf-native-${threadIndex.incrementAndGet()}").apply { isDaemon = true }
+    }
+
+    private val queueWait: Timer? = registry?.let {
+        Timer.builder("kpod.bpf.native.queue.wait")
+            .description("Time a native BPF call waited for a platform thread")
+            .register(it)
+    }
+    private val pinnedCalls: Counter? = registry?.let {
+        Counter.builder("kpod.bpf.native.pinned.calls.total")
+            .description("Native BPF calls executed on a virtual thread (carrier pinned)")
+            .register(it)
+    }
+
+    init {
+        registry?.let { reg ->
+            Gauge.builder("kpod.bpf.native.queue.depth", executor) { it.queue.size.toDouble() }
+                .description("Native BPF calls waiting for a platform thread")
+                .register(reg)
+            Gauge.builder("kpod.bpf.native.active", executor) { it.activeCount.toDouble() }
+                .description("Platform threads currently executing native BPF calls")
+                .register(reg)
+        }
+        log.info("Native BPF call executor started with {} platform threads (queue={})",
+            poolSize, queueCapacity)
+    }
+
+    companion object {
+        /** A daemon platform thread whose native calls go through the pool like a virtual thread's. */
+        fun offloadingThread(runnable: Runnable, name: String): Thread =
+            OffloadingThread(runnable, name).apply { isDaemon = true }
+    }
+
+    private class OffloadingThread(runnable: Runnable, name: String) : Thread(runnable, name)
+
+    fun <T> call(block: () -> T): T {
+        val caller = Thread.currentThread()
+        if (!caller.isVirtual && caller !is OffloadingThread) return block()
+
+        val submittedAt = System.nanoTime()
+        val future = try {
+            executor.submit(Callable {
+                queueWait?.record(System.nanoTime() - submittedAt, TimeUnit.NANOSECONDS)
+                block()
+            })
+        } catch (_: RejectedExecutionException) {
+            if (caller.isVirtual) pinnedCalls?.increment()
+            return block()
+        }
+        try {
+            return future.get()
+        } catch (e: ExecutionException) {
+            throw e.cause ?: e
+        }
+    }
+
+    override fun close() {
+        executor.shutdown()
+        if (!executor.awaitTermination(5, TimeUnit.SECONDS)) {
+            log.warn("Native BPF call executor did not drain within 5s")
+            executor.shutdownNow()
+        }
+    }
+}
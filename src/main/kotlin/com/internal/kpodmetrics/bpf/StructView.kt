@@ -0,0 +1,104 @@
+package com.internal.kpodmetrics.bpf
+
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
+
+/**
+ * Base class for the generated flyweight struct views (`*Views.kt` under
+ * `bpf.generated`). A view is a reusable cursor: [wrap] re-points it at a struct
+ * inside a heap array or a (direct or heap) [ByteBuffer] and field accessors read
+ * little-endian values at fixed offsets from there. Nothing is allocated per entry,
+ * so one view instance can walk an entire map drain.
+ *
+ * Views are not thread-safe; use one per decoding thread.
+ */
+abstract class StructView<T : StructView<T>> {
+    private var array: ByteArray? = null
+    private var buffer: ByteBuffer? = null
+    private var base = 0
+
+    /** Struct size in bytes, matching the kernel-side C layout. */
+    abstract val size: Int
+
+    @Suppress("UNCHECKED_CAST")
+    fun wrap(bytes: ByteArray, offset: Int = 0): T {
+        require(offset >= 0 && offset + size <= bytes.size) {
+            "struct of $size bytes does not fit at offset $offset of ${bytes.size}-byte array"
+        }
+        array = bytes
+        buffer = null
+        base = offset
+        return this as T
+    }
+
+    @Suppress("UNCHECKED_CAST")
+    fun wrap(buf: ByteBuffer, offset: Int = 0): T {
+        require(buf.order() == ByteOrder.LITTLE_ENDIAN) { "BPF struct buffers must be little-endian" }
+        require(offset >= 0 && offset + size <= buf.limit()) {
+            "struct of $size bytes does not fit at offset $offset of ${buf.limit()}-byte buffer"
+        }
+        array = null
+        buffer = buf
+        base = offset
+        return this as T
+    }
+
+    protected fun u8(off: Int): Int {
+        val a = array
+        return if (a != null) a[base + off].toInt() and 0xFF
+        else buffer!!.get(base + off).toInt() and 0xFF
+    }
+
+    protected fun u16(off: Int): Int {
+        val a = array
+        if (a == null) return buffer!!.getShort(base + off).toInt() and 0xFFFF
+        val i = base + off
+        return (a[i].toInt() and 0xFF) or ((a[i + 1].toInt() and 0xFF) shl 8)
+    }
+
+    protected fun s32(off: Int): Int {
+        val a = array
+        if (a == null) return buffer!!.getInt(base + off)
+        val i = base + off
+        return (a[i].toInt() and 0xFF) or
+            ((a[i + 1].toInt() and 0xFF) shl 8) or
+            ((a[i + 2].toInt() and 0xFF) shl 16) or
+            (a[i + 3].toInt() shl 24)
+    }
+
+    protected fun u32(off: Int): Long = s32(off).toLong() and 0xFFFFFFFFL
+
+    protected fun s64(off: Int): Long {
+        val a = array
+        if (a == null) return buffer!!.getLong(base + off)
+        val i = base + off
+        return (a[i].toLong() and 0xFF) or
+            ((a[i + 1].toLong() and 0xFF) shl 8) or
+            ((a[i + 2].toLong() and 0xFF) shl 16) or
+            ((a[i + 3].toLong() and 0xFF) shl 24) or
+            ((a[i + 4].toLong() and 0xFF) shl 32) or
+            ((a[i + 5].toLong() and 0xFF) shl 40) or
+            ((a[i + 6].toLong() and 0xFF) shl 48) or
+            (a[i + 7].toLong() shl 56)
+    }
+
+    protected fun u64(off: Int): Long = s64(off)
+
+    protected fun s8(off: Int): Int = u8(off).toByte().toInt()
+
+    protected fun s16(off: Int): Int = u16(off).toShort().toInt()
+
+    /**
+     * Reads an unsigned little-endian field of [width] bytes (1, 2, 4 or 8) at
+     * [offset], for code that takes field positions from a generated spec rather
+     * than the typed accessors (the schema-driven
+     * [com.internal.kpodmetrics.collector.MapMetricEmitter]).
+     */
+    fun unsigned(offset: Int, width: Int): Long = when (width) {
+        1 -> u8(offset).toLong()
+        2 -> u16(offset).toLong()
+        4 -> u32(offset)
+        8 -> u64(offset)
+        else -> throw IllegalArgumentException("unsupported field width $width")
+    }
+}
@@ -0,0 +1,25 @@
+package com.internal.kpodmetrics.bpf
+
+import java.lang.management.ManagementFactory
+
+/**
+ * Per-thread CPU and allocation counters from the HotSpot [com.sun.management.ThreadMXBean].
+ * Returns -1 when the JVM cannot measure the current thread (e.g. virtual threads).
+ */
+internal object ThreadCostProbe {
+    private val threadBean = ManagementFactory.getThreadMXBean() as? com.sun.management.ThreadMXBean
+
+    fun cpuTimeNs(): Long = try {
+        threadBean?.currentThreadCpuTime ?: -1L
+    } catch (_: UnsupportedOperationException) {
+        -1L
+    }
+
+    fun allocatedBytes(): Long = try {
+        threadBean?.currentThreadAllocatedBytes ?: -1L
+    } catch (_: UnsupportedOperationException) {
+        -1L
+    }
+
+    fun delta(start: Long, end: Long): Long = if (start < 0 || end < 0) -1L else end - start
+}
@@ -0,0 +1,163 @@
+package com.internal.kpodmetrics.cgroup
+
+import com.internal.kpodmetrics.bpf.BpfBridge
+import io.micrometer.core.instrument.Counter
+import io.micrometer.core.instrument.MeterRegistry
+import org.slf4j.LoggerFactory
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
+import java.nio.file.Files
+import java.nio.file.Paths
+import java.util.concurrent.atomic.AtomicInteger
+
+/** Memory counters of one cgroup from the iterator, in bytes. */
+data class IterMemoryStat(
+    val usageBytes: Long,
+    val peakBytes: Long,
+    val swapBytes: Long
+)
+
+/**
+ * Memory and io counters of every cgroup under the kubepods root from one pass of
+ * the `cgroup_stats` BPF cgroup iterator (kernel 6.1+), instead of a stat file
+ * read per cgroup and controller. A pass is taken on the first lookup after
+ * [maxAgeMs], so the cgroup collectors of a cycle share it.
+ *
+ * Cgroups are matched by id (the inode of the cgroup directory); ids of target
+ * paths are cached. A lookup returns null when the cgroup is not in the last pass
+ * or the pass failed, and [CgroupReader] falls back to the stat files.
+ */
+class CgroupIterStats(
+    private val bridge: BpfBridge,
+    private val linkFd: Int,
+    registry: MeterRegistry? = null,
+    private val maxAgeMs: Long = 1000,
+    private val clock: () -> Long = System::currentTimeMillis,
+    private val cgroupIdOf: (String) -> Long? = ::inodeOf
+) {
+    private val log = LoggerFactory.getLogger(CgroupIterStats::class.java)
+
+    companion object {
+        private const val RECORD_SIZE = 48
+        private const val KIND_MEMORY = 1
+        private const val KIND_IO = 2
+        private const val ENOSPC = 28
+        private const val MAX_BUFFER = 64 shl 20
+
+        private fun inodeOf(path: String): Long? = try {
+            Files.getAttribute(Paths.get(path), "unix:ino") as Long
+        } catch (_: Exception) {
+            null
+        }
+    }
+
+    private val pageSize = bridge.pageSize().toLong().takeIf { it > 0 } ?: 4096L
+    private var buffer = ByteArray(64 * 1024)
+    private var memory = HashMap<Long, IterMemoryStat>()
+    private var io = HashMap<Long, MutableList<DiskIOStat>>()
+    private val idsByPath = HashMap<String, Long>()
+    private var lastPassMs = Long.MIN_VALUE
+    private val cgroupCount = AtomicInteger()
+    private val errors: Counter? = registry?.counter("kpod.cgroup.iter.errors")
+
+    init {
+        registry?.gauge("kpod.cgroup.iter.cgroups", cgroupCount)
+    }
+
+    /** Memory counters of the cgroup at [cgroupPath], or null to read its stat files. */
+    @Synchronized
+    fun memory(cgroupPath: String): IterMemoryStat? {
+        refreshIfStale()
+        val id = idOf(cgroupPath) ?: return null
+        return memory[id] ?: forget(cgroupPath)
+    }
+
+    /** Per-device io counters of the cgroup at [cgroupPath], or null to read io.stat. */
+    @Synchronized
+    fun diskIO(cgroupPath: String): List<DiskIOStat>? {
+        refreshIfStale()
+        val id = idOf(cgroupPath) ?: return null
+        // Every walked cgroup has a memory record; a cgroup without io records did no io
+        if (!memory.containsKey(id)) return forget(cgroupPath)
+        return io[id] ?: emptyList()
+    }
+
+    private fun idOf(cgroupPath: String): Long? {
+        if (memory.isEmpty()) return null
+        idsByPath[cgroupPath]?.let { return it }
+        val id = cgroupIdOf(cgroupPath) ?: return null
+        idsByPath[cgroupPath] = id
+        return id
+    }
+
+    /** The cgroup was recreated under the same path, or is outside the walk. */
+    private fun <T> forget(cgroupPath: String): T? {
+        idsByPath.remove(cgroupPath)
+        return null
+    }
+
+    private fun refreshIfStale() {
+        val now = clock()
+        if (lastPassMs != Long.MIN_VALUE && now - lastPassMs < maxAgeMs) return
+        lastPassMs = now
+        val length = read()
+        if (length < 0) {
+            memory = HashMap()
+            io = HashMap()
+            cgroupCount.set(0)
+            return
+        }
+        parse(length)
+        idsByPath.values.retainAll(memory.keys)
+        cgroupCount.set(memory.size)
+    }
+
+    private fun read(): Int {
+        while (true) {
+            val n = try {
+                bridge.iterRead(linkFd, buffer)
+            } catch (e: Exception) {
+                log.debug("Cgroup iterator read failed: {}", e.message)
+                errors?.increment()
+                return -1
+            }
+            if (n == -ENOSPC && buffer.size < MAX_BUFFER) {
+                buffer = ByteArray(buffer.size * 2)
+                continue
+            }
+            if (n < 0) {
+                log.debug("Cgroup iterator read failed: errno {}", -n)
+                errors?.increment()
+            }
+            return n
+        }
+    }
+
+    private fun parse(length: Int) {
+        val mem = HashMap<Long, IterMemoryStat>(memory.size.coerceAtLeast(16))
+        val ios = HashMap<Long, MutableList<DiskIOStat>>(io.size.coerceAtLeast(16))
+        val bb = ByteBuffer.wrap(buffer, 0, length).order(ByteOrder.LITTLE_ENDIAN)
+        var off = 0
+        while (off + RECORD_SIZE <= length) {
+            val id = bb.getLong(off)
+            val kind = bb.getInt(off + 8)
+            val dev = bb.getInt(off + 12)
+            val v0 = bb.getLong(off + 16)
+            val v1 = bb.getLong(off + 24)
+            val v2 = bb.getLong(off + 32)
+            val v3 = bb.getLong(off + 40)
+            off += RECORD_SIZE
+            when (kind) {
+                KIND_MEMORY -> mem[id] = IterMemoryStat(v0 * pageSize, v1 * pageSize, v2 * pageSize)
+                KIND_IO -> if (v0 != 0L || v1 != 0L || v2 != 0L || v3 != 0L) {
+                    ios.getOrPut(id) { ArrayList(2) }.add(DiskIOStat(
+                        major = dev ushr 20, minor = dev and 0xfffff,
+                        readBytes = v0, writeBytes = v1, reads = v2, writes = v3
+                    ))
+                }
+            }
+        }
+        memory = mem
+        io = ios
+    }
+}
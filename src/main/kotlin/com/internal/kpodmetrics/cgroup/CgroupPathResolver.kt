@@ -30,7 +30,7 @@ class CgroupPathResolver(
             stream.filter { Files.isDirectory(it) }
                 .map { dir ->
                     val dirName = dir.fileName.toString()
-                    val containerId = extractContainerId(dirName)
+                    val containerId = containerIdOf(dirName)
                     ContainerCgroup(containerId = containerId, path = dir.toString())
                 }
                 .toList()
@@ -69,11 +69,14 @@ class CgroupPathResolver(
         }
     }
 
-    private fun extractContainerId(dirName: String): String {
-        return dirName
-            .removePrefix("cri-containerd-")
-            .removePrefix("docker-")
-            .removePrefix("crio-")
-            .removeSuffix(".scope")
+    companion object {
+        /** Container ID from a container cgroup directory name. */
+        internal fun containerIdOf(dirName: String): String {
+            return dirName
+                .removePrefix("cri-containerd-")
+                .removePrefix("docker-")
+                .removePrefix("crio-")
+                .removeSuffix(".scope")
+        }
     }
 }
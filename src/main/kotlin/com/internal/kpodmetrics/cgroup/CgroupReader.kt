@@ -24,6 +24,14 @@ data class FilesystemStat(
     val availableBytes: Long
 )
 
+/** One line of /proc/<pid>/mountinfo; [device] is `major:minor` of the backing filesystem. */
+data class MountEntry(
+    val mountId: Int,
+    val device: String,
+    val mountPoint: String,
+    val fsType: String
+)
+
 data class MemoryStat(
     val usageBytes: Long,
     val peakBytes: Long,
@@ -31,9 +39,62 @@ data class MemoryStat(
     val swapBytes: Long
 )
 
-class CgroupReader(private val version: CgroupVersion) {
+/**
+ * Reads per-container cgroup and /proc stat files. Files are kept open in [files]
+ * and parsed with a [StatScanner]; beyond the returned stat objects a read
+ * allocates nothing in steady state. With a cgroup iterator set through
+ * [setIterStats], memory and io counters come from its bulk pass, and the files
+ * are read only for what it does not cover (page cache) or cgroups it missed.
+ */
+class CgroupReader(
+    val version: CgroupVersion,
+    private val files: StatFileCache = StatFileCache()
+) : AutoCloseable {
     private val log = LoggerFactory.getLogger(CgroupReader::class.java)
 
+    @Volatile private var interfaceNames = emptyArray<String>()
+    @Volatile private var iterStats: CgroupIterStats? = null
+
+    companion object {
+        private val MEMORY_STAT_V2_KEYS = StatScanner.keys("inactive_file", "active_file")
+        private val MEMORY_STAT_V1_KEYS = StatScanner.keys("total_cache", "cache")
+        private val IO_STAT_KEYS = StatScanner.keys("rbytes", "wbytes", "rios", "wios")
+        private val BLKIO_OPS = StatScanner.keys("Read", "Write")
+        private const val MAX_INTERFACE_NAMES = 256
+        private val REAL_FILESYSTEMS = setOf("overlay", "ext4", "xfs", "btrfs", "nfs", "nfs4", "ceph", "cifs")
+
+        /**
+         * statfs of the filesystem containing [path] (java.io.File issues statvfs
+         * directly, without the mount table lookup of Files.getFileStore).
+         * Returns null if the path does not exist.
+         */
+        fun statfs(path: String): FilesystemStat? {
+            val file = java.io.File(path)
+            if (!file.exists()) return null
+            val total = file.totalSpace
+            val available = file.usableSpace
+            return FilesystemStat("", total, total - available, available)
+        }
+    }
+
+    fun setIterStats(stats: CgroupIterStats?) {
+        this.iterStats = stats
+    }
+
+    private inline fun <T> withScanner(block: (StatScanner) -> T): T {
+        val scanner = files.borrow()
+        try {
+            return block(scanner)
+        } finally {
+            files.giveBack(scanner)
+        }
+    }
+
+    private fun StatScanner.firstLong(): Long = nextLong().let { if (it == StatScanner.NO_VALUE) 0L else it }
+
+    private fun readLong(scanner: StatScanner, path: String, file: StatFile): Long? =
+        if (files.read(path, file, scanner)) scanner.firstLong() else null
+
     fun readMemoryStats(containerCgroupPath: String): MemoryStat? {
         return when (version) {
             CgroupVersion.V2 -> readMemoryV2(containerCgroupPath)
@@ -41,62 +102,42 @@ class CgroupReader(private val version: CgroupVersion) {
         }
     }
 
-    private fun readMemoryV2(containerCgroupPath: String): MemoryStat? {
-        val currentFile = Paths.get(containerCgroupPath, "memory.current")
-        if (!Files.exists(currentFile)) return null
-        return try {
-            val usage = Files.readString(currentFile).trim().toLongOrNull() ?: 0L
-            val peak = try {
-                val peakFile = Paths.get(containerCgroupPath, "memory.peak")
-                if (Files.exists(peakFile)) Files.readString(peakFile).trim().toLongOrNull() ?: 0L else 0L
-            } catch (_: Exception) { 0L }
-            val swap = try {
-                val swapFile = Paths.get(containerCgroupPath, "memory.swap.current")
-                if (Files.exists(swapFile)) Files.readString(swapFile).trim().toLongOrNull() ?: 0L else 0L
-            } catch (_: Exception) { 0L }
-            val statFile = Paths.get(containerCgroupPath, "memory.stat")
-            val statMap = if (Files.exists(statFile)) {
-                Files.readAllLines(statFile)
-                    .filter { it.isNotBlank() }
-                    .mapNotNull { line ->
-                        val parts = line.trim().split("\\s+".toRegex())
-                        if (parts.size == 2) parts[0] to (parts[1].toLongOrNull() ?: 0L) else null
-                    }.toMap()
-            } else emptyMap()
-            val cache = (statMap["inactive_file"] ?: 0L) + (statMap["active_file"] ?: 0L)
-            MemoryStat(usage, peak, cache, swap)
+    private fun readMemoryV2(containerCgroupPath: String): MemoryStat? = withScanner { s ->
+        try {
+            val bulk = iterStats?.memory(containerCgroupPath)
+            if (bulk != null) {
+                return MemoryStat(bulk.usageBytes, bulk.peakBytes, readPageCacheV2(s, containerCgroupPath), bulk.swapBytes)
+            }
+            val usage = readLong(s, containerCgroupPath, StatFile.MEMORY_CURRENT) ?: return null
+            val peak = readLong(s, containerCgroupPath, StatFile.MEMORY_PEAK) ?: 0L
+            val swap = readLong(s, containerCgroupPath, StatFile.MEMORY_SWAP_CURRENT) ?: 0L
+            MemoryStat(usage, peak, readPageCacheV2(s, containerCgroupPath), swap)
         } catch (e: Exception) {
             log.warn("Failed to read memory stats from {}: {}", containerCgroupPath, e.message)
             null
         }
     }
 
-    private fun readMemoryV1(containerCgroupPath: String): MemoryStat? {
-        val usageFile = Paths.get(containerCgroupPath, "memory.usage_in_bytes")
-        if (!Files.exists(usageFile)) return null
-        return try {
-            val usage = Files.readString(usageFile).trim().toLongOrNull() ?: 0L
-            val peak = try {
-                val peakFile = Paths.get(containerCgroupPath, "memory.max_usage_in_bytes")
-                if (Files.exists(peakFile)) Files.readString(peakFile).trim().toLongOrNull() ?: 0L else 0L
-            } catch (_: Exception) { 0L }
-            val swap = try {
-                val swapFile = Paths.get(containerCgroupPath, "memory.memsw.usage_in_bytes")
-                if (Files.exists(swapFile)) {
-                    val memsw = Files.readString(swapFile).trim().toLongOrNull() ?: 0L
-                    (memsw - usage).coerceAtLeast(0L)
-                } else 0L
-            } catch (_: Exception) { 0L }
-            val statFile = Paths.get(containerCgroupPath, "memory.stat")
-            val statMap = if (Files.exists(statFile)) {
-                Files.readAllLines(statFile)
-                    .filter { it.isNotBlank() }
-                    .mapNotNull { line ->
-                        val parts = line.trim().split("\\s+".toRegex())
-                        if (parts.size == 2) parts[0] to (parts[1].toLongOrNull() ?: 0L) else null
-                    }.toMap()
-            } else emptyMap()
-            val cache = statMap["total_cache"] ?: statMap["cache"] ?: 0L
+    private fun readPageCacheV2(s: StatScanner, containerCgroupPath: String): Long =
+        if (files.read(containerCgroupPath, StatFile.MEMORY_STAT, s)) {
+            s.scanKeyed(MEMORY_STAT_V2_KEYS)
+            s.values[0].coerceAtLeast(0L) + s.values[1].coerceAtLeast(0L)
+        } else 0L
+
+    private fun readMemoryV1(containerCgroupPath: String): MemoryStat? = withScanner { s ->
+        try {
+            val usage = readLong(s, containerCgroupPath, StatFile.MEMORY_USAGE_V1) ?: return null
+            val peak = readLong(s, containerCgroupPath, StatFile.MEMORY_MAX_USAGE_V1) ?: 0L
+            val swap = readLong(s, containerCgroupPath, StatFile.MEMSW_USAGE_V1)
+                ?.let { (it - usage).coerceAtLeast(0L) } ?: 0L
+            val cache = if (files.read(containerCgroupPath, StatFile.MEMORY_STAT, s)) {
+                s.scanKeyed(MEMORY_STAT_V1_KEYS)
+                when {
+                    s.values[0] != StatScanner.NO_VALUE -> s.values[0]
+                    s.values[1] != StatScanner.NO_VALUE -> s.values[1]
+                    else -> 0L
+                }
+            } else 0L
             MemoryStat(usage, peak, cache, swap)
         } catch (e: Exception) {
             log.warn("Failed to read memory stats from {}: {}", containerCgroupPath, e.message)
@@ -112,123 +153,159 @@ class CgroupReader(private val version: CgroupVersion) {
     }
 
     fun readInitPid(containerCgroupPath: String): Int? {
-        val fileName = when (version) {
-            CgroupVersion.V2 -> "cgroup.procs"
-            CgroupVersion.V1 -> "tasks"
+        val file = when (version) {
+            CgroupVersion.V2 -> StatFile.CGROUP_PROCS
+            CgroupVersion.V1 -> StatFile.TASKS_V1
         }
-        val file = Paths.get(containerCgroupPath, fileName)
-        if (!Files.exists(file)) return null
-        return try {
-            Files.readAllLines(file)
-                .firstOrNull { it.isNotBlank() }
-                ?.trim()?.toIntOrNull()
-        } catch (e: Exception) {
-            log.warn("Failed to read PID from {}: {}", file, e.message)
-            null
+        return withScanner { s ->
+            try {
+                if (!files.read(containerCgroupPath, file, s)) return null
+                s.nextLong().takeIf { it != StatScanner.NO_VALUE && it <= Int.MAX_VALUE }?.toInt()
+            } catch (e: Exception) {
+                log.warn("Failed to read PID from {}/{}: {}", containerCgroupPath, file.fileName, e.message)
+                null
+            }
         }
     }
 
-    fun readNetworkStats(procRoot: String, pid: Int): List<NetworkStat> {
-        val netDev = Paths.get(procRoot, pid.toString(), "net", "dev")
-        if (!Files.exists(netDev)) return emptyList()
-        return try {
-            Files.readAllLines(netDev)
-                .drop(2)
-                .filter { it.contains(":") }
-                .mapNotNull { parseNetDevLine(it) }
+    fun readNetworkStats(procRoot: String, pid: Int): List<NetworkStat> = withScanner { s ->
+        try {
+            if (!files.read("$procRoot/$pid", StatFile.NET_DEV, s)) return emptyList()
+            // Two header lines, then "iface: rx(8 columns) tx(8 columns)"
+            s.nextLine()
+            s.nextLine()
+            val stats = ArrayList<NetworkStat>(4)
+            while (s.hasMore()) {
+                s.nextToken()
+                if (!s.expect(':')) {
+                    s.nextLine()
+                    continue
+                }
+                val iface = interfaceName(s)
+                for (i in 0 until 16) s.values[i] = s.nextLong().coerceAtLeast(0L)
+                s.nextLine()
+                stats.add(NetworkStat(
+                    interfaceName = iface,
+                    rxBytes = s.values[0], rxPackets = s.values[1],
+                    rxErrors = s.values[2], rxDrops = s.values[3],
+                    txBytes = s.values[8], txPackets = s.values[9],
+                    txErrors = s.values[10], txDrops = s.values[11]
+                ))
+            }
+            stats
         } catch (e: Exception) {
             log.warn("Failed to read network stats for PID {}: {}", pid, e.message)
             emptyList()
         }
     }
 
-    fun readFilesystemStats(procRoot: String, pid: Int): List<FilesystemStat> {
+    /** Interface names repeat across pods (eth0, lo); reuse one String per name. */
+    private fun interfaceName(s: StatScanner): String {
+        val known = interfaceNames
+        for (name in known) {
+            if (s.tokenEquals(name)) return name
+        }
+        val name = s.tokenString()
+        if (known.size < MAX_INTERFACE_NAMES) {
+            synchronized(this) {
+                if (name !in interfaceNames) interfaceNames = interfaceNames + name
+            }
+        }
+        return name
+    }
+
+    /** Mounts of real filesystems in the pid's mount namespace, from `/proc/<pid>/mountinfo`. */
+    fun readMounts(procRoot: String, pid: Int): List<MountEntry> {
         val mountInfo = Paths.get(procRoot, pid.toString(), "mountinfo")
         if (!Files.exists(mountInfo)) return emptyList()
         return try {
-            Files.readAllLines(mountInfo)
-                .mapNotNull { parseMountInfoLine(it) }
-                .mapNotNull { (mountPoint, _) ->
-                    try {
-                        val resolvedPath = Paths.get(procRoot, pid.toString(), "root", mountPoint.removePrefix("/"))
-                        if (!Files.exists(resolvedPath)) return@mapNotNull null
-                        val store = Files.getFileStore(resolvedPath)
-                        val total = store.totalSpace
-                        val available = store.usableSpace
-                        FilesystemStat(mountPoint, total, total - available, available)
-                    } catch (e: Exception) {
-                        log.debug("Skipping mount {}: {}", mountPoint, e.message)
-                        null
-                    }
-                }
+            Files.readAllLines(mountInfo).mapNotNull { parseMountEntry(it) }
         } catch (e: Exception) {
-            log.warn("Failed to read filesystem stats for PID {}: {}", pid, e.message)
+            log.warn("Failed to read mountinfo for PID {}: {}", pid, e.message)
             emptyList()
         }
     }
 
-    internal fun parseMountInfoLine(line: String): Pair<String, String>? {
-        val parts = line.trim().split("\\s+".toRegex())
+    fun readFilesystemStats(procRoot: String, pid: Int): List<FilesystemStat> =
+        readMounts(procRoot, pid).mapNotNull { mount ->
+            try {
+                statfs(Paths.get(procRoot, pid.toString(), "root", mount.mountPoint.removePrefix("/")).toString())
+                    ?.copy(mountPoint = mount.mountPoint)
+            } catch (e: Exception) {
+                log.debug("Skipping mount {}: {}", mount.mountPoint, e.message)
+                null
+            }
+        }
+
+    internal fun parseMountInfoLine(line: String): Pair<String, String>? =
+        parseMountEntry(line)?.let { it.mountPoint to it.fsType }
+
+    /** "36 35 98:0 /mnt1 /mnt2 rw,noatime master:1 - ext3 /dev/root rw" */
+    internal fun parseMountEntry(line: String): MountEntry? {
+        val parts = line.trim().split(' ')
         val separatorIndex = parts.indexOf("-")
         if (separatorIndex < 0 || separatorIndex + 1 >= parts.size) return null
         if (parts.size < 5) return null
-        val mountPoint = parts[4]
         val fsType = parts[separatorIndex + 1]
-        val realFilesystems = setOf("overlay", "ext4", "xfs", "btrfs")
-        if (fsType !in realFilesystems) return null
-        return mountPoint to fsType
+        if (fsType !in REAL_FILESYSTEMS) return null
+        val mountId = parts[0].toIntOrNull() ?: return null
+        return MountEntry(mountId, parts[2], parts[4], fsType)
     }
 
     private fun readDiskIOV2(containerCgroupPath: String): List<DiskIOStat> {
-        val ioStat = Paths.get(containerCgroupPath, "io.stat")
-        if (!Files.exists(ioStat)) return emptyList()
-        return try {
-            Files.readAllLines(ioStat)
-                .filter { it.isNotBlank() }
-                .mapNotNull { parseIOStatV2Line(it) }
+        iterStats?.diskIO(containerCgroupPath)?.let { return it }
+        return readIoStat(containerCgroupPath)
+    }
+
+    private fun readIoStat(containerCgroupPath: String): List<DiskIOStat> = withScanner { s ->
+        try {
+            if (!files.read(containerCgroupPath, StatFile.IO_STAT, s)) return emptyList()
+            // "8:0 rbytes=1 wbytes=2 rios=3 wios=4 dbytes=0 dios=0"
+            val stats = ArrayList<DiskIOStat>(2)
+            while (s.hasMore()) {
+                val major = s.nextLong()
+                if (major == StatScanner.NO_VALUE || !s.expect(':')) {
+                    s.nextLine()
+                    continue
+                }
+                val minor = s.nextLong()
+                s.values.fill(0L, 0, IO_STAT_KEYS.size)
+                while (!s.atLineEnd()) {
+                    val idx = s.matchToken(IO_STAT_KEYS)
+                    if (!s.expect('=')) {
+                        s.expect(':')
+                        continue
+                    }
+                    val value = s.nextLong()
+                    if (idx >= 0 && value != StatScanner.NO_VALUE) s.values[idx] = value
+                }
+                s.nextLine()
+                if (minor == StatScanner.NO_VALUE) continue
+                stats.add(DiskIOStat(
+                    major = major.toInt(), minor = minor.toInt(),
+                    readBytes = s.values[0], writeBytes = s.values[1],
+                    reads = s.values[2], writes = s.values[3]
+                ))
+            }
+            stats
         } catch (e: Exception) {
             log.warn("Failed to read io.stat from {}: {}", containerCgroupPath, e.message)
             emptyList()
         }
     }
 
-    private fun parseIOStatV2Line(line: String): DiskIOStat? {
-        val parts = line.trim().split("\\s+".toRegex())
-        if (parts.size < 2) return null
-        val deviceParts = parts[0].split(":")
-        if (deviceParts.size != 2) return null
-        val kvMap = parts.drop(1).mapNotNull {
-            val kv = it.split("=")
-            if (kv.size == 2) kv[0] to kv[1].toLongOrNull() else null
-        }.toMap()
-        return DiskIOStat(
-            major = deviceParts[0].toIntOrNull() ?: return null,
-            minor = deviceParts[1].toIntOrNull() ?: return null,
-            readBytes = kvMap["rbytes"] ?: 0L,
-            writeBytes = kvMap["wbytes"] ?: 0L,
-            reads = kvMap["rios"] ?: 0L,
-            writes = kvMap["wios"] ?: 0L
-        )
-    }
-
-    private fun readDiskIOV1(containerCgroupPath: String): List<DiskIOStat> {
-        val bytesFile = Paths.get(containerCgroupPath, "blkio.throttle.io_service_bytes")
-        val opsFile = Paths.get(containerCgroupPath, "blkio.throttle.io_serviced")
-        if (!Files.exists(bytesFile) || !Files.exists(opsFile)) return emptyList()
-        return try {
-            val bytesMap = parseBlkioV1(Files.readAllLines(bytesFile))
-            val opsMap = parseBlkioV1(Files.readAllLines(opsFile))
-            val devices = bytesMap.keys union opsMap.keys
-            devices.mapNotNull { device ->
-                val bytes = bytesMap[device] ?: emptyMap()
-                val ops = opsMap[device] ?: emptyMap()
-                val deviceParts = device.split(":")
-                if (deviceParts.size != 2) return@mapNotNull null
+    private fun readDiskIOV1(containerCgroupPath: String): List<DiskIOStat> = withScanner { s ->
+        try {
+            // Per device: [readBytes, writeBytes, reads, writes]
+            val devices = LinkedHashMap<Long, LongArray>()
+            if (!files.read(containerCgroupPath, StatFile.BLKIO_BYTES_V1, s)) return emptyList()
+            parseBlkioV1(s, devices, 0)
+            if (!files.read(containerCgroupPath, StatFile.BLKIO_OPS_V1, s)) return emptyList()
+            parseBlkioV1(s, devices, 2)
+            devices.map { (device, v) ->
                 DiskIOStat(
-                    major = deviceParts[0].toIntOrNull() ?: return@mapNotNull null,
-                    minor = deviceParts[1].toIntOrNull() ?: return@mapNotNull null,
-                    readBytes = bytes["Read"] ?: 0L, writeBytes = bytes["Write"] ?: 0L,
-                    reads = ops["Read"] ?: 0L, writes = ops["Write"] ?: 0L
+                    major = (device ushr 32).toInt(), minor = device.toInt(),
+                    readBytes = v[0], writeBytes = v[1], reads = v[2], writes = v[3]
                 )
             }
         } catch (e: Exception) {
@@ -237,34 +314,22 @@ class CgroupReader(private val version: CgroupVersion) {
         }
     }
 
-    private fun parseBlkioV1(lines: List<String>): Map<String, Map<String, Long>> {
-        val result = mutableMapOf<String, MutableMap<String, Long>>()
-        for (line in lines) {
-            val parts = line.trim().split("\\s+".toRegex())
-            if (parts.size != 3) continue
-            val device = parts[0]; val op = parts[1]; val value = parts[2].toLongOrNull() ?: continue
-            if (op == "Total" || op == "Sync" || op == "Async") continue
-            result.getOrPut(device) { mutableMapOf() }[op] = value
+    /** Parses "8:0 Read 123" lines into [devices] at [offset] (Read) and offset+1 (Write). */
+    private fun parseBlkioV1(s: StatScanner, devices: MutableMap<Long, LongArray>, offset: Int) {
+        while (s.hasMore()) {
+            val major = s.nextLong()
+            if (major == StatScanner.NO_VALUE || !s.expect(':')) {
+                s.nextLine()
+                continue
+            }
+            val minor = s.nextLong()
+            val op = s.matchToken(BLKIO_OPS)
+            val value = s.nextLong()
+            s.nextLine()
+            if (minor == StatScanner.NO_VALUE || op < 0 || value == StatScanner.NO_VALUE) continue
+            devices.getOrPut((major shl 32) or minor) { LongArray(4) }[offset + op] = value
         }
-        return result
     }
 
-    private fun parseNetDevLine(line: String): NetworkStat? {
-        val colonIndex = line.indexOf(':')
-        if (colonIndex < 0) return null
-        val iface = line.substring(0, colonIndex).trim()
-        val values = line.substring(colonIndex + 1).trim().split("\\s+".toRegex())
-        if (values.size < 16) return null
-        return NetworkStat(
-            interfaceName = iface,
-            rxBytes = values[0].toLongOrNull() ?: 0L,
-            rxPackets = values[1].toLongOrNull() ?: 0L,
-            rxErrors = values[2].toLongOrNull() ?: 0L,
-            rxDrops = values[3].toLongOrNull() ?: 0L,
-            txBytes = values[8].toLongOrNull() ?: 0L,
-            txPackets = values[9].toLongOrNull() ?: 0L,
-            txErrors = values[10].toLongOrNull() ?: 0L,
-            txDrops = values[11].toLongOrNull() ?: 0L
-        )
-    }
+    override fun close() = files.close()
 }
@@ -0,0 +1,308 @@
+package com.internal.kpodmetrics.cgroup
+
+import com.internal.kpodmetrics.model.CgroupVersion
+import org.slf4j.LoggerFactory
+import java.io.IOException
+import java.nio.file.ClosedWatchServiceException
+import java.nio.file.FileSystems
+import java.nio.file.Files
+import java.nio.file.Path
+import java.nio.file.Paths
+import java.nio.file.StandardWatchEventKinds.ENTRY_CREATE
+import java.nio.file.StandardWatchEventKinds.ENTRY_DELETE
+import java.nio.file.StandardWatchEventKinds.OVERFLOW
+import java.nio.file.WatchKey
+import java.nio.file.WatchService
+import java.util.concurrent.ConcurrentHashMap
+import java.util.concurrent.CopyOnWriteArrayList
+
+/** A container cgroup directory tracked by [CgroupTreeWatcher]. */
+data class ContainerCgroupNode(
+    val podUid: String,
+    val containerId: String,
+    val path: String,
+    /** Inode of the directory: the cgroup id bpf_get_current_cgroup_id() returns on v2. */
+    val cgroupId: Long
+)
+
+/**
+ * In-memory tree of the kubepods cgroup hierarchy, kept current by inotify (the JDK
+ * WatchService) instead of resolving and listing pod directories every cycle.
+ * The kubepods roots, QoS and pod directories are watched for mkdir/rmdir;
+ * container directories are leaves, indexed by pod uid, container id and cgroup id.
+ *
+ * A new pod directory is listed right after its watch is added, so containers
+ * created in between are not missed, and a queue overflow rescans the tree.
+ * [Listener]s see a container as soon as its cgroup is created, before the API
+ * server reports it.
+ *
+ * A directory that cannot be watched (for instance `fs.inotify.max_user_watches`
+ * exhausted) is still listed once, but later changes under it are missed until a
+ * resync; `PodCgroupMapper` lists the pod directory itself when the tree has no
+ * containers for a pod.
+ */
+class CgroupTreeWatcher(
+    private val cgroupRoot: String,
+    private val version: CgroupVersion,
+    private val subsystem: String = "blkio",
+    private val register: (Path, WatchService) -> WatchKey = { dir, ws -> dir.register(ws, ENTRY_CREATE, ENTRY_DELETE) }
+) : AutoCloseable {
+    private val log = LoggerFactory.getLogger(CgroupTreeWatcher::class.java)
+
+    interface Listener {
+        fun onContainerAdded(node: ContainerCgroupNode)
+        fun onContainerRemoved(node: ContainerCgroupNode)
+    }
+
+    private class PodNode(val uid: String, val path: Path) {
+        val containers = ConcurrentHashMap<String, ContainerCgroupNode>()
+    }
+
+    private var watchService: WatchService? = null
+    private var thread: Thread? = null
+    private val watchedDirs = ConcurrentHashMap<WatchKey, Path>()
+    private val intermediateDirs = ConcurrentHashMap.newKeySet<Path>()
+    private val roots = ConcurrentHashMap.newKeySet<Path>()
+    private val pods = ConcurrentHashMap<String, PodNode>()
+    private val podsByPath = ConcurrentHashMap<Path, PodNode>()
+    private val byCgroupId = ConcurrentHashMap<Long, ContainerCgroupNode>()
+    private val byContainerId = ConcurrentHashMap<String, ContainerCgroupNode>()
+    private val listeners = CopyOnWriteArrayList<Listener>()
+    @Volatile private var running = false
+
+    /** Whether the tree is being kept current; callers fall back to listing directories otherwise. */
+    @Volatile var ready = false
+        private set
+
+    companion object {
+        private val CGROUPFS_POD = Regex("^pod([0-9a-f-]+)$")
+        private val SYSTEMD_POD = Regex("^[a-z-]*-pod([0-9a-f_]+)\\.slice$")
+
+        /** Pod uid of a pod cgroup directory name, or null if [name] is not a pod directory. */
+        internal fun podUidOf(name: String): String? {
+            CGROUPFS_POD.find(name)?.let { return it.groupValues[1] }
+            SYSTEMD_POD.find(name)?.let { return it.groupValues[1].replace('_', '-') }
+            return null
+        }
+
+        /** Directories under [cgroupRoot] the kubelet may put pod cgroups in, by driver and layout. */
+        fun kubepodsRoots(cgroupRoot: String, version: CgroupVersion, subsystem: String = "blkio"): List<Path> =
+            when (version) {
+                CgroupVersion.V2 -> listOf(
+                    Paths.get(cgroupRoot, "kubepods.slice"),
+                    Paths.get(cgroupRoot, "kubelet.slice", "kubelet-kubepods.slice"),
+                    Paths.get(cgroupRoot, "kubepods")
+                )
+                CgroupVersion.V1 -> listOf(Paths.get(cgroupRoot, subsystem, "kubepods"))
+            }
+    }
+
+    fun addListener(listener: Listener) {
+        listeners.add(listener)
+    }
+
+    /** Pod cgroup directory of [podUid], or null if it does not exist. */
+    fun podPath(podUid: String): String? = pods[podUid]?.path?.toString()
+
+    fun containers(podUid: String): List<ContainerCgroup> =
+        pods[podUid]?.containers?.values?.map { ContainerCgroup(it.containerId, it.path) } ?: emptyList()
+
+    fun findByCgroupId(cgroupId: Long): ContainerCgroupNode? = byCgroupId[cgroupId]
+
+    fun findByContainerId(containerId: String): ContainerCgroupNode? = byContainerId[containerId]
+
+    fun podCount(): Int = pods.size
+
+    fun containerCount(): Int = byCgroupId.size
+
+    /**
+     * Adds watches on the kubepods roots that exist, loads the current tree and
+     * starts the event thread. Leaves [ready] false if there is nothing to watch or
+     * inotify is unavailable (for instance `fs.inotify.max_user_instances` exhausted).
+     */
+    @Synchronized
+    fun start() {
+        if (running) return
+        val existing = rootCandidates().filter { Files.isDirectory(it) }
+        if (existing.isEmpty()) {
+            log.warn("No kubepods cgroup directory under {}; cgroup tree watch disabled", cgroupRoot)
+            return
+        }
+        try {
+            watchService = FileSystems.getDefault().newWatchService()
+        } catch (e: IOException) {
+            log.warn("Cannot create inotify watch for cgroups, listing pod directories instead: {}", e.message)
+            return
+        }
+        for (root in existing) {
+            roots.add(root)
+            intermediateDirs.add(root)
+            watchDirectory(root)
+        }
+        running = true
+        ready = true
+        thread = Thread({ loop() }, "cgroup-tree-watch").apply {
+            isDaemon = true
+            start()
+        }
+        log.info("Watching {} for cgroup changes: {} pods, {} containers", existing, pods.size, byCgroupId.size)
+    }
+
+    @Synchronized
+    override fun close() {
+        running = false
+        ready = false
+        runCatching { watchService?.close() }
+        thread?.interrupt()
+        thread = null
+    }
+
+    private fun rootCandidates(): List<Path> = kubepodsRoots(cgroupRoot, version, subsystem)
+
+    private fun loop() {
+        val ws = watchService ?: return
+        while (running) {
+            val key = try {
+                ws.take()
+            } catch (_: InterruptedException) {
+                break
+            } catch (_: ClosedWatchServiceException) {
+                break
+            }
+            val dir = watchedDirs[key]
+            for (event in key.pollEvents()) {
+                try {
+                    if (event.kind() == OVERFLOW) {
+                        resync()
+                        continue
+                    }
+                    if (dir == null) continue
+                    val child = dir.resolve(event.context() as Path)
+                    when (event.kind()) {
+                        ENTRY_CREATE -> onCreated(dir, child)
+                        ENTRY_DELETE -> onDeleted(dir, child)
+                    }
+                } catch (e: Exception) {
+                    log.debug("Failed to apply cgroup event in {}: {}", dir, e.message)
+                }
+            }
+            if (!key.reset()) watchedDirs.remove(key)
+        }
+    }
+
+    /**
+     * Watches [dir] (a root, QoS or pod directory) and adds what is already in it,
+     * even when the watch cannot be added.
+     */
+    private fun watchDirectory(dir: Path) {
+        try {
+            watchedDirs[register(dir, watchService!!)] = dir
+        } catch (e: IOException) {
+            log.warn("Cannot watch {}, changes under it will be missed: {}", dir, e.message)
+        }
+        for (child in listDirectories(dir)) onCreated(dir, child)
+    }
+
+    private fun onCreated(parent: Path, child: Path) {
+        val parentPod = podsByPath[parent]
+        if (parentPod != null) {
+            addContainer(parentPod, child)
+            return
+        }
+        if (!Files.isDirectory(child)) return
+        val uid = podUidOf(child.fileName.toString())
+        if (uid != null) {
+            if (podsByPath.containsKey(child)) return
+            val pod = PodNode(uid, child)
+            pods[uid] = pod
+            podsByPath[child] = pod
+            watchDirectory(child)
+        } else if (parent in roots && intermediateDirs.add(child)) {
+            // QoS level (burstable, besteffort)
+            watchDirectory(child)
+        }
+    }
+
+    private fun onDeleted(parent: Path, child: Path) {
+        val parentPod = podsByPath[parent]
+        if (parentPod != null) {
+            parentPod.containers.remove(child.toString())?.let { removeContainer(it) }
+            return
+        }
+        val pod = podsByPath.remove(child)
+        if (pod != null) {
+            pods.remove(pod.uid, pod)
+            for (node in pod.containers.values) removeContainer(node)
+            pod.containers.clear()
+            return
+        }
+        intermediateDirs.remove(child)
+    }
+
+    private fun addContainer(pod: PodNode, dir: Path) {
+        if (pod.containers.containsKey(dir.toString()) || !Files.isDirectory(dir)) return
+        val cgroupId = try {
+            Files.getAttribute(dir, "unix:ino") as Long
+        } catch (e: Exception) {
+            log.debug("Cannot stat container cgroup {}: {}", dir, e.message)
+            return
+        }
+        val node = ContainerCgroupNode(
+            podUid = pod.uid,
+            containerId = CgroupPathResolver.containerIdOf(dir.fileName.toString()),
+            path = dir.toString(),
+            cgroupId = cgroupId
+        )
+        if (pod.containers.putIfAbsent(node.path, node) != null) return
+        byCgroupId[cgroupId] = node
+        byContainerId[node.containerId] = node
+        for (listener in listeners) {
+            try {
+                listener.onContainerAdded(node)
+            } catch (e: Exception) {
+                log.debug("Cgroup listener failed for {}: {}", node.path, e.message)
+            }
+        }
+    }
+
+    private fun removeContainer(node: ContainerCgroupNode) {
+        byCgroupId.remove(node.cgroupId, node)
+        byContainerId.remove(node.containerId, node)
+        for (listener in listeners) {
+            try {
+                listener.onContainerRemoved(node)
+            } catch (e: Exception) {
+                log.debug("Cgroup listener failed for {}: {}", node.path, e.message)
+            }
+        }
+    }
+
+    /** Reconciles with the filesystem after the event queue overflowed. */
+    private fun resync() {
+        log.warn("Cgroup watch queue overflowed; rescanning {}", roots)
+        for (pod in podsByPath.values.toList()) {
+            if (!Files.isDirectory(pod.path)) {
+                onDeleted(pod.path.parent, pod.path)
+                continue
+            }
+            for (node in pod.containers.values.toList()) {
+                val path = Paths.get(node.path)
+                if (!Files.isDirectory(path)) onDeleted(pod.path, path)
+            }
+            for (child in listDirectories(pod.path)) onCreated(pod.path, child)
+        }
+        for (dir in intermediateDirs.toList()) {
+            if (!Files.isDirectory(dir) && dir !in roots) {
+                intermediateDirs.remove(dir)
+                continue
+            }
+            for (child in listDirectories(dir)) onCreated(dir, child)
+        }
+    }
+
+    private fun listDirectories(dir: Path): List<Path> = try {
+        Files.list(dir).use { stream -> stream.filter { Files.isDirectory(it) }.toList() }
+    } catch (_: IOException) {
+        emptyList()
+    }
+}
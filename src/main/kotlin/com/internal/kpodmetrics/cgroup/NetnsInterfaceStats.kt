@@ -0,0 +1,87 @@
+package com.internal.kpodmetrics.cgroup
+
+import com.internal.kpodmetrics.bpf.BpfBridge
+import org.slf4j.LoggerFactory
+import java.nio.file.Files
+import java.nio.file.Paths
+import java.util.concurrent.ConcurrentHashMap
+
+/**
+ * Interface statistics keyed by network namespace inode, read at most once per
+ * namespace per cycle ([beginCycle]). All containers of a pod, and all hostNetwork
+ * pods, share a namespace, so a dense node needs far fewer reads than targets.
+ *
+ * Each namespace is read with one RTM_GETLINK netlink dump ([BpfBridge.netnsLinkStats]),
+ * falling back to parsing `/proc/<pid>/net/dev` when there is no bridge, the dump
+ * fails, or the namespace of a pid cannot be determined.
+ */
+class NetnsInterfaceStats(
+    private val procRoot: String,
+    private val reader: CgroupReader,
+    private val bridge: BpfBridge? = null
+) {
+    private val log = LoggerFactory.getLogger(NetnsInterfaceStats::class.java)
+
+    private val cycle = ConcurrentHashMap<Long, List<NetworkStat>>()
+    @Volatile private var netlinkWorked = false
+    @Volatile private var netlinkFailures = 0
+    @Volatile private var netlinkDisabled = bridge == null
+
+    companion object {
+        private const val MAX_INITIAL_FAILURES = 3
+    }
+
+    /** Drops the previous cycle's results; call once before reading for a cycle. */
+    fun beginCycle() = cycle.clear()
+
+    /** Distinct namespaces read this cycle. */
+    fun namespacesRead(): Int = cycle.size
+
+    fun read(pid: Int): List<NetworkStat> = readWithInode(pid).second
+
+    /**
+     * Stats of the pid's namespace together with the namespace inode, which is null
+     * when it cannot be determined. The inode changes when the namespace is recreated.
+     */
+    fun readWithInode(pid: Int): Pair<Long?, List<NetworkStat>> {
+        val inode = netnsInode(pid) ?: return null to reader.readNetworkStats(procRoot, pid)
+        return inode to cycle.computeIfAbsent(inode) { readNetns(pid) }
+    }
+
+    /** Inode of the pid's network namespace, from the `net:[<inode>]` link target. */
+    internal fun netnsInode(pid: Int): Long? {
+        val target = try {
+            Files.readSymbolicLink(Paths.get(procRoot, pid.toString(), "ns", "net")).toString()
+        } catch (_: Exception) {
+            return null
+        }
+        val open = target.indexOf('[')
+        val close = target.indexOf(']', open + 1)
+        if (!target.startsWith("net:") || open < 0 || close < 0) return null
+        return target.substring(open + 1, close).toLongOrNull()
+    }
+
+    private fun readNetns(pid: Int): List<NetworkStat> {
+        if (!netlinkDisabled) {
+            val stats = try {
+                bridge!!.netnsLinkStats("$procRoot/$pid/ns/net")
+            } catch (e: Exception) {
+                log.debug("Netlink link stats for PID {} failed: {}", pid, e.message)
+                null
+            } catch (e: UnsatisfiedLinkError) {
+                log.debug("Netlink link stats unavailable: {}", e.message)
+                null
+            }
+            if (stats != null) {
+                netlinkWorked = true
+                return stats
+            }
+            if (!netlinkWorked && ++netlinkFailures >= MAX_INITIAL_FAILURES) {
+                // Never worked (no CAP_SYS_ADMIN, old native library): stop trying
+                log.warn("Netlink interface stats unavailable, falling back to /proc/<pid>/net/dev")
+                netlinkDisabled = true
+            }
+        }
+        return reader.readNetworkStats(procRoot, pid)
+    }
+}
@@ -0,0 +1,174 @@
+package com.internal.kpodmetrics.cgroup
+
+import org.slf4j.LoggerFactory
+import java.nio.file.Files
+import java.nio.file.Path
+
+/**
+ * Container id to cgroup id index built from `/proc/<pid>/cgroup`, for containers
+ * the [CgroupTreeWatcher] does not know (inotify unavailable, or a layout it does
+ * not watch).
+ *
+ * One pass reads the cgroup file of every process and indexes each container
+ * cgroup by the container id in its directory name, so resolving all containers of
+ * a node costs one pass over /proc instead of one per container. Later passes only
+ * read processes started since the previous one and forget those that exited. A
+ * process is known by its pid and start time (`/proc/<pid>/stat`), so a pid reused
+ * by a new process is read again. A lookup that misses starts a pass at most every
+ * [minRefreshMs].
+ *
+ * The cgroup id is the inode of the container's cgroup directory, taken with one
+ * stat on first lookup and dropped when the directory is gone.
+ */
+class ProcCgroupIndex(
+    private val procRoot: Path? = defaultProcRoot(),
+    private val cgroupRoot: Path = Path.of("/sys/fs/cgroup"),
+    private val minRefreshMs: Long = 1000,
+    private val clock: () -> Long = System::currentTimeMillis,
+    private val statInode: (Path) -> Long? = ::inodeOf
+) {
+    private val log = LoggerFactory.getLogger(ProcCgroupIndex::class.java)
+
+    private class Entry(val path: Path) {
+        var processes = 0
+        var cgroupId = 0L
+    }
+
+    // containerId is "" for processes outside pod containers
+    private class Process(val startTime: Long, val containerId: String)
+
+    private val processOfPid = HashMap<Int, Process>()
+    private val entries = HashMap<String, Entry>()
+    private var lastRefreshMs = Long.MIN_VALUE
+
+    companion object {
+        private fun defaultProcRoot(): Path? =
+            sequenceOf(Path.of("/host/proc"), Path.of("/proc")).firstOrNull { Files.isDirectory(it) }
+
+        private fun inodeOf(path: Path): Long? = try {
+            Files.getAttribute(path, "unix:ino") as Long
+        } catch (_: Exception) {
+            null
+        }
+
+        /**
+         * Parses the cgroup path from /proc/<pid>/cgroup content.
+         * Looks for the cgroup v2 unified hierarchy (line starting with "0::") or
+         * falls back to any line containing "kubepods".
+         */
+        fun parseCgroupPath(content: String): String? {
+            for (line in content.lines()) {
+                // cgroup v2: "0::/kubepods.slice/..."
+                if (line.startsWith("0::")) {
+                    val path = line.removePrefix("0::")
+                    if (path.length > 1 && path.contains("kubepods")) return path
+                }
+            }
+            // Fallback: find any kubepods line (cgroup v1)
+            for (line in content.lines()) {
+                if (line.contains("kubepods")) {
+                    val path = line.substringAfterLast(":")
+                    if (path.isNotBlank()) return path
+                }
+            }
+            return null
+        }
+
+        /** Start time (field 22, clock ticks since boot) from /proc/<pid>/stat content. */
+        internal fun parseStartTime(content: String): Long? {
+            // The command name in field 2 may contain spaces and parentheses
+            val fields = content.substring(content.lastIndexOf(')') + 1).trim().split(' ')
+            return fields.getOrNull(STARTTIME_FIELD - 3)?.toLongOrNull()
+        }
+
+        private const val STARTTIME_FIELD = 22
+    }
+
+    /** Cgroup id of the container [containerId], or null if none of its processes is running. */
+    @Synchronized
+    fun cgroupIdOf(containerId: String): Long? {
+        if (containerId.isBlank()) return null
+        entries[containerId]?.let { entry -> idOf(containerId, entry)?.let { return it } }
+        val now = clock()
+        if (lastRefreshMs != Long.MIN_VALUE && now - lastRefreshMs < minRefreshMs) return null
+        lastRefreshMs = now
+        refresh()
+        return entries[containerId]?.let { idOf(containerId, it) }
+    }
+
+    @Synchronized
+    fun size(): Int = entries.size
+
+    private fun idOf(containerId: String, entry: Entry): Long? {
+        if (entry.cgroupId != 0L) return entry.cgroupId
+        val id = statInode(cgroupRoot.resolve(entry.path))
+        if (id == null) {
+            // The container exited; its processes are forgotten on the next pass
+            entries.remove(containerId)
+            return null
+        }
+        entry.cgroupId = id
+        return id
+    }
+
+    /** Reads the processes started since the last pass and forgets those that exited. */
+    internal fun refresh() {
+        val proc = procRoot ?: return
+        val started = System.nanoTime()
+        val alive = HashSet<Int>(processOfPid.size * 2)
+        var read = 0
+        try {
+            Files.newDirectoryStream(proc).use { stream ->
+                for (dir in stream) {
+                    val pid = dir.fileName.toString().toIntOrNull() ?: continue
+                    val startTime = try {
+                        parseStartTime(Files.readString(dir.resolve("stat")))
+                    } catch (_: Exception) {
+                        null
+                    } ?: continue
+                    alive.add(pid)
+                    val known = processOfPid[pid]
+                    if (known != null) {
+                        if (known.startTime == startTime) continue
+                        // The pid was reused by a process started since the last pass
+                        processOfPid.remove(pid)
+                        release(known.containerId)
+                    }
+                    val content = try {
+                        Files.readString(dir.resolve("cgroup"))
+                    } catch (_: Exception) {
+                        continue
+                    }
+                    read++
+                    val path = parseCgroupPath(content)
+                    if (path == null) {
+                        processOfPid[pid] = Process(startTime, "")
+                        continue
+                    }
+                    val containerId = CgroupPathResolver.containerIdOf(path.substringAfterLast('/'))
+                    processOfPid[pid] = Process(startTime, containerId)
+                    entries.getOrPut(containerId) { Entry(Path.of(path.removePrefix("/"))) }.processes++
+                }
+            }
+        } catch (e: Exception) {
+            log.debug("Failed to list {}: {}", proc, e.message)
+            return
+        }
+        val exited = processOfPid.entries.iterator()
+        while (exited.hasNext()) {
+            val (pid, process) = exited.next()
+            if (pid in alive) continue
+            exited.remove()
+            release(process.containerId)
+        }
+        log.debug(
+            "Indexed {} containers from {} processes ({} read) in {} ms",
+            entries.size, alive.size, read, (System.nanoTime() - started) / 1_000_000
+        )
+    }
+
+    private fun release(containerId: String) {
+        val entry = entries[containerId] ?: return
+        if (--entry.processes <= 0) entries.remove(containerId)
+    }
+}
@@ -0,0 +1,160 @@
+package com.internal.kpodmetrics.cgroup
+
+import org.slf4j.LoggerFactory
+import java.io.IOException
+import java.nio.channels.FileChannel
+import java.nio.file.Files
+import java.nio.file.NoSuchFileException
+import java.nio.file.Paths
+import java.nio.file.StandardOpenOption
+import java.util.concurrent.ArrayBlockingQueue
+import java.util.concurrent.ConcurrentHashMap
+import java.util.concurrent.TimeUnit
+
+/** Stat files [StatFileCache] keeps open, relative to a cgroup or /proc/<pid> directory. */
+enum class StatFile(val fileName: String) {
+    MEMORY_CURRENT("memory.current"),
+    MEMORY_PEAK("memory.peak"),
+    MEMORY_SWAP_CURRENT("memory.swap.current"),
+    MEMORY_STAT("memory.stat"),
+    IO_STAT("io.stat"),
+    CGROUP_PROCS("cgroup.procs"),
+    MEMORY_USAGE_V1("memory.usage_in_bytes"),
+    MEMORY_MAX_USAGE_V1("memory.max_usage_in_bytes"),
+    MEMSW_USAGE_V1("memory.memsw.usage_in_bytes"),
+    BLKIO_BYTES_V1("blkio.throttle.io_service_bytes"),
+    BLKIO_OPS_V1("blkio.throttle.io_serviced"),
+    TASKS_V1("tasks"),
+    NET_DEV("net/dev")
+}
+
+/**
+ * Keeps stat files open per directory across collection cycles and re-reads them
+ * with positional reads at offset 0 (pread) into a [StatScanner]'s reusable buffer,
+ * so a steady-state read opens no file and allocates nothing.
+ *
+ * A file that does not exist in an existing directory is remembered as missing.
+ * A read error (the cgroup was removed) closes the file; the next read reopens it
+ * or finds it gone. Directories not read for [idleTimeoutMs] are closed, which
+ * releases the descriptors of deleted pods and exited processes.
+ */
+class StatFileCache(
+    private val idleTimeoutMs: Long = TimeUnit.MINUTES.toMillis(5),
+    private val clock: () -> Long = System::currentTimeMillis
+) : AutoCloseable {
+    private val log = LoggerFactory.getLogger(StatFileCache::class.java)
+
+    private class Dir(val path: String) {
+        private val channels = arrayOfNulls<FileChannel>(StatFile.entries.size)
+        private val missing = BooleanArray(StatFile.entries.size)
+
+        @Volatile var lastUsedMs = 0L
+
+        @Synchronized
+        fun channel(file: StatFile): FileChannel? {
+            channels[file.ordinal]?.let { return it }
+            if (missing[file.ordinal]) return null
+            return try {
+                FileChannel.open(Paths.get(path, file.fileName), StandardOpenOption.READ)
+                    .also { channels[file.ordinal] = it }
+            } catch (_: NoSuchFileException) {
+                missing[file.ordinal] = true
+                null
+            }
+        }
+
+        @Synchronized
+        fun close(file: StatFile) {
+            channels[file.ordinal]?.let { runCatching { it.close() } }
+            channels[file.ordinal] = null
+        }
+
+        @Synchronized
+        fun closeAll() {
+            for (file in StatFile.entries) close(file)
+        }
+
+        @Synchronized
+        fun openCount(): Int = channels.count { it != null }
+    }
+
+    private val dirs = ConcurrentHashMap<String, Dir>()
+    private val scanners = ArrayBlockingQueue<StatScanner>(SCANNER_POOL_SIZE)
+    @Volatile private var lastSweepMs = 0L
+
+    companion object {
+        private const val SCANNER_POOL_SIZE = 8
+        private const val SWEEP_INTERVAL_MS = 60_000L
+    }
+
+    fun borrow(): StatScanner = scanners.poll() ?: StatScanner()
+
+    fun giveBack(scanner: StatScanner) {
+        scanners.offer(scanner)
+    }
+
+    /**
+     * Loads [file] under [dir] into [scanner] and rewinds it. Returns false if the
+     * file is missing, empty or could not be read.
+     */
+    fun read(dir: String, file: StatFile, scanner: StatScanner): Boolean {
+        val entry = dir(dir) ?: return false
+        try {
+            val channel = entry.channel(file) ?: return false
+            while (true) {
+                val buf = scanner.buffer
+                buf.clear()
+                var n = 0
+                while (buf.hasRemaining()) {
+                    val r = channel.read(buf, n.toLong())
+                    if (r <= 0) break
+                    n += r
+                }
+                if (buf.hasRemaining() || !scanner.grow()) {
+                    if (n == 0) {
+                        entry.close(file)
+                        return false
+                    }
+                    scanner.reset(n)
+                    return true
+                }
+            }
+        } catch (e: IOException) {
+            log.debug("Closing {}/{} after read failure: {}", dir, file.fileName, e.message)
+            entry.close(file)
+            return false
+        }
+    }
+
+    /** Number of files currently held open. */
+    fun openFiles(): Int = dirs.values.sumOf { it.openCount() }
+
+    override fun close() {
+        for (dir in dirs.values) dir.closeAll()
+        dirs.clear()
+    }
+
+    private fun dir(path: String): Dir? {
+        val now = clock()
+        if (now - lastSweepMs >= SWEEP_INTERVAL_MS) sweep(now)
+        val existing = dirs[path]
+        if (existing != null) {
+            existing.lastUsedMs = now
+            return existing
+        }
+        if (!Files.isDirectory(Paths.get(path))) return null
+        return dirs.computeIfAbsent(path) { Dir(it) }.also { it.lastUsedMs = now }
+    }
+
+    private fun sweep(now: Long) {
+        lastSweepMs = now
+        val it = dirs.values.iterator()
+        while (it.hasNext()) {
+            val dir = it.next()
+            if (now - dir.lastUsedMs > idleTimeoutMs) {
+                it.remove()
+                dir.closeAll()
+            }
+        }
+    }
+}
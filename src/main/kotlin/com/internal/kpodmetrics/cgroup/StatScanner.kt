@@ -0,0 +1,175 @@
+package com.internal.kpodmetrics.cgroup
+
+import java.nio.ByteBuffer
+
+/**
+ * Hand-rolled byte scanner over the contents of one cgroup or /proc stat file,
+ * as loaded by [StatFileCache.read]. Parses `key value`, `key=value` and
+ * whitespace-separated numeric columns without creating strings; [values] is a
+ * preallocated slot array that [scanKeyed] fills by key index.
+ *
+ * A scanner and its buffer are reused across reads and are not thread-safe;
+ * borrow one per read from [StatFileCache.borrow].
+ */
+class StatScanner(initialCapacity: Int = 16 * 1024, private val maxCapacity: Int = 1024 * 1024) {
+    var buffer: ByteBuffer = ByteBuffer.allocateDirect(initialCapacity)
+        private set
+
+    /** Slots filled by [scanKeyed]; [NO_VALUE] where a key was absent or not a number. */
+    val values = LongArray(MAX_KEYS)
+
+    private var pos = 0
+    private var limit = 0
+    private var tokenStart = 0
+    private var tokenEnd = 0
+
+    companion object {
+        const val NO_VALUE = Long.MIN_VALUE
+        const val MAX_KEYS = 32
+
+        private const val NL = '\n'.code.toByte()
+        private const val SP = ' '.code.toByte()
+        private const val TAB = '\t'.code.toByte()
+
+        /** Encodes [keys] for [scanKeyed] / [matchToken]. */
+        fun keys(vararg keys: String): Array<ByteArray> {
+            require(keys.size <= MAX_KEYS) { "At most $MAX_KEYS keys" }
+            return Array(keys.size) { keys[it].toByteArray(Charsets.US_ASCII) }
+        }
+    }
+
+    /** Doubles the buffer; false once [maxCapacity] is reached. */
+    internal fun grow(): Boolean {
+        if (buffer.capacity() >= maxCapacity) return false
+        buffer = ByteBuffer.allocateDirect(minOf(buffer.capacity() * 2, maxCapacity))
+        return true
+    }
+
+    /** Rewinds to the start of [length] bytes just read into [buffer]. */
+    internal fun reset(length: Int) {
+        pos = 0
+        limit = length
+    }
+
+    fun hasMore(): Boolean = pos < limit
+
+    fun atLineEnd(): Boolean {
+        skipBlanks()
+        return pos >= limit || buffer.get(pos) == NL
+    }
+
+    /** Moves past the next newline. */
+    fun nextLine() {
+        while (pos < limit && buffer.get(pos) != NL) pos++
+        if (pos < limit) pos++
+    }
+
+    /** Consumes [c] if it is the next byte. */
+    fun expect(c: Char): Boolean {
+        if (pos < limit && buffer.get(pos) == c.code.toByte()) {
+            pos++
+            return true
+        }
+        return false
+    }
+
+    /**
+     * Parses the next unsigned decimal, skipping leading blanks. Returns [NO_VALUE]
+     * (and skips the token) if it is not a number or does not fit in a Long.
+     */
+    fun nextLong(): Long {
+        skipBlanks()
+        var value = 0L
+        var digits = 0
+        while (pos < limit) {
+            val d = buffer.get(pos) - '0'.code.toByte()
+            if (d !in 0..9) break
+            if (value > (Long.MAX_VALUE - d) / 10) {
+                skipToken()
+                return NO_VALUE
+            }
+            value = value * 10 + d
+            digits++
+            pos++
+        }
+        if (digits == 0 || (pos < limit && !isDelimiter(buffer.get(pos)))) {
+            skipToken()
+            return NO_VALUE
+        }
+        return value
+    }
+
+    /**
+     * Reads the next token (up to a blank, newline, `=` or `:`) and returns its
+     * index in [keys], or -1 if it is none of them.
+     */
+    fun matchToken(keys: Array<ByteArray>): Int {
+        skipBlanks()
+        tokenStart = pos
+        while (pos < limit && !isDelimiter(buffer.get(pos))) pos++
+        tokenEnd = pos
+        for (i in keys.indices) {
+            if (tokenEquals(keys[i])) return i
+        }
+        return -1
+    }
+
+    /** Reads the next token like [matchToken] without matching it. */
+    fun nextToken() {
+        matchToken(NO_KEYS)
+    }
+
+    /** Whether the last token read equals [s] (ASCII). */
+    fun tokenEquals(s: String): Boolean {
+        if (tokenEnd - tokenStart != s.length) return false
+        for (i in s.indices) {
+            if (buffer.get(tokenStart + i) != s[i].code.toByte()) return false
+        }
+        return true
+    }
+
+    /** The last token read, as a new String. */
+    fun tokenString(): String {
+        val bytes = ByteArray(tokenEnd - tokenStart)
+        buffer.get(tokenStart, bytes)
+        return String(bytes, Charsets.US_ASCII)
+    }
+
+    /**
+     * Scans `key value` lines from the current position, storing each value whose
+     * key is in [keys] into [values] at the key's index. Unlisted keys are skipped.
+     */
+    fun scanKeyed(keys: Array<ByteArray>) {
+        values.fill(NO_VALUE, 0, keys.size)
+        while (hasMore()) {
+            val idx = matchToken(keys)
+            if (idx >= 0) values[idx] = nextLong()
+            nextLine()
+        }
+    }
+
+    private fun tokenEquals(key: ByteArray): Boolean {
+        if (tokenEnd - tokenStart != key.size) return false
+        for (i in key.indices) {
+            if (buffer.get(tokenStart + i) != key[i]) return false
+        }
+        return true
+    }
+
+    private fun skipBlanks() {
+        while (pos < limit) {
+            val b = buffer.get(pos)
+            if (b != SP && b != TAB) break
+            pos++
+        }
+    }
+
+    private fun skipToken() {
+        while (pos < limit && !isDelimiter(buffer.get(pos))) pos++
+    }
+
+    private fun isDelimiter(b: Byte): Boolean =
+        b == SP || b == TAB || b == NL || b == '='.code.toByte() || b == ':'.code.toByte()
+}
+
+private val NO_KEYS = emptyArray<ByteArray>()
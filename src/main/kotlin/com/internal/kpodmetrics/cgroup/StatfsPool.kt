@@ -0,0 +1,88 @@
+package com.internal.kpodmetrics.cgroup
+
+import io.micrometer.core.instrument.Counter
+import io.micrometer.core.instrument.MeterRegistry
+import org.slf4j.LoggerFactory
+import java.util.concurrent.ArrayBlockingQueue
+import java.util.concurrent.Callable
+import java.util.concurrent.ConcurrentHashMap
+import java.util.concurrent.ExecutionException
+import java.util.concurrent.Future
+import java.util.concurrent.RejectedExecutionException
+import java.util.concurrent.ThreadPoolExecutor
+import java.util.concurrent.TimeUnit
+import java.util.concurrent.TimeoutException
+import java.util.concurrent.atomic.AtomicInteger
+
+/**
+ * Runs statfs for a cycle's unique filesystems on a small pool of daemon threads,
+ * waiting at most [timeoutMs] for the whole batch. A hung mount (an unreachable NFS
+ * server) then costs one stuck worker instead of stalling the collector, and a
+ * filesystem whose previous statfs has not returned is skipped rather than
+ * submitted again, so it cannot take over the pool.
+ *
+ * Skipped and timed-out filesystems are counted in `kpod.fs.statfs.timeouts`.
+ */
+class StatfsPool(
+    threads: Int = 4,
+    private val timeoutMs: Long = 2000,
+    registry: MeterRegistry? = null,
+    private val stat: (String) -> FilesystemStat? = { CgroupReader.statfs(it) }
+) : AutoCloseable {
+    private val log = LoggerFactory.getLogger(StatfsPool::class.java)
+    private val threadIds = AtomicInteger()
+    private val executor = ThreadPoolExecutor(
+        threads, threads, 0, TimeUnit.MILLISECONDS, ArrayBlockingQueue(QUEUE_CAPACITY)
+    ) { r -> Thread(r, "statfs-${threadIds.incrementAndGet()}").apply { isDaemon = true } }
+    private val inFlight = ConcurrentHashMap<String, Future<FilesystemStat?>>()
+    private val timeouts: Counter? = registry?.counter("kpod.fs.statfs.timeouts")
+
+    companion object {
+        private const val QUEUE_CAPACITY = 1024
+    }
+
+    /**
+     * statfs of each path in [paths], keyed by filesystem (for instance its device).
+     * Filesystems that failed, timed out or are still hung from an earlier cycle are
+     * absent from the result.
+     */
+    fun statAll(paths: Map<String, String>): Map<String, FilesystemStat> {
+        inFlight.values.removeIf { it.isDone }
+        val deadline = System.nanoTime() + TimeUnit.MILLISECONDS.toNanos(timeoutMs)
+        val pending = HashMap<String, Future<FilesystemStat?>>(paths.size)
+        for ((key, path) in paths) {
+            if (inFlight.containsKey(key)) {
+                timeouts?.increment()
+                continue
+            }
+            val future = try {
+                executor.submit(Callable { stat(path) })
+            } catch (_: RejectedExecutionException) {
+                timeouts?.increment()
+                continue
+            }
+            inFlight[key] = future
+            pending[key] = future
+        }
+
+        val result = HashMap<String, FilesystemStat>(pending.size)
+        for ((key, future) in pending) {
+            try {
+                val remaining = (deadline - System.nanoTime()).coerceAtLeast(0)
+                future.get(remaining, TimeUnit.NANOSECONDS)?.let { result[key] = it }
+                inFlight.remove(key, future)
+            } catch (_: TimeoutException) {
+                log.debug("statfs of {} ({}) did not return within {}ms", key, paths[key], timeoutMs)
+                timeouts?.increment()
+            } catch (e: ExecutionException) {
+                log.debug("statfs of {} ({}) failed: {}", key, paths[key], e.cause?.message)
+                inFlight.remove(key, future)
+            }
+        }
+        return result
+    }
+
+    override fun close() {
+        executor.shutdownNow()
+    }
+}
@@ -19,6 +19,7 @@ class BiolatencyCollector(
     private val nodeName: String
 ) {
     private val log = LoggerFactory.getLogger(BiolatencyCollector::class.java)
+    private val unresolvedBioLatency = UnresolvedBuffer<Pair<ByteArray, ByteArray>>(cgroupResolver)
 
     companion object {
         private const val MAX_ENTRIES = 10240
@@ -28,17 +29,14 @@ class BiolatencyCollector(
         if (!config.extended.biolatency) return
 
         val mapFd = programManager.getMapFd("biolatency", "bio_latency")
-        val entries = bridge.mapBatchLookupAndDelete(
-            mapFd, BiolatencyMapReader.HistKeyLayout.SIZE,
-            BiolatencyMapReader.HistValueLayout.SIZE, MAX_ENTRIES
-        )
-        entries.forEach { (keyBytes, valueBytes) ->
-            val cgroupId = BiolatencyMapReader.HistKeyLayout.decodeCgroupId(keyBytes)
-            val podInfo = cgroupResolver.resolve(cgroupId) ?: return@forEach
-
+        unresolvedBioLatency.drain(
+            bridge, mapFd, BiolatencyMapReader.HistKeyLayout.SIZE,
+            BiolatencyMapReader.HistValueLayout.SIZE, MAX_ENTRIES,
+            { BiolatencyMapReader.HistKeyLayout.decodeCgroupId(it) }
+        ) { podInfo, _, valueBytes ->
             val count = BiolatencyMapReader.HistValueLayout.decodeCount(valueBytes)
             val sumNs = BiolatencyMapReader.HistValueLayout.decodeSumNs(valueBytes)
-            if (!BpfValueValidation.isValidLatency(count, sumNs, log, "biolatency")) return@forEach
+            if (!BpfValueValidation.isValidLatency(count, sumNs, log, "biolatency")) return@drain
 
             val tags = Tags.of(
                 "namespace", podInfo.namespace,
@@ -7,7 +7,25 @@ import io.micrometer.core.instrument.Tags
 import org.slf4j.LoggerFactory
 import java.nio.ByteBuffer
 import java.nio.ByteOrder
+import java.util.concurrent.ConcurrentHashMap
+import java.util.concurrent.atomic.AtomicLong
 
+/**
+ * Per-map diagnostics from the `<map>_stats` companions that map_insert() and
+ * map_delete() maintain in every program:
+ * - kpod.bpf.map.entries{map} — estimated live entries (gauge)
+ * - kpod.bpf.map.capacity{map} — max_entries (gauge)
+ * - kpod.bpf.map.occupancy.high.water{map} — peak occupancy seen during the last
+ *   cycle: the largest drain, or the live estimate for maps that are not drained (gauge)
+ * - kpod.bpf.map.update.errors.total{map} — inserts the kernel rejected (counter)
+ * - kpod.bpf.map.evictions.total{map} — entries that left a drained map without
+ *   being drained, i.e. LRU evictions (counter)
+ * - kpod.bpf.map.lost.updates.total{map} — update errors plus evictions (counter)
+ *
+ * Evictions are inferred by comparing in-kernel inserts with what drains removed
+ * ([BpfBridge.drainTally]). Inserts are taken from the previous cycle's read, so
+ * the count lags one cycle but never includes keys that are merely not drained yet.
+ */
 class BpfMapStatsCollector(
     private val bridge: BpfBridge,
     private val programManager: BpfProgramManager,
@@ -15,52 +33,124 @@ class BpfMapStatsCollector(
 ) {
     private val log = LoggerFactory.getLogger(BpfMapStatsCollector::class.java)
 
+    /** A data map with a DEFINE_STATS_MAP companion named `<name>_stats`. */
+    private data class TrackedMap(
+        val program: String,
+        val name: String,
+        val capacity: Int = MAX_ENTRIES,
+        val mapName: String = name
+    )
+
+    private class MapState {
+        var errors = 0L
+        var prevInserts = -1L
+        var prevDrains = 0L
+        var evictions = 0L
+        val entries = AtomicLong()
+        val highWater = AtomicLong()
+    }
+
     companion object {
         private const val MAP_STAT_ENTRIES = 0
         private const val MAP_STAT_UPDATE_ERRORS = 1
-        private const val MAP_STAT_MAX = 2
         private const val MAX_ENTRIES = 10240
         private const val STAT_VALUE_SIZE = 8 // sizeof(__s64)
 
-        private val STATS_MAPS = listOf(
-            "cpu_sched" to "ctx_switches_stats",
-            "cpu_sched" to "runq_latency_stats",
-            "net" to "tcp_stats_map_stats",
-            "net" to "rtt_hist_stats",
-            "syscall" to "syscall_stats_map_stats"
-        )
+        private val TRACKED_MAPS = listOf(
+            TrackedMap("cpu_sched", "ctx_switches"),
+            TrackedMap("cpu_sched", "runq_latency"),
+            TrackedMap("net", "tcp_stats_map"),
+            TrackedMap("net", "rtt_hist"),
+            TrackedMap("syscall", "syscall_stats_map", mapName = "syscall_stats"),
+            TrackedMap("mem", "oom_kills"),
+            TrackedMap("mem", "major_faults"),
+            TrackedMap("cachestat", "cache_stats"),
+            TrackedMap("tcpdrop", "tcp_drops"),
+            TrackedMap("tcp_peer", "tcp_peer_conns"),
+            TrackedMap("tcp_peer", "tcp_peer_rtt"),
+            TrackedMap("dns", "dns_requests"),
+            TrackedMap("dns", "dns_latency"),
+            TrackedMap("dns", "dns_errors"),
+            TrackedMap("dns", "dns_domains", capacity = 1024),
+            TrackedMap("dns", "dns_inflight", capacity = 4096),
+            TrackedMap("http", "http_events"),
+            TrackedMap("http", "http_latency"),
+            TrackedMap("http", "http_inflight", capacity = 8192)
+        ) + listOf("redis", "mysql", "kafka", "mongo").flatMap { p ->
+            listOf(
+                TrackedMap(p, "${p}_events"),
+                TrackedMap(p, "${p}_latency"),
+                TrackedMap(p, "${p}_errors"),
+                TrackedMap(p, "${p}_inflight", capacity = 8192)
+            )
+        }
+
+        private val STAT_KEYS = List(2) { idx ->
+            ByteBuffer.allocate(4).order(ByteOrder.LITTLE_ENDIAN).putInt(idx).array()
+        }
     }
 
+    private val states = ConcurrentHashMap<TrackedMap, MapState>()
+
     fun collect() {
-        for ((program, statsMap) in STATS_MAPS) {
-            if (!programManager.isProgramLoaded(program)) continue
+        for (map in TRACKED_MAPS) {
+            if (!programManager.isProgramLoaded(map.program)) continue
             try {
-                collectMapStats(program, statsMap)
+                collectMapStats(map)
             } catch (e: Exception) {
-                log.debug("Failed to collect stats from {}/{}: {}", program, statsMap, e.message)
+                log.debug("Failed to collect stats from {}/{}_stats: {}", map.program, map.name, e.message)
             }
         }
     }
 
-    private fun collectMapStats(program: String, statsMap: String) {
-        val mapFd = programManager.getMapFd(program, statsMap)
-        val mapName = statsMap.removeSuffix("_stats")
-        val tags = Tags.of("map", mapName)
-
-        for (statIdx in 0 until MAP_STAT_MAX) {
-            val key = ByteBuffer.allocate(4).order(ByteOrder.LITTLE_ENDIAN).putInt(statIdx).array()
-            val value = bridge.mapLookupPercpuSum(mapFd, key, STAT_VALUE_SIZE) ?: continue
-
-            when (statIdx) {
-                MAP_STAT_ENTRIES ->
-                    registry.gauge("kpod.bpf.map.entries", tags, value) { it.toDouble() }
-                MAP_STAT_UPDATE_ERRORS ->
-                    registry.counter("kpod.bpf.map.update.errors.total", tags).increment(
-                        value.toDouble().coerceAtLeast(0.0)
-                    )
+    private fun collectMapStats(map: TrackedMap) {
+        val statsFd = programManager.getMapFd(map.program, "${map.name}_stats")
+        // Successful inserts net of in-kernel deletes; drains are not seen by the kernel side
+        val sums = bridge.mapLookupPercpuSums(statsFd, STAT_KEYS, STAT_VALUE_SIZE)
+        val inserts = sums[MAP_STAT_ENTRIES] ?: return
+        val errors = sums[MAP_STAT_UPDATE_ERRORS] ?: 0L
+        val tally = bridge.drainTally(programManager.getMapFd(map.program, map.mapName))
+        val drained = tally?.entries ?: 0L
+        val drains = tally?.drains ?: 0L
+
+        val tags = Tags.of("map", map.name)
+        val state = states.computeIfAbsent(map) { newState(tags, map.capacity) }
+
+        val errorDelta = (errors - state.errors).coerceAtLeast(0)
+        state.errors = errors
+
+        // Every key inserted before the previous read has since been drained, evicted,
+        // or is still live; after a full drain none is live, so the rest was evicted.
+        var evictionDelta = 0L
+        if (state.prevInserts >= 0 && drains > state.prevDrains) {
+            val evicted = state.prevInserts - drained
+            if (evicted > state.evictions) {
+                evictionDelta = evicted - state.evictions
+                state.evictions = evicted
             }
         }
+        state.prevInserts = inserts
+        state.prevDrains = drains
+
+        if (errorDelta > 0) {
+            registry.counter("kpod.bpf.map.update.errors.total", tags).increment(errorDelta.toDouble())
+        }
+        if (evictionDelta > 0) {
+            registry.counter("kpod.bpf.map.evictions.total", tags).increment(evictionDelta.toDouble())
+        }
+        if (errorDelta + evictionDelta > 0) {
+            registry.counter("kpod.bpf.map.lost.updates.total", tags)
+                .increment((errorDelta + evictionDelta).toDouble())
+        }
+
+        val live = (inserts - drained - state.evictions).coerceIn(0L, map.capacity.toLong())
+        state.entries.set(live)
+        state.highWater.set(maxOf(tally?.takePeak()?.toLong() ?: 0L, live))
+    }
 
-        registry.gauge("kpod.bpf.map.capacity", tags, MAX_ENTRIES) { it.toDouble() }
+    private fun newState(tags: Tags, capacity: Int) = MapState().also { state ->
+        registry.gauge("kpod.bpf.map.entries", tags, state.entries) { it.toDouble() }
+        registry.gauge("kpod.bpf.map.occupancy.high.water", tags, state.highWater) { it.toDouble() }
+        registry.gauge("kpod.bpf.map.capacity", tags, capacity) { it.toDouble() }
     }
 }
@@ -2,18 +2,29 @@ package com.internal.kpodmetrics.collector
 
 import com.internal.kpodmetrics.bpf.BpfBridge
 import com.internal.kpodmetrics.bpf.BpfProgramManager
+import com.internal.kpodmetrics.bpf.BpfProgramStats
 import io.micrometer.core.instrument.MeterRegistry
 import io.micrometer.core.instrument.Tags
 import org.slf4j.LoggerFactory
 import java.util.concurrent.ConcurrentHashMap
+import java.util.concurrent.atomic.AtomicLong
 
 /**
- * Collects BPF program overhead metrics:
+ * Collects BPF program overhead metrics per object:
  * - kpod.bpf.program.run.time.ns{program} — cumulative in-kernel CPU time (counter)
  * - kpod.bpf.program.run.count{program} — invocation count (counter)
  *
- * Requires kernel 5.1+ with /proc/sys/kernel/bpf_stats_enabled=1.
- * On older kernels, values will be 0 (harmless).
+ * and per program within the object, tagged with its attach point:
+ * - kpod.bpf.hook.run.time.ns{program,function,attach_point} (counter)
+ * - kpod.bpf.hook.run.count{program,function,attach_point} (counter)
+ * - kpod.bpf.hook.recursion.misses{program,function,attach_point} — runs skipped
+ *   because the program was already running on that CPU (counter, kernel 5.12+)
+ * - kpod.bpf.hook.ns.per.event{program,function,attach_point} — mean run time per
+ *   invocation over the last collection interval (gauge)
+ *
+ * Run-time stats must be enabled; [BpfProgramManager] does that with
+ * BPF_ENABLE_STATS (kernel 5.8+) or the bpf_stats_enabled sysctl. Without them
+ * the values stay 0 (harmless).
  */
 class BpfOverheadCollector(
     private val bridge: BpfBridge,
@@ -25,6 +36,8 @@ class BpfOverheadCollector(
     // Track previous values to emit monotonic deltas as counters
     private val prevRunTime = ConcurrentHashMap<String, Long>()
     private val prevRunCnt = ConcurrentHashMap<String, Long>()
+    private val prevRecursionMisses = ConcurrentHashMap<String, Long>()
+    private val nsPerEvent = ConcurrentHashMap<String, AtomicLong>()
 
     fun collect() {
         for (name in programManager.getLoadedProgramNames()) {
@@ -38,18 +51,20 @@ class BpfOverheadCollector(
 
     private fun collectProgram(name: String) {
         val handle = programManager.getHandle(name) ?: return
-        val stats = bridge.getProgStats(handle) ?: return
-        val runTimeNs = stats[0]
-        val runCnt = stats[1]
+        val perProgram = bridge.getProgramStats(handle)
+        val (runTimeNs, runCnt) = if (perProgram != null) {
+            perProgram.forEach { collectHook(name, it) }
+            perProgram.sumOf { it.runTimeNs } to perProgram.sumOf { it.runCount }
+        } else {
+            val stats = bridge.getProgStats(handle) ?: return
+            stats[0] to stats[1]
+        }
 
         val tags = Tags.of("program", name)
 
         // Emit as counters (monotonically increasing)
-        val prevTime = prevRunTime.put(name, runTimeNs) ?: 0L
-        val prevCnt = prevRunCnt.put(name, runCnt) ?: 0L
-
-        val timeDelta = (runTimeNs - prevTime).coerceAtLeast(0)
-        val cntDelta = (runCnt - prevCnt).coerceAtLeast(0)
+        val timeDelta = delta(prevRunTime, name, runTimeNs)
+        val cntDelta = delta(prevRunCnt, name, runCnt)
 
         if (timeDelta > 0) {
             registry.counter("kpod.bpf.program.run.time.ns", tags).increment(timeDelta.toDouble())
@@ -58,4 +73,33 @@ class BpfOverheadCollector(
             registry.counter("kpod.bpf.program.run.count", tags).increment(cntDelta.toDouble())
         }
     }
+
+    private fun collectHook(program: String, stats: BpfProgramStats) {
+        val key = "$program/${stats.name}"
+        val tags = Tags.of("program", program, "function", stats.name, "attach_point", stats.attachPoint)
+
+        val timeDelta = delta(prevRunTime, key, stats.runTimeNs)
+        val cntDelta = delta(prevRunCnt, key, stats.runCount)
+        val missDelta = delta(prevRecursionMisses, key, stats.recursionMisses)
+
+        if (timeDelta > 0) {
+            registry.counter("kpod.bpf.hook.run.time.ns", tags).increment(timeDelta.toDouble())
+        }
+        if (cntDelta > 0) {
+            registry.counter("kpod.bpf.hook.run.count", tags).increment(cntDelta.toDouble())
+        }
+        if (missDelta > 0) {
+            registry.counter("kpod.bpf.hook.recursion.misses", tags).increment(missDelta.toDouble())
+        }
+
+        val perEvent = if (cntDelta > 0) timeDelta.toDouble() / cntDelta else 0.0
+        nsPerEvent.computeIfAbsent(key) { k ->
+            AtomicLong().also { holder ->
+                registry.gauge("kpod.bpf.hook.ns.per.event", tags, holder) { Double.fromBits(it.get()) }
+            }
+        }.set(perEvent.toRawBits())
+    }
+
+    private fun delta(previous: ConcurrentHashMap<String, Long>, key: String, current: Long): Long =
+        (current - (previous.put(key, current) ?: 0L)).coerceAtLeast(0)
 }
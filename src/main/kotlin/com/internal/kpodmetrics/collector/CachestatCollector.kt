@@ -18,6 +18,7 @@ class CachestatCollector(
     private val nodeName: String
 ) {
     private val log = LoggerFactory.getLogger(CachestatCollector::class.java)
+    private val unresolvedCacheStats = UnresolvedBuffer<Pair<ByteArray, ByteArray>>(cgroupResolver)
 
     companion object {
         private const val MAX_ENTRIES = 10240
@@ -27,14 +28,11 @@ class CachestatCollector(
         if (!config.extended.cachestat) return
 
         val mapFd = programManager.getMapFd("cachestat", "cache_stats")
-        val entries = bridge.mapBatchLookupAndDelete(
-            mapFd, CachestatMapReader.CgroupKeyLayout.SIZE,
-            CachestatMapReader.CacheStatsLayout.SIZE, MAX_ENTRIES
-        )
-        entries.forEach { (keyBytes, valueBytes) ->
-            val cgroupId = CachestatMapReader.CgroupKeyLayout.decodeCgroupId(keyBytes)
-            val podInfo = cgroupResolver.resolve(cgroupId) ?: return@forEach
-
+        unresolvedCacheStats.drain(
+            bridge, mapFd, CachestatMapReader.CgroupKeyLayout.SIZE,
+            CachestatMapReader.CacheStatsLayout.SIZE, MAX_ENTRIES,
+            { CachestatMapReader.CgroupKeyLayout.decodeCgroupId(it) }
+        ) { podInfo, _, valueBytes ->
             val accesses = CachestatMapReader.CacheStatsLayout.decodeAccesses(valueBytes)
             val additions = CachestatMapReader.CacheStatsLayout.decodeAdditions(valueBytes)
             val dirtied = CachestatMapReader.CacheStatsLayout.decodeDirtied(valueBytes)
@@ -0,0 +1,218 @@
+package com.internal.kpodmetrics.collector
+
+import com.internal.kpodmetrics.bpf.ThreadCostProbe
+import org.slf4j.LoggerFactory
+import java.lang.management.ManagementFactory
+import java.util.concurrent.ConcurrentHashMap
+
+/**
+ * Cost-budgeted adaptive scheduler for [MetricsCollectorService].
+ *
+ * Learns each collector's cost (EWMA of wall time, thread CPU time and allocated
+ * bytes, the same sample recorded into `kpod.collector.duration`) and its data
+ * volatility (EWMA of how often a run produced anything: map entries drained, or
+ * series changed for the cgroup collectors; see [recordActivity]).
+ *
+ * Each cycle it:
+ * 1. Spreads collectors over [spreadWindowMs] by assigning start offsets, placing
+ *    the most expensive collectors first into the least-loaded slot, so CPU is
+ *    not burned in one burst at the start of the cycle.
+ * 2. When agent CPU load (against its container CPU limit, see [ContainerCpuLoad]) is
+ *    at or above [cpuBudget], doubles the stretch factor of the collector with the
+ *    highest cost/volatility score (expensive, low value), up to [maxStretchFactor]. Once load falls below the relax threshold, the
+ *    least expensive stretched collector is halved again. One step per cycle keeps
+ *    the control loop from oscillating.
+ *
+ * A collector with stretch factor N runs on every N-th cycle where it is otherwise due.
+ */
+class CollectionScheduler(
+    private val spreadWindowMs: Long,
+    private val spreadSlots: Int = 4,
+    private val cpuBudget: Double = 0.8,
+    private val maxStretchFactor: Int = 4,
+    private val ewmaAlpha: Double = 0.3,
+    private val cpuLoadSupplier: () -> Double = ContainerCpuLoad.forSelf()::sample
+) {
+    private val log = LoggerFactory.getLogger(CollectionScheduler::class.java)
+
+    companion object {
+        /** Load must fall this far below the budget before a stretch is relaxed. */
+        private const val RELAX_RATIO = 0.75
+        private const val VOLATILITY_FLOOR = 0.05
+
+        /** Agent CPU load relative to all host CPUs. */
+        fun processCpuLoad(): Double {
+            val os = ManagementFactory.getOperatingSystemMXBean() as? com.sun.management.OperatingSystemMXBean
+                ?: return -1.0
+            return os.processCpuLoad
+        }
+    }
+
+    private class CollectorState {
+        var wallNs = 0.0
+        var cpuNs = 0.0
+        var allocBytes = 0.0
+        var volatility = 1.0
+        var samples = 0L
+        var activitySamples = 0L
+        var stretch = 1
+        var skipsRemaining = 0
+        var offsetMs = 0L
+    }
+
+    private val states = ConcurrentHashMap<String, CollectorState>()
+    @Volatile private var lastCpuLoad = -1.0
+    @Volatile private var underPressure = false
+
+    private fun state(name: String): CollectorState = states.computeIfAbsent(name) { CollectorState() }
+
+    /**
+     * Called once at the start of every cycle with the names of all enabled collectors.
+     * Applies at most one stretch/relax step and recomputes start offsets.
+     */
+    fun beginCycle(collectors: Collection<String>) {
+        collectors.forEach { state(it) }
+        val load = cpuLoadSupplier()
+        lastCpuLoad = load
+        underPressure = load >= 0 && load >= cpuBudget
+        synchronized(this) {
+            adjustStretch(load)
+            assignOffsets(collectors)
+        }
+    }
+
+    /**
+     * Returns false if the collector is stretched and should sit out this cycle.
+     * Only called for collectors whose static interval already allows a run.
+     */
+    fun admit(name: String): Boolean {
+        val s = state(name)
+        synchronized(s) {
+            if (s.skipsRemaining > 0) {
+                s.skipsRemaining--
+                return false
+            }
+            s.skipsRemaining = s.stretch - 1
+            return true
+        }
+    }
+
+    fun offsetMs(name: String): Long = states[name]?.offsetMs ?: 0L
+
+    fun stretchFactor(name: String): Int = states[name]?.stretch ?: 1
+
+    /** Records one invocation's cost. Negative cpu/alloc values mean "not measurable". */
+    fun recordCost(name: String, wallNs: Long, cpuNs: Long, allocBytes: Long) {
+        val s = state(name)
+        synchronized(s) {
+            if (s.samples == 0L) {
+                s.wallNs = wallNs.toDouble()
+                s.cpuNs = cpuNs.coerceAtLeast(0).toDouble()
+                s.allocBytes = allocBytes.coerceAtLeast(0).toDouble()
+            } else {
+                s.wallNs = ewma(s.wallNs, wallNs.toDouble())
+                if (cpuNs >= 0) s.cpuNs = ewma(s.cpuNs, cpuNs.toDouble())
+                if (allocBytes >= 0) s.allocBytes = ewma(s.allocBytes, allocBytes.toDouble())
+            }
+            s.samples++
+        }
+    }
+
+    /**
+     * Folds whether a run produced output ([activity] > 0: map entries drained or
+     * series changed) into the collector's volatility estimate. The collectors count
+     * this as they work, so no registry scan is needed.
+     */
+    fun recordActivity(name: String, activity: Long) {
+        val s = state(name)
+        synchronized(s) {
+            // The first run drains whatever piled up before the agent started
+            if (s.activitySamples++ == 0L) return
+            s.volatility = ewma(s.volatility, if (activity > 0) 1.0 else 0.0)
+        }
+    }
+
+    private fun ewma(prev: Double, sample: Double): Double =
+        ewmaAlpha * sample + (1 - ewmaAlpha) * prev
+
+    private fun cost(s: CollectorState): Double = if (s.cpuNs > 0) s.cpuNs else s.wallNs
+
+    private fun score(s: CollectorState): Double = cost(s) / s.volatility.coerceAtLeast(VOLATILITY_FLOOR)
+
+    private fun adjustStretch(load: Double) {
+        if (load < 0) return
+        if (load >= cpuBudget) {
+            val candidate = states.entries
+                .filter { it.value.samples > 0 && it.value.stretch < maxStretchFactor }
+                .maxByOrNull { score(it.value) } ?: return
+            val s = candidate.value
+            synchronized(s) { s.stretch = (s.stretch * 2).coerceAtMost(maxStretchFactor) }
+            log.info("Agent CPU load {} >= budget {}: stretching collector '{}' to every {} cycles",
+                "%.2f".format(load), cpuBudget, candidate.key, s.stretch)
+        } else if (load < cpuBudget * RELAX_RATIO) {
+            val candidate = states.entries
+                .filter { it.value.stretch > 1 }
+                .minByOrNull { score(it.value) } ?: return
+            val s = candidate.value
+            synchronized(s) {
+                s.stretch = (s.stretch / 2).coerceAtLeast(1)
+                s.skipsRemaining = s.skipsRemaining.coerceAtMost(s.stretch - 1)
+            }
+            log.info("Agent CPU load {} below relax threshold: collector '{}' back to every {} cycles",
+                "%.2f".format(load), candidate.key, s.stretch)
+        }
+    }
+
+    /** Longest-processing-time-first placement of collectors into evenly spaced slots. */
+    private fun assignOffsets(collectors: Collection<String>) {
+        val slots = spreadSlots.coerceAtLeast(1)
+        if (slots == 1 || spreadWindowMs <= 0) {
+            collectors.forEach { state(it).offsetMs = 0L }
+            return
+        }
+        val slotLoad = DoubleArray(slots)
+        val slotWidth = spreadWindowMs / slots
+        val ordered = collectors.sortedByDescending { cost(state(it)) }
+        for (name in ordered) {
+            val s = state(name)
+            if (s.samples == 0L) {
+                // Unknown cost: run immediately so the first sample comes in quickly
+                s.offsetMs = 0L
+                continue
+            }
+            var best = 0
+            for (i in 1 until slots) {
+                if (slotLoad[i] < slotLoad[best]) best = i
+            }
+            slotLoad[best] += cost(s)
+            s.offsetMs = best * slotWidth
+        }
+    }
+
+    /** Budget and current schedule, exposed through `kpodDiagnostics`. */
+    fun snapshot(): Map<String, Any?> {
+        val collectors = states.entries.sortedBy { it.key }.associate { (name, s) ->
+            name to synchronized(s) {
+                mapOf(
+                    "offsetMs" to s.offsetMs,
+                    "stretchFactor" to s.stretch,
+                    "avgWallMs" to s.wallNs / 1_000_000.0,
+                    "avgCpuMs" to s.cpuNs / 1_000_000.0,
+                    "avgAllocatedBytes" to s.allocBytes.toLong(),
+                    "volatility" to s.volatility,
+                    "samples" to s.samples
+                )
+            }
+        }
+        return mapOf(
+            "enabled" to true,
+            "cpuBudget" to cpuBudget,
+            "cpuLoad" to lastCpuLoad.takeIf { it >= 0 },
+            "underPressure" to underPressure,
+            "spreadWindowMs" to spreadWindowMs,
+            "spreadSlots" to spreadSlots,
+            "maxStretchFactor" to maxStretchFactor,
+            "collectors" to collectors
+        )
+    }
+}
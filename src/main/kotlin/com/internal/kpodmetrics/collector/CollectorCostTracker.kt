@@ -0,0 +1,125 @@
+package com.internal.kpodmetrics.collector
+
+import com.internal.kpodmetrics.bpf.NativeCallCost
+import io.micrometer.core.instrument.Counter
+import io.micrometer.core.instrument.MeterRegistry
+import io.micrometer.core.instrument.Tags
+import java.util.concurrent.ConcurrentHashMap
+
+/**
+ * Per-collector CPU and allocation self-telemetry, recorded around every collector
+ * invocation by [MetricsCollectorService]. The collector's own (JVM-side) cost and
+ * the cost of its native BPF calls ([NativeCallCost]) are kept apart:
+ * - kpod.collector.cpu.time.ns{collector} — thread CPU time outside native calls (counter)
+ * - kpod.collector.allocated.bytes{collector} — bytes allocated outside native calls (counter)
+ * - kpod.collector.jni.time.ns{collector} — wall time inside native calls (counter)
+ * - kpod.collector.jni.cpu.time.ns{collector} — CPU time inside native calls (counter)
+ * - kpod.collector.jni.allocated.bytes{collector} — bytes allocated by native calls,
+ *   i.e. the key/value arrays they return (counter)
+ * - kpod.collector.jni.calls{collector} — native calls made (counter)
+ *
+ * Collectors run on platform threads so both sides can be measured; where the JVM
+ * still cannot measure a thread (virtual threads) the JVM-side counters are not
+ * incremented. The last [window] invocations
+ * per collector feed the rolling top-[topN] in `kpodDiagnostics`.
+ */
+class CollectorCostTracker(
+    private val registry: MeterRegistry? = null,
+    private val window: Int = 10,
+    private val topN: Int = 5
+) {
+    /** Cost of one collector invocation; -1 for a value that could not be measured. */
+    data class Sample(
+        val wallNs: Long,
+        val cpuNs: Long,
+        val allocatedBytes: Long,
+        val jniWallNs: Long,
+        val jniCpuNs: Long,
+        val jniAllocatedBytes: Long,
+        val jniCalls: Long
+    )
+
+    private class CollectorMeters(registry: MeterRegistry, name: String) {
+        private val tags = Tags.of("collector", name)
+        val cpu: Counter = registry.counter("kpod.collector.cpu.time.ns", tags)
+        val alloc: Counter = registry.counter("kpod.collector.allocated.bytes", tags)
+        val jniWall: Counter = registry.counter("kpod.collector.jni.time.ns", tags)
+        val jniCpu: Counter = registry.counter("kpod.collector.jni.cpu.time.ns", tags)
+        val jniAlloc: Counter = registry.counter("kpod.collector.jni.allocated.bytes", tags)
+        val jniCalls: Counter = registry.counter("kpod.collector.jni.calls", tags)
+    }
+
+    private val meters = ConcurrentHashMap<String, CollectorMeters>()
+    private val recent = ConcurrentHashMap<String, ArrayDeque<Sample>>()
+
+    /**
+     * Records one invocation from its thread-level deltas ([threadCpuNs], [threadAllocBytes],
+     * -1 when unmeasurable) and the [native] account it ran with. Native work that ran
+     * inline on the collector thread is moved from the thread totals to the JNI side.
+     */
+    fun record(name: String, wallNs: Long, threadCpuNs: Long, threadAllocBytes: Long, native: NativeCallCost) {
+        val sample = Sample(
+            wallNs = wallNs,
+            cpuNs = if (threadCpuNs < 0) -1 else (threadCpuNs - native.inlineCpuNs).coerceAtLeast(0),
+            allocatedBytes = if (threadAllocBytes < 0) -1 else
+                (threadAllocBytes - native.inlineAllocatedBytes).coerceAtLeast(0),
+            jniWallNs = native.wallNs,
+            jniCpuNs = native.cpuNs,
+            jniAllocatedBytes = native.allocatedBytes,
+            jniCalls = native.calls
+        )
+        record(name, sample)
+    }
+
+    fun record(name: String, sample: Sample) {
+        registry?.let { reg ->
+            val m = meters.computeIfAbsent(name) { CollectorMeters(reg, it) }
+            if (sample.cpuNs >= 0) m.cpu.increment(sample.cpuNs.toDouble())
+            if (sample.allocatedBytes >= 0) m.alloc.increment(sample.allocatedBytes.toDouble())
+            m.jniWall.increment(sample.jniWallNs.toDouble())
+            m.jniCpu.increment(sample.jniCpuNs.toDouble())
+            m.jniAlloc.increment(sample.jniAllocatedBytes.toDouble())
+            m.jniCalls.increment(sample.jniCalls.toDouble())
+        }
+        val samples = recent.computeIfAbsent(name) { ArrayDeque(window) }
+        synchronized(samples) {
+            if (samples.size >= window) samples.removeFirst()
+            samples.addLast(sample)
+        }
+    }
+
+    /** Rolling averages for the costliest collectors, exposed through `kpodDiagnostics`. */
+    fun snapshot(): Map<String, Any?> {
+        val averages = recent.entries.map { (name, samples) ->
+            val copy = synchronized(samples) { samples.toList() }
+            average(name, copy)
+        }
+        return mapOf(
+            "window" to window,
+            "topByAllocation" to averages
+                .sortedByDescending { (it["avgAllocatedBytes"] as Long) + (it["avgJniAllocatedBytes"] as Long) }
+                .take(topN),
+            "topByCpu" to averages
+                .sortedByDescending { (it["avgCpuMs"] as Double) + (it["avgJniCpuMs"] as Double) }
+                .take(topN)
+        )
+    }
+
+    private fun average(name: String, samples: List<Sample>): Map<String, Any> {
+        fun avg(values: List<Long>): Double {
+            val measured = values.filter { it >= 0 }
+            return if (measured.isEmpty()) 0.0 else measured.average()
+        }
+        return mapOf(
+            "collector" to name,
+            "samples" to samples.size,
+            "avgWallMs" to avg(samples.map { it.wallNs }) / 1_000_000.0,
+            "avgCpuMs" to avg(samples.map { it.cpuNs }) / 1_000_000.0,
+            "avgAllocatedBytes" to avg(samples.map { it.allocatedBytes }).toLong(),
+            "avgJniMs" to avg(samples.map { it.jniWallNs }) / 1_000_000.0,
+            "avgJniCpuMs" to avg(samples.map { it.jniCpuNs }) / 1_000_000.0,
+            "avgJniAllocatedBytes" to avg(samples.map { it.jniAllocatedBytes }).toLong(),
+            "avgJniCalls" to avg(samples.map { it.jniCalls })
+        )
+    }
+}
@@ -0,0 +1,106 @@
+package com.internal.kpodmetrics.collector
+
+import java.io.IOException
+import java.nio.file.Files
+import java.nio.file.Path
+import java.nio.file.Paths
+
+/**
+ * Agent CPU load as a fraction of its container's CPU limit, for [CollectionScheduler].
+ *
+ * The JVM's `processCpuLoad` is relative to all host CPUs: an agent limited to half a
+ * CPU on a 64-core node never reads above 0.008, so no budget would ever be reached.
+ * Each [sample] instead divides the CPU time the agent's cgroup used since the previous
+ * sample (`usage_usec` in `cpu.stat`, or `cpuacct.usage` on cgroup v1) by what the quota
+ * allows over the same interval (`cpu.max`, or `cpu.cfs_quota_us`/`cpu.cfs_period_us`).
+ * Without a limit, or without a readable cgroup, it falls back to the host-relative value.
+ */
+class ContainerCpuLoad(
+    private val cgroupDir: Path?,
+    private val nanoTime: () -> Long = System::nanoTime,
+    private val hostLoad: () -> Double = { CollectionScheduler.processCpuLoad() }
+) {
+    private var lastUsageUs = -1L
+    private var lastNanos = 0L
+
+    companion object {
+        /** Load of the agent's own cgroup, found through `/proc/self/cgroup`. */
+        fun forSelf(
+            procSelfCgroup: Path = Paths.get("/proc/self/cgroup"),
+            cgroupRoot: Path = Paths.get("/sys/fs/cgroup")
+        ) = ContainerCpuLoad(ownCgroupDir(procSelfCgroup, cgroupRoot))
+
+        /**
+         * The unified (v2) cgroup of the process, else its v1 cpu controller cgroup. With a
+         * cgroup namespace, or a v1 mount of only the container's own cgroup, the listed path
+         * does not exist below [cgroupRoot] and the mount root is the agent's cgroup.
+         */
+        internal fun ownCgroupDir(procSelfCgroup: Path, cgroupRoot: Path): Path? {
+            val lines = try {
+                Files.readAllLines(procSelfCgroup)
+            } catch (e: IOException) {
+                return null
+            }
+            for (line in lines) {
+                val parts = line.split(':', limit = 3)
+                if (parts.size != 3) continue
+                val relative = parts[2].trimStart('/')
+                val (mount, marker) = when {
+                    parts[0] == "0" && parts[1].isEmpty() -> cgroupRoot to "cpu.stat"
+                    "cpu" in parts[1].split(',') -> cgroupRoot.resolve(parts[1]) to "cpu.cfs_quota_us"
+                    else -> continue
+                }
+                val dir = listOf(mount.resolve(relative), mount).firstOrNull { Files.exists(it.resolve(marker)) }
+                if (dir != null) return dir
+            }
+            return null
+        }
+    }
+
+    /** Load since the previous call; -1 when unknown (first call against a limit). */
+    @Synchronized
+    fun sample(): Double {
+        val dir = cgroupDir ?: return hostLoad()
+        val cpus = limitCpus(dir)
+        val usageUs = usageUs(dir)
+        if (cpus == null || usageUs == null) {
+            lastUsageUs = -1L
+            return hostLoad()
+        }
+        val now = nanoTime()
+        val previousUs = lastUsageUs
+        val elapsedUs = (now - lastNanos) / 1000.0
+        lastUsageUs = usageUs
+        lastNanos = now
+        if (previousUs < 0 || usageUs < previousUs || elapsedUs <= 0) return -1.0
+        return (usageUs - previousUs) / (elapsedUs * cpus)
+    }
+
+    /** CPUs the quota allows, or null without a limit. */
+    private fun limitCpus(dir: Path): Double? {
+        val max = read(dir.resolve("cpu.max"))
+        if (max != null) {
+            val fields = max.trim().split(' ')
+            val quota = fields[0].toLongOrNull() ?: return null
+            val period = fields.getOrNull(1)?.toLongOrNull() ?: return null
+            return if (quota > 0 && period > 0) quota.toDouble() / period else null
+        }
+        val quota = read(dir.resolve("cpu.cfs_quota_us"))?.trim()?.toLongOrNull() ?: return null
+        val period = read(dir.resolve("cpu.cfs_period_us"))?.trim()?.toLongOrNull() ?: return null
+        return if (quota > 0 && period > 0) quota.toDouble() / period else null
+    }
+
+    private fun usageUs(dir: Path): Long? {
+        val stat = read(dir.resolve("cpu.stat"))
+        stat?.lineSequence()?.firstOrNull { it.startsWith("usage_usec ") }?.let {
+            return it.substringAfter(' ').trim().toLongOrNull()
+        }
+        return read(dir.resolve("cpuacct.usage"))?.trim()?.toLongOrNull()?.div(1000)
+    }
+
+    private fun read(path: Path): String? = try {
+        Files.readString(path)
+    } catch (e: IOException) {
+        null
+    }
+}
@@ -53,8 +53,8 @@ class CpuProfileCollector(
         val entries = bridge.mapBatchLookupAndDelete(countsFd, PROFILE_KEY_SIZE, PROFILE_VALUE_SIZE, MAX_ENTRIES)
         if (entries.isEmpty()) return emptyMap()
 
-        val stackCache = HashMap<Int, LongArray>()
-        val result = HashMap<PodInfo, MutableList<StackSample>>()
+        val samples = ArrayList<PendingSample>(entries.size)
+        val stackIds = LinkedHashSet<Int>()
 
         for ((keyBytes, valueBytes) in entries) {
             val buf = ByteBuffer.wrap(keyBytes).order(ByteOrder.LITTLE_ENDIAN)
@@ -64,33 +64,52 @@ class CpuProfileCollector(
             val userStackId = buf.int
             val count = ByteBuffer.wrap(valueBytes).order(ByteOrder.LITTLE_ENDIAN).long
 
+            // Not held for a later cycle like other collectors: a stack id is only valid
+            // until stack_traces reuses its bucket for another stack
             val podInfo = cgroupResolver.resolve(cgroupId) ?: continue
             if (count <= 0) continue
 
-            val kernIps = if (kernStackId >= 0) {
-                stackCache.getOrPut(kernStackId) { readStack(stacksFd, kernStackId) }
-            } else LongArray(0)
-
-            val userIps = if (userStackId >= 0) {
-                stackCache.getOrPut(userStackId) { readStack(stacksFd, userStackId) }
-            } else LongArray(0)
+            if (kernStackId >= 0) stackIds.add(kernStackId)
+            if (userStackId >= 0) stackIds.add(userStackId)
+            samples.add(PendingSample(podInfo, tgid, kernStackId, userStackId, count))
+        }
 
-            result.getOrPut(podInfo) { mutableListOf() }
-                .add(StackSample(tgid, kernIps, userIps, count))
+        val stacks = readStacks(stacksFd, stackIds)
+        val result = HashMap<PodInfo, MutableList<StackSample>>()
+        for (sample in samples) {
+            val kernIps = stacks[sample.kernStackId] ?: LongArray(0)
+            val userIps = stacks[sample.userStackId] ?: LongArray(0)
+            result.getOrPut(sample.podInfo) { mutableListOf() }
+                .add(StackSample(sample.tgid, kernIps, userIps, sample.count))
         }
 
         log.debug(
             "Collected {} profile entries for {} pods ({} unique stacks)",
-            entries.size, result.size, stackCache.size
+            entries.size, result.size, stacks.size
         )
         return result
     }
 
-    private fun readStack(stacksFd: Int, stackId: Int): LongArray {
-        val key = ByteBuffer.allocate(4).order(ByteOrder.LITTLE_ENDIAN).putInt(stackId).array()
-        val valueSize = maxStackDepth * 8
-        val raw = bridge.mapLookup(stacksFd, key, valueSize) ?: return LongArray(0)
+    private class PendingSample(
+        val podInfo: PodInfo,
+        val tgid: Int,
+        val kernStackId: Int,
+        val userStackId: Int,
+        val count: Long
+    )
+
+    /** Reads every stack in [stackIds] with one offloaded lookup loop. */
+    private fun readStacks(stacksFd: Int, stackIds: Collection<Int>): Map<Int, LongArray> {
+        val keys = stackIds.map { ByteBuffer.allocate(4).order(ByteOrder.LITTLE_ENDIAN).putInt(it).array() }
+        val values = bridge.mapLookupAll(stacksFd, keys, maxStackDepth * 8)
+        val stacks = HashMap<Int, LongArray>(stackIds.size * 2)
+        for ((stackId, raw) in stackIds.zip(values)) {
+            stacks[stackId] = if (raw != null) parseStack(raw) else LongArray(0)
+        }
+        return stacks
+    }
 
+    private fun parseStack(raw: ByteArray): LongArray {
         val buf = ByteBuffer.wrap(raw).order(ByteOrder.LITTLE_ENDIAN)
         val ips = mutableListOf<Long>()
         while (buf.remaining() >= 8) {
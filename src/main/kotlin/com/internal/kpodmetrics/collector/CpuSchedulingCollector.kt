@@ -19,6 +19,8 @@ class CpuSchedulingCollector(
     private val nodeName: String
 ) {
     private val log = LoggerFactory.getLogger(CpuSchedulingCollector::class.java)
+    private val unresolvedRunqLatency = UnresolvedBuffer<Pair<ByteArray, ByteArray>>(cgroupResolver)
+    private val unresolvedCtxSwitches = UnresolvedBuffer<Pair<ByteArray, ByteArray>>(cgroupResolver)
 
     companion object {
         private const val MAX_ENTRIES = 10240
@@ -35,13 +37,13 @@ class CpuSchedulingCollector(
 
     private fun collectRunqueueLatency() {
         val mapFd = programManager.getMapFd("cpu_sched", "runq_latency")
-        collectMap(mapFd, CpuSchedMapReader.HistKeyLayout.SIZE, CpuSchedMapReader.HistValueLayout.SIZE) { keyBytes, valueBytes ->
-            val cgroupId = CpuSchedMapReader.HistKeyLayout.decodeCgroupId(keyBytes)
-            val podInfo = cgroupResolver.resolve(cgroupId) ?: return@collectMap
-
+        unresolvedRunqLatency.drain(
+            bridge, mapFd, CpuSchedMapReader.HistKeyLayout.SIZE, CpuSchedMapReader.HistValueLayout.SIZE, MAX_ENTRIES,
+            { CpuSchedMapReader.HistKeyLayout.decodeCgroupId(it) }
+        ) { podInfo, _, valueBytes ->
             val count = CpuSchedMapReader.HistValueLayout.decodeCount(valueBytes)
             val sumNs = CpuSchedMapReader.HistValueLayout.decodeSumNs(valueBytes)
-            if (!BpfValueValidation.isValidLatency(count, sumNs, log, "cpu_runq")) return@collectMap
+            if (!BpfValueValidation.isValidLatency(count, sumNs, log, "cpu_runq")) return@drain
 
             val tags = Tags.of(
                 "namespace", podInfo.namespace,
@@ -60,10 +62,10 @@ class CpuSchedulingCollector(
 
     private fun collectContextSwitches() {
         val mapFd = programManager.getMapFd("cpu_sched", "ctx_switches")
-        collectMap(mapFd, CpuSchedMapReader.CounterKeyLayout.SIZE, CpuSchedMapReader.CounterValueLayout.SIZE) { keyBytes, valueBytes ->
-            val cgroupId = CpuSchedMapReader.CounterKeyLayout.decodeCgroupId(keyBytes)
-            val podInfo = cgroupResolver.resolve(cgroupId) ?: return@collectMap
-
+        unresolvedCtxSwitches.drain(
+            bridge, mapFd, CpuSchedMapReader.CounterKeyLayout.SIZE, CpuSchedMapReader.CounterValueLayout.SIZE, MAX_ENTRIES,
+            { CpuSchedMapReader.CounterKeyLayout.decodeCgroupId(it) }
+        ) { podInfo, _, valueBytes ->
             val count = CpuSchedMapReader.CounterValueLayout.decodeCount(valueBytes)
 
             val tags = Tags.of(
@@ -76,12 +78,4 @@ class CpuSchedulingCollector(
             registry.counter("kpod.cpu.context.switches", tags).increment(count.toDouble())
         }
     }
-
-    private fun collectMap(
-        mapFd: Int, keySize: Int, valueSize: Int,
-        handler: (ByteArray, ByteArray) -> Unit
-    ) {
-        val entries = bridge.mapBatchLookupAndDelete(mapFd, keySize, valueSize, MAX_ENTRIES)
-        entries.forEach { (key, value) -> handler(key, value) }
-    }
 }
@@ -0,0 +1,135 @@
+package com.internal.kpodmetrics.collector
+
+import io.micrometer.core.instrument.Counter
+import io.micrometer.core.instrument.MeterRegistry
+import io.micrometer.core.instrument.Tags
+
+/**
+ * Turns counters the kernel already keeps cumulatively (io.stat, blkio, interface
+ * stats) into Micrometer counter increments, so each cycle adds only what changed
+ * since the previous read instead of the running total.
+ *
+ * Every series (one set of tags) gets a slot; the last value of each of its fields
+ * is kept in one flat LongArray at `slot * fields + field`, and the caller passes
+ * current values through the reusable [values] array, so recording a sample boxes
+ * nothing. A series is reset, and its current values counted in full, when it is
+ * first seen, when its generation changes (the cgroup was recreated under the same
+ * pod and container name) or when any field goes backwards. Increments are never
+ * negative, so the exported counters stay monotonic and safe for `rate()`.
+ *
+ * A released series (idle for maxIdleCycles, or removed with [removeWhere]) has its
+ * counters removed from the registry. If it comes back, it starts on a new counter
+ * from its full value instead of adding that value again to the old counter.
+ *
+ * Not thread-safe; callers serialize [record] with [removeWhere].
+ */
+class CumulativeCounters<K : Any>(
+    private val registry: MeterRegistry,
+    private val names: List<String>,
+    private val maxIdleCycles: Int = 10,
+    initialSlots: Int = 64
+) {
+    private class Series<K>(val key: K, val counters: Array<Counter>) {
+        var generation: Any? = null
+        var lastSeenCycle = 0L
+    }
+
+    private val fields = names.size
+    private val slots = HashMap<K, Int>()
+    private var series = arrayOfNulls<Series<K>>(initialSlots.coerceAtLeast(1))
+    private var previous = LongArray(series.size * fields)
+    private var freeSlots = IntArray(16)
+    private var freeCount = 0
+    private var nextSlot = 0
+    private var cycle = 0L
+    private var changed = 0
+
+    /** Current values of the series about to be [record]ed, indexed like [names]. */
+    val values = LongArray(fields)
+
+    fun size(): Int = slots.size
+
+    fun beginCycle() {
+        cycle++
+        changed = 0
+    }
+
+    /** Series whose counters moved since [beginCycle]. */
+    fun changedSeries(): Int = changed
+
+    /** Slot of [key], or -1 if it is not tracked yet. */
+    fun slotOf(key: K): Int = slots[key] ?: -1
+
+    /** Starts tracking [key], registering one counter per field with [tags]. */
+    fun add(key: K, tags: Tags): Int {
+        slots[key]?.let { return it }
+        val slot = if (freeCount > 0) freeSlots[--freeCount] else nextSlot++
+        if (slot >= series.size) grow()
+        series[slot] = Series(key, Array(fields) { registry.counter(names[it], tags) })
+        previous.fill(0L, slot * fields, (slot + 1) * fields)
+        slots[key] = slot
+        return slot
+    }
+
+    /**
+     * Increments the counters of [slot] by the difference between [values] and the
+     * previous sample. [generation] identifies the kernel object behind the series,
+     * such as the cgroup path; a change means the counters restarted from zero.
+     */
+    fun record(slot: Int, generation: Any) {
+        val s = series[slot] ?: return
+        val base = slot * fields
+        var reset = s.generation != generation
+        if (!reset) {
+            for (f in 0 until fields) {
+                if (values[f] < previous[base + f]) {
+                    reset = true
+                    break
+                }
+            }
+        }
+        s.generation = generation
+        s.lastSeenCycle = cycle
+        var moved = false
+        for (f in 0 until fields) {
+            val current = values[f].coerceAtLeast(0L)
+            val delta = if (reset) current else current - previous[base + f]
+            previous[base + f] = current
+            if (delta > 0) {
+                s.counters[f].increment(delta.toDouble())
+                moved = true
+            }
+        }
+        if (moved) changed++
+    }
+
+    /** Drops series not recorded for more than maxIdleCycles cycles. */
+    fun endCycle() {
+        for (slot in 0 until nextSlot) {
+            val s = series[slot] ?: continue
+            if (cycle - s.lastSeenCycle > maxIdleCycles) release(slot, s)
+        }
+    }
+
+    /** Drops series whose key matches, e.g. those of a deleted pod whose meters were removed. */
+    fun removeWhere(predicate: (K) -> Boolean) {
+        for (slot in 0 until nextSlot) {
+            val s = series[slot] ?: continue
+            if (predicate(s.key)) release(slot, s)
+        }
+    }
+
+    private fun release(slot: Int, s: Series<K>) {
+        for (counter in s.counters) registry.remove(counter)
+        slots.remove(s.key)
+        series[slot] = null
+        if (freeCount == freeSlots.size) freeSlots = freeSlots.copyOf(freeCount * 2)
+        freeSlots[freeCount++] = slot
+    }
+
+    private fun grow() {
+        val capacity = series.size * 2
+        series = series.copyOf(capacity)
+        previous = previous.copyOf(capacity * fields)
+    }
+}
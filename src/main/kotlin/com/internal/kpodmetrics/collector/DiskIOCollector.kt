@@ -4,9 +4,12 @@ import com.internal.kpodmetrics.cgroup.CgroupReader
 import com.internal.kpodmetrics.model.PodCgroupTarget
 import io.micrometer.core.instrument.Counter
 import io.micrometer.core.instrument.MeterRegistry
-import io.micrometer.core.instrument.Tags
 import org.slf4j.LoggerFactory
 
+/**
+ * Per-container block I/O from io.stat (v2) or blkio (v1). The kernel counters are
+ * cumulative; [CumulativeCounters] turns them into per-cycle increments.
+ */
 class DiskIOCollector(
     private val reader: CgroupReader,
     private val registry: MeterRegistry
@@ -14,22 +17,40 @@ class DiskIOCollector(
     private val log = LoggerFactory.getLogger(DiskIOCollector::class.java)
     private val errorCounter: Counter = registry.counter("kpod.cgroup.read.errors", "collector", "diskIO")
 
-    fun collect(targets: List<PodCgroupTarget>) {
+    private data class SeriesKey(val ns: String, val pod: String, val container: String, val device: String)
+    private val counters = CumulativeCounters<SeriesKey>(
+        registry, listOf("kpod.disk.read.bytes", "kpod.disk.written.bytes", "kpod.disk.reads", "kpod.disk.writes")
+    )
+
+    fun collect(targets: List<PodCgroupTarget>) = synchronized(counters) {
+        counters.beginCycle()
         for (target in targets) {
             try {
                 val stats = reader.readDiskIO(target.cgroupPath)
                 for (stat in stats) {
                     val device = "${stat.major}:${stat.minor}"
-                    val tags = target.tags().and("device", device)
-                    registry.counter("kpod.disk.read.bytes", tags).increment(stat.readBytes.toDouble())
-                    registry.counter("kpod.disk.written.bytes", tags).increment(stat.writeBytes.toDouble())
-                    registry.counter("kpod.disk.reads", tags).increment(stat.reads.toDouble())
-                    registry.counter("kpod.disk.writes", tags).increment(stat.writes.toDouble())
+                    val key = SeriesKey(target.namespace, target.podName, target.containerName, device)
+                    var slot = counters.slotOf(key)
+                    if (slot < 0) slot = counters.add(key, target.tags().and("device", device))
+                    val values = counters.values
+                    values[0] = stat.readBytes
+                    values[1] = stat.writeBytes
+                    values[2] = stat.reads
+                    values[3] = stat.writes
+                    counters.record(slot, target.cgroupPath)
                 }
             } catch (e: Exception) {
                 log.debug("Failed to read disk I/O for pod {}/{}: {}", target.namespace, target.podName, e.message)
                 errorCounter.increment()
             }
         }
+        counters.endCycle()
+    }
+
+    /** Series whose counters moved in the last [collect]; the scheduler's activity signal. */
+    fun lastActivity(): Int = synchronized(counters) { counters.changedSeries() }
+
+    fun removeStaleEntries(podName: String, namespace: String) = synchronized(counters) {
+        counters.removeWhere { it.pod == podName && it.ns == namespace }
     }
 }
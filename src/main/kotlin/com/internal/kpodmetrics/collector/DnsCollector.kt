@@ -3,13 +3,12 @@ package com.internal.kpodmetrics.collector
 import com.internal.kpodmetrics.bpf.BpfBridge
 import com.internal.kpodmetrics.bpf.BpfProgramManager
 import com.internal.kpodmetrics.bpf.CgroupResolver
+import com.internal.kpodmetrics.bpf.generated.DnsViews
 import com.internal.kpodmetrics.config.ResolvedConfig
 import io.micrometer.core.instrument.DistributionSummary
 import io.micrometer.core.instrument.MeterRegistry
 import io.micrometer.core.instrument.Tags
 import org.slf4j.LoggerFactory
-import java.nio.ByteBuffer
-import java.nio.ByteOrder
 
 class DnsCollector(
     private val bridge: BpfBridge,
@@ -22,20 +21,22 @@ class DnsCollector(
     private val log = LoggerFactory.getLogger(DnsCollector::class.java)
     // Track unique domains to prevent cardinality explosion (Beyla #2219, Kepler #2366)
     private val knownDomains = java.util.concurrent.ConcurrentHashMap.newKeySet<String>()
+    private val reqKey = DnsViews.DnsReqKeyView()
+    private val errKey = DnsViews.DnsErrKeyView()
+    private val domainKey = DnsViews.DnsDomainKeyView()
+    private val histKey = DnsViews.HistKeyView()
+    private val histValue = DnsViews.HistValueView()
+    private val countValue = DnsViews.CounterValueView()
+    private val unresolvedRequests = UnresolvedBuffer<Pair<ByteArray, ByteArray>>(cgroupResolver)
+    private val unresolvedLatency = UnresolvedBuffer<Pair<ByteArray, ByteArray>>(cgroupResolver)
+    private val unresolvedErrors = UnresolvedBuffer<Pair<ByteArray, ByteArray>>(cgroupResolver)
+    private val unresolvedDomains = UnresolvedBuffer<Pair<ByteArray, ByteArray>>(cgroupResolver)
 
     companion object {
         private const val MAX_ENTRIES = 10240
         private const val MAX_DOMAIN_ENTRIES = 1024
         private const val MAX_UNIQUE_DOMAINS = 200
 
-        // Struct sizes matching dns.bpf.c
-        private const val DNS_REQ_KEY_SIZE = 16       // u64 + u16 + u16 + u32
-        private const val DNS_ERR_KEY_SIZE = 16       // u64 + u8 + u8[7]
-        private const val DNS_DOMAIN_KEY_SIZE = 40    // u64 + u8[32]
-        private const val HIST_KEY_SIZE = 8           // u64
-        private const val HIST_VALUE_SIZE = 232       // u64[27] + u64 + u64
-        private const val COUNTER_VALUE_SIZE = 8      // u64
-
         private val QTYPE_NAMES = mapOf(
             1.toShort() to "A",
             28.toShort() to "AAAA",
@@ -66,14 +67,11 @@ class DnsCollector(
 
     private fun collectRequests() {
         val mapFd = programManager.getMapFd("dns", "dns_requests")
-        val entries = bridge.mapBatchLookupAndDelete(mapFd, DNS_REQ_KEY_SIZE, COUNTER_VALUE_SIZE, MAX_ENTRIES)
-        for ((keyBytes, valueBytes) in entries) {
-            val buf = ByteBuffer.wrap(keyBytes).order(ByteOrder.LITTLE_ENDIAN)
-            val cgroupId = buf.long
-            val qtype = buf.short
-
-            val podInfo = cgroupResolver.resolve(cgroupId) ?: continue
-            val count = ByteBuffer.wrap(valueBytes).order(ByteOrder.LITTLE_ENDIAN).long
+        unresolvedRequests.drain(
+            bridge, mapFd, reqKey.size, countValue.size, MAX_ENTRIES, { reqKey.wrap(it).cgroupId }
+        ) { podInfo, keyBytes, valueBytes ->
+            val qtype = reqKey.wrap(keyBytes).qtype.toShort()
+            val count = countValue.wrap(valueBytes).count
 
             val tags = Tags.of(
                 "namespace", podInfo.namespace,
@@ -88,18 +86,14 @@ class DnsCollector(
 
     private fun collectLatency() {
         val mapFd = programManager.getMapFd("dns", "dns_latency")
-        val entries = bridge.mapBatchLookupAndDelete(mapFd, HIST_KEY_SIZE, HIST_VALUE_SIZE, MAX_ENTRIES)
-        for ((keyBytes, valueBytes) in entries) {
-            val cgroupId = ByteBuffer.wrap(keyBytes).order(ByteOrder.LITTLE_ENDIAN).long
-            val podInfo = cgroupResolver.resolve(cgroupId) ?: continue
+        unresolvedLatency.drain(
+            bridge, mapFd, histKey.size, histValue.size, MAX_ENTRIES, { histKey.wrap(it).cgroupId }
+        ) { podInfo, _, valueBytes ->
+            histValue.wrap(valueBytes)
+            val count = histValue.count
+            val sumNs = histValue.sumNs
 
-            val valBuf = ByteBuffer.wrap(valueBytes).order(ByteOrder.LITTLE_ENDIAN)
-            // Skip 27 histogram slots (27 * 8 = 216 bytes)
-            valBuf.position(27 * 8)
-            val count = valBuf.long
-            val sumNs = valBuf.long
-
-            if (count <= 0 || sumNs <= 0) continue
+            if (count <= 0 || sumNs <= 0) return@drain
 
             val tags = Tags.of(
                 "namespace", podInfo.namespace,
@@ -117,14 +111,11 @@ class DnsCollector(
 
     private fun collectErrors() {
         val mapFd = programManager.getMapFd("dns", "dns_errors")
-        val entries = bridge.mapBatchLookupAndDelete(mapFd, DNS_ERR_KEY_SIZE, COUNTER_VALUE_SIZE, MAX_ENTRIES)
-        for ((keyBytes, valueBytes) in entries) {
-            val buf = ByteBuffer.wrap(keyBytes).order(ByteOrder.LITTLE_ENDIAN)
-            val cgroupId = buf.long
-            val rcode = buf.get()  // u8
-
-            val podInfo = cgroupResolver.resolve(cgroupId) ?: continue
-            val count = ByteBuffer.wrap(valueBytes).order(ByteOrder.LITTLE_ENDIAN).long
+        unresolvedErrors.drain(
+            bridge, mapFd, errKey.size, countValue.size, MAX_ENTRIES, { errKey.wrap(it).cgroupId }
+        ) { podInfo, keyBytes, valueBytes ->
+            val rcode = errKey.wrap(keyBytes).rcode.toByte()
+            val count = countValue.wrap(valueBytes).count
 
             val tags = Tags.of(
                 "namespace", podInfo.namespace,
@@ -139,24 +130,19 @@ class DnsCollector(
 
     private fun collectDomains() {
         val mapFd = programManager.getMapFd("dns", "dns_domains")
-        val entries = bridge.mapBatchLookupAndDelete(mapFd, DNS_DOMAIN_KEY_SIZE, COUNTER_VALUE_SIZE, MAX_DOMAIN_ENTRIES)
-        for ((keyBytes, valueBytes) in entries) {
-            val buf = ByteBuffer.wrap(keyBytes).order(ByteOrder.LITTLE_ENDIAN)
-            val cgroupId = buf.long
-            val domainBytes = ByteArray(32)
-            buf.get(domainBytes)
-
-            val podInfo = cgroupResolver.resolve(cgroupId) ?: continue
-            // Decode null-terminated UTF-8 domain
-            val nullIdx = domainBytes.indexOf(0.toByte())
-            val domain = if (nullIdx > 0) {
-                String(domainBytes, 0, nullIdx, Charsets.UTF_8)
-            } else if (nullIdx == 0) {
+        unresolvedDomains.drain(
+            bridge, mapFd, domainKey.size, countValue.size, MAX_DOMAIN_ENTRIES, { domainKey.wrap(it).cgroupId }
+        ) { podInfo, keyBytes, valueBytes ->
+            domainKey.wrap(keyBytes)
+            // Decode null-terminated UTF-8 domain straight from the key bytes
+            var len = 0
+            while (len < DnsViews.DnsDomainKeyView.DOMAIN_LENGTH && domainKey.domain(len) != 0) len++
+            val domain = if (len == 0) {
                 "unknown"
             } else {
-                String(domainBytes, Charsets.UTF_8)
+                String(keyBytes, DnsViews.DnsDomainKeyView.DOMAIN_OFFSET, len, Charsets.UTF_8)
             }
-            val count = ByteBuffer.wrap(valueBytes).order(ByteOrder.LITTLE_ENDIAN).long
+            val count = countValue.wrap(valueBytes).count
 
             // Cap unique domains to prevent cardinality explosion
             val cappedDomain = if (knownDomains.contains(domain) || knownDomains.size < MAX_UNIQUE_DOMAINS) {
@@ -18,6 +18,7 @@ class ExecsnoopCollector(
     private val nodeName: String
 ) {
     private val log = LoggerFactory.getLogger(ExecsnoopCollector::class.java)
+    private val unresolvedExecStats = UnresolvedBuffer<Pair<ByteArray, ByteArray>>(cgroupResolver)
 
     companion object {
         private const val MAX_ENTRIES = 10240
@@ -27,14 +28,11 @@ class ExecsnoopCollector(
         if (!config.extended.execsnoop) return
 
         val mapFd = programManager.getMapFd("execsnoop", "exec_stats")
-        val entries = bridge.mapBatchLookupAndDelete(
-            mapFd, ExecsnoopMapReader.CgroupKeyLayout.SIZE,
-            ExecsnoopMapReader.ExecStatsLayout.SIZE, MAX_ENTRIES
-        )
-        entries.forEach { (keyBytes, valueBytes) ->
-            val cgroupId = ExecsnoopMapReader.CgroupKeyLayout.decodeCgroupId(keyBytes)
-            val podInfo = cgroupResolver.resolve(cgroupId) ?: return@forEach
-
+        unresolvedExecStats.drain(
+            bridge, mapFd, ExecsnoopMapReader.CgroupKeyLayout.SIZE,
+            ExecsnoopMapReader.ExecStatsLayout.SIZE, MAX_ENTRIES,
+            { ExecsnoopMapReader.CgroupKeyLayout.decodeCgroupId(it) }
+        ) { podInfo, _, valueBytes ->
             val execs = ExecsnoopMapReader.ExecStatsLayout.decodeExecs(valueBytes)
             val exits = ExecsnoopMapReader.ExecStatsLayout.decodeExits(valueBytes)
             val forks = ExecsnoopMapReader.ExecStatsLayout.decodeForks(valueBytes)
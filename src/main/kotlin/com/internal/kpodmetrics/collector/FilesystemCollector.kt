@@ -1,6 +1,8 @@
 package com.internal.kpodmetrics.collector
 
 import com.internal.kpodmetrics.cgroup.CgroupReader
+import com.internal.kpodmetrics.cgroup.MountEntry
+import com.internal.kpodmetrics.cgroup.StatfsPool
 import com.internal.kpodmetrics.model.PodCgroupTarget
 import io.micrometer.core.instrument.Counter
 import io.micrometer.core.instrument.MeterRegistry
@@ -8,11 +10,18 @@ import io.micrometer.core.instrument.Tags
 import org.slf4j.LoggerFactory
 import java.util.concurrent.atomic.AtomicLong
 
+/**
+ * Filesystem capacity per container mount. Each cycle builds a node-wide mount
+ * table keyed by (device, mount id) from the containers' mountinfo, statfs's every
+ * unique filesystem once on [statfs], and fans the result out to all containers
+ * that mount it: a node of pods on the same image filesystem costs one statfs.
+ */
 class FilesystemCollector(
     private val reader: CgroupReader,
     private val procRoot: String,
-    private val registry: MeterRegistry
-) {
+    private val registry: MeterRegistry,
+    private val statfs: StatfsPool = StatfsPool(registry = registry)
+) : AutoCloseable {
     private val log = LoggerFactory.getLogger(FilesystemCollector::class.java)
     private val errorCounter: Counter = registry.counter("kpod.cgroup.read.errors", "collector", "filesystem")
 
@@ -21,31 +30,57 @@ class FilesystemCollector(
     private val usageValues = java.util.concurrent.ConcurrentHashMap<GaugeKey, AtomicLong>()
     private val availableValues = java.util.concurrent.ConcurrentHashMap<GaugeKey, AtomicLong>()
 
+    private data class MountKey(val device: String, val mountId: Int)
+    @Volatile private var changed = 0
+
     fun collect(targets: List<PodCgroupTarget>) {
+        val mountsByTarget = ArrayList<Pair<PodCgroupTarget, List<MountEntry>>>(targets.size)
+        val mountTable = HashMap<MountKey, String>()
         for (target in targets) {
             try {
                 val pid = reader.readInitPid(target.cgroupPath) ?: continue
-                val stats = reader.readFilesystemStats(procRoot, pid)
-                for (stat in stats) {
-                    val key = GaugeKey(target.podName, target.namespace, target.containerName, target.nodeName, stat.mountPoint)
-                    val tags = target.tags().and("mountpoint", stat.mountPoint)
-                    getOrRegisterGauge(capacityValues, key, "kpod.fs.capacity.bytes", tags).set(stat.totalBytes)
-                    getOrRegisterGauge(usageValues, key, "kpod.fs.usage.bytes", tags).set(stat.usedBytes)
-                    getOrRegisterGauge(availableValues, key, "kpod.fs.available.bytes", tags).set(stat.availableBytes)
+                val mounts = reader.readMounts(procRoot, pid)
+                for (mount in mounts) {
+                    mountTable.putIfAbsent(MountKey(mount.device, mount.mountId), "$procRoot/$pid/root${mount.mountPoint}")
                 }
+                mountsByTarget.add(target to mounts)
             } catch (e: Exception) {
-                log.debug("Failed to read filesystem stats for pod {}/{}: {}", target.namespace, target.podName, e.message)
+                log.debug("Failed to read mounts for pod {}/{}: {}", target.namespace, target.podName, e.message)
                 errorCounter.increment()
             }
         }
+
+        // One statfs per filesystem: bind mounts of the same device report the same usage
+        val byDevice = HashMap<String, String>()
+        for ((key, path) in mountTable) byDevice.putIfAbsent(key.device, path)
+        val usage = statfs.statAll(byDevice)
+
+        var changed = 0
+        for ((target, mounts) in mountsByTarget) {
+            for (mount in mounts) {
+                val stat = usage[mount.device] ?: continue
+                val key = GaugeKey(target.podName, target.namespace, target.containerName, target.nodeName, mount.mountPoint)
+                val tags = target.tags().and("mountpoint", mount.mountPoint)
+                changed += set(getOrRegisterGauge(capacityValues, key, "kpod.fs.capacity.bytes", tags), stat.totalBytes)
+                changed += set(getOrRegisterGauge(usageValues, key, "kpod.fs.usage.bytes", tags), stat.usedBytes)
+                changed += set(getOrRegisterGauge(availableValues, key, "kpod.fs.available.bytes", tags), stat.availableBytes)
+            }
+        }
+        this.changed = changed
     }
 
+    /** Gauges whose value changed in the last [collect]; the scheduler's activity signal. */
+    fun lastActivity(): Int = changed
+
     fun removeStaleEntries(podName: String, namespace: String) {
         capacityValues.keys.removeAll { it.pod == podName && it.ns == namespace }
         usageValues.keys.removeAll { it.pod == podName && it.ns == namespace }
         availableValues.keys.removeAll { it.pod == podName && it.ns == namespace }
     }
 
+    /** Sets [gauge] to [value]; 1 if that changed it, else 0. */
+    private fun set(gauge: AtomicLong, value: Long): Int = if (gauge.getAndSet(value) != value) 1 else 0
+
     private fun getOrRegisterGauge(
         store: java.util.concurrent.ConcurrentHashMap<GaugeKey, AtomicLong>,
         key: GaugeKey, name: String, tags: Tags
@@ -56,4 +91,6 @@ class FilesystemCollector(
             value
         }
     }
+
+    override fun close() = statfs.close()
 }
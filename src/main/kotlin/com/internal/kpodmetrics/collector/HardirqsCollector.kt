@@ -19,6 +19,8 @@ class HardirqsCollector(
     private val nodeName: String
 ) {
     private val log = LoggerFactory.getLogger(HardirqsCollector::class.java)
+    private val unresolvedIrqLatency = UnresolvedBuffer<Pair<ByteArray, ByteArray>>(cgroupResolver)
+    private val unresolvedIrqCount = UnresolvedBuffer<Pair<ByteArray, ByteArray>>(cgroupResolver)
 
     companion object {
         private const val MAX_ENTRIES = 10240
@@ -32,17 +34,14 @@ class HardirqsCollector(
 
     private fun collectLatency() {
         val mapFd = programManager.getMapFd("hardirqs", "irq_latency")
-        val entries = bridge.mapBatchLookupAndDelete(
-            mapFd, HardirqsMapReader.HistKeyLayout.SIZE,
-            HardirqsMapReader.HistValueLayout.SIZE, MAX_ENTRIES
-        )
-        entries.forEach { (keyBytes, valueBytes) ->
-            val cgroupId = HardirqsMapReader.HistKeyLayout.decodeCgroupId(keyBytes)
-            val podInfo = cgroupResolver.resolve(cgroupId) ?: return@forEach
-
+        unresolvedIrqLatency.drain(
+            bridge, mapFd, HardirqsMapReader.HistKeyLayout.SIZE,
+            HardirqsMapReader.HistValueLayout.SIZE, MAX_ENTRIES,
+            { HardirqsMapReader.HistKeyLayout.decodeCgroupId(it) }
+        ) { podInfo, _, valueBytes ->
             val count = HardirqsMapReader.HistValueLayout.decodeCount(valueBytes)
             val sumNs = HardirqsMapReader.HistValueLayout.decodeSumNs(valueBytes)
-            if (!BpfValueValidation.isValidLatency(count, sumNs, log, "hardirqs")) return@forEach
+            if (!BpfValueValidation.isValidLatency(count, sumNs, log, "hardirqs")) return@drain
 
             val tags = Tags.of(
                 "namespace", podInfo.namespace,
@@ -63,14 +62,11 @@ class HardirqsCollector(
 
     private fun collectCount() {
         val mapFd = programManager.getMapFd("hardirqs", "irq_count")
-        val entries = bridge.mapBatchLookupAndDelete(
-            mapFd, HardirqsMapReader.CgroupKeyLayout.SIZE,
-            HardirqsMapReader.CounterLayout.SIZE, MAX_ENTRIES
-        )
-        entries.forEach { (keyBytes, valueBytes) ->
-            val cgroupId = HardirqsMapReader.CgroupKeyLayout.decodeCgroupId(keyBytes)
-            val podInfo = cgroupResolver.resolve(cgroupId) ?: return@forEach
-
+        unresolvedIrqCount.drain(
+            bridge, mapFd, HardirqsMapReader.CgroupKeyLayout.SIZE,
+            HardirqsMapReader.CounterLayout.SIZE, MAX_ENTRIES,
+            { HardirqsMapReader.CgroupKeyLayout.decodeCgroupId(it) }
+        ) { podInfo, _, valueBytes ->
             val count = HardirqsMapReader.CounterLayout.decodeCount(valueBytes)
 
             val tags = Tags.of(
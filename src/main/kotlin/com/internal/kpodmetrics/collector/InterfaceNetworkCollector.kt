@@ -1,40 +1,73 @@
 package com.internal.kpodmetrics.collector
 
 import com.internal.kpodmetrics.cgroup.CgroupReader
+import com.internal.kpodmetrics.cgroup.NetnsInterfaceStats
 import com.internal.kpodmetrics.model.PodCgroupTarget
 import io.micrometer.core.instrument.Counter
 import io.micrometer.core.instrument.MeterRegistry
-import io.micrometer.core.instrument.Tags
 import org.slf4j.LoggerFactory
 
+/**
+ * Per-container interface counters. Stats are read once per network namespace
+ * per cycle ([NetnsInterfaceStats]) and fanned out to every container in it;
+ * the cumulative interface counters become per-cycle increments in [CumulativeCounters].
+ * The namespace inode is the series generation: interface counters restart with
+ * the namespace, which can be recreated under an unchanged cgroup path.
+ */
 class InterfaceNetworkCollector(
     private val reader: CgroupReader,
     private val procRoot: String,
-    private val registry: MeterRegistry
+    private val registry: MeterRegistry,
+    private val netns: NetnsInterfaceStats = NetnsInterfaceStats(procRoot, reader)
 ) {
     private val log = LoggerFactory.getLogger(InterfaceNetworkCollector::class.java)
     private val errorCounter: Counter = registry.counter("kpod.cgroup.read.errors", "collector", "ifaceNet")
 
-    fun collect(targets: List<PodCgroupTarget>) {
+    private data class SeriesKey(val ns: String, val pod: String, val container: String, val iface: String)
+    private val counters = CumulativeCounters<SeriesKey>(
+        registry, listOf(
+            "kpod.net.iface.rx.bytes", "kpod.net.iface.tx.bytes",
+            "kpod.net.iface.rx.packets", "kpod.net.iface.tx.packets",
+            "kpod.net.iface.rx.errors", "kpod.net.iface.tx.errors",
+            "kpod.net.iface.rx.drops", "kpod.net.iface.tx.drops"
+        )
+    )
+
+    fun collect(targets: List<PodCgroupTarget>) = synchronized(counters) {
+        netns.beginCycle()
+        counters.beginCycle()
         for (target in targets) {
             try {
                 val pid = reader.readInitPid(target.cgroupPath) ?: continue
-                val stats = reader.readNetworkStats(procRoot, pid)
+                val (inode, stats) = netns.readWithInode(pid)
+                val generation: Any = inode ?: target.cgroupPath
                 for (stat in stats) {
-                    val tags = target.tags().and("interface", stat.interfaceName)
-                    registry.counter("kpod.net.iface.rx.bytes", tags).increment(stat.rxBytes.toDouble())
-                    registry.counter("kpod.net.iface.tx.bytes", tags).increment(stat.txBytes.toDouble())
-                    registry.counter("kpod.net.iface.rx.packets", tags).increment(stat.rxPackets.toDouble())
-                    registry.counter("kpod.net.iface.tx.packets", tags).increment(stat.txPackets.toDouble())
-                    registry.counter("kpod.net.iface.rx.errors", tags).increment(stat.rxErrors.toDouble())
-                    registry.counter("kpod.net.iface.tx.errors", tags).increment(stat.txErrors.toDouble())
-                    registry.counter("kpod.net.iface.rx.drops", tags).increment(stat.rxDrops.toDouble())
-                    registry.counter("kpod.net.iface.tx.drops", tags).increment(stat.txDrops.toDouble())
+                    val key = SeriesKey(target.namespace, target.podName, target.containerName, stat.interfaceName)
+                    var slot = counters.slotOf(key)
+                    if (slot < 0) slot = counters.add(key, target.tags().and("interface", stat.interfaceName))
+                    val values = counters.values
+                    values[0] = stat.rxBytes
+                    values[1] = stat.txBytes
+                    values[2] = stat.rxPackets
+                    values[3] = stat.txPackets
+                    values[4] = stat.rxErrors
+                    values[5] = stat.txErrors
+                    values[6] = stat.rxDrops
+                    values[7] = stat.txDrops
+                    counters.record(slot, generation)
                 }
             } catch (e: Exception) {
                 log.debug("Failed to read network stats for pod {}/{}: {}", target.namespace, target.podName, e.message)
                 errorCounter.increment()
             }
         }
+        counters.endCycle()
+    }
+
+    /** Series whose counters moved in the last [collect]; the scheduler's activity signal. */
+    fun lastActivity(): Int = synchronized(counters) { counters.changedSeries() }
+
+    fun removeStaleEntries(podName: String, namespace: String) = synchronized(counters) {
+        counters.removeWhere { it.pod == podName && it.ns == namespace }
     }
 }
@@ -0,0 +1,174 @@
+package com.internal.kpodmetrics.collector
+
+import com.internal.kpodmetrics.bpf.BpfBridge
+import com.internal.kpodmetrics.bpf.BpfProgramManager
+import com.internal.kpodmetrics.bpf.CgroupResolver
+import com.internal.kpodmetrics.bpf.PodInfo
+import com.internal.kpodmetrics.bpf.StructView
+import com.internal.kpodmetrics.model.MetricLabels.UNRESOLVED
+import io.micrometer.core.instrument.DistributionSummary
+import io.micrometer.core.instrument.MeterRegistry
+import io.micrometer.core.instrument.Tags
+import org.slf4j.LoggerFactory
+import java.util.concurrent.ConcurrentHashMap
+
+/**
+ * Maps a numeric key field to a label value. Known values come from a dense array
+ * or a sparse map; anything else is rendered once with [unknown] (a format string
+ * when it contains `%`) and cached, so steady-state decoding allocates no strings.
+ */
+class LabelTable private constructor(
+    private val dense: Array<String>?,
+    private val sparse: Map<Int, String>?,
+    private val unknown: String?
+) {
+    private val rendered = ConcurrentHashMap<Int, String>()
+
+    fun name(value: Int): String {
+        if (dense != null && value >= 0 && value < dense.size) return dense[value]
+        sparse?.get(value)?.let { return it }
+        return rendered.computeIfAbsent(value) { v ->
+            when {
+                unknown == null -> v.toString()
+                unknown.contains('%') -> unknown.format(v)
+                else -> unknown
+            }
+        }
+    }
+
+    companion object {
+        fun dense(names: Array<String>, unknown: String): LabelTable = LabelTable(names, null, unknown)
+        fun sparse(names: Map<Int, String>, unknown: String): LabelTable = LabelTable(null, names, unknown)
+        /** Renders the raw number, e.g. HTTP status or MySQL error code. */
+        fun numeric(): LabelTable = LabelTable(null, null, null)
+    }
+}
+
+/** One key field that becomes a label. */
+data class LabelSpec(val name: String, val offset: Int, val width: Int, val table: LabelTable)
+
+enum class MetricKind {
+    /** Value field is a u64 count added to a counter. */
+    COUNTER,
+    /** Value is a `hist_value`; count/sum are turned into an average latency in seconds. */
+    AVERAGE_LATENCY
+}
+
+/**
+ * Generated description of how one BPF map becomes one metric (see the
+ * `*MetricSchema` declarations next to the BPF struct definitions). [keyView] and
+ * [valueView] create the program's generated flyweight views for the map's key
+ * and value structs; offsets below are fields of those structs.
+ */
+data class MapMetricSpec(
+    val program: String,
+    val map: String,
+    val keyView: () -> StructView<*>,
+    val valueView: () -> StructView<*>,
+    val keySize: Int,
+    val valueSize: Int,
+    val cgroupIdOffset: Int,
+    val metric: String,
+    val kind: MetricKind,
+    val labels: List<LabelSpec>,
+    val countOffset: Int,
+    val sumOffset: Int = -1,
+    val sumScale: Double = 1.0,
+    /**
+     * Emit entries whose cgroup does not resolve with `_unresolved` pod labels. When
+     * false they are held for one cycle in case their pod is registered by then.
+     */
+    val emitUnresolved: Boolean = false
+)
+
+/**
+ * Single drain → decode → resolve → emit path shared by all schema-driven
+ * collectors (HTTP, Redis, MySQL, Kafka, MongoDB).
+ *
+ * Per map it reuses one generated key view, one value view and one tag array, and label
+ * strings come from [LabelTable] caches, so the per-entry cost is the field reads,
+ * the cgroup lookup and the registry lookup. Entries dropped for an unknown cgroup
+ * go through an [UnresolvedBuffer] per map first.
+ */
+class MapMetricEmitter(
+    private val bridge: BpfBridge,
+    private val programManager: BpfProgramManager,
+    private val cgroupResolver: CgroupResolver,
+    private val registry: MeterRegistry,
+    private val nodeName: String
+) {
+    private val log = LoggerFactory.getLogger(MapMetricEmitter::class.java)
+    private val unresolved = ConcurrentHashMap<String, UnresolvedBuffer<Pair<ByteArray, ByteArray>>>()
+
+    fun collect(specs: List<MapMetricSpec>) {
+        for (spec in specs) collect(spec)
+    }
+
+    fun collect(spec: MapMetricSpec) {
+        val mapFd = programManager.getMapFd(spec.program, spec.map)
+        val entries = bridge.mapIterateAndDelete(mapFd, spec.keySize, spec.valueSize)
+        val held = if (spec.emitUnresolved) null else unresolved.computeIfAbsent(spec.map) { UnresolvedBuffer(cgroupResolver) }
+        if (entries.isEmpty() && (held == null || held.size() == 0)) return
+        log.debug("{} map has {} entries", spec.map, entries.size)
+
+        val key = spec.keyView()
+        val value = spec.valueView()
+        val labels = spec.labels
+        val tagValues = arrayOfNulls<String>((4 + labels.size) * 2)
+        tagValues[0] = "namespace"
+        tagValues[2] = "pod"
+        tagValues[4] = "container"
+        tagValues[6] = "node"
+        tagValues[7] = nodeName
+        for (i in labels.indices) tagValues[8 + i * 2] = labels[i].name
+
+        held?.replay { podInfo, (keyBytes, valueBytes) ->
+            key.wrap(keyBytes)
+            value.wrap(valueBytes)
+            emit(spec, key, value, podInfo, tagValues)
+        }
+        for (entry in entries) {
+            key.wrap(entry.first)
+            value.wrap(entry.second)
+            val cgroupId = key.unsigned(spec.cgroupIdOffset, 8)
+            val podInfo = cgroupResolver.resolve(cgroupId)
+            if (podInfo == null && held != null) {
+                // Dropped as before if the buffer is full
+                held.hold(cgroupId, entry)
+                continue
+            }
+            emit(spec, key, value, podInfo, tagValues)
+        }
+    }
+
+    private fun emit(
+        spec: MapMetricSpec, key: StructView<*>, value: StructView<*>,
+        podInfo: PodInfo?, tagValues: Array<String?>
+    ) {
+        val labels = spec.labels
+        val count = value.unsigned(spec.countOffset, 8)
+        val sum = if (spec.sumOffset >= 0) value.unsigned(spec.sumOffset, 8) else 0L
+        if (spec.kind == MetricKind.AVERAGE_LATENCY && (count <= 0 || sum <= 0)) return
+
+        tagValues[1] = podInfo?.namespace ?: UNRESOLVED
+        tagValues[3] = podInfo?.podName ?: UNRESOLVED
+        tagValues[5] = podInfo?.containerName ?: UNRESOLVED
+        for (i in labels.indices) {
+            val label = labels[i]
+            tagValues[9 + i * 2] = label.table.name(key.unsigned(label.offset, label.width).toInt())
+        }
+        @Suppress("UNCHECKED_CAST")
+        val tags = Tags.of(*(tagValues as Array<String>))
+
+        when (spec.kind) {
+            MetricKind.COUNTER ->
+                registry.counter(spec.metric, tags).increment(count.toDouble())
+            MetricKind.AVERAGE_LATENCY ->
+                DistributionSummary.builder(spec.metric)
+                    .tags(tags)
+                    .baseUnit("seconds")
+                    .register(registry)
+                    .record(sum.toDouble() / count.toDouble() * spec.sumScale)
+        }
+    }
+}
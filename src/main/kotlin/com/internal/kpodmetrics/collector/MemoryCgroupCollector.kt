@@ -21,24 +21,30 @@ class MemoryCgroupCollector(
     private val peakValues = ConcurrentHashMap<GaugeKey, AtomicLong>()
     private val cacheValues = ConcurrentHashMap<GaugeKey, AtomicLong>()
     private val swapValues = ConcurrentHashMap<GaugeKey, AtomicLong>()
+    @Volatile private var changed = 0
 
     fun collect(targets: List<PodCgroupTarget>) {
+        var changed = 0
         for (target in targets) {
             try {
                 val stat = reader.readMemoryStats(target.cgroupPath) ?: continue
                 val key = GaugeKey(target.podName, target.namespace, target.containerName, target.nodeName)
                 val tags = target.tags()
-                getOrRegisterGauge(usageValues, key, "kpod.mem.cgroup.usage.bytes", tags).set(stat.usageBytes)
-                getOrRegisterGauge(peakValues, key, "kpod.mem.cgroup.peak.bytes", tags).set(stat.peakBytes)
-                getOrRegisterGauge(cacheValues, key, "kpod.mem.cgroup.cache.bytes", tags).set(stat.cacheBytes)
-                getOrRegisterGauge(swapValues, key, "kpod.mem.cgroup.swap.bytes", tags).set(stat.swapBytes)
+                changed += set(getOrRegisterGauge(usageValues, key, "kpod.mem.cgroup.usage.bytes", tags), stat.usageBytes)
+                changed += set(getOrRegisterGauge(peakValues, key, "kpod.mem.cgroup.peak.bytes", tags), stat.peakBytes)
+                changed += set(getOrRegisterGauge(cacheValues, key, "kpod.mem.cgroup.cache.bytes", tags), stat.cacheBytes)
+                changed += set(getOrRegisterGauge(swapValues, key, "kpod.mem.cgroup.swap.bytes", tags), stat.swapBytes)
             } catch (e: Exception) {
                 log.debug("Failed to read memory stats for pod {}/{}: {}", target.namespace, target.podName, e.message)
                 errorCounter.increment()
             }
         }
+        this.changed = changed
     }
 
+    /** Gauges whose value changed in the last [collect]; the scheduler's activity signal. */
+    fun lastActivity(): Int = changed
+
     fun removeStaleEntries(podName: String, namespace: String) {
         usageValues.keys.removeAll { it.pod == podName && it.ns == namespace }
         peakValues.keys.removeAll { it.pod == podName && it.ns == namespace }
@@ -46,6 +52,9 @@ class MemoryCgroupCollector(
         swapValues.keys.removeAll { it.pod == podName && it.ns == namespace }
     }
 
+    /** Sets [gauge] to [value]; 1 if that changed it, else 0. */
+    private fun set(gauge: AtomicLong, value: Long): Int = if (gauge.getAndSet(value) != value) 1 else 0
+
     private fun getOrRegisterGauge(
         store: ConcurrentHashMap<GaugeKey, AtomicLong>,
         key: GaugeKey, name: String, tags: Tags
@@ -3,14 +3,20 @@ package com.internal.kpodmetrics.collector
 import com.internal.kpodmetrics.bpf.BpfBridge
 import com.internal.kpodmetrics.bpf.BpfProgramManager
 import com.internal.kpodmetrics.bpf.CgroupResolver
+import com.internal.kpodmetrics.bpf.NativeCallCost
+import com.internal.kpodmetrics.bpf.NativeCallExecutor
+import com.internal.kpodmetrics.bpf.ThreadCostProbe
 import com.internal.kpodmetrics.config.CollectorIntervals
 import com.internal.kpodmetrics.config.CollectorOverrides
 import com.internal.kpodmetrics.discovery.PodCgroupMapper
+import com.internal.kpodmetrics.jfr.CollectorRunEvent
 import com.internal.kpodmetrics.model.PodCgroupTarget
 import io.micrometer.core.instrument.Counter
 import io.micrometer.core.instrument.MeterRegistry
 import io.micrometer.core.instrument.Timer
 import kotlinx.coroutines.*
+import kotlinx.coroutines.sync.Mutex
+import kotlinx.coroutines.sync.withLock
 import org.slf4j.LoggerFactory
 import org.springframework.scheduling.annotation.Scheduled
 import java.time.Instant
@@ -19,6 +25,8 @@ import java.util.concurrent.ExecutorService
 import java.util.concurrent.Executors
 import java.util.concurrent.TimeUnit
 import java.util.concurrent.atomic.AtomicBoolean
+import java.util.concurrent.atomic.AtomicInteger
+import java.util.concurrent.atomic.AtomicLong
 import java.util.concurrent.atomic.AtomicReference
 
 class MetricsCollectorService(
@@ -54,11 +62,26 @@ class MetricsCollectorService(
     private val collectorIntervals: CollectorIntervals = CollectorIntervals(),
     private val basePollIntervalMs: Long = 29000,
     private val startupJitterMs: Long = 0,
-    private val profilingPipeline: com.internal.kpodmetrics.profiling.ProfilingPipeline? = null
+    private val profilingPipeline: com.internal.kpodmetrics.profiling.ProfilingPipeline? = null,
+    private val scheduler: CollectionScheduler? = null,
+    private val snapshotCoordinator: SnapshotCoordinator? = null,
+    private val costTracker: CollectorCostTracker? = null,
+    private val pressureMonitor: PressureMonitor? = null
 ) {
     private val log = LoggerFactory.getLogger(MetricsCollectorService::class.java)
     private val vtExecutor: ExecutorService = Executors.newVirtualThreadPerTaskExecutor()
     private val vtDispatcher = vtExecutor.asCoroutineDispatcher()
+    // Collector bodies run on platform threads: the JVM reports no CPU time or
+    // allocation for virtual threads, so the cost counters would stay at zero. One
+    // thread per collector keeps the cycle as parallel as on virtual threads, and
+    // their native calls still go through the NativeCallExecutor pool.
+    private val collectorThreadIndex = AtomicInteger(0)
+    private val collectorExecutor: ExecutorService = Executors.newFixedThreadPool(
+        bpfCollectors().size + listOfNotNull(diskIOCollector, ifaceNetCollector, fsCollector, memCollector).size
+    ) { r ->
+        NativeCallExecutor.offloadingThread(r, "kpod-collector-${collectorThreadIndex.incrementAndGet()}")
+    }
+    private val collectorDispatcher = collectorExecutor.asCoroutineDispatcher()
 
     private val shuttingDown = AtomicBoolean(false)
     private val collecting = AtomicBoolean(false)
@@ -71,6 +94,15 @@ class MetricsCollectorService(
     private val lastSuccessfulCycle = AtomicReference<Instant?>(null)
     private val lastCollectorRun = ConcurrentHashMap<String, Instant>()
     private val lastCollectorError = ConcurrentHashMap<String, String>()
+    // Held by a cycle and by each burst run, so the two never drain maps concurrently
+    private val drainMutex = Mutex()
+    private val bursting = AtomicBoolean(false)
+    private val burstDeadlineNs = AtomicLong(0)
+    private val burstRuns = ConcurrentHashMap<String, Counter>()
+    // Pressured pods sampled on every burst tick, each until its own deadline
+    private val burstTargets = ConcurrentHashMap<String, BurstTarget>()
+
+    private class BurstTarget(val event: PressureEvent, val untilNs: Long)
 
     private val intervalMap: Map<String, Long?> = mapOf(
         "cpu" to collectorIntervals.cpu,
@@ -122,9 +154,13 @@ class MetricsCollectorService(
 
     private fun shouldRunCollector(name: String): Boolean {
         if (!isCollectorEnabled(name)) return false
-        val interval = intervalMap[name] ?: return true
-        val lastRun = lastCollectorRun[name] ?: return true
-        return java.time.Duration.between(lastRun, Instant.now()).toMillis() >= interval
+        val interval = intervalMap[name]
+        val lastRun = lastCollectorRun[name]
+        if (interval != null && lastRun != null &&
+            java.time.Duration.between(lastRun, Instant.now()).toMillis() < interval) {
+            return false
+        }
+        return scheduler?.admit(name) ?: true
     }
 
     private fun markCollectorRun(name: String) {
@@ -171,16 +207,13 @@ class MetricsCollectorService(
             return@runBlocking
         }
         try {
-            collectInternal()
+            drainMutex.withLock { collectInternal() }
         } finally {
             collecting.set(false)
         }
     }
 
-    private suspend fun collectInternal() {
-        val cycleSample = cycleTimer?.let { Timer.start() }
-
-        val allBpfCollectors = listOfNotNull(
+    private fun bpfCollectors(): List<Pair<String, () -> Unit>> = listOfNotNull(
             "cpu" to cpuCollector::collect,
             "network" to netCollector::collect,
             "syscall" to syscallCollector::collect,
@@ -200,13 +233,79 @@ class MetricsCollectorService(
             bpfMapStatsCollector?.let { "bpfMapStats" to it::collect },
             bpfOverheadCollector?.let { "bpfOverhead" to it::collect }
         )
-        val bpfCollectors = allBpfCollectors.filter { (name, _) ->
-            val run = shouldRunCollector(name)
-            if (!run && isCollectorEnabled(name) && registry != null) {
-                collectorSkipCounter(name).increment()
+
+    /**
+     * Runs the named BPF collectors every [intervalMs] for [durationMs] outside the
+     * regular cycle, e.g. on a PSI pressure event, so the stall window is drained at
+     * high resolution. A request during a running burst extends it. Burst runs are
+     * skipped while a regular cycle is collecting. BPF maps are node-wide, so a
+     * burst drains them for every pod; the pod under pressure ([event]) is also
+     * sampled on every tick into the [PressureMonitor] diagnostics.
+     */
+    fun requestBurst(collectors: Collection<String>, durationMs: Long, intervalMs: Long, event: PressureEvent? = null) {
+        if (shuttingDown.get()) return
+        val until = System.nanoTime() + TimeUnit.MILLISECONDS.toNanos(durationMs)
+        if (event != null) {
+            burstTargets.merge("${event.namespace}/${event.pod}/${event.resource}", BurstTarget(event, until)) { a, b ->
+                if (b.untilNs > a.untilNs) b else a
             }
-            run
         }
+        burstDeadlineNs.accumulateAndGet(until) { a, b -> maxOf(a, b) }
+        if (!bursting.compareAndSet(false, true)) return
+        val selected = bpfCollectors().filter { (name, _) -> name in collectors && isCollectorEnabled(name) }
+        CoroutineScope(vtDispatcher).launch {
+            do {
+                try {
+                    while (!shuttingDown.get() && System.nanoTime() < burstDeadlineNs.get()) {
+                        sampleBurstTargets()
+                        if (!collecting.get()) {
+                            drainMutex.withLock {
+                                for ((name, collectFn) in selected) runBurstCollector(name, collectFn)
+                            }
+                        }
+                        delay(intervalMs)
+                    }
+                } finally {
+                    bursting.set(false)
+                }
+                // A request that extended the deadline after the last check saw the
+                // flag still set and returned; take the burst back over for it
+            } while (!shuttingDown.get() && System.nanoTime() < burstDeadlineNs.get() && bursting.compareAndSet(false, true))
+        }
+    }
+
+    private fun sampleBurstTargets() {
+        val now = System.nanoTime()
+        for ((key, target) in burstTargets) {
+            if (now >= target.untilNs) {
+                burstTargets.remove(key, target)
+                continue
+            }
+            try {
+                pressureMonitor?.sample(target.event)
+            } catch (e: Exception) {
+                log.debug("Pressure sample for {} failed: {}", key, e.message)
+            }
+        }
+    }
+
+    private fun runBurstCollector(name: String, collectFn: () -> Unit) {
+        try {
+            collectFn()
+            if (registry != null) {
+                burstRuns.computeIfAbsent(name) {
+                    Counter.builder("kpod.collector.burst.runs").tag("collector", name).register(registry)
+                }.increment()
+            }
+        } catch (e: Exception) {
+            log.debug("Burst run of collector '{}' failed: {}", name, e.message)
+        }
+    }
+
+    private suspend fun collectInternal() {
+        val cycleSample = cycleTimer?.let { Timer.start() }
+
+        val allBpfCollectors = bpfCollectors()
 
         val targets = try {
             podCgroupMapper?.resolve() ?: emptyList()
@@ -215,6 +314,12 @@ class MetricsCollectorService(
             emptyList()
         }
 
+        try {
+            pressureMonitor?.sync(targets)
+        } catch (e: Exception) {
+            log.warn("Failed to update PSI triggers: {}", e.message)
+        }
+
         registry?.gauge("kpod.discovery.pods.total", targets.size)
 
         val allCgroupCollectors = listOfNotNull(
@@ -223,6 +328,19 @@ class MetricsCollectorService(
             fsCollector?.let { "filesystem" to { it.collect(targets) } },
             memCollector?.let { "memory" to { it.collect(targets) } }
         )
+
+        scheduler?.beginCycle(
+            (allBpfCollectors.map { it.first } + allCgroupCollectors.map { it.first })
+                .filter { isCollectorEnabled(it) }
+        )
+
+        val bpfCollectors = allBpfCollectors.filter { (name, _) ->
+            val run = shouldRunCollector(name)
+            if (!run && isCollectorEnabled(name) && registry != null) {
+                collectorSkipCounter(name).increment()
+            }
+            run
+        }
         val cgroupCollectors = allCgroupCollectors.filter { (name, _) ->
             val run = shouldRunCollector(name)
             if (!run && isCollectorEnabled(name) && registry != null) {
@@ -231,23 +349,30 @@ class MetricsCollectorService(
             run
         }
 
-        val completed = withTimeoutOrNull(collectionTimeoutMs) {
-            (bpfCollectors + cgroupCollectors).map { (name, collectFn) ->
-                launch {
-                    try {
-                        if (registry != null) {
-                            collectorTimer(name).record(Runnable { collectFn() })
-                        } else {
-                            collectFn()
-                        }
-                        markCollectorRun(name)
-                    } catch (e: Exception) {
-                        log.error("Collector '{}' failed: {}", name, e.message, e)
-                        lastCollectorError[name] = "${Instant.now()} ${e.message}"
-                        if (registry != null) collectorErrorCounter(name).increment()
+        // Phase 1: drain all planned BPF maps back-to-back under one timestamp
+        val coordinator = snapshotCoordinator
+        val snapshotCollectors = if (coordinator == null) bpfCollectors else bpfCollectors.map { (name, collectFn) ->
+            name to { coordinator.collect(name, collectFn) }
+        }
+        try {
+            coordinator?.beginCycle(bpfCollectors.map { it.first })
+        } catch (e: Exception) {
+            log.warn("Snapshot drain failed, collectors will drain live: {}", e.message)
+        }
+
+        // Phase 2: decode and publish in parallel
+        val completed = try {
+            withTimeoutOrNull(collectionTimeoutMs) {
+                (snapshotCollectors + cgroupCollectors).map { (name, collectFn) ->
+                    launch {
+                        val offsetMs = scheduler?.offsetMs(name) ?: 0L
+                        if (offsetMs > 0) delay(offsetMs)
+                        withContext(collectorDispatcher) { runCollector(name, collectFn) }
                     }
-                }
-            }.joinAll()
+                }.joinAll()
+            }
+        } finally {
+            coordinator?.endCycle()
         }
 
         if (completed == null) {
@@ -270,6 +395,52 @@ class MetricsCollectorService(
         cycleSample?.stop(cycleTimer!!)
     }
 
+    private fun runCollector(name: String, collectFn: () -> Unit) {
+        val startNs = System.nanoTime()
+        val cpuStart = ThreadCostProbe.cpuTimeNs()
+        val allocStart = ThreadCostProbe.allocatedBytes()
+        val nativeCost = NativeCallCost()
+        val event = CollectorRunEvent()
+        event.begin()
+        try {
+            NativeCallCost.bind(nativeCost, collectFn)
+            markCollectorRun(name)
+        } catch (e: Exception) {
+            log.error("Collector '{}' failed: {}", name, e.message, e)
+            lastCollectorError[name] = "${Instant.now()} ${e.message}"
+            if (registry != null) collectorErrorCounter(name).increment()
+            event.failed = true
+        } finally {
+            if (event.shouldCommit()) {
+                event.collector = name
+                event.commit()
+            }
+            val wallNs = System.nanoTime() - startNs
+            val cpuNs = ThreadCostProbe.delta(cpuStart, ThreadCostProbe.cpuTimeNs())
+            val allocBytes = ThreadCostProbe.delta(allocStart, ThreadCostProbe.allocatedBytes())
+            if (registry != null) collectorTimer(name).record(wallNs, TimeUnit.NANOSECONDS)
+            costTracker?.record(name, wallNs, cpuNs, allocBytes, nativeCost)
+            scheduler?.let {
+                it.recordCost(name, wallNs, cpuNs, allocBytes)
+                activityOf(name, nativeCost)?.let { activity -> it.recordActivity(name, activity) }
+            }
+        }
+    }
+
+    /**
+     * What a run produced, for the scheduler's volatility estimate: series changed by
+     * the cgroup collectors, map entries drained by the BPF ones. Null for the
+     * self-monitoring collectors, which always have something to report.
+     */
+    private fun activityOf(name: String, nativeCost: NativeCallCost): Long? = when (name) {
+        "diskIO" -> diskIOCollector?.lastActivity()?.toLong()
+        "ifaceNet" -> ifaceNetCollector?.lastActivity()?.toLong()
+        "filesystem" -> fsCollector?.lastActivity()?.toLong()
+        "memory" -> memCollector?.lastActivity()?.toLong()
+        "bpfMapStats", "bpfOverhead" -> null
+        else -> nativeCost.entriesDrained
+    }
+
     fun isShuttingDown(): Boolean = shuttingDown.get()
 
     fun getLastCollectorErrors(): Map<String, String> = lastCollectorError.toMap()
@@ -303,7 +474,9 @@ class MetricsCollectorService(
             log.debug("Removed {} stale meters for pod {}/{}", metersToRemove.size, namespace, podName)
         }
 
-        // Clean gauge stores in cgroup collectors
+        // Clean counter and gauge stores in cgroup collectors
+        diskIOCollector?.removeStaleEntries(podName, namespace)
+        ifaceNetCollector?.removeStaleEntries(podName, namespace)
         fsCollector?.removeStaleEntries(podName, namespace)
         memCollector?.removeStaleEntries(podName, namespace)
     }
@@ -338,5 +511,6 @@ class MetricsCollectorService(
         vtExecutor.shutdown()
         vtExecutor.awaitTermination(5, TimeUnit.SECONDS)
         vtDispatcher.close()
+        collectorDispatcher.close()
     }
 }
@@ -3,182 +3,33 @@ package com.internal.kpodmetrics.collector
 import com.internal.kpodmetrics.bpf.BpfBridge
 import com.internal.kpodmetrics.bpf.BpfProgramManager
 import com.internal.kpodmetrics.bpf.CgroupResolver
+import com.internal.kpodmetrics.bpf.generated.MongoMetrics
 import com.internal.kpodmetrics.config.ResolvedConfig
-import io.micrometer.core.instrument.DistributionSummary
 import io.micrometer.core.instrument.MeterRegistry
-import io.micrometer.core.instrument.Tags
-import org.slf4j.LoggerFactory
-import java.nio.ByteBuffer
-import java.nio.ByteOrder
 
+/**
+ * Map layouts, label tables and metric names come from the `mongo` metric schema
+ * in the BPF generator ([MongoMetrics]); draining and emission is [MapMetricEmitter].
+ */
 class MongoCollector(
-    private val bridge: BpfBridge,
+    bridge: BpfBridge,
     private val programManager: BpfProgramManager,
-    private val cgroupResolver: CgroupResolver,
-    private val registry: MeterRegistry,
+    cgroupResolver: CgroupResolver,
+    registry: MeterRegistry,
     private val config: ResolvedConfig,
-    private val nodeName: String
+    nodeName: String
 ) {
-    private val log = LoggerFactory.getLogger(MongoCollector::class.java)
+    private val emitter = MapMetricEmitter(bridge, programManager, cgroupResolver, registry, nodeName)
 
     companion object {
-        private const val MAX_ENTRIES = 10240
+        fun commandName(command: Int): String = MongoMetrics.COMMAND.name(command)
 
-        // mongo_event_key: u64(cgroup_id) + u8(command) + u8(pad1) + u16(pad2) + u32(pad3) = 16
-        private const val EVENT_KEY_SIZE = 16
-        // counter_value: u64(count) = 8
-        private const val EVENT_VALUE_SIZE = 8
-        // mongo_latency_key: u64(cgroup_id) + u8(command) + u8(pad1) + u16(pad2) + u32(pad3) = 16
-        private const val LATENCY_KEY_SIZE = 16
-        // hist_value: u64[27](slots) + u64(count) + u64(sum_ns) = 232
-        private const val HIST_VALUE_SIZE = 232
-        // mongo_err_key: u64(cgroup_id) + u8(err_type) + u8[7](pad) = 16
-        private const val ERROR_KEY_SIZE = 16
-        // counter_value: u64(count) = 8
-        private const val ERROR_VALUE_SIZE = 8
-
-        private val COMMAND_NAMES = arrayOf(
-            "UNKNOWN", "find", "insert", "update", "delete",
-            "aggregate", "getMore", "count", "distinct", "Other"
-        )
-
-        private val ERROR_NAMES = arrayOf(
-            "UNKNOWN", "cmd_failure"
-        )
-
-        fun commandName(command: Int): String =
-            if (command in COMMAND_NAMES.indices) COMMAND_NAMES[command] else "UNKNOWN"
-
-        fun errorName(errType: Int): String =
-            if (errType in ERROR_NAMES.indices) ERROR_NAMES[errType] else "UNKNOWN"
+        fun errorName(errType: Int): String = MongoMetrics.ERROR.name(errType)
     }
 
     fun collect() {
         if (!config.extended.mongo) return
         if (!programManager.isProgramLoaded("mongo")) return
-        collectEvents()
-        collectLatency()
-        collectErrors()
-    }
-
-    private fun mapIterateAndDelete(mapFd: Int, keySize: Int, valueSize: Int): List<Pair<ByteArray, ByteArray>> {
-        val keys = mutableListOf<ByteArray>()
-        var prevKey: ByteArray? = null
-        while (true) {
-            val nextKey = bridge.mapGetNextKey(mapFd, prevKey, keySize) ?: break
-            keys.add(nextKey)
-            prevKey = nextKey
-        }
-        val results = mutableListOf<Pair<ByteArray, ByteArray>>()
-        for (k in keys) {
-            val value = bridge.mapLookup(mapFd, k, valueSize)
-            if (value != null) {
-                results.add(k to value)
-            }
-            bridge.mapDelete(mapFd, k)
-        }
-        return results
-    }
-
-    private fun collectEvents() {
-        val mapFd = programManager.getMapFd("mongo", "mongo_events")
-        val entries = mapIterateAndDelete(mapFd, EVENT_KEY_SIZE, EVENT_VALUE_SIZE)
-        if (entries.isNotEmpty()) {
-            log.info("MongoDB events map has {} entries", entries.size)
-        }
-        for ((keyBytes, valueBytes) in entries) {
-            val buf = ByteBuffer.wrap(keyBytes).order(ByteOrder.LITTLE_ENDIAN)
-            val cgroupId = buf.long                        // offset 0: u64
-            val command = buf.get().toInt() and 0xFF       // offset 8: u8
-            // offset 9: u8 pad1, offset 10: u16 pad2, offset 12: u32 pad3 (skip)
-
-            val podInfo = cgroupResolver.resolve(cgroupId)
-            if (podInfo == null) {
-                val valBuf2 = ByteBuffer.wrap(valueBytes).order(ByteOrder.LITTLE_ENDIAN)
-                val cnt = valBuf2.long
-                log.info("MongoDB event: cgroup={} cmd={} count={}",
-                    cgroupId, commandName(command), cnt)
-                val tags = Tags.of(
-                    "namespace", "_unresolved",
-                    "pod", "_unresolved",
-                    "container", "_unresolved",
-                    "node", nodeName,
-                    "command", commandName(command)
-                )
-                registry.counter("kpod.mongo.requests", tags).increment(cnt.toDouble())
-                continue
-            }
-
-            val valBuf = ByteBuffer.wrap(valueBytes).order(ByteOrder.LITTLE_ENDIAN)
-            val count = valBuf.long
-
-            val tags = Tags.of(
-                "namespace", podInfo.namespace,
-                "pod", podInfo.podName,
-                "container", podInfo.containerName,
-                "node", nodeName,
-                "command", commandName(command)
-            )
-            registry.counter("kpod.mongo.requests", tags).increment(count.toDouble())
-        }
-    }
-
-    private fun collectLatency() {
-        val mapFd = programManager.getMapFd("mongo", "mongo_latency")
-        val entries = mapIterateAndDelete(mapFd, LATENCY_KEY_SIZE, HIST_VALUE_SIZE)
-        for ((keyBytes, valueBytes) in entries) {
-            val buf = ByteBuffer.wrap(keyBytes).order(ByteOrder.LITTLE_ENDIAN)
-            val cgroupId = buf.long                        // offset 0: u64
-            val command = buf.get().toInt() and 0xFF       // offset 8: u8
-            // offset 9: u8 pad1, offset 10: u16 pad2, offset 12: u32 pad3 (skip)
-
-            val podInfo = cgroupResolver.resolve(cgroupId) ?: continue
-
-            val valBuf = ByteBuffer.wrap(valueBytes).order(ByteOrder.LITTLE_ENDIAN)
-            valBuf.position(27 * 8) // Skip histogram slots
-            val count = valBuf.long
-            val sumNs = valBuf.long
-
-            if (count <= 0 || sumNs <= 0) continue
-
-            val tags = Tags.of(
-                "namespace", podInfo.namespace,
-                "pod", podInfo.podName,
-                "container", podInfo.containerName,
-                "node", nodeName,
-                "command", commandName(command)
-            )
-            val avgLatencySeconds = (sumNs.toDouble() / count.toDouble()) / 1_000_000_000.0
-            DistributionSummary.builder("kpod.mongo.request.duration")
-                .tags(tags)
-                .baseUnit("seconds")
-                .register(registry)
-                .record(avgLatencySeconds)
-        }
-    }
-
-    private fun collectErrors() {
-        val mapFd = programManager.getMapFd("mongo", "mongo_errors")
-        val entries = mapIterateAndDelete(mapFd, ERROR_KEY_SIZE, ERROR_VALUE_SIZE)
-        for ((keyBytes, valueBytes) in entries) {
-            val buf = ByteBuffer.wrap(keyBytes).order(ByteOrder.LITTLE_ENDIAN)
-            val cgroupId = buf.long                        // offset 0: u64
-            val errType = buf.get().toInt() and 0xFF       // offset 8: u8
-            // offset 9: 7 bytes pad (skip)
-
-            val podInfo = cgroupResolver.resolve(cgroupId) ?: continue
-
-            val valBuf = ByteBuffer.wrap(valueBytes).order(ByteOrder.LITTLE_ENDIAN)
-            val count = valBuf.long
-
-            val tags = Tags.of(
-                "namespace", podInfo.namespace,
-                "pod", podInfo.podName,
-                "container", podInfo.containerName,
-                "node", nodeName,
-                "error_type", errorName(errType)
-            )
-            registry.counter("kpod.mongo.errors", tags).increment(count.toDouble())
-        }
+        emitter.collect(MongoMetrics.ALL)
     }
 }
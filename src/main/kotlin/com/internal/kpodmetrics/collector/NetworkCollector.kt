@@ -19,6 +19,7 @@ class NetworkCollector(
     private val nodeName: String
 ) {
     private val log = LoggerFactory.getLogger(NetworkCollector::class.java)
+    private val unresolvedTcpStats = UnresolvedBuffer<Pair<ByteArray, ByteArray>>(cgroupResolver)
 
     companion object {
         private const val MAX_ENTRIES = 10240
@@ -32,10 +33,10 @@ class NetworkCollector(
 
     private fun collectTcpStats() {
         val mapFd = programManager.getMapFd("net", "tcp_stats_map")
-        collectMap(mapFd, NetMapReader.CounterKeyLayout.SIZE, NetMapReader.TcpStatsLayout.SIZE) { keyBytes, valueBytes ->
-            val cgroupId = NetMapReader.CounterKeyLayout.decodeCgroupId(keyBytes)
-            val podInfo = cgroupResolver.resolve(cgroupId) ?: return@collectMap
-
+        unresolvedTcpStats.drain(
+            bridge, mapFd, NetMapReader.CounterKeyLayout.SIZE, NetMapReader.TcpStatsLayout.SIZE, MAX_ENTRIES,
+            { NetMapReader.CounterKeyLayout.decodeCgroupId(it) }
+        ) { podInfo, _, valueBytes ->
             // bytes_sent/bytes_received omitted — cAdvisor already provides
             // container_network_transmit/receive_bytes_total
             val retransmits = NetMapReader.TcpStatsLayout.decodeRetransmits(valueBytes)
@@ -43,7 +44,7 @@ class NetworkCollector(
             val rttSumUs = NetMapReader.TcpStatsLayout.decodeRttSumUs(valueBytes)
             val rttCount = NetMapReader.TcpStatsLayout.decodeRttCount(valueBytes)
             // Convert RTT from microseconds to nanoseconds for validation
-            if (!BpfValueValidation.isValidLatency(rttCount, rttSumUs * 1000, log, "net_rtt")) return@collectMap
+            if (!BpfValueValidation.isValidLatency(rttCount, rttSumUs * 1000, log, "net_rtt")) return@drain
 
             val tags = Tags.of(
                 "namespace", podInfo.namespace,
@@ -65,12 +66,4 @@ class NetworkCollector(
             }
         }
     }
-
-    private fun collectMap(
-        mapFd: Int, keySize: Int, valueSize: Int,
-        handler: (ByteArray, ByteArray) -> Unit
-    ) {
-        val entries = bridge.mapBatchLookupAndDelete(mapFd, keySize, valueSize, MAX_ENTRIES)
-        entries.forEach { (key, value) -> handler(key, value) }
-    }
 }
@@ -1,8 +1,21 @@
 package com.internal.kpodmetrics.collector
 
+import io.fabric8.kubernetes.api.model.HasMetadata
+import io.fabric8.kubernetes.api.model.Pod
+import io.fabric8.kubernetes.api.model.Service
+import io.fabric8.kubernetes.api.model.discovery.v1.EndpointSlice
 import io.fabric8.kubernetes.client.KubernetesClient
+import io.fabric8.kubernetes.client.informers.ResourceEventHandler
+import io.fabric8.kubernetes.client.informers.SharedIndexInformer
+import io.fabric8.kubernetes.client.informers.cache.ReducedStateItemStore
+import io.micrometer.core.instrument.MeterRegistry
+import io.micrometer.core.instrument.Tags
+import io.micrometer.core.instrument.Timer
 import org.slf4j.LoggerFactory
+import java.time.Duration
+import java.time.Instant
 import java.util.concurrent.ConcurrentHashMap
+import java.util.concurrent.CopyOnWriteArrayList
 
 data class PeerInfo(
     val podName: String? = null,
@@ -10,42 +23,257 @@ data class PeerInfo(
     val serviceName: String? = null
 )
 
-class PodIpResolver(private val client: KubernetesClient) {
+/**
+ * Maps cluster IPs to the pod or service behind them for the peer and HTTP collectors.
+ *
+ * Pods, Services and EndpointSlices are tracked with shared informers: one paginated
+ * list each, then a watch that applies deltas to the IP indexes, instead of listing
+ * every pod and service in the cluster each cycle. Pod IPs selected by a Service
+ * carry its name, taken from the EndpointSlices of the Service; an IP listed by
+ * several Services carries the lowest name, so the choice does not depend on event
+ * order. Informer stores keep only the fields used here.
+ *
+ * Exports `kpod.peer.index.size` (by index) and `kpod.peer.watch.lag`, the delay
+ * between an endpoint change (the EndpointSlice controller's trigger time) and its
+ * delta arriving here. Lag is taken only from updates after the initial list whose
+ * trigger time changed, so replayed objects do not count as late.
+ */
+class PodIpResolver(
+    private val client: KubernetesClient,
+    registry: MeterRegistry? = null,
+    private val clock: () -> Long = System::currentTimeMillis
+) : AutoCloseable {
     private val log = LoggerFactory.getLogger(PodIpResolver::class.java)
-    private val cache = ConcurrentHashMap<String, PeerInfo>()
 
-    fun resolve(ip: String): PeerInfo? = cache[ip]
+    // Indexes by IP; peers is the merged view resolve() reads
+    private val podsByIp = ConcurrentHashMap<String, PeerInfo>()
+    private val servicesByIp = ConcurrentHashMap<String, PeerInfo>()
+    private val serviceOfEndpoint = ConcurrentHashMap<String, PeerInfo>()
+    private val peers = ConcurrentHashMap<String, PeerInfo>()
+    // EndpointSlice namespace/name -> what it last listed, to apply updates as deltas
+    private class SliceState(val service: PeerInfo?, val addresses: Set<String>, val triggerTime: String?)
+    private val slices = HashMap<String, SliceState>()
+    // IP -> services whose slices list it, with the number of those slices
+    private val endpointServices = HashMap<String, HashMap<PeerInfo, Int>>()
+    private val informers = CopyOnWriteArrayList<SharedIndexInformer<*>>()
+    @Volatile internal var sliceInformer: SharedIndexInformer<EndpointSlice>? = null
+    @Volatile private var started = false
+    private val watchLag: Timer? = registry?.let {
+        Timer.builder("kpod.peer.watch.lag")
+            .description("Delay between an endpoint change and its watch event")
+            .register(it)
+    }
+
+    companion object {
+        private const val LIST_PAGE_SIZE = 500L
+        private const val SERVICE_NAME_LABEL = "kubernetes.io/service-name"
+        private const val TRIGGER_TIME_ANNOTATION = "endpoints.kubernetes.io/last-change-trigger-time"
+        private val SERVICE_ORDER = compareBy<PeerInfo>({ it.namespace }, { it.serviceName })
+
+        private fun podIps(pod: Pod): Set<String> {
+            val status = pod.status ?: return emptySet()
+            val ips = HashSet<String>(2)
+            status.podIP?.let { ips.add(it) }
+            status.podIPs?.forEach { it.ip?.let(ips::add) }
+            return ips
+        }
 
-    fun refresh() {
+        private fun clusterIps(svc: Service): Set<String> {
+            val spec = svc.spec ?: return emptySet()
+            val ips = HashSet<String>(2)
+            spec.clusterIP?.let { ips.add(it) }
+            spec.clusterIPs?.let { ips.addAll(it) }
+            ips.remove("None")
+            ips.remove("")
+            return ips
+        }
+
+        private fun key(obj: HasMetadata): String = "${obj.metadata?.namespace}/${obj.metadata?.name}"
+    }
+
+    init {
+        registry?.let {
+            it.gaugeMapSize("kpod.peer.index.size", Tags.of("index", "pod"), podsByIp)
+            it.gaugeMapSize("kpod.peer.index.size", Tags.of("index", "service"), servicesByIp)
+            it.gaugeMapSize("kpod.peer.index.size", Tags.of("index", "endpoint"), serviceOfEndpoint)
+        }
+    }
+
+    fun resolve(ip: String): PeerInfo? = peers[ip]
+
+    /**
+     * Starts the informers on first call; later calls return immediately. Called by
+     * the collectors that need peer names, so clusters without them enabled are not
+     * watched.
+     */
+    fun ensureWatching() {
+        if (started) return
+        synchronized(this) {
+            if (started) return
+            started = true
+        }
+        val serialization = client.kubernetesSerialization
         try {
-            val newMap = ConcurrentHashMap<String, PeerInfo>()
-
-            // Map podIP -> PeerInfo(podName, namespace)
-            val pods = client.pods().inAnyNamespace().list().items
-            for (pod in pods) {
-                val ip = pod.status?.podIP ?: continue
-                val name = pod.metadata?.name ?: continue
-                val namespace = pod.metadata?.namespace ?: continue
-                newMap[ip] = PeerInfo(podName = name, namespace = namespace)
+            informers += client.pods().inAnyNamespace().withLimit(LIST_PAGE_SIZE).runnableInformer(0)
+                .itemStore(ReducedStateItemStore(
+                    ReducedStateItemStore.NAME_KEY_STATE, Pod::class.java, serialization,
+                    "status.podIP", "status.podIPs"
+                ))
+                .addEventHandler(podHandler)
+            informers += client.services().inAnyNamespace().withLimit(LIST_PAGE_SIZE).runnableInformer(0)
+                .itemStore(ReducedStateItemStore(
+                    ReducedStateItemStore.NAME_KEY_STATE, Service::class.java, serialization,
+                    "spec.clusterIP", "spec.clusterIPs"
+                ))
+                .addEventHandler(serviceHandler)
+            val slices = client.discovery().v1().endpointSlices().inAnyNamespace().withLimit(LIST_PAGE_SIZE)
+                .runnableInformer(0)
+                .itemStore(ReducedStateItemStore(
+                    ReducedStateItemStore.NAME_KEY_STATE, EndpointSlice::class.java, serialization,
+                    "metadata.labels"
+                ))
+                .addEventHandler(endpointSliceHandler)
+            sliceInformer = slices
+            informers += slices
+            for (informer in informers) informer.start()
+            log.info("PodIpResolver watching pods, services and endpoint slices")
+        } catch (e: Exception) {
+            log.warn("Failed to start PodIpResolver informers: {}", e.message)
+        }
+    }
+
+    override fun close() {
+        for (informer in informers) informer.stop()
+        informers.clear()
+    }
+
+    internal val podHandler = object : ResourceEventHandler<Pod> {
+        override fun onAdd(obj: Pod) = onPod(null, obj)
+        override fun onUpdate(oldObj: Pod, newObj: Pod) = onPod(oldObj, newObj)
+        override fun onDelete(obj: Pod, deletedFinalStateUnknown: Boolean) = onPod(obj, null)
+    }
+
+    internal val serviceHandler = object : ResourceEventHandler<Service> {
+        override fun onAdd(obj: Service) = onService(null, obj)
+        override fun onUpdate(oldObj: Service, newObj: Service) = onService(oldObj, newObj)
+        override fun onDelete(obj: Service, deletedFinalStateUnknown: Boolean) = onService(obj, null)
+    }
+
+    internal val endpointSliceHandler = object : ResourceEventHandler<EndpointSlice> {
+        override fun onAdd(obj: EndpointSlice) = onEndpointSlice(obj, obj, update = false)
+        override fun onUpdate(oldObj: EndpointSlice, newObj: EndpointSlice) = onEndpointSlice(newObj, newObj, update = true)
+        override fun onDelete(obj: EndpointSlice, deletedFinalStateUnknown: Boolean) = onEndpointSlice(obj, null, update = false)
+    }
+
+    @Synchronized
+    private fun onPod(old: Pod?, new: Pod?) {
+        val oldIps = old?.let { podIps(it) } ?: emptySet()
+        val newIps = new?.let { podIps(it) } ?: emptySet()
+        for (ip in oldIps) {
+            if (ip in newIps) continue
+            val owner = podsByIp[ip] ?: continue
+            // The IP may already belong to another pod
+            if (owner.podName == old?.metadata?.name && owner.namespace == old?.metadata?.namespace) {
+                podsByIp.remove(ip)
+                reindex(ip)
             }
+        }
+        if (new == null) return
+        val name = new.metadata?.name ?: return
+        val namespace = new.metadata?.namespace ?: return
+        for (ip in newIps) {
+            val existing = podsByIp[ip]
+            if (existing != null && existing.podName == name && existing.namespace == namespace) continue
+            podsByIp[ip] = PeerInfo(podName = name, namespace = namespace)
+            reindex(ip)
+        }
+    }
+
+    @Synchronized
+    private fun onService(old: Service?, new: Service?) {
+        val oldIps = old?.let { clusterIps(it) } ?: emptySet()
+        val newIps = new?.let { clusterIps(it) } ?: emptySet()
+        for (ip in oldIps) {
+            if (ip in newIps) continue
+            servicesByIp.remove(ip)
+            reindex(ip)
+        }
+        if (new == null) return
+        val name = new.metadata?.name ?: return
+        val namespace = new.metadata?.namespace ?: return
+        for (ip in newIps) {
+            servicesByIp[ip] = PeerInfo(serviceName = name, namespace = namespace)
+            reindex(ip)
+        }
+    }
+
+    /**
+     * Applies the addresses of [slice] ([new] null on delete) as a delta against the
+     * last ones seen. The informer's old object carries no endpoints or annotations
+     * (reduced store), so the previous state is kept here.
+     */
+    @Synchronized
+    private fun onEndpointSlice(slice: EndpointSlice, new: EndpointSlice?, update: Boolean) {
+        val sliceKey = key(slice)
+        val serviceName = slice.metadata?.labels?.get(SERVICE_NAME_LABEL)
+        val namespace = slice.metadata?.namespace
+        val service = if (serviceName != null && namespace != null) PeerInfo(namespace = namespace, serviceName = serviceName) else null
+        val addresses = new?.endpoints?.flatMapTo(HashSet()) { it.addresses ?: emptyList() } ?: emptySet()
+        val triggerTime = new?.metadata?.annotations?.get(TRIGGER_TIME_ANNOTATION)
+        val previous = if (new == null) slices.remove(sliceKey) else slices.put(sliceKey, SliceState(service, addresses, triggerTime))
 
-            // Map clusterIP -> PeerInfo(serviceName, namespace)
-            val services = client.services().inAnyNamespace().list().items
-            for (svc in services) {
-                val clusterIP = svc.spec?.clusterIP ?: continue
-                if (clusterIP == "None") continue
-                val name = svc.metadata?.name ?: continue
-                val namespace = svc.metadata?.namespace ?: continue
-                newMap[clusterIP] = PeerInfo(serviceName = name, namespace = namespace)
+        if (previous?.service != null) {
+            for (ip in previous.addresses) {
+                if (previous.service == service && ip in addresses) continue
+                removeEndpoint(ip, previous.service)
+            }
+        }
+        if (service != null) {
+            for (ip in addresses) {
+                if (previous != null && previous.service == service && ip in previous.addresses) continue
+                addEndpoint(ip, service)
             }
+        }
+        if (update && triggerTime != null && triggerTime != previous?.triggerTime && sliceInformer?.hasSynced() == true) {
+            recordLag(triggerTime)
+        }
+    }
 
-            cache.clear()
-            cache.putAll(newMap)
-            log.debug("PodIpResolver refreshed: {} pod IPs, {} service IPs",
-                pods.count { it.status?.podIP != null },
-                services.count { val ip = it.spec?.clusterIP; ip != null && ip != "None" })
-        } catch (e: Exception) {
-            log.warn("Failed to refresh PodIpResolver cache: {}", e.message)
+    private fun addEndpoint(ip: String, service: PeerInfo) {
+        endpointServices.getOrPut(ip) { HashMap(2) }.merge(service, 1) { a, b -> a + b }
+        updateEndpoint(ip)
+    }
+
+    private fun removeEndpoint(ip: String, service: PeerInfo) {
+        val services = endpointServices[ip] ?: return
+        val count = services[service] ?: return
+        if (count > 1) services[service] = count - 1 else services.remove(service)
+        if (services.isEmpty()) endpointServices.remove(ip)
+        updateEndpoint(ip)
+    }
+
+    /** Points [ip] at the lowest of the services listing it. */
+    private fun updateEndpoint(ip: String) {
+        val chosen = endpointServices[ip]?.keys?.minWithOrNull(SERVICE_ORDER)
+        val changed = if (chosen == null) serviceOfEndpoint.remove(ip) != null else serviceOfEndpoint.put(ip, chosen) != chosen
+        if (changed) reindex(ip)
+    }
+
+    private fun recordLag(triggerTime: String) {
+        val timer = watchLag ?: return
+        try {
+            val lagMs = clock() - Instant.parse(triggerTime).toEpochMilli()
+            if (lagMs >= 0) timer.record(Duration.ofMillis(lagMs))
+        } catch (_: Exception) {
+        }
+    }
+
+    /** Service IPs resolve to the service; pod IPs to the pod, with the service selecting it. */
+    private fun reindex(ip: String) {
+        val peer = servicesByIp[ip] ?: podsByIp[ip]?.let { pod ->
+            val endpoint = serviceOfEndpoint[ip]
+            if (endpoint != null && endpoint.namespace == pod.namespace) pod.copy(serviceName = endpoint.serviceName) else pod
         }
+        if (peer == null) peers.remove(ip) else peers[ip] = peer
     }
 }
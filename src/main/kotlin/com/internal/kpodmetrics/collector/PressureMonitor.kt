@@ -0,0 +1,283 @@
+package com.internal.kpodmetrics.collector
+
+import com.internal.kpodmetrics.bpf.BpfBridge
+import com.internal.kpodmetrics.model.PodCgroupTarget
+import io.micrometer.core.instrument.Counter
+import io.micrometer.core.instrument.MeterRegistry
+import io.micrometer.core.instrument.Tags
+import org.slf4j.LoggerFactory
+import java.io.IOException
+import java.nio.file.Files
+import java.nio.file.Paths
+import java.time.Instant
+import java.util.concurrent.ConcurrentHashMap
+import java.util.concurrent.atomic.AtomicLong
+
+/** One PSI trigger firing for a pod cgroup. */
+data class PressureEvent(
+    val timestampMs: Long,
+    val namespace: String,
+    val pod: String,
+    val resource: String
+)
+
+/**
+ * One reading of a pod cgroup's `<resource>.pressure` file, taken while a burst
+ * follows a [PressureEvent]. Totals are cumulative stall microseconds, so the
+ * difference between consecutive samples is the stall in that interval.
+ */
+data class PressureSample(
+    val timestampMs: Long,
+    val namespace: String,
+    val pod: String,
+    val resource: String,
+    val someAvg10: Double,
+    val someTotalUs: Long,
+    val fullTotalUs: Long?
+)
+
+/**
+ * Event-driven pressure stall monitoring with kernel PSI triggers (cgroup v2).
+ * A [trigger] such as `some 150000 1000000` (150ms of stall within any 1s window)
+ * is armed on `<resource>.pressure` of every pod cgroup, and all trigger fds are
+ * waited on by one epoll loop on its own platform thread, so sub-second stalls
+ * are seen as they happen instead of being averaged away between polls.
+ *
+ * Pod cgroups are armed and disarmed by [sync] once per collection cycle. Each
+ * firing is exported as:
+ * - kpod.psi.trigger.events{namespace,pod,resource} — trigger firings (counter)
+ * - kpod.psi.last.event.timestamp.seconds{namespace,pod,resource} — epoch time of the last firing (gauge)
+ * and kept, timestamped, in a bounded list of [recentEvents] for `kpodDiagnostics`.
+ * The callback set with [setOnPressureCallback] runs on the loop thread for every firing.
+ * [sample] reads the pressured pod's stall totals on demand, so a burst after a
+ * firing leaves a timestamped stall curve for that pod in [recentSamples].
+ */
+class PressureMonitor(
+    private val bridge: BpfBridge,
+    private val registry: MeterRegistry,
+    private val trigger: String = "some 150000 1000000",
+    private val resources: List<String> = listOf("cpu", "memory", "io"),
+    private val recentCapacity: Int = 256,
+    private val clock: () -> Long = System::currentTimeMillis,
+    private val readFile: (String) -> String? = ::readPressureFile
+) : AutoCloseable {
+    private val log = LoggerFactory.getLogger(PressureMonitor::class.java)
+
+    private class Trigger(val podPath: String, val namespace: String, val pod: String, val resource: String) {
+        var counter: Counter? = null
+        var lastEpochMs: AtomicLong? = null
+    }
+
+    private val triggersByFd = ConcurrentHashMap<Int, Trigger>()
+    private val fdsByPod = ConcurrentHashMap<String, IntArray>()
+    private val recent = ArrayDeque<PressureEvent>(recentCapacity)
+    private val samples = ArrayDeque<PressureSample>(recentCapacity)
+    private val armErrors: Counter = registry.counter("kpod.psi.trigger.errors")
+    @Volatile private var epollFd = -1
+    @Volatile private var running = false
+    private var thread: Thread? = null
+    @Volatile private var onPressure: ((PressureEvent) -> Unit)? = null
+
+    companion object {
+        private const val EPOLLPRI = 0x002
+        private const val EPOLLERR = 0x008
+        private const val WAIT_TIMEOUT_MS = 1000
+        private const val MAX_EVENTS = 64
+
+        private fun readPressureFile(path: String): String? = try {
+            Files.readString(Paths.get(path))
+        } catch (e: IOException) {
+            null
+        }
+
+        /** Value of `<key>=` on the `some` or `full` line of a PSI file, or null. */
+        internal fun psiField(content: String, line: String, key: String): String? {
+            val row = content.lineSequence().firstOrNull { it.startsWith("$line ") } ?: return null
+            return row.split(' ').firstOrNull { it.startsWith("$key=") }?.substringAfter('=')
+        }
+    }
+
+    init {
+        registry.gauge("kpod.psi.triggers.armed", triggersByFd) { it.size.toDouble() }
+    }
+
+    fun setOnPressureCallback(callback: (PressureEvent) -> Unit) {
+        this.onPressure = callback
+    }
+
+    /** Creates the epoll instance and starts the loop; returns false if PSI triggers are unavailable. */
+    @Synchronized
+    fun start(): Boolean {
+        if (running) return true
+        val fd = try {
+            bridge.psiEpollCreate()
+        } catch (e: UnsatisfiedLinkError) {
+            log.warn("PSI triggers unavailable (native library too old): {}", e.message)
+            return false
+        }
+        if (fd < 0) {
+            log.warn("Cannot create epoll instance for PSI triggers: errno {}", -fd)
+            return false
+        }
+        epollFd = fd
+        running = true
+        thread = Thread({ loop() }, "psi-monitor").apply {
+            isDaemon = true
+            start()
+        }
+        return true
+    }
+
+    /**
+     * Arms triggers for pod cgroups that appeared among [targets] and disarms those
+     * that are gone. Targets are container cgroups; triggers go on their pod cgroup.
+     */
+    fun sync(targets: List<PodCgroupTarget>) {
+        if (!running) return
+        val pods = HashMap<String, PodCgroupTarget>()
+        for (target in targets) {
+            val podPath = Paths.get(target.cgroupPath).parent?.toString() ?: continue
+            pods.putIfAbsent(podPath, target)
+        }
+        for (podPath in fdsByPod.keys.toList()) {
+            if (podPath !in pods) disarm(podPath)
+        }
+        for ((podPath, target) in pods) {
+            if (!fdsByPod.containsKey(podPath)) arm(podPath, target)
+        }
+    }
+
+    /** Most recent firings, newest last. */
+    fun recentEvents(): List<PressureEvent> = synchronized(recent) { recent.toList() }
+
+    /** Burst samples, newest last. */
+    fun recentSamples(): List<PressureSample> = synchronized(samples) { samples.toList() }
+
+    /**
+     * Reads the current stall totals of the pod cgroup [event] fired on and keeps
+     * them in [recentSamples]. Returns null if the pod is no longer armed or its
+     * pressure file cannot be read.
+     */
+    fun sample(event: PressureEvent): PressureSample? {
+        val podPath = triggersByFd.values
+            .firstOrNull { it.namespace == event.namespace && it.pod == event.pod }?.podPath ?: return null
+        val content = readFile("$podPath/${event.resource}.pressure") ?: return null
+        val sample = PressureSample(
+            clock(), event.namespace, event.pod, event.resource,
+            psiField(content, "some", "avg10")?.toDoubleOrNull() ?: return null,
+            psiField(content, "some", "total")?.toLongOrNull() ?: return null,
+            psiField(content, "full", "total")?.toLongOrNull()
+        )
+        synchronized(samples) {
+            if (samples.size >= recentCapacity) samples.removeFirst()
+            samples.addLast(sample)
+        }
+        return sample
+    }
+
+    fun snapshot(): Map<String, Any?> = mapOf(
+        "enabled" to running,
+        "trigger" to trigger,
+        "armedPods" to fdsByPod.size,
+        "armedTriggers" to triggersByFd.size,
+        "recentEvents" to recentEvents().map {
+            mapOf(
+                "timestamp" to Instant.ofEpochMilli(it.timestampMs).toString(),
+                "namespace" to it.namespace,
+                "pod" to it.pod,
+                "resource" to it.resource
+            )
+        },
+        "burstSamples" to recentSamples().map {
+            mapOf(
+                "timestamp" to Instant.ofEpochMilli(it.timestampMs).toString(),
+                "namespace" to it.namespace,
+                "pod" to it.pod,
+                "resource" to it.resource,
+                "someAvg10" to it.someAvg10,
+                "someTotalUs" to it.someTotalUs,
+                "fullTotalUs" to it.fullTotalUs
+            )
+        }
+    )
+
+    private fun arm(podPath: String, target: PodCgroupTarget) {
+        val fds = IntArray(resources.size) { -1 }
+        for ((i, resource) in resources.withIndex()) {
+            val fd = bridge.psiTriggerAdd(epollFd, "$podPath/$resource.pressure", trigger)
+            if (fd < 0) {
+                log.debug("Cannot arm PSI trigger on {}/{}.pressure: errno {}", podPath, resource, -fd)
+                armErrors.increment()
+                continue
+            }
+            fds[i] = fd
+            triggersByFd[fd] = Trigger(podPath, target.namespace, target.podName, resource)
+        }
+        fdsByPod[podPath] = fds
+    }
+
+    private fun disarm(podPath: String) {
+        val fds = fdsByPod.remove(podPath) ?: return
+        for (fd in fds) {
+            if (fd < 0) continue
+            triggersByFd.remove(fd)
+            bridge.closeFd(fd)
+        }
+    }
+
+    private fun loop() {
+        val out = IntArray(MAX_EVENTS * 2)
+        while (running) {
+            val n = bridge.psiWait(epollFd, out, WAIT_TIMEOUT_MS)
+            if (n < 0) {
+                log.warn("PSI epoll wait failed: errno {}; stopping pressure monitor", -n)
+                running = false
+                break
+            }
+            for (i in 0 until n) {
+                val fd = out[i * 2]
+                val events = out[i * 2 + 1]
+                val trig = triggersByFd[fd] ?: continue
+                if ((events and EPOLLERR) != 0) {
+                    // The cgroup was removed under the trigger
+                    disarm(trig.podPath)
+                } else if ((events and EPOLLPRI) != 0) {
+                    fire(trig)
+                }
+            }
+        }
+    }
+
+    private fun fire(trig: Trigger) {
+        val now = clock()
+        val tags = Tags.of("namespace", trig.namespace, "pod", trig.pod, "resource", trig.resource)
+        val counter = trig.counter ?: registry.counter("kpod.psi.trigger.events", tags).also { trig.counter = it }
+        counter.increment()
+        val last = trig.lastEpochMs ?: AtomicLong().also {
+            registry.gauge("kpod.psi.last.event.timestamp.seconds", tags, it) { v -> v.get() / 1000.0 }
+            trig.lastEpochMs = it
+        }
+        last.set(now)
+
+        val event = PressureEvent(now, trig.namespace, trig.pod, trig.resource)
+        synchronized(recent) {
+            if (recent.size >= recentCapacity) recent.removeFirst()
+            recent.addLast(event)
+        }
+        try {
+            onPressure?.invoke(event)
+        } catch (e: Exception) {
+            log.debug("Pressure handler failed: {}", e.message)
+        }
+    }
+
+    @Synchronized
+    override fun close() {
+        running = false
+        thread?.join(WAIT_TIMEOUT_MS * 2L)
+        thread = null
+        for (podPath in fdsByPod.keys.toList()) disarm(podPath)
+        if (epollFd >= 0) bridge.closeFd(epollFd)
+        epollFd = -1
+    }
+}
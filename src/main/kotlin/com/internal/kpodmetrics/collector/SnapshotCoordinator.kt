@@ -0,0 +1,137 @@
+package com.internal.kpodmetrics.collector
+
+import com.internal.kpodmetrics.bpf.BpfBridge
+import com.internal.kpodmetrics.bpf.DrainSpec
+import com.internal.kpodmetrics.bpf.MapDrainSnapshot
+import io.micrometer.core.instrument.Counter
+import io.micrometer.core.instrument.DistributionSummary
+import io.micrometer.core.instrument.MeterRegistry
+import io.micrometer.core.instrument.Timer
+import org.slf4j.LoggerFactory
+import java.util.concurrent.ConcurrentHashMap
+import java.util.concurrent.TimeUnit
+
+/**
+ * Two-phase consistent-snapshot collection for BPF collectors.
+ *
+ * Phase 1 ([beginCycle]) drains every map the due collectors read, back-to-back on
+ * one native thread. Phase 2 is the normal parallel collector run; each collector's
+ * drain calls are served from the snapshot, so HTTP counts, TCP bytes and topology
+ * edges in one scrape cover the same window and cross-metric ratios are exact.
+ *
+ * The drain plan is learned: a collector's drain calls are recorded the first time
+ * it runs (live), and from the next cycle on its maps are included in phase 1.
+ * Maps a collector ran without reading back are dropped from the plan. Entries
+ * pre-drained for a collector that did not finish (timed out or threw) were
+ * already removed from the kernel, so they are carried over and served ahead of
+ * that map's next drain instead of being lost.
+ */
+class SnapshotCoordinator(
+    private val bridge: BpfBridge,
+    registry: MeterRegistry? = null
+) {
+    private val log = LoggerFactory.getLogger(SnapshotCoordinator::class.java)
+
+    companion object {
+        /** Carried entries kept per map; the oldest go first when a collector keeps failing. */
+        const val MAX_CARRIED_ENTRIES = 65_536
+    }
+
+    private val plans = ConcurrentHashMap<String, MutableSet<DrainSpec>>()
+    private val finished: MutableSet<String> = ConcurrentHashMap.newKeySet()
+    private val carried = HashMap<DrainSpec, List<Pair<ByteArray, ByteArray>>>()
+    @Volatile private var current: MapDrainSnapshot? = null
+
+    private val drainTimer: Timer? = registry?.let {
+        Timer.builder("kpod.collection.snapshot.drain.duration")
+            .description("Time to drain all BPF maps in the snapshot phase")
+            .register(it)
+    }
+    private val entriesSummary: DistributionSummary? = registry?.let {
+        DistributionSummary.builder("kpod.collection.snapshot.entries")
+            .description("Map entries captured per snapshot")
+            .register(it)
+    }
+    private val unconsumedCounter: Counter? = registry?.let {
+        Counter.builder("kpod.collection.snapshot.unconsumed.total")
+            .description("Snapshot maps no collector read back")
+            .register(it)
+    }
+    private val carriedCounter: Counter? = registry?.let {
+        Counter.builder("kpod.collection.snapshot.carried.entries.total")
+            .description("Pre-drained entries held for the next cycle because their collector did not finish")
+            .register(it)
+    }
+
+    /**
+     * Phase 1: drains the planned maps of [collectors] and installs the snapshot,
+     * with entries carried from earlier cycles in front of the fresh ones.
+     * Returns null when no collector has a plan yet.
+     */
+    @Synchronized
+    fun beginCycle(collectors: Collection<String>): MapDrainSnapshot? {
+        finished.clear()
+        val specs = LinkedHashSet<DrainSpec>()
+        for (name in collectors) plans[name]?.let { specs.addAll(it) }
+        if (specs.isEmpty()) return null
+
+        val drained = bridge.drainAll(specs)
+        drainTimer?.record(drained.drainDurationNs, TimeUnit.NANOSECONDS)
+        entriesSummary?.record(drained.entryCount.toDouble())
+        val snapshot = if (carried.keys.none { it in specs }) drained else {
+            val merged = LinkedHashMap<DrainSpec, List<Pair<ByteArray, ByteArray>>>(specs.size * 2)
+            for (spec in specs) {
+                val fresh = drained.take(spec)
+                val held = carried.remove(spec)
+                when {
+                    held == null -> fresh?.let { merged[spec] = it }
+                    fresh == null -> merged[spec] = held
+                    else -> merged[spec] = held + fresh
+                }
+            }
+            MapDrainSnapshot(drained.drainDurationNs, merged)
+        }
+        current = snapshot
+        bridge.installSnapshot(snapshot)
+        log.debug("Snapshot drained {} maps ({} entries) in {}us",
+            snapshot.mapCount, snapshot.entryCount, snapshot.drainDurationNs / 1000)
+        return snapshot
+    }
+
+    /** Phase 2 wrapper: records which maps [name] drains so later cycles can pre-drain them. */
+    fun <T> collect(name: String, block: () -> T): T {
+        val plan = plans.computeIfAbsent(name) { ConcurrentHashMap.newKeySet() }
+        val result = bridge.recordDrains({ plan.add(it) }, block)
+        finished.add(name)
+        return result
+    }
+
+    /**
+     * Uninstalls the snapshot. Unread maps of collectors that finished are pruned
+     * from the plan; unread entries of collectors that did not are carried over.
+     */
+    @Synchronized
+    fun endCycle() {
+        val snapshot = current ?: return
+        current = null
+        bridge.installSnapshot(null)
+        val unconsumed = snapshot.unconsumed()
+        if (unconsumed.isEmpty()) return
+
+        val readByFinished = plans.filterKeys { it in finished }.values.flatMapTo(HashSet()) { it }
+        val unread = unconsumed.filterTo(HashSet()) { it in readByFinished }
+        for (spec in unconsumed) {
+            if (spec in readByFinished) continue
+            // take() is atomic, so a straggler still reading the snapshot gets each entry or we do
+            val entries = snapshot.take(spec) ?: continue
+            if (entries.isEmpty()) continue
+            carriedCounter?.increment(entries.size.toDouble())
+            val held = carried[spec]
+            carried[spec] = (if (held == null) entries else held + entries).takeLast(MAX_CARRIED_ENTRIES)
+        }
+        if (unread.isEmpty()) return
+        unconsumedCounter?.increment(unread.size.toDouble())
+        for (plan in plans.values) plan.removeAll(unread)
+        log.debug("Dropped {} unconsumed maps from the snapshot plan", unread.size)
+    }
+}
@@ -19,6 +19,7 @@ class SoftirqsCollector(
     private val nodeName: String
 ) {
     private val log = LoggerFactory.getLogger(SoftirqsCollector::class.java)
+    private val unresolvedSoftirqLatency = UnresolvedBuffer<Pair<ByteArray, ByteArray>>(cgroupResolver)
 
     companion object {
         private const val MAX_ENTRIES = 10240
@@ -28,17 +29,14 @@ class SoftirqsCollector(
         if (!config.extended.softirqs) return
 
         val mapFd = programManager.getMapFd("softirqs", "softirq_latency")
-        val entries = bridge.mapBatchLookupAndDelete(
-            mapFd, SoftirqsMapReader.HistKeyLayout.SIZE,
-            SoftirqsMapReader.HistValueLayout.SIZE, MAX_ENTRIES
-        )
-        entries.forEach { (keyBytes, valueBytes) ->
-            val cgroupId = SoftirqsMapReader.HistKeyLayout.decodeCgroupId(keyBytes)
-            val podInfo = cgroupResolver.resolve(cgroupId) ?: return@forEach
-
+        unresolvedSoftirqLatency.drain(
+            bridge, mapFd, SoftirqsMapReader.HistKeyLayout.SIZE,
+            SoftirqsMapReader.HistValueLayout.SIZE, MAX_ENTRIES,
+            { SoftirqsMapReader.HistKeyLayout.decodeCgroupId(it) }
+        ) { podInfo, _, valueBytes ->
             val count = SoftirqsMapReader.HistValueLayout.decodeCount(valueBytes)
             val sumNs = SoftirqsMapReader.HistValueLayout.decodeSumNs(valueBytes)
-            if (!BpfValueValidation.isValidLatency(count, sumNs, log, "softirqs")) return@forEach
+            if (!BpfValueValidation.isValidLatency(count, sumNs, log, "softirqs")) return@drain
 
             val tags = Tags.of(
                 "namespace", podInfo.namespace,
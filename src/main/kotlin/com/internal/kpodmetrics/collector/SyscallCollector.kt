@@ -19,6 +19,7 @@ class SyscallCollector(
     private val nodeName: String
 ) {
     private val log = LoggerFactory.getLogger(SyscallCollector::class.java)
+    private val unresolvedSyscallStats = UnresolvedBuffer<Pair<ByteArray, ByteArray>>(cgroupResolver)
 
     companion object {
         private const val MAX_ENTRIES = 10240
@@ -50,18 +51,17 @@ class SyscallCollector(
 
     private fun collectSyscallStats() {
         val mapFd = programManager.getMapFd("syscall", "syscall_stats")
-        collectMap(mapFd, SyscallMapReader.SyscallKeyLayout.SIZE, SyscallMapReader.SyscallStatsLayout.SIZE) { keyBytes, valueBytes ->
-            val cgroupId = SyscallMapReader.SyscallKeyLayout.decodeCgroupId(keyBytes)
+        unresolvedSyscallStats.drain(
+            bridge, mapFd, SyscallMapReader.SyscallKeyLayout.SIZE, SyscallMapReader.SyscallStatsLayout.SIZE, MAX_ENTRIES,
+            { SyscallMapReader.SyscallKeyLayout.decodeCgroupId(it) }
+        ) { podInfo, keyBytes, valueBytes ->
             val syscallNr = SyscallMapReader.SyscallKeyLayout.decodeSyscallNr(keyBytes)
-
-            val podInfo = cgroupResolver.resolve(cgroupId) ?: return@collectMap
-
             val syscallName = SYSCALL_NAMES[syscallNr] ?: "syscall_$syscallNr"
 
             val count = SyscallMapReader.SyscallStatsLayout.decodeCount(valueBytes)
             val errorCount = SyscallMapReader.SyscallStatsLayout.decodeErrorCount(valueBytes)
             val latencySumNs = SyscallMapReader.SyscallStatsLayout.decodeLatencySumNs(valueBytes)
-            if (!BpfValueValidation.isValidLatency(count, latencySumNs, log, "syscall")) return@collectMap
+            if (!BpfValueValidation.isValidLatency(count, latencySumNs, log, "syscall")) return@drain
 
             val tags = Tags.of(
                 "namespace", podInfo.namespace,
@@ -84,12 +84,4 @@ class SyscallCollector(
             }
         }
     }
-
-    private fun collectMap(
-        mapFd: Int, keySize: Int, valueSize: Int,
-        handler: (ByteArray, ByteArray) -> Unit
-    ) {
-        val entries = bridge.mapBatchLookupAndDelete(mapFd, keySize, valueSize, MAX_ENTRIES)
-        entries.forEach { (key, value) -> handler(key, value) }
-    }
 }
@@ -3,6 +3,7 @@ package com.internal.kpodmetrics.collector
 import com.internal.kpodmetrics.bpf.BpfBridge
 import com.internal.kpodmetrics.bpf.BpfProgramManager
 import com.internal.kpodmetrics.bpf.CgroupResolver
+import com.internal.kpodmetrics.bpf.generated.TcpPeerViews
 import com.internal.kpodmetrics.config.ResolvedConfig
 import com.internal.kpodmetrics.topology.ConnectionRecord
 import com.internal.kpodmetrics.topology.RttRecord
@@ -11,8 +12,6 @@ import io.micrometer.core.instrument.DistributionSummary
 import io.micrometer.core.instrument.MeterRegistry
 import io.micrometer.core.instrument.Tags
 import org.slf4j.LoggerFactory
-import java.nio.ByteBuffer
-import java.nio.ByteOrder
 
 class TcpPeerCollector(
     private val bridge: BpfBridge,
@@ -25,13 +24,15 @@ class TcpPeerCollector(
     private val topologyAggregator: TopologyAggregator? = null
 ) {
     private val log = LoggerFactory.getLogger(TcpPeerCollector::class.java)
+    private val connKey = TcpPeerViews.TcpPeerConnKeyView()
+    private val rttKey = TcpPeerViews.TcpPeerRttKeyView()
+    private val countValue = TcpPeerViews.CounterValueView()
+    private val histValue = TcpPeerViews.TcpPeerHistValueView()
+    private val unresolvedConnections = UnresolvedBuffer<Pair<ByteArray, ByteArray>>(cgroupResolver)
+    private val unresolvedRtt = UnresolvedBuffer<Pair<ByteArray, ByteArray>>(cgroupResolver)
 
     companion object {
         private const val MAX_ENTRIES = 10240
-        private const val CONN_KEY_SIZE = 20   // u64 + u32 + u16 + u8 + u8
-        private const val CONN_VALUE_SIZE = 8  // u64
-        private const val RTT_KEY_SIZE = 16    // u64 + u32 + u16 + u16
-        private const val RTT_VALUE_SIZE = 232 // u64[27] + u64 + u64
 
         fun ipToString(ip: Int): String {
             return "${ip and 0xFF}.${(ip shr 8) and 0xFF}.${(ip shr 16) and 0xFF}.${(ip shr 24) and 0xFF}"
@@ -47,7 +48,7 @@ class TcpPeerCollector(
     fun collect() {
         if (!config.extended.tcpPeer) return
         if (!programManager.isProgramLoaded("tcp_peer")) return
-        podIpResolver.refresh()
+        podIpResolver.ensureWatching()
         collectConnections()
         collectRtt()
         topologyAggregator?.advanceWindow()
@@ -55,17 +56,16 @@ class TcpPeerCollector(
 
     private fun collectConnections() {
         val mapFd = programManager.getMapFd("tcp_peer", "tcp_peer_conns")
-        val entries = bridge.mapBatchLookupAndDelete(mapFd, CONN_KEY_SIZE, CONN_VALUE_SIZE, MAX_ENTRIES)
         val records = mutableListOf<ConnectionRecord>()
-        for ((keyBytes, valueBytes) in entries) {
-            val buf = ByteBuffer.wrap(keyBytes).order(ByteOrder.LITTLE_ENDIAN)
-            val cgroupId = buf.long
-            val remoteIp4 = buf.int
-            val remotePort = buf.short.toInt() and 0xFFFF
-            val direction = buf.get()
+        unresolvedConnections.drain(
+            bridge, mapFd, connKey.size, countValue.size, MAX_ENTRIES, { connKey.wrap(it).cgroupId }
+        ) { podInfo, keyBytes, valueBytes ->
+            connKey.wrap(keyBytes)
+            val remoteIp4 = connKey.remoteIp4.toInt()
+            val remotePort = connKey.remotePort
+            val direction = connKey.direction.toByte()
 
-            val podInfo = cgroupResolver.resolve(cgroupId) ?: continue
-            val count = ByteBuffer.wrap(valueBytes).order(ByteOrder.LITTLE_ENDIAN).long
+            val count = countValue.wrap(valueBytes).count
 
             val remoteIpStr = ipToString(remoteIp4)
             val peerInfo = podIpResolver.resolve(remoteIpStr)
@@ -135,26 +135,25 @@ class TcpPeerCollector(
 
     private fun collectRtt() {
         val mapFd = programManager.getMapFd("tcp_peer", "tcp_peer_rtt")
-        val entries = bridge.mapBatchLookupAndDelete(mapFd, RTT_KEY_SIZE, RTT_VALUE_SIZE, MAX_ENTRIES)
         val rttRecords = mutableListOf<RttRecord>()
-        for ((keyBytes, valueBytes) in entries) {
-            val buf = ByteBuffer.wrap(keyBytes).order(ByteOrder.LITTLE_ENDIAN)
-            val cgroupId = buf.long
-            val remoteIp4 = buf.int
-            val remotePort = buf.short.toInt() and 0xFFFF
+        unresolvedRtt.drain(
+            bridge, mapFd, rttKey.size, histValue.size, MAX_ENTRIES, { rttKey.wrap(it).cgroupId }
+        ) { podInfo, keyBytes, valueBytes ->
+            rttKey.wrap(keyBytes)
+            val remoteIp4 = rttKey.remoteIp4.toInt()
+            val remotePort = rttKey.remotePort
 
-            val podInfo = cgroupResolver.resolve(cgroupId) ?: continue
+            histValue.wrap(valueBytes)
+            val count = histValue.count
+            val sumUs = histValue.sumUs
 
-            val valBuf = ByteBuffer.wrap(valueBytes).order(ByteOrder.LITTLE_ENDIAN)
-            // Read 27 histogram slots
+            if (count <= 0 || sumUs <= 0) return@drain
+
+            // The histogram is retained by the topology aggregator, so it is copied out
             val histogram = LongArray(TopologyAggregator.RTT_HISTOGRAM_SLOTS)
             for (i in histogram.indices) {
-                histogram[i] = valBuf.long
+                histogram[i] = histValue.slots(i)
             }
-            val count = valBuf.long
-            val sumUs = valBuf.long
-
-            if (count <= 0 || sumUs <= 0) continue
 
             val remoteIpStr = ipToString(remoteIp4)
             val peerInfo = podIpResolver.resolve(remoteIpStr)
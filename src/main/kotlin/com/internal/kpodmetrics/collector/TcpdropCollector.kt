@@ -20,6 +20,7 @@ class TcpdropCollector(
     private val topologyAggregator: TopologyAggregator? = null
 ) {
     private val log = LoggerFactory.getLogger(TcpdropCollector::class.java)
+    private val unresolvedTcpDrops = UnresolvedBuffer<Pair<ByteArray, ByteArray>>(cgroupResolver)
 
     companion object {
         private const val MAX_ENTRIES = 10240
@@ -29,15 +30,12 @@ class TcpdropCollector(
         if (!config.extended.tcpdrop) return
 
         val mapFd = programManager.getMapFd("tcpdrop", "tcp_drops")
-        val entries = bridge.mapBatchLookupAndDelete(
-            mapFd, TcpdropMapReader.CgroupKeyLayout.SIZE,
-            TcpdropMapReader.CounterLayout.SIZE, MAX_ENTRIES
-        )
         val dropsByService = mutableMapOf<String, Long>()
-        entries.forEach { (keyBytes, valueBytes) ->
-            val cgroupId = TcpdropMapReader.CgroupKeyLayout.decodeCgroupId(keyBytes)
-            val podInfo = cgroupResolver.resolve(cgroupId) ?: return@forEach
-
+        unresolvedTcpDrops.drain(
+            bridge, mapFd, TcpdropMapReader.CgroupKeyLayout.SIZE,
+            TcpdropMapReader.CounterLayout.SIZE, MAX_ENTRIES,
+            { TcpdropMapReader.CgroupKeyLayout.decodeCgroupId(it) }
+        ) { podInfo, _, valueBytes ->
             val count = TcpdropMapReader.CounterLayout.decodeCount(valueBytes)
 
             val tags = Tags.of(
@@ -0,0 +1,87 @@
+package com.internal.kpodmetrics.collector
+
+import com.internal.kpodmetrics.bpf.BpfBridge
+import com.internal.kpodmetrics.bpf.CgroupResolver
+import com.internal.kpodmetrics.bpf.PodInfo
+
+/**
+ * Holds drained map entries whose cgroup id did not resolve for one more cycle.
+ *
+ * BPF maps are drained on read, so an entry from a container whose pod is not
+ * registered yet (right after agent start, while the pod list is still coming in,
+ * or a container that just started) would otherwise be lost. The next cycle
+ * [replay]s the held entries first: those that resolve now are emitted late rather
+ * than never, and the rest are dropped. Ids the resolver still knows as misses
+ * ([CgroupResolver.isKnownMiss]: no container was registered since they missed)
+ * cannot have become resolvable and are dropped without a lookup.
+ */
+class UnresolvedBuffer<T>(
+    private val cgroupResolver: CgroupResolver,
+    private val capacity: Int = DEFAULT_CAPACITY
+) {
+    private var ids = LongArray(0)
+    private val entries = ArrayList<T>()
+
+    companion object {
+        const val DEFAULT_CAPACITY = 4096
+    }
+
+    /** Keeps [entry] for the next [replay]; false if the buffer is full. */
+    @Synchronized
+    fun hold(cgroupId: Long, entry: T): Boolean {
+        if (entries.size >= capacity) return false
+        if (ids.size == entries.size) ids = ids.copyOf(maxOf(16, ids.size * 2).coerceAtMost(capacity))
+        ids[entries.size] = cgroupId
+        entries.add(entry)
+        return true
+    }
+
+    /** The pod of [cgroupId], or null after holding [entry] for the next replay. */
+    fun resolveOrHold(cgroupId: Long, entry: T): PodInfo? {
+        val podInfo = cgroupResolver.resolve(cgroupId)
+        if (podInfo == null) hold(cgroupId, entry)
+        return podInfo
+    }
+
+    /**
+     * Hands entries held since the last call to [handler] with their pod, then
+     * forgets them. Entries that still miss are passed with a null pod when
+     * [includeUnresolved] is set, and dropped otherwise.
+     */
+    @Synchronized
+    fun replay(includeUnresolved: Boolean = false, handler: (PodInfo?, T) -> Unit) =
+        forEachHeld { podInfo, entry -> if (podInfo != null || includeUnresolved) handler(podInfo, entry) }
+
+    /** [replay] for callers that only emit entries with a pod. */
+    @Synchronized
+    fun replayResolved(handler: (PodInfo, T) -> Unit) =
+        forEachHeld { podInfo, entry -> if (podInfo != null) handler(podInfo, entry) }
+
+    @Synchronized
+    fun size(): Int = entries.size
+
+    private inline fun forEachHeld(block: (PodInfo?, T) -> Unit) {
+        if (entries.isEmpty()) return
+        for (i in entries.indices) {
+            block(if (cgroupResolver.isKnownMiss(ids[i])) null else cgroupResolver.resolve(ids[i]), entries[i])
+        }
+        entries.clear()
+    }
+}
+
+/**
+ * Drains a map and hands each entry to [handler] with its pod, after the entries
+ * held from the previous drain that resolve now. Entries whose cgroup id does not
+ * resolve yet are held for the next call.
+ */
+fun UnresolvedBuffer<Pair<ByteArray, ByteArray>>.drain(
+    bridge: BpfBridge, mapFd: Int, keySize: Int, valueSize: Int, maxEntries: Int,
+    cgroupIdOf: (ByteArray) -> Long,
+    handler: (PodInfo, ByteArray, ByteArray) -> Unit
+) {
+    replayResolved { podInfo, (key, value) -> handler(podInfo, key, value) }
+    for (entry in bridge.mapBatchLookupAndDelete(mapFd, keySize, valueSize, maxEntries)) {
+        val podInfo = resolveOrHold(cgroupIdOf(entry.first), entry) ?: continue
+        handler(podInfo, entry.first, entry.second)
+    }
+}
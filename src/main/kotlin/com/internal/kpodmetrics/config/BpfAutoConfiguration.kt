@@ -3,8 +3,13 @@ package com.internal.kpodmetrics.config
 import com.internal.kpodmetrics.bpf.BpfBridge
 import com.internal.kpodmetrics.bpf.BpfProgramManager
 import com.internal.kpodmetrics.bpf.CgroupResolver
+import com.internal.kpodmetrics.bpf.NativeCallExecutor
+import com.internal.kpodmetrics.cgroup.CgroupIterStats
 import com.internal.kpodmetrics.cgroup.CgroupPathResolver
 import com.internal.kpodmetrics.cgroup.CgroupReader
+import com.internal.kpodmetrics.cgroup.CgroupTreeWatcher
+import com.internal.kpodmetrics.cgroup.NetnsInterfaceStats
+import com.internal.kpodmetrics.cgroup.StatfsPool
 import com.internal.kpodmetrics.collector.*
 import com.internal.kpodmetrics.profiling.ProfilingPipeline
 import com.internal.kpodmetrics.discovery.KubeletPodProvider
@@ -21,6 +26,7 @@ import com.internal.kpodmetrics.tracing.TracingConfigManager
 import com.internal.kpodmetrics.tracing.SpanCollector
 import com.internal.kpodmetrics.tracing.TracingEndpoint
 import com.internal.kpodmetrics.k8s.PodWatcher
+import com.internal.kpodmetrics.model.CgroupVersion
 import io.fabric8.kubernetes.client.KubernetesClient
 import io.fabric8.kubernetes.client.KubernetesClientBuilder
 import io.micrometer.core.instrument.MeterRegistry
@@ -48,6 +54,8 @@ class BpfAutoConfiguration(private val props: MetricsProperties) {
     private var metricsCollectorServiceInstance: MetricsCollectorService? = null
     private var kubeletPodProviderInstance: KubeletPodProvider? = null
     private var registryInstance: MeterRegistry? = null
+    private var pressureMonitorInstance: PressureMonitor? = null
+    private var cgroupReaderInstance: CgroupReader? = null
     @Volatile private var bpfCleanedUp = false
 
     @Bean
@@ -106,17 +114,27 @@ class BpfAutoConfiguration(private val props: MetricsProperties) {
     fun kubernetesClient(): KubernetesClient = KubernetesClientBuilder().build()
 
     @Bean
-    fun podWatcher(kubernetesClient: KubernetesClient, cgroupResolver: CgroupResolver, registry: MeterRegistry): PodWatcher {
-        val watcher = PodWatcher(kubernetesClient, cgroupResolver, props, registry)
+    fun podWatcher(
+        kubernetesClient: KubernetesClient,
+        cgroupResolver: CgroupResolver,
+        registry: MeterRegistry,
+        cgroupTree: Optional<CgroupTreeWatcher>
+    ): PodWatcher {
+        val watcher = PodWatcher(kubernetesClient, cgroupResolver, props, registry, cgroupTree.orElse(null))
         this.podWatcherInstance = watcher
         return watcher
     }
 
     @Bean
     @ConditionalOnProperty("kpod.bpf.enabled", havingValue = "true", matchIfMissing = true)
-    fun bpfBridge(): BpfBridge {
+    fun nativeCallExecutor(registry: MeterRegistry): NativeCallExecutor =
+        NativeCallExecutor(props.bpf.nativeThreads, props.bpf.nativeQueueCapacity, registry)
+
+    @Bean
+    @ConditionalOnProperty("kpod.bpf.enabled", havingValue = "true", matchIfMissing = true)
+    fun bpfBridge(nativeCallExecutor: NativeCallExecutor): BpfBridge {
         BpfBridge.loadLibrary()
-        return BpfBridge()
+        return BpfBridge(nativeCallExecutor)
     }
 
     @Bean
@@ -257,7 +275,7 @@ class BpfAutoConfiguration(private val props: MetricsProperties) {
 
     @Bean
     @ConditionalOnProperty("kpod.bpf.enabled", havingValue = "true", matchIfMissing = true)
-    fun podIpResolver(kubernetesClient: KubernetesClient) = PodIpResolver(kubernetesClient)
+    fun podIpResolver(kubernetesClient: KubernetesClient, registry: MeterRegistry) = PodIpResolver(kubernetesClient, registry)
 
     @Bean
     @ConditionalOnProperty("kpod.bpf.enabled", havingValue = "true", matchIfMissing = true)
@@ -337,10 +355,15 @@ class BpfAutoConfiguration(private val props: MetricsProperties) {
     }
 
     @Bean
-    fun podCgroupMapper(podProvider: PodProvider, resolver: CgroupPathResolver): PodCgroupMapper =
+    fun podCgroupMapper(
+        podProvider: PodProvider,
+        resolver: CgroupPathResolver,
+        cgroupTree: Optional<CgroupTreeWatcher>
+    ): PodCgroupMapper =
         PodCgroupMapper(
             podProvider, resolver, props.nodeName, props.filter.includeLabels,
-            props.filter.scrubLabelValues.map { it.toRegex(RegexOption.IGNORE_CASE) }
+            props.filter.scrubLabelValues.map { it.toRegex(RegexOption.IGNORE_CASE) },
+            cgroupTree.orElse(null)
         )
 
     // --- Cgroup-based collectors (conditionally created) ---
@@ -352,15 +375,22 @@ class BpfAutoConfiguration(private val props: MetricsProperties) {
     }
 
     @Bean
-    fun interfaceNetworkCollector(reader: CgroupReader, registry: MeterRegistry, config: ResolvedConfig): InterfaceNetworkCollector? {
+    fun interfaceNetworkCollector(
+        reader: CgroupReader,
+        registry: MeterRegistry,
+        config: ResolvedConfig,
+        bridge: BpfBridge?
+    ): InterfaceNetworkCollector? {
         if (!config.cgroup.interfaceNetwork) return null
-        return InterfaceNetworkCollector(reader, props.cgroup.procRoot, registry)
+        val procRoot = props.cgroup.procRoot
+        return InterfaceNetworkCollector(reader, procRoot, registry, NetnsInterfaceStats(procRoot, reader, bridge))
     }
 
     @Bean
     fun filesystemCollector(reader: CgroupReader, registry: MeterRegistry, config: ResolvedConfig): FilesystemCollector? {
         if (!config.cgroup.filesystem) return null
-        return FilesystemCollector(reader, props.cgroup.procRoot, registry)
+        val statfs = StatfsPool(props.cgroup.statfsThreads, props.cgroup.statfsTimeoutMs, registry)
+        return FilesystemCollector(reader, props.cgroup.procRoot, registry, statfs)
     }
 
     @Bean
@@ -371,6 +401,40 @@ class BpfAutoConfiguration(private val props: MetricsProperties) {
 
     // --- Aggregated service ---
 
+    @Bean
+    @ConditionalOnProperty("kpod.bpf.enabled", havingValue = "true", matchIfMissing = true)
+    fun collectionScheduler(): CollectionScheduler? {
+        val sched = props.scheduler
+        if (!sched.adaptive) return null
+        // Offsets must leave room for the collectors themselves inside the cycle timeout
+        val window = sched.spreadWindow.coerceAtMost(props.collectionTimeout / 2)
+        log.info("Adaptive collection scheduler enabled (spreadWindow={}ms, slots={}, cpuBudget={})",
+            window, sched.spreadSlots, sched.cpuBudget)
+        return CollectionScheduler(
+            spreadWindowMs = window,
+            spreadSlots = sched.spreadSlots,
+            cpuBudget = sched.cpuBudget,
+            maxStretchFactor = sched.maxStretchFactor
+        )
+    }
+
+    @Bean
+    @ConditionalOnProperty("kpod.bpf.enabled", havingValue = "true", matchIfMissing = true)
+    fun collectorCostTracker(registry: MeterRegistry) = CollectorCostTracker(registry)
+
+    @Bean
+    @ConditionalOnProperty("kpod.bpf.enabled", havingValue = "true", matchIfMissing = true)
+    fun pressureMonitor(bridge: BpfBridge, registry: MeterRegistry): PressureMonitor? {
+        val pressure = props.pressure
+        if (!pressure.enabled) return null
+        val monitor = PressureMonitor(bridge, registry, pressure.trigger, pressure.resources, pressure.recentEvents)
+        if (monitor.start()) {
+            log.info("PSI pressure triggers enabled ({}) for {}", pressure.trigger, pressure.resources)
+        }
+        this.pressureMonitorInstance = monitor
+        return monitor
+    }
+
     @Bean
     @ConditionalOnProperty("kpod.bpf.enabled", havingValue = "true", matchIfMissing = true)
     fun metricsCollectorService(
@@ -401,9 +465,14 @@ class BpfAutoConfiguration(private val props: MetricsProperties) {
         bpfMapStatsCollector: BpfMapStatsCollector,
         bpfOverheadCollector: BpfOverheadCollector,
         registry: MeterRegistry,
-        profilingPipeline: Optional<ProfilingPipeline>
+        profilingPipeline: Optional<ProfilingPipeline>,
+        collectionScheduler: Optional<CollectionScheduler>,
+        collectorCostTracker: CollectorCostTracker,
+        pressureMonitor: Optional<PressureMonitor>,
+        cgroupReader: CgroupReader
     ): MetricsCollectorService {
         this.registryInstance = registry
+        this.cgroupReaderInstance = cgroupReader
         val service = MetricsCollectorService(
             cpuCollector, netCollector, syscallCollector,
             biolatencyCollector, cachestatCollector,
@@ -424,7 +493,11 @@ class BpfAutoConfiguration(private val props: MetricsProperties) {
             props.collectorIntervals,
             props.pollInterval,
             props.startupJitter,
-            profilingPipeline.orElse(null)
+            profilingPipeline.orElse(null),
+            collectionScheduler.orElse(null),
+            if (props.consistentSnapshot) SnapshotCoordinator(bridge, registry) else null,
+            collectorCostTracker,
+            pressureMonitor.orElse(null)
         )
         this.metricsCollectorServiceInstance = service
         return service
@@ -454,8 +527,14 @@ class BpfAutoConfiguration(private val props: MetricsProperties) {
         service: MetricsCollectorService,
         manager: Optional<BpfProgramManager>,
         config: ResolvedConfig,
-        registry: MeterRegistry
-    ) = DiagnosticsEndpoint(service, manager.orElse(null), config, registry)
+        registry: MeterRegistry,
+        collectionScheduler: Optional<CollectionScheduler>,
+        collectorCostTracker: Optional<CollectorCostTracker>,
+        pressureMonitor: Optional<PressureMonitor>
+    ) = DiagnosticsEndpoint(service, manager.orElse(null), config, registry,
+        scheduler = collectionScheduler.orElse(null),
+        costTracker = collectorCostTracker.orElse(null),
+        pressureMonitor = pressureMonitor.orElse(null))
 
     // --- Tracing ---
 
@@ -565,6 +644,8 @@ class BpfAutoConfiguration(private val props: MetricsProperties) {
                     it.configureMongoPorts(resolvedCfg.extended.mongoPorts)
                 }
 
+                cgroupReaderInstance?.let { reader -> attachCgroupIterator(it, reader) }
+
                 if (props.profiling.enabled && props.profiling.cpu.enabled) {
                     try {
                         it.loadCpuProfile(props.profiling.cpu.frequency)
@@ -576,6 +657,16 @@ class BpfAutoConfiguration(private val props: MetricsProperties) {
                 log.warn("BPF program loading failed (kernel may not support tracing); cgroup collectors will still run: {}", e.message)
             }
         }
+        val burst = props.pressure.burst
+        if (burst.enabled) {
+            pressureMonitorInstance?.let { monitor ->
+                metricsCollectorServiceInstance?.let { service ->
+                    monitor.setOnPressureCallback { event ->
+                        service.requestBurst(burst.collectors, burst.durationMs, burst.intervalMs, event)
+                    }
+                }
+            }
+        }
         podWatcherInstance?.let { watcher ->
             metricsCollectorServiceInstance?.let { service ->
                 watcher.setOnPodDeletedCallback { cgroupId ->
@@ -600,6 +691,16 @@ class BpfAutoConfiguration(private val props: MetricsProperties) {
         }
     }
 
+    private fun attachCgroupIterator(manager: BpfProgramManager, reader: CgroupReader) {
+        if (!props.cgroup.iterator || reader.version != CgroupVersion.V2) return
+        val root = CgroupTreeWatcher.kubepodsRoots(props.cgroup.root, reader.version)
+            .firstOrNull { java.nio.file.Files.isDirectory(it) } ?: return
+        val linkFd = manager.loadCgroupStatsIter(root.toString())
+        if (linkFd >= 0) {
+            reader.setIterStats(CgroupIterStats(manager.bridge, linkFd, registryInstance))
+        }
+    }
+
     @PreDestroy
     fun onShutdown() {
         podWatcherInstance?.stop()
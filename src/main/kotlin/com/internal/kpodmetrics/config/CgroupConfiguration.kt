@@ -3,6 +3,7 @@ package com.internal.kpodmetrics.config
 import com.internal.kpodmetrics.bpf.CgroupResolver
 import com.internal.kpodmetrics.cgroup.CgroupPathResolver
 import com.internal.kpodmetrics.cgroup.CgroupReader
+import com.internal.kpodmetrics.cgroup.CgroupTreeWatcher
 import com.internal.kpodmetrics.cgroup.CgroupVersionDetector
 import org.springframework.boot.context.properties.EnableConfigurationProperties
 import org.springframework.context.annotation.Bean
@@ -25,4 +26,10 @@ class CgroupConfiguration(private val props: MetricsProperties) {
     @Bean
     fun cgroupPathResolver(detector: CgroupVersionDetector): CgroupPathResolver =
         CgroupPathResolver(props.cgroup.root, detector.detect())
+
+    @Bean
+    fun cgroupTreeWatcher(detector: CgroupVersionDetector): CgroupTreeWatcher? {
+        if (!props.cgroup.watch) return null
+        return CgroupTreeWatcher(props.cgroup.root, detector.detect()).also { it.start() }
+    }
 }
@@ -7,6 +7,7 @@ data class MetricsProperties(
     val profile: String = "standard",
     val pollInterval: Long = 29000,
     val collectionTimeout: Long = 20000,
+    val consistentSnapshot: Boolean = true,
     val initialDelay: Long = 10000,
     val startupJitter: Long = 5000,
     val nodeName: String = "unknown",
@@ -18,6 +19,7 @@ data class MetricsProperties(
     val extended: ExtendedProperties = ExtendedProperties(),
     val collectors: CollectorOverrides = CollectorOverrides(),
     val collectorIntervals: CollectorIntervals = CollectorIntervals(),
+    val scheduler: CollectionSchedulerProperties = CollectionSchedulerProperties(),
     val filter: FilterProperties = FilterProperties(),
     val bpf: BpfProperties = BpfProperties(),
     val discovery: DiscoveryProperties = DiscoveryProperties(),
@@ -25,7 +27,9 @@ data class MetricsProperties(
     val otlp: OtlpProperties = OtlpProperties(),
     val profiling: ProfilingProperties = ProfilingProperties(),
     val tracing: TracingProperties = TracingProperties(),
-    val topology: TopologyProperties = TopologyProperties()
+    val topology: TopologyProperties = TopologyProperties(),
+    val selfProfiling: SelfProfilingProperties = SelfProfilingProperties(),
+    val pressure: PressureProperties = PressureProperties()
 ) {
     fun resolveProfile(override: String? = null): ResolvedConfig {
         return when (override ?: profile) {
@@ -128,7 +132,9 @@ data class FilterProperties(
 
 data class BpfProperties(
     val enabled: Boolean = true,
-    val programDir: String = "/app/bpf"
+    val programDir: String = "/app/bpf",
+    val nativeThreads: Int = 2,
+    val nativeQueueCapacity: Int = 64
 )
 
 data class DiscoveryProperties(
@@ -139,7 +145,11 @@ data class DiscoveryProperties(
 
 data class CgroupProperties(
     val root: String = "/host/sys/fs/cgroup",
-    val procRoot: String = "/host/proc"
+    val procRoot: String = "/host/proc",
+    val watch: Boolean = true,
+    val iterator: Boolean = true,
+    val statfsThreads: Int = 4,
+    val statfsTimeoutMs: Long = 2000
 )
 
 data class OtlpProperties(
@@ -161,6 +171,29 @@ data class TopologyProperties(
     val demoData: Boolean = false
 )
 
+data class SelfProfilingProperties(
+    val enabled: Boolean = false,
+    val authToken: String = "",
+    val defaultDurationSeconds: Long = 30,
+    val maxDurationSeconds: Long = 300,
+    val maxSizeMb: Long = 64
+)
+
+data class PressureProperties(
+    val enabled: Boolean = false,
+    val trigger: String = "some 150000 1000000",
+    val resources: List<String> = listOf("cpu", "memory", "io"),
+    val recentEvents: Int = 256,
+    val burst: PressureBurstProperties = PressureBurstProperties()
+)
+
+data class PressureBurstProperties(
+    val enabled: Boolean = false,
+    val collectors: List<String> = listOf("cpu", "syscall", "biolatency"),
+    val durationMs: Long = 5000,
+    val intervalMs: Long = 500
+)
+
 data class TracingProperties(
     val enabled: Boolean = false,
     val http: ProtocolTracingConfig = ProtocolTracingConfig(thresholdMs = 200),
@@ -224,6 +257,14 @@ data class CollectorIntervals(
     val memory: Long? = null
 )
 
+data class CollectionSchedulerProperties(
+    val adaptive: Boolean = false,
+    val spreadWindow: Long = 10000,
+    val spreadSlots: Int = 4,
+    val cpuBudget: Double = 0.8,
+    val maxStretchFactor: Int = 4
+)
+
 data class ProfilingProperties(
     val enabled: Boolean = false,
     val cpu: CpuProfilingProperties = CpuProfilingProperties(),
@@ -0,0 +1,42 @@
+package com.internal.kpodmetrics.config
+
+import com.internal.kpodmetrics.jfr.SelfProfileAuthFilter
+import com.internal.kpodmetrics.jfr.SelfProfileEndpoint
+import com.internal.kpodmetrics.jfr.SelfProfiler
+import org.springframework.boot.autoconfigure.condition.ConditionalOnProperty
+import org.springframework.boot.context.properties.EnableConfigurationProperties
+import org.springframework.boot.web.servlet.FilterRegistrationBean
+import org.springframework.context.annotation.Bean
+import org.springframework.context.annotation.Configuration
+import org.springframework.core.env.Environment
+import java.time.Duration
+
+@Configuration
+@EnableConfigurationProperties(MetricsProperties::class)
+@ConditionalOnProperty("kpod.self-profiling.enabled", havingValue = "true")
+class SelfProfilingConfiguration(private val props: MetricsProperties) {
+
+    @Bean
+    fun selfProfiler() = SelfProfiler(
+        maxDuration = Duration.ofSeconds(props.selfProfiling.maxDurationSeconds),
+        maxSizeBytes = props.selfProfiling.maxSizeMb * 1024 * 1024
+    )
+
+    @Bean
+    fun selfProfileEndpoint(profiler: SelfProfiler) =
+        SelfProfileEndpoint(profiler, Duration.ofSeconds(props.selfProfiling.defaultDurationSeconds))
+
+    @Bean
+    fun selfProfileAuthFilter(env: Environment): FilterRegistrationBean<SelfProfileAuthFilter> {
+        // The filter guards the application servlet context only; a separate
+        // management port would serve the endpoint without it.
+        val managementPort = env.getProperty("management.server.port")
+        check(managementPort == null || managementPort == env.getProperty("server.port", "8080")) {
+            "kpod.self-profiling requires the actuator on the application port"
+        }
+        val basePath = env.getProperty("management.endpoints.web.base-path", "/actuator").trimEnd('/')
+        return FilterRegistrationBean(SelfProfileAuthFilter(props.selfProfiling.authToken)).apply {
+            addUrlPatterns("$basePath/kpodProfile", "$basePath/kpodProfile/*")
+        }
+    }
+}
@@ -0,0 +1,209 @@
+package com.internal.kpodmetrics.discovery
+
+import com.fasterxml.jackson.core.JsonFactory
+import com.fasterxml.jackson.core.JsonParser
+import com.fasterxml.jackson.core.JsonToken
+import com.internal.kpodmetrics.model.ContainerInfo
+import com.internal.kpodmetrics.model.DiscoveredPod
+import com.internal.kpodmetrics.model.QosClass
+import java.io.IOException
+import java.io.InputStream
+
+/**
+ * Streaming parser for the kubelet `/pods` response. Reads tokens straight from the
+ * response stream and keeps only the fields the agent uses (uid, name, namespace,
+ * labels, QoS class, phase, container names, ids and restart counts); everything
+ * else, including the pod specs that make up most of the document, is skipped
+ * without being materialized.
+ *
+ * Pods are diffed against the previous parse. Metadata is diffed by resourceVersion:
+ * a pod whose version is unchanged keeps its previous labels, which are skipped.
+ * The status is always read, because the kubelet overlays its own view (phase,
+ * container ids, restart counts) without a new resourceVersion; a pod whose version
+ * and status fields are both unchanged reuses its previous [DiscoveredPod]. [parse]
+ * returns null when no pod changed, appeared or went away, so an unchanged poll
+ * allocates only the few status strings.
+ *
+ * Pods that have finished (phase Succeeded or Failed) have no running containers
+ * and are left out. Not thread-safe.
+ */
+class KubeletPodListParser {
+    private class Entry(
+        val resourceVersion: String?,
+        val phase: String?,
+        val qosClass: String?,
+        val containers: List<ContainerInfo>?,
+        val pod: DiscoveredPod?
+    )
+
+    /** Fields of the item being parsed, reused across items. */
+    private class Item {
+        var uid: String? = null
+        var name: String? = null
+        var namespace: String? = null
+        var resourceVersion: String? = null
+        var labels: Map<String, String>? = null
+        var qosClass: String? = null
+        var phase: String? = null
+        var containers: List<ContainerInfo>? = null
+
+        fun reset() {
+            uid = null
+            name = null
+            namespace = null
+            resourceVersion = null
+            labels = null
+            qosClass = null
+            phase = null
+            containers = null
+        }
+    }
+
+    private var previous: Map<String, Entry>? = null
+    private val item = Item()
+
+    companion object {
+        private val factory = JsonFactory()
+    }
+
+    /** Pods by uid, or null if they are the same as on the previous call. */
+    fun parse(input: InputStream): Map<String, DiscoveredPod>? {
+        val last = previous
+        val next = HashMap<String, Entry>(last?.size?.coerceAtLeast(16) ?: 16)
+        var changed = last == null
+        factory.createParser(input).use { p ->
+            if (p.nextToken() != JsonToken.START_OBJECT) throw IOException("Kubelet /pods response is not an object")
+            while (p.nextToken() == JsonToken.FIELD_NAME) {
+                val field = p.currentName()
+                if (p.nextToken() == JsonToken.START_ARRAY && field == "items") {
+                    while (p.nextToken() == JsonToken.START_OBJECT) {
+                        if (parseItem(p, last, next)) changed = true
+                    }
+                } else {
+                    p.skipChildren()
+                }
+            }
+        }
+        if (!changed && (next.size != last!!.size || !last.keys.containsAll(next.keys))) changed = true
+        previous = next
+        if (!changed) return null
+        val pods = HashMap<String, DiscoveredPod>(next.size)
+        for ((uid, entry) in next) entry.pod?.let { pods[uid] = it }
+        return pods
+    }
+
+    /** Parses one item into [next]; true unless it was reused from [last]. */
+    private fun parseItem(p: JsonParser, last: Map<String, Entry>?, next: HashMap<String, Entry>): Boolean {
+        val cur = item
+        cur.reset()
+        while (p.nextToken() == JsonToken.FIELD_NAME) {
+            val field = p.currentName()
+            val token = p.nextToken()
+            when {
+                field == "metadata" && token == JsonToken.START_OBJECT -> parseMetadata(p, last)
+                field == "status" && token == JsonToken.START_OBJECT -> parseStatus(p)
+                else -> p.skipChildren()
+            }
+        }
+        // Items without a uid cannot be tracked or diffed
+        val uid = cur.uid ?: return false
+        val known = last?.get(uid)
+        if (known != null && cur.resourceVersion != null && known.resourceVersion == cur.resourceVersion &&
+            known.phase == cur.phase && known.qosClass == cur.qosClass && known.containers == cur.containers
+        ) {
+            next[uid] = known
+            return false
+        }
+        next[uid] = Entry(cur.resourceVersion, cur.phase, cur.qosClass, cur.containers, toPod(uid, last))
+        return true
+    }
+
+    private fun parseMetadata(p: JsonParser, last: Map<String, Entry>?) {
+        val cur = item
+        while (p.nextToken() == JsonToken.FIELD_NAME) {
+            val field = p.currentName()
+            val token = p.nextToken()
+            when (field) {
+                "uid" -> cur.uid = textOf(p)
+                "name" -> cur.name = textOf(p)
+                "namespace" -> cur.namespace = textOf(p)
+                "resourceVersion" -> cur.resourceVersion = textOf(p)
+                "labels" -> {
+                    // resourceVersion precedes labels in the kubelet's output
+                    val uid = cur.uid
+                    val rv = cur.resourceVersion
+                    val unchanged = uid != null && rv != null && last?.get(uid)?.resourceVersion == rv
+                    if (token == JsonToken.START_OBJECT && !unchanged) cur.labels = parseStringMap(p) else p.skipChildren()
+                }
+                else -> p.skipChildren()
+            }
+        }
+    }
+
+    private fun parseStatus(p: JsonParser) {
+        val cur = item
+        while (p.nextToken() == JsonToken.FIELD_NAME) {
+            val field = p.currentName()
+            val token = p.nextToken()
+            when {
+                field == "qosClass" -> cur.qosClass = textOf(p)
+                field == "phase" -> cur.phase = textOf(p)
+                field == "containerStatuses" && token == JsonToken.START_ARRAY -> cur.containers = parseContainers(p)
+                else -> p.skipChildren()
+            }
+        }
+    }
+
+    private fun parseContainers(p: JsonParser): List<ContainerInfo> {
+        val containers = ArrayList<ContainerInfo>(2)
+        while (p.nextToken() == JsonToken.START_OBJECT) {
+            var name: String? = null
+            var containerId: String? = null
+            var restartCount = 0
+            while (p.nextToken() == JsonToken.FIELD_NAME) {
+                val field = p.currentName()
+                val token = p.nextToken()
+                when {
+                    field == "name" -> name = textOf(p)
+                    field == "containerID" -> containerId = textOf(p)
+                    field == "restartCount" && token == JsonToken.VALUE_NUMBER_INT -> restartCount = p.intValue
+                    else -> p.skipChildren()
+                }
+            }
+            if (name != null && containerId != null) {
+                containers.add(ContainerInfo(name, containerId.substringAfter("://"), restartCount))
+            }
+        }
+        return containers
+    }
+
+    private fun parseStringMap(p: JsonParser): Map<String, String> {
+        val map = HashMap<String, String>()
+        while (p.nextToken() == JsonToken.FIELD_NAME) {
+            val key = p.currentName()
+            p.nextToken()
+            textOf(p)?.let { map[key] = it }
+        }
+        return map
+    }
+
+    private fun textOf(p: JsonParser): String? =
+        if (p.currentToken() == JsonToken.VALUE_STRING) p.text else {
+            p.skipChildren()
+            null
+        }
+
+    private fun toPod(uid: String, last: Map<String, Entry>?): DiscoveredPod? {
+        val cur = item
+        val name = cur.name ?: return null
+        if (cur.phase == "Succeeded" || cur.phase == "Failed") return null
+        val qosClass = when (cur.qosClass) {
+            "Guaranteed" -> QosClass.GUARANTEED
+            "BestEffort" -> QosClass.BEST_EFFORT
+            else -> QosClass.BURSTABLE
+        }
+        // Labels skipped because the version was unchanged are still current
+        val labels = cur.labels ?: last?.get(uid)?.pod?.labels ?: emptyMap()
+        return DiscoveredPod(uid, name, cur.namespace ?: "default", qosClass, cur.containers ?: emptyList(), labels)
+    }
+}
@@ -1,11 +1,6 @@
 package com.internal.kpodmetrics.discovery
 
-import com.fasterxml.jackson.annotation.JsonIgnoreProperties
-import com.fasterxml.jackson.module.kotlin.jacksonObjectMapper
-import com.fasterxml.jackson.module.kotlin.readValue
-import com.internal.kpodmetrics.model.ContainerInfo
 import com.internal.kpodmetrics.model.DiscoveredPod
-import com.internal.kpodmetrics.model.QosClass
 import org.slf4j.LoggerFactory
 import java.net.URI
 import java.net.http.HttpClient
@@ -31,6 +26,7 @@ class KubeletPodProvider(
     private val pods = ConcurrentHashMap<String, DiscoveredPod>()
     private var scheduler: ScheduledExecutorService? = null
     private val httpClient: HttpClient = buildInsecureClient()
+    private val parser = KubeletPodListParser()
 
     override fun getDiscoveredPods(): Map<String, DiscoveredPod> =
         java.util.Collections.unmodifiableMap(HashMap(pods))
@@ -62,13 +58,19 @@ class KubeletPodProvider(
             if (token.isNotBlank()) {
                 requestBuilder.header("Authorization", "Bearer $token")
             }
-            val response = httpClient.send(requestBuilder.build(), HttpResponse.BodyHandlers.ofString())
-            if (response.statusCode() != 200) {
-                log.warn("Kubelet /pods returned {}", response.statusCode())
-                return
+            val response = httpClient.send(requestBuilder.build(), HttpResponse.BodyHandlers.ofInputStream())
+            response.body().use { body ->
+                if (response.statusCode() != 200) {
+                    log.warn("Kubelet /pods returned {}", response.statusCode())
+                    return
+                }
+                val parsed = parser.parse(body)
+                if (parsed == null) {
+                    log.debug("Kubelet /pods unchanged")
+                    return
+                }
+                reconcile(parsed)
             }
-            val parsed = parsePodListJson(response.body())
-            reconcile(parsed)
         } catch (e: Exception) {
             log.error("Failed to poll kubelet /pods: {}", e.message, e)
         }
@@ -100,43 +102,7 @@ class KubeletPodProvider(
     }
 
     companion object {
-        private val mapper = jacksonObjectMapper()
-
-        fun parsePodListJson(json: String): Map<String, DiscoveredPod> {
-            val podList = mapper.readValue<KubeletPodList>(json)
-            val result = mutableMapOf<String, DiscoveredPod>()
-            for (item in podList.items) {
-                val uid = item.metadata?.uid ?: continue
-                val name = item.metadata.name ?: continue
-                val namespace = item.metadata.namespace ?: "default"
-                val qosClass = when (item.status?.qosClass) {
-                    "Guaranteed" -> QosClass.GUARANTEED
-                    "BestEffort" -> QosClass.BEST_EFFORT
-                    else -> QosClass.BURSTABLE
-                }
-                val containers = (item.status?.containerStatuses ?: emptyList()).mapNotNull { cs ->
-                    val cName = cs.name ?: return@mapNotNull null
-                    val rawId = cs.containerID ?: return@mapNotNull null
-                    ContainerInfo(cName, rawId.substringAfter("://"), cs.restartCount ?: 0)
-                }
-                result[uid] = DiscoveredPod(uid, name, namespace, qosClass, containers, item.metadata.labels ?: emptyMap())
-            }
-            return result
-        }
+        fun parsePodListJson(json: String): Map<String, DiscoveredPod> =
+            KubeletPodListParser().parse(json.byteInputStream()) ?: emptyMap()
     }
 }
-
-@JsonIgnoreProperties(ignoreUnknown = true)
-data class KubeletPodList(val items: List<KubeletPod> = emptyList())
-
-@JsonIgnoreProperties(ignoreUnknown = true)
-data class KubeletPod(val metadata: KubeletPodMeta? = null, val status: KubeletPodStatus? = null)
-
-@JsonIgnoreProperties(ignoreUnknown = true)
-data class KubeletPodMeta(val uid: String? = null, val name: String? = null, val namespace: String? = null, val labels: Map<String, String>? = null)
-
-@JsonIgnoreProperties(ignoreUnknown = true)
-data class KubeletPodStatus(val qosClass: String? = null, val containerStatuses: List<KubeletContainerStatus>? = null)
-
-@JsonIgnoreProperties(ignoreUnknown = true)
-data class KubeletContainerStatus(val name: String? = null, val containerID: String? = null, val restartCount: Int? = null)
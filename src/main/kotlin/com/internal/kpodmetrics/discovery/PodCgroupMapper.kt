@@ -1,6 +1,9 @@
 package com.internal.kpodmetrics.discovery
 
 import com.internal.kpodmetrics.cgroup.CgroupPathResolver
+import com.internal.kpodmetrics.cgroup.CgroupTreeWatcher
+import com.internal.kpodmetrics.cgroup.ContainerCgroup
+import com.internal.kpodmetrics.model.DiscoveredPod
 import com.internal.kpodmetrics.model.PodCgroupTarget
 import org.slf4j.LoggerFactory
 
@@ -9,7 +12,8 @@ class PodCgroupMapper(
     private val pathResolver: CgroupPathResolver,
     private val nodeName: String,
     private val includeLabels: List<String> = emptyList(),
-    private val scrubLabelValues: List<Regex> = emptyList()
+    private val scrubLabelValues: List<Regex> = emptyList(),
+    private val cgroupTree: CgroupTreeWatcher? = null
 ) {
     private val log = LoggerFactory.getLogger(PodCgroupMapper::class.java)
 
@@ -20,8 +24,7 @@ class PodCgroupMapper(
     fun resolve(): List<PodCgroupTarget> {
         val targets = mutableListOf<PodCgroupTarget>()
         for ((_, pod) in podProvider.getDiscoveredPods()) {
-            val podPath = pathResolver.resolvePodPath(pod.uid, pod.qosClass) ?: continue
-            val containerCgroups = pathResolver.listContainerPaths(podPath)
+            val containerCgroups = containerCgroups(pod) ?: continue
             val filteredLabels = if (includeLabels.isEmpty()) emptyMap()
                 else pod.labels.filterKeys { it in includeLabels }
             val scrubbedLabels = scrubLabels(filteredLabels)
@@ -45,6 +48,21 @@ class PodCgroupMapper(
         return targets
     }
 
+    /**
+     * From the watched cgroup tree when it is live, otherwise by resolving and listing the
+     * pod directory. The tree can miss a pod whose directory could not be watched, so a pod
+     * it has no containers for is listed too.
+     */
+    private fun containerCgroups(pod: DiscoveredPod): List<ContainerCgroup>? {
+        val tree = cgroupTree
+        if (tree != null && tree.ready) {
+            val fromTree = tree.containers(pod.uid)
+            if (fromTree.isNotEmpty()) return fromTree
+        }
+        val podPath = pathResolver.resolvePodPath(pod.uid, pod.qosClass) ?: return null
+        return pathResolver.listContainerPaths(podPath)
+    }
+
     private fun scrubLabels(labels: Map<String, String>): Map<String, String> {
         if (scrubLabelValues.isEmpty()) return labels
         return labels.mapValues { (key, value) ->
@@ -1,7 +1,10 @@
 package com.internal.kpodmetrics.health
 
 import com.internal.kpodmetrics.bpf.BpfProgramManager
+import com.internal.kpodmetrics.collector.CollectionScheduler
+import com.internal.kpodmetrics.collector.CollectorCostTracker
 import com.internal.kpodmetrics.collector.MetricsCollectorService
+import com.internal.kpodmetrics.collector.PressureMonitor
 import com.internal.kpodmetrics.config.ResolvedConfig
 import io.micrometer.core.instrument.MeterRegistry
 import org.springframework.boot.actuate.endpoint.annotation.Endpoint
@@ -15,7 +18,10 @@ class DiagnosticsEndpoint(
     private val programManager: BpfProgramManager?,
     private val config: ResolvedConfig,
     private val registry: MeterRegistry? = null,
-    private val startTime: Instant = Instant.now()
+    private val startTime: Instant = Instant.now(),
+    private val scheduler: CollectionScheduler? = null,
+    private val costTracker: CollectorCostTracker? = null,
+    private val pressureMonitor: PressureMonitor? = null
 ) {
 
     companion object {
@@ -50,6 +56,9 @@ class DiagnosticsEndpoint(
             "metricHealth" to metricHealth(),
             "monitoredPods" to monitoredPodCount(),
             "overhead" to overhead(),
+            "scheduler" to (scheduler?.snapshot() ?: mapOf("enabled" to false)),
+            "collectorCost" to (costTracker?.snapshot() ?: mapOf("available" to false)),
+            "pressure" to (pressureMonitor?.snapshot() ?: mapOf("enabled" to false)),
             "recommendations" to recommendations()
         )
     }
@@ -0,0 +1,73 @@
+package com.internal.kpodmetrics.jfr
+
+import jdk.jfr.Category
+import jdk.jfr.DataAmount
+import jdk.jfr.Event
+import jdk.jfr.Label
+import jdk.jfr.Name
+import jdk.jfr.StackTrace
+
+/*
+ * Custom JFR events around the agent's own units of work. They cost a branch
+ * when no recording enables them, and are what a [SelfProfiler] session uses to
+ * attribute time to collectors, drains and the profiling pipeline.
+ */
+
+@Name("kpod.CollectorRun")
+@Label("Collector Run")
+@Category("kpod")
+@StackTrace(false)
+class CollectorRunEvent : Event() {
+    @Label("Collector")
+    @JvmField var collector: String = ""
+
+    @Label("Failed")
+    @JvmField var failed: Boolean = false
+}
+
+@Name("kpod.MapDrain")
+@Label("BPF Map Drain")
+@Category("kpod", "BPF")
+@StackTrace(false)
+class MapDrainEvent : Event() {
+    @Label("Map FD")
+    @JvmField var mapFd: Int = 0
+
+    @Label("Mode")
+    @JvmField var mode: String = ""
+
+    @Label("Entries")
+    @JvmField var entries: Int = 0
+}
+
+@Name("kpod.PprofBuild")
+@Label("pprof Build")
+@Category("kpod", "Profiling")
+@StackTrace(false)
+class PprofBuildEvent : Event() {
+    @Label("Pod")
+    @JvmField var pod: String = ""
+
+    @Label("Samples")
+    @JvmField var samples: Int = 0
+
+    @Label("Size")
+    @DataAmount
+    @JvmField var bytes: Long = 0
+}
+
+@Name("kpod.PyroscopePush")
+@Label("Pyroscope Push")
+@Category("kpod", "Profiling")
+@StackTrace(false)
+class PyroscopePushEvent : Event() {
+    @Label("Application")
+    @JvmField var app: String = ""
+
+    @Label("Size")
+    @DataAmount
+    @JvmField var bytes: Long = 0
+
+    @Label("HTTP Status")
+    @JvmField var status: Int = 0
+}
@@ -0,0 +1,35 @@
+package com.internal.kpodmetrics.jfr
+
+import jakarta.servlet.FilterChain
+import jakarta.servlet.http.HttpServletRequest
+import jakarta.servlet.http.HttpServletResponse
+import org.springframework.web.filter.OncePerRequestFilter
+import java.security.MessageDigest
+
+/**
+ * Bearer-token guard for [SelfProfileEndpoint]; registered only on the endpoint's
+ * paths. Tokens are compared in constant time.
+ */
+class SelfProfileAuthFilter(token: String) : OncePerRequestFilter() {
+    private val expected = token.toByteArray(Charsets.UTF_8)
+
+    init {
+        require(token.isNotBlank()) { "Self-profiling auth token must not be blank" }
+    }
+
+    override fun doFilterInternal(request: HttpServletRequest, response: HttpServletResponse, chain: FilterChain) {
+        val header = request.getHeader("Authorization")
+        val presented = header?.takeIf { it.startsWith(PREFIX, ignoreCase = true) }
+            ?.substring(PREFIX.length)?.trim()
+        if (presented == null || !MessageDigest.isEqual(expected, presented.toByteArray(Charsets.UTF_8))) {
+            response.setHeader("WWW-Authenticate", "Bearer")
+            response.sendError(HttpServletResponse.SC_UNAUTHORIZED)
+            return
+        }
+        chain.doFilter(request, response)
+    }
+
+    companion object {
+        private const val PREFIX = "Bearer "
+    }
+}
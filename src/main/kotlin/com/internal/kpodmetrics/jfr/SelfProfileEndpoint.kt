@@ -0,0 +1,74 @@
+package com.internal.kpodmetrics.jfr
+
+import org.springframework.boot.actuate.endpoint.annotation.DeleteOperation
+import org.springframework.boot.actuate.endpoint.annotation.ReadOperation
+import org.springframework.boot.actuate.endpoint.annotation.Selector
+import org.springframework.boot.actuate.endpoint.annotation.WriteOperation
+import org.springframework.boot.actuate.endpoint.web.WebEndpointResponse
+import org.springframework.boot.actuate.endpoint.web.annotation.WebEndpoint
+import org.springframework.core.io.FileSystemResource
+import org.springframework.core.io.Resource
+import org.springframework.lang.Nullable
+import java.io.FilterInputStream
+import java.io.InputStream
+import java.time.Duration
+
+/**
+ * On-demand JFR self-profiling of the agent. Every request must carry the bearer
+ * token checked by [SelfProfileAuthFilter].
+ * - GET    /actuator/kpodProfile        — session status and hot-method summary (`top`)
+ * - POST   /actuator/kpodProfile        — start a session (`durationSeconds`)
+ * - DELETE /actuator/kpodProfile        — stop the running session
+ * - GET    /actuator/kpodProfile/jfr    — download the recording
+ */
+@WebEndpoint(id = "kpodProfile")
+class SelfProfileEndpoint(
+    private val profiler: SelfProfiler,
+    private val defaultDuration: Duration = Duration.ofSeconds(30)
+) {
+
+    @ReadOperation
+    fun read(@Nullable top: Int?): Map<String, Any?> = mapOf(
+        "status" to profiler.status(),
+        "summary" to profiler.summary(top ?: 20)
+    )
+
+    @WriteOperation
+    fun start(@Nullable durationSeconds: Long?): WebEndpointResponse<Map<String, Any?>> {
+        val duration = durationSeconds?.let { Duration.ofSeconds(it) } ?: defaultDuration
+        return try {
+            WebEndpointResponse(profiler.start(duration), WebEndpointResponse.STATUS_OK)
+        } catch (e: IllegalStateException) {
+            WebEndpointResponse(mapOf("error" to e.message, "status" to profiler.status()), 409)
+        }
+    }
+
+    @DeleteOperation
+    fun stop(): Map<String, Any?> = mapOf(
+        "stopped" to profiler.stop(),
+        "status" to profiler.status()
+    )
+
+    @ReadOperation(produces = ["application/octet-stream"])
+    fun recording(@Selector format: String): WebEndpointResponse<Resource> {
+        if (format != "jfr") return WebEndpointResponse(WebEndpointResponse.STATUS_NOT_FOUND)
+        val dump = profiler.dump() ?: return WebEndpointResponse(WebEndpointResponse.STATUS_NOT_FOUND)
+        return WebEndpointResponse(DumpResource(dump), WebEndpointResponse.STATUS_OK)
+    }
+
+    /** Streams one request's dump and deletes it once the response has been written. */
+    private class DumpResource(private val dump: SelfProfiler.RecordingDump) : FileSystemResource(dump.path) {
+        override fun getInputStream(): InputStream {
+            val stream = super.getInputStream()
+            return object : FilterInputStream(stream) {
+                override fun close() {
+                    try {
+                        super.close()
+                    } finally {
+                        dump.close()
+                    }
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,294 @@
+package com.internal.kpodmetrics.jfr
+
+import jdk.jfr.Recording
+import jdk.jfr.RecordingState
+import jdk.jfr.consumer.RecordedEvent
+import jdk.jfr.consumer.RecordedFrame
+import jdk.jfr.consumer.RecordingFile
+import org.slf4j.LoggerFactory
+import java.nio.file.Files
+import java.nio.file.Path
+import java.time.Duration
+import java.time.Instant
+
+/**
+ * Runs at most one bounded JDK Flight Recorder session over the agent itself, with
+ * a low-overhead settings profile ([SETTINGS]) rather than JFR's `default`/`profile`:
+ * coarse execution and native-method sampling, throttled allocation sampling, GC
+ * and CPU load, and the kpod.* events around collectors, map drains, pprof builds
+ * and Pyroscope pushes (see KpodEvents.kt).
+ *
+ * Every session is capped at [maxDuration] and [maxSizeBytes] and written to a file
+ * under [directory]; the file of the last session is kept until the next one starts.
+ * Readers never share a file: each download or summary works on its own [dump],
+ * taken without holding the profiler lock and deleted when the reader is done.
+ */
+class SelfProfiler(
+    private val maxDuration: Duration = Duration.ofMinutes(5),
+    private val maxSizeBytes: Long = 64L * 1024 * 1024,
+    private val directory: Path? = null
+) {
+    private val log = LoggerFactory.getLogger(SelfProfiler::class.java)
+
+    private var recording: Recording? = null
+    private var file: Path? = null
+    private var startedAt: Instant? = null
+    private var session = 0L
+    private val openDumps = java.util.concurrent.ConcurrentHashMap.newKeySet<Path>()
+
+    private val summaryLock = Any()
+    private var cachedSummary: CachedSummary? = null
+
+    /** One reader's copy of the recording; [close] deletes it. */
+    inner class RecordingDump internal constructor(
+        val path: Path,
+        internal val session: Long,
+        /** The session had ended when this was taken, so the data is final. */
+        internal val complete: Boolean
+    ) : AutoCloseable {
+        override fun close() {
+            openDumps.remove(path)
+            Files.deleteIfExists(path)
+        }
+    }
+
+    private class CachedSummary(
+        val session: Long,
+        val complete: Boolean,
+        val takenAtNs: Long,
+        val topN: Int,
+        val summary: Map<String, Any?>
+    )
+
+    companion object {
+        val SETTINGS: Map<String, String> = buildMap {
+            put("jdk.ExecutionSample#enabled", "true")
+            put("jdk.ExecutionSample#period", "20 ms")
+            put("jdk.NativeMethodSample#enabled", "true")
+            put("jdk.NativeMethodSample#period", "50 ms")
+            put("jdk.ObjectAllocationSample#enabled", "true")
+            put("jdk.ObjectAllocationSample#throttle", "100/s")
+            put("jdk.ObjectAllocationSample#stackTrace", "true")
+            put("jdk.GarbageCollection#enabled", "true")
+            put("jdk.GarbageCollection#threshold", "0 ms")
+            put("jdk.GCPhasePause#enabled", "true")
+            put("jdk.GCPhasePause#threshold", "0 ms")
+            put("jdk.CPULoad#enabled", "true")
+            put("jdk.CPULoad#period", "1 s")
+            put("jdk.ThreadCPULoad#enabled", "true")
+            put("jdk.ThreadCPULoad#period", "10 s")
+            for (event in listOf("kpod.CollectorRun", "kpod.MapDrain", "kpod.PprofBuild", "kpod.PyroscopePush")) {
+                put("$event#enabled", "true")
+                put("$event#threshold", "0 ms")
+            }
+        }
+
+        private val SAMPLE_EVENTS = setOf("jdk.ExecutionSample", "jdk.NativeMethodSample")
+
+        /** How long a summary of a running session is reused before the next dump. */
+        private val RUNNING_SUMMARY_TTL: Duration = Duration.ofSeconds(10)
+    }
+
+    /**
+     * Starts a session of [duration], capped at [maxDuration].
+     * @throws IllegalStateException if a session is already running
+     */
+    @Synchronized
+    fun start(duration: Duration): Map<String, Any?> {
+        check(!isRunning()) { "A self-profiling session is already running" }
+        closeCurrent(deleteFile = true)
+        val bounded = if (duration > maxDuration || duration <= Duration.ZERO) maxDuration else duration
+        val path = if (directory != null) {
+            Files.createTempFile(directory, "kpod-self-", ".jfr")
+        } else {
+            Files.createTempFile("kpod-self-", ".jfr")
+        }
+        val rec = Recording(SETTINGS)
+        rec.name = "kpod-self-profile"
+        rec.duration = bounded
+        rec.maxSize = maxSizeBytes
+        rec.isToDisk = true
+        rec.destination = path
+        rec.start()
+        recording = rec
+        file = path
+        startedAt = Instant.now()
+        session++
+        log.info("Started self-profiling session for {}s, writing {}", bounded.seconds, path)
+        return status()
+    }
+
+    /** Stops the running session early; returns false if none was running. */
+    @Synchronized
+    fun stop(): Boolean {
+        val rec = recording ?: return false
+        if (rec.state != RecordingState.RUNNING) return false
+        rec.stop()
+        log.info("Stopped self-profiling session, recording at {}", file)
+        return true
+    }
+
+    @Synchronized
+    fun isRunning(): Boolean = recording?.state.let { it == RecordingState.RUNNING || it == RecordingState.DELAYED }
+
+    @Synchronized
+    fun status(): Map<String, Any?> {
+        val rec = recording
+        return mapOf(
+            "state" to (rec?.state?.name ?: "NONE"),
+            "startedAt" to startedAt?.toString(),
+            "durationSeconds" to rec?.duration?.seconds,
+            "maxDurationSeconds" to maxDuration.seconds,
+            "maxSizeBytes" to maxSizeBytes,
+            "recordingBytes" to file?.takeIf { Files.exists(it) }?.let { Files.size(it) }
+        )
+    }
+
+    /**
+     * Copies the current or last session's recording to a new file owned by the
+     * caller, who must [RecordingDump.close] it. A running session keeps running.
+     * Returns null if there is nothing recorded.
+     */
+    fun dump(): RecordingDump? {
+        val rec: Recording
+        val dir: Path
+        val id: Long
+        synchronized(this) {
+            rec = recording ?: return null
+            dir = file?.parent ?: return null
+            id = session
+        }
+        val copy = Files.createTempFile(dir, "kpod-self-dump-", ".jfr")
+        openDumps.add(copy)
+        val dump = RecordingDump(copy, id, complete = rec.state != RecordingState.RUNNING)
+        try {
+            rec.dump(copy)
+            if (Files.size(copy) > 0) return dump
+        } catch (e: Exception) {
+            // Closed by a concurrent start() or close()
+            log.debug("Could not dump self-profiling recording: {}", e.message)
+        }
+        dump.close()
+        return null
+    }
+
+    /**
+     * Summarizes the recording: the [topN] hottest methods by execution/native
+     * samples (self = top frame, total = anywhere on the stack), the top allocation
+     * sites by sampled weight, and count/total/max time of every kpod event per key.
+     * The summary of a finished session is computed once; a running one is dumped
+     * again at most every [RUNNING_SUMMARY_TTL].
+     */
+    fun summary(topN: Int = 20): Map<String, Any?> = synchronized(summaryLock) {
+        val current = synchronized(this) { session }
+        cachedSummary?.let { c ->
+            val fresh = c.complete || System.nanoTime() - c.takenAtNs < RUNNING_SUMMARY_TTL.toNanos()
+            if (c.session == current && c.topN == topN && fresh) return c.summary
+        }
+        val dump = dump() ?: return mapOf("available" to false)
+        dump.use {
+            val summary = summarize(it.path, topN)
+            cachedSummary = CachedSummary(it.session, it.complete, System.nanoTime(), topN, summary)
+            summary
+        }
+    }
+
+    private class MethodStats(var self: Long = 0, var total: Long = 0)
+    private class EventStats(var count: Long = 0, var totalNs: Long = 0, var maxNs: Long = 0)
+
+    private fun summarize(path: Path, topN: Int): Map<String, Any?> {
+        val methods = HashMap<String, MethodStats>()
+        val allocations = HashMap<String, Long>()
+        val kpodEvents = HashMap<Pair<String, String>, EventStats>()
+        var samples = 0L
+        var gcPauseNs = 0L
+        var gcCount = 0L
+
+        val recordingFile = RecordingFile(path)
+        try {
+            while (recordingFile.hasMoreEvents()) {
+                val event = recordingFile.readEvent()
+                val type = event.eventType.name
+                when {
+                    type in SAMPLE_EVENTS -> {
+                        val frames = event.stackTrace?.frames
+                        if (frames.isNullOrEmpty()) continue
+                        samples++
+                        methods.getOrPut(frameName(frames[0])) { MethodStats() }.self++
+                        frames.mapTo(HashSet()) { frameName(it) }
+                            .forEach { methods.getOrPut(it) { MethodStats() }.total++ }
+                    }
+                    type == "jdk.ObjectAllocationSample" -> {
+                        val top = event.stackTrace?.frames?.firstOrNull() ?: continue
+                        allocations.merge(frameName(top), event.getLong("weight")) { a, b -> a + b }
+                    }
+                    type == "jdk.GarbageCollection" -> {
+                        gcCount++
+                        gcPauseNs += event.getDuration("sumOfPauses").toNanos()
+                    }
+                    type.startsWith("kpod.") -> {
+                        val stats = kpodEvents.getOrPut(type to eventKey(event)) { EventStats() }
+                        val ns = event.duration.toNanos()
+                        stats.count++
+                        stats.totalNs += ns
+                        if (ns > stats.maxNs) stats.maxNs = ns
+                    }
+                }
+            }
+        } finally {
+            recordingFile.close()
+        }
+
+        return mapOf(
+            "available" to true,
+            "executionSamples" to samples,
+            "hotMethods" to methods.entries
+                .sortedByDescending { it.value.self }
+                .take(topN)
+                .map { (method, s) -> mapOf("method" to method, "self" to s.self, "total" to s.total) },
+            "allocationSites" to allocations.entries
+                .sortedByDescending { it.value }
+                .take(topN)
+                .map { (method, bytes) -> mapOf("method" to method, "sampledBytes" to bytes) },
+            "gc" to mapOf("collections" to gcCount, "pauseMs" to gcPauseNs / 1_000_000.0),
+            "kpodEvents" to kpodEvents.entries
+                .sortedByDescending { it.value.totalNs }
+                .map { (key, s) ->
+                    mapOf(
+                        "event" to key.first,
+                        "key" to key.second,
+                        "count" to s.count,
+                        "totalMs" to s.totalNs / 1_000_000.0,
+                        "maxMs" to s.maxNs / 1_000_000.0
+                    )
+                }
+        )
+    }
+
+    private fun frameName(frame: RecordedFrame): String {
+        val method = frame.method
+        return "${method.type.name}.${method.name}"
+    }
+
+    private fun eventKey(event: RecordedEvent): String = when {
+        event.hasField("collector") -> event.getString("collector")
+        event.hasField("mode") -> event.getString("mode")
+        else -> ""
+    }
+
+    @Synchronized
+    fun close() {
+        closeCurrent(deleteFile = true)
+        // Dumps nobody collected; on Linux a stream still reading one is unaffected
+        for (path in openDumps) Files.deleteIfExists(path)
+        openDumps.clear()
+    }
+
+    private fun closeCurrent(deleteFile: Boolean) {
+        recording?.close()
+        recording = null
+        startedAt = null
+        if (deleteFile) file?.let { Files.deleteIfExists(it) }
+        file = null
+    }
+}
@@ -0,0 +1,32 @@
+package com.internal.kpodmetrics.k8s
+
+import kotlin.random.Random
+
+/**
+ * Exponential backoff with full jitter: attempt n waits a uniformly random time in
+ * [0, min(maxMs, baseMs * 2^n)]. Agents that lose their watch at the same moment
+ * (an API server restart) then come back spread over the window instead of at once.
+ */
+class JitteredBackoff(
+    private val baseMs: Long = 1000,
+    private val maxMs: Long = 60_000,
+    private val random: Random = Random.Default
+) {
+    private var attempt = 0
+
+    @Synchronized
+    fun nextDelayMs(): Long {
+        val cap = (baseMs shl attempt.coerceAtMost(MAX_SHIFT)).coerceIn(1, maxMs)
+        attempt++
+        return random.nextLong(cap + 1)
+    }
+
+    @Synchronized
+    fun reset() {
+        attempt = 0
+    }
+
+    private companion object {
+        const val MAX_SHIFT = 20
+    }
+}
@@ -2,34 +2,55 @@ package com.internal.kpodmetrics.k8s
 
 import com.internal.kpodmetrics.bpf.CgroupResolver
 import com.internal.kpodmetrics.bpf.PodInfo
+import com.internal.kpodmetrics.cgroup.CgroupTreeWatcher
+import com.internal.kpodmetrics.cgroup.ContainerCgroupNode
+import com.internal.kpodmetrics.cgroup.ProcCgroupIndex
 import com.internal.kpodmetrics.config.FilterProperties
 import com.internal.kpodmetrics.config.MetricsProperties
 import com.internal.kpodmetrics.discovery.PodProvider
 import com.internal.kpodmetrics.model.ContainerInfo
 import com.internal.kpodmetrics.model.DiscoveredPod
+import com.internal.kpodmetrics.model.MetricLabels
 import com.internal.kpodmetrics.model.QosClass
+import io.fabric8.kubernetes.api.model.ListOptionsBuilder
 import io.fabric8.kubernetes.api.model.Pod
 import io.fabric8.kubernetes.client.KubernetesClient
 import io.fabric8.kubernetes.client.Watch
 import io.fabric8.kubernetes.client.Watcher
 import io.fabric8.kubernetes.client.WatcherException
 import org.slf4j.LoggerFactory
-import java.nio.file.Files
-import java.nio.file.Path
-import java.nio.file.attribute.BasicFileAttributes
 import io.micrometer.core.instrument.MeterRegistry
 import io.micrometer.core.instrument.Tags
+import java.util.concurrent.Callable
 import java.util.concurrent.ConcurrentHashMap
+import java.util.concurrent.Executors
+import java.util.concurrent.Future
+import java.util.concurrent.RejectedExecutionException
+import java.util.concurrent.TimeUnit
 import java.util.concurrent.atomic.AtomicLong
 
 class PodWatcher(
     private val kubernetesClient: KubernetesClient,
     private val cgroupResolver: CgroupResolver,
     private val properties: MetricsProperties,
-    private val registry: MeterRegistry? = null
+    private val registry: MeterRegistry? = null,
+    private val cgroupTree: CgroupTreeWatcher? = null,
+    private val procIndex: ProcCgroupIndex = ProcCgroupIndex(),
+    private val backoff: JitteredBackoff = JitteredBackoff()
 ) : PodProvider {
     private val log = LoggerFactory.getLogger(PodWatcher::class.java)
-    private var watch: Watch? = null
+    @Volatile private var watch: Watch? = null
+    @Volatile private var lastResourceVersion: String? = null
+    @Volatile private var stopped = false
+    private val reconnectScheduler = Executors.newSingleThreadScheduledExecutor { r ->
+        Thread(r, "pod-watch-reconnect").apply { isDaemon = true }
+    }
+    // Resolves cgroup ids of listed pods in parallel while the next page is fetched
+    private val registerPool = Executors.newFixedThreadPool(REGISTER_THREADS) { r ->
+        Thread(r, "pod-register").apply { isDaemon = true }
+    }
+    private val resumes = registry?.counter("kpod.pod.watch.reconnects", "mode", "resume")
+    private val relists = registry?.counter("kpod.pod.watch.reconnects", "mode", "relist")
     private val discoveredPods = ConcurrentHashMap<String, DiscoveredPod>()
     private val podCgroupIds = ConcurrentHashMap<String, MutableSet<Long>>()
     private var onPodDeletedCallback: ((Long) -> Unit)? = null
@@ -56,80 +77,149 @@ class PodWatcher(
             return
         }
 
-        val filter = properties.filter
         log.info("Starting PodWatcher on node '{}'", nodeName)
 
-        // Initial list of running pods on this node
-        val pods = kubernetesClient.pods()
-            .inAnyNamespace()
-            .withField("spec.nodeName", nodeName)
-            .list()
-            .items
+        cgroupTree?.addListener(object : CgroupTreeWatcher.Listener {
+            override fun onContainerAdded(node: ContainerCgroupNode) = onContainerCgroupCreated(node)
+            override fun onContainerRemoved(node: ContainerCgroupNode) = onContainerCgroupRemoved(node)
+        })
 
-        var registered = 0
-        for (pod in pods) {
-            if (shouldWatch(pod.metadata.namespace, pod.metadata.labels ?: emptyMap(), filter)) {
-                registered += registerPod(pod)
+        relist()
+    }
+
+    fun stop() {
+        stopped = true
+        reconnectScheduler.shutdownNow()
+        registerPool.shutdownNow()
+        watch?.close()
+        watch = null
+        log.info("PodWatcher stopped")
+    }
+
+    private fun podsOnNode() = kubernetesClient.pods()
+        .inAnyNamespace()
+        .withField("spec.nodeName", properties.nodeName)
+
+    /**
+     * Lists the pods on this node in pages and watches from the list's resourceVersion.
+     * Each page is registered on [registerPool] as it arrives, so pods become
+     * resolvable while later pages are still being fetched. Pods that went away since
+     * the last list (while the watch was down) are removed.
+     */
+    private fun relist() {
+        val filter = properties.filter
+        val listed = HashSet<String>()
+        val pending = ArrayList<Future<Int>>()
+        var resourceVersion: String? = null
+        var continueToken: String? = null
+        var pages = 0
+        do {
+            val options = ListOptionsBuilder().withLimit(LIST_PAGE_SIZE).withContinue(continueToken).build()
+            val page = podsOnNode().list(options)
+            pages++
+            // Every page of a paginated list is served from the same snapshot
+            resourceVersion = page.metadata?.resourceVersion
+            continueToken = page.metadata?.`continue`?.takeIf { it.isNotEmpty() }
+            for (pod in page.items ?: emptyList()) {
+                pod.metadata?.uid?.let { listed.add(it) }
+                if (shouldWatch(pod.metadata.namespace, pod.metadata.labels ?: emptyMap(), filter)) {
+                    pending += registerPool.submit(Callable { registerPod(pod) })
+                }
             }
+        } while (continueToken != null)
+
+        var registered = 0
+        for (future in pending) registered += future.get()
+        for (gone in discoveredPods.values.filter { it.uid !in listed }) {
+            removePod(gone.uid, gone.name, gone.namespace, gone.containers.map { it.containerId })
         }
-        log.info("Initial pod scan complete: {} pods found, {} containers registered", pods.size, registered)
-
-        // Watch for changes
-        watch = kubernetesClient.pods()
-            .inAnyNamespace()
-            .withField("spec.nodeName", nodeName)
-            .watch(object : Watcher<Pod> {
-                override fun eventReceived(action: Watcher.Action, pod: Pod) {
-                    when (action) {
-                        Watcher.Action.ADDED, Watcher.Action.MODIFIED -> {
-                            if (shouldWatch(pod.metadata.namespace, pod.metadata.labels ?: emptyMap(), filter)) {
-                                registerPod(pod)
-                            }
-                        }
-                        Watcher.Action.DELETED -> {
-                            log.debug(
-                                "Pod deleted: {}/{}", pod.metadata.namespace, pod.metadata.name
-                            )
-                            pod.metadata?.let { meta ->
-                                // Clear cgroup cache for this pod's containers
-                                pod.status?.containerStatuses?.forEach { cs ->
-                                    cs.containerID?.substringAfterLast("://")?.let { containerCgroupCache.remove(it) }
-                                }
-                                meta.uid?.let { uid ->
-                                    discoveredPods.remove(uid)
-                                    podCgroupIds.remove(uid)?.forEach { cgroupId ->
-                                        cgroupResolver.onPodDeleted(cgroupId)
-                                        onPodDeletedCallback?.invoke(cgroupId)
-                                    }
-                                }
-                                val name = meta.name
-                                val ns = meta.namespace
-                                if (name != null && ns != null) {
-                                    onPodRemovedCallback?.invoke(name, ns)
-                                    removeRestartGauges(name, ns)
-                                }
-                            }
-                        }
-                        else -> {}
-                    }
-                }
+        log.info(
+            "Pod list complete: {} pods in {} pages, {} containers registered",
+            listed.size, pages, registered
+        )
+        watchFrom(resourceVersion)
+    }
+
+    private fun watchFrom(resourceVersion: String?) {
+        lastResourceVersion = resourceVersion
+        val options = ListOptionsBuilder()
+            .withResourceVersion(resourceVersion)
+            .withAllowWatchBookmarks(true)
+            .build()
+        watch = podsOnNode().watch(options, podEventWatcher)
+        log.info("Pod watch established on node '{}' from resourceVersion {}", properties.nodeName, resourceVersion)
+    }
 
-                override fun onClose(cause: WatcherException?) {
-                    if (cause != null) {
-                        log.warn("Pod watch closed with error, reconnect is handled by fabric8", cause)
-                    } else {
-                        log.info("Pod watch closed normally")
+    private val podEventWatcher = object : Watcher<Pod> {
+        override fun eventReceived(action: Watcher.Action, pod: Pod) {
+            // Bookmarks carry only a resourceVersion to resume from
+            pod.metadata?.resourceVersion?.let { lastResourceVersion = it }
+            backoff.reset()
+            when (action) {
+                Watcher.Action.ADDED, Watcher.Action.MODIFIED -> {
+                    if (shouldWatch(pod.metadata.namespace, pod.metadata.labels ?: emptyMap(), properties.filter)) {
+                        registerPod(pod)
                     }
                 }
-            })
+                Watcher.Action.DELETED -> {
+                    log.debug("Pod deleted: {}/{}", pod.metadata.namespace, pod.metadata.name)
+                    val meta = pod.metadata ?: return
+                    val containerIds = pod.status?.containerStatuses
+                        ?.mapNotNull { it.containerID?.substringAfterLast("://") } ?: emptyList()
+                    removePod(meta.uid, meta.name, meta.namespace, containerIds)
+                }
+                else -> {}
+            }
+        }
 
-        log.info("Pod watch established on node '{}'", nodeName)
+        override fun onClose(cause: WatcherException?) {
+            if (cause == null || stopped) {
+                log.info("Pod watch closed normally")
+                return
+            }
+            // fabric8 resumes dropped watches by itself; it gives up on 410 Gone (the
+            // resourceVersion was compacted away) or once out of reconnect attempts
+            scheduleReconnect(relist = cause.isHttpGone || lastResourceVersion == null, cause.message)
+        }
     }
 
-    fun stop() {
-        watch?.close()
-        watch = null
-        log.info("PodWatcher stopped")
+    private fun scheduleReconnect(relist: Boolean, reason: String?) {
+        val delayMs = backoff.nextDelayMs()
+        log.warn(
+            "Pod watch closed ({}); {} in {} ms", reason,
+            if (relist) "relisting" else "resuming from resourceVersion $lastResourceVersion", delayMs
+        )
+        (if (relist) relists else resumes)?.increment()
+        try {
+            reconnectScheduler.schedule({ reconnect(relist) }, delayMs, TimeUnit.MILLISECONDS)
+        } catch (_: RejectedExecutionException) {
+            // Stopped
+        }
+    }
+
+    private fun reconnect(relist: Boolean) {
+        if (stopped) return
+        try {
+            if (relist) relist() else watchFrom(lastResourceVersion)
+        } catch (e: Exception) {
+            scheduleReconnect(relist, e.message)
+        }
+    }
+
+    /** Forgets a deleted pod: its cgroup ids go to the resolver's grace cache and its meters are removed. */
+    private fun removePod(uid: String?, name: String?, namespace: String?, containerIds: List<String>) {
+        for (containerId in containerIds) containerCgroupCache.remove(containerId)
+        uid?.let {
+            discoveredPods.remove(it)
+            podCgroupIds.remove(it)?.forEach { cgroupId ->
+                cgroupResolver.onPodDeleted(cgroupId)
+                onPodDeletedCallback?.invoke(cgroupId)
+            }
+        }
+        if (name != null && namespace != null) {
+            onPodRemovedCallback?.invoke(name, namespace)
+            removeRestartGauges(name, namespace)
+        }
     }
 
     /**
@@ -166,11 +256,12 @@ class PodWatcher(
     }
 
     /**
-     * Resolves the cgroup ID (inode number of the cgroupfs directory) for a container.
+     * Resolves the cgroup ID (inode number of the cgroupfs directory) for a container,
+     * the value returned by bpf_get_current_cgroup_id().
      *
-     * Scans /host/proc/<pid>/cgroup (or /proc/<pid>/cgroup when not in a container) to find
-     * a process belonging to the given container ID, then stats the corresponding cgroupfs
-     * directory to obtain its inode number, which is the value returned by bpf_get_current_cgroup_id().
+     * Uses the cgroup tree when it tracks the container, else the [ProcCgroupIndex],
+     * which maps every container with a running process from one pass over
+     * /host/proc (or /proc when not in a container).
      */
     internal fun resolveCgroupId(podInfo: PodInfo): Long? {
         val containerId = podInfo.containerId
@@ -178,50 +269,41 @@ class PodWatcher(
 
         containerCgroupCache[containerId]?.let { return it }
 
-        // Try /host/proc first (mounted from host in DaemonSet), fall back to /proc
-        val procDir = sequenceOf(Path.of("/host/proc"), Path.of("/proc"))
-            .firstOrNull { Files.isDirectory(it) }
-            ?: return null
+        cgroupTree?.findByContainerId(containerId)?.let { node ->
+            containerCgroupCache[containerId] = node.cgroupId
+            return node.cgroupId
+        }
 
-        try {
-            Files.list(procDir).use { stream ->
-                for (entry in stream) {
-                    if (!entry.fileName.toString().all { it.isDigit() }) continue
-                    val cgroupFile = entry.resolve("cgroup")
-                    if (!Files.exists(cgroupFile)) continue
-
-                    val content = try {
-                        Files.readString(cgroupFile)
-                    } catch (_: Exception) {
-                        continue
-                    }
+        val cgroupId = procIndex.cgroupIdOf(containerId) ?: return null
+        log.debug(
+            "Resolved cgroup ID {} for container {} (pod {}/{})",
+            cgroupId, containerId, podInfo.namespace, podInfo.podName
+        )
+        containerCgroupCache[containerId] = cgroupId
+        return cgroupId
+    }
 
-                    if (!content.contains(containerId)) continue
-
-                    // Found a process in this container; extract the cgroup path
-                    val cgroupPath = parseCgroupPathFromProc(content) ?: continue
-                    val fullPath = Path.of("/sys/fs/cgroup").resolve(cgroupPath.removePrefix("/"))
-                    if (!Files.isDirectory(fullPath)) continue
-
-                    val attrs = Files.readAttributes(fullPath, BasicFileAttributes::class.java)
-                    val fileKey = attrs.fileKey()?.toString() ?: return null
-                    // fileKey format: "(dev=XXX,ino=YYY)"
-                    val inoMatch = Regex("ino=(\\d+)").find(fileKey)
-                    val inode = inoMatch?.groupValues?.get(1)?.toLongOrNull()
-                    if (inode != null) {
-                        log.debug(
-                            "Resolved cgroup ID {} for container {} (pod {}/{})",
-                            inode, containerId, podInfo.namespace, podInfo.podName
-                        )
-                        containerCgroupCache[containerId] = inode
-                        return inode
-                    }
-                }
-            }
-        } catch (e: Exception) {
-            log.debug("Failed to resolve cgroup ID for container {}: {}", containerId, e.message)
+    /**
+     * Registers a container of a known pod as soon as its cgroup is created, ahead of
+     * the API server reporting its ID, so short-lived containers are attributed. The
+     * container name stays unresolved until the pod's status catches up.
+     */
+    internal fun onContainerCgroupCreated(node: ContainerCgroupNode) {
+        val pod = discoveredPods[node.podUid] ?: return
+        val containerName = pod.containers.firstOrNull { it.containerId == node.containerId }?.name
+            ?: MetricLabels.UNRESOLVED
+        containerCgroupCache[node.containerId] = node.cgroupId
+        cgroupResolver.register(node.cgroupId, PodInfo(pod.uid, node.containerId, pod.namespace, pod.name, containerName))
+        podCgroupIds.getOrPut(pod.uid) { ConcurrentHashMap.newKeySet() }.add(node.cgroupId)
+    }
+
+    /** A container cgroup was removed (container exit or restart): retire its cgroup id. */
+    internal fun onContainerCgroupRemoved(node: ContainerCgroupNode) {
+        containerCgroupCache.remove(node.containerId, node.cgroupId)
+        if (podCgroupIds[node.podUid]?.remove(node.cgroupId) == true) {
+            cgroupResolver.onPodDeleted(node.cgroupId)
+            onPodDeletedCallback?.invoke(node.cgroupId)
         }
-        return null
     }
 
     private fun updateRestartGauges(pod: DiscoveredPod) {
@@ -251,28 +333,11 @@ class PodWatcher(
     }
 
     companion object {
-        /**
-         * Parses the cgroup path from /proc/<pid>/cgroup content.
-         * Looks for the cgroup v2 unified hierarchy (line starting with "0::") or
-         * falls back to any line containing "kubepods".
-         */
-        internal fun parseCgroupPathFromProc(content: String): String? {
-            for (line in content.lines()) {
-                // cgroup v2: "0::/kubepods.slice/..."
-                if (line.startsWith("0::")) {
-                    val path = line.removePrefix("0::")
-                    if (path.length > 1 && path.contains("kubepods")) return path
-                }
-            }
-            // Fallback: find any kubepods line (cgroup v1)
-            for (line in content.lines()) {
-                if (line.contains("kubepods")) {
-                    val path = line.substringAfterLast(":")
-                    if (path.isNotBlank()) return path
-                }
-            }
-            return null
-        }
+        private const val LIST_PAGE_SIZE = 100L
+        private val REGISTER_THREADS = Runtime.getRuntime().availableProcessors().coerceIn(1, 4)
+
+        internal fun parseCgroupPathFromProc(content: String): String? =
+            ProcCgroupIndex.parseCgroupPath(content)
 
         fun toDiscoveredPod(pod: Pod): DiscoveredPod? {
             val metadata = pod.metadata ?: return null
@@ -0,0 +1,6 @@
+package com.internal.kpodmetrics.model
+
+object MetricLabels {
+    /** Value of the pod, namespace or container label when the owner is not known. */
+    const val UNRESOLVED = "_unresolved"
+}
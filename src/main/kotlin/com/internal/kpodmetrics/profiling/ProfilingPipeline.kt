@@ -3,6 +3,7 @@ package com.internal.kpodmetrics.profiling
 import com.internal.kpodmetrics.bpf.PodInfo
 import com.internal.kpodmetrics.collector.CpuProfileCollector
 import com.internal.kpodmetrics.collector.StackSample
+import com.internal.kpodmetrics.jfr.PprofBuildEvent
 import org.slf4j.LoggerFactory
 
 class ProfilingPipeline(
@@ -25,7 +26,15 @@ class ProfilingPipeline(
 
         for ((podInfo, samples) in profiles) {
             try {
+                val event = PprofBuildEvent()
+                event.begin()
                 val pprofBytes = buildPprof(podInfo, samples)
+                if (event.shouldCommit()) {
+                    event.pod = "${podInfo.namespace}/${podInfo.podName}"
+                    event.samples = samples.size
+                    event.bytes = pprofBytes.size.toLong()
+                    event.commit()
+                }
                 val appName = "kpod.cpu{namespace=${podInfo.namespace},pod=${podInfo.podName},node=$nodeName}"
                 pusher.push(pprofBytes, appName, from, now)
             } catch (e: Exception) {
@@ -1,5 +1,6 @@
 package com.internal.kpodmetrics.profiling
 
+import com.internal.kpodmetrics.jfr.PyroscopePushEvent
 import org.slf4j.LoggerFactory
 import java.io.ByteArrayOutputStream
 import java.net.URI
@@ -30,6 +31,8 @@ class PyroscopePusher(
      * @param untilEpochSeconds end of the profiling window
      */
     fun push(pprofBytes: ByteArray, appName: String, fromEpochSeconds: Long, untilEpochSeconds: Long) {
+        val event = PyroscopePushEvent()
+        event.begin()
         val gzipped = gzip(pprofBytes)
 
         val encodedName = URLEncoder.encode(appName, Charsets.UTF_8)
@@ -52,6 +55,7 @@ class PyroscopePusher(
 
         try {
             val response = client.send(requestBuilder.build(), HttpResponse.BodyHandlers.ofString())
+            event.status = response.statusCode()
             if (response.statusCode() in 200..299) {
                 log.debug("Pushed profile to Pyroscope: {} ({} bytes gzipped)", appName, gzipped.size)
             } else {
@@ -59,6 +63,12 @@ class PyroscopePusher(
             }
         } catch (e: Exception) {
             log.warn("Failed to push profile to Pyroscope: {}", e.message)
+        } finally {
+            if (event.shouldCommit()) {
+                event.app = appName
+                event.bytes = gzipped.size.toLong()
+                event.commit()
+            }
         }
     }
 
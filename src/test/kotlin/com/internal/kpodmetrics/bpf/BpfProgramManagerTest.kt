@@ -68,6 +68,22 @@ class BpfProgramManagerTest {
         verify { bridge.destroyObject(4L) }
     }
 
+    @Test
+    fun `holds BPF_ENABLE_STATS fd while loaded and closes it on destroyAll`() {
+        val config = MetricsProperties(profile = "minimal").resolveProfile()
+        manager = BpfProgramManager(bridge, "/test/bpf", config)
+
+        every { bridge.enableStats() } returns 17
+        every { bridge.openObject(any()) } returns 1L
+
+        manager.loadAll()
+        manager.loadAll()
+        manager.destroyAll()
+
+        verify(exactly = 1) { bridge.enableStats() }
+        verify(exactly = 1) { bridge.closeStatsFd(17) }
+    }
+
     @Test
     fun `getMapFd delegates to bridge with correct handle`() {
         val config = MetricsProperties(profile = "minimal").resolveProfile()
@@ -63,4 +63,75 @@ class CgroupResolverTest {
         val resolver = CgroupResolver()
         assertNull(resolver.resolve(999L))
     }
+
+    @Test
+    fun `resolves every id after the table grows`() {
+        val resolver = CgroupResolver()
+        for (id in 1L..5000L) resolver.register(id * 4099, PodInfo("uid-$id", "c-$id"))
+        assertEquals(5000, resolver.size())
+        for (id in 1L..5000L) assertEquals("uid-$id", resolver.resolve(id * 4099)?.podUid)
+        assertNull(resolver.resolve(3L))
+    }
+
+    @Test
+    fun `deleted container resolves until its grace period ends`() {
+        var now = 1_000_000L
+        val resolver = CgroupResolver(clock = { now })
+        val info = PodInfo("uid", "c1")
+        resolver.register(7L, info)
+        resolver.register(8L, PodInfo("uid", "c2"))
+        resolver.onPodDeleted(7L)
+        assertEquals(1, resolver.size())
+
+        now += 4_000
+        resolver.pruneGraceCache()
+        assertEquals(info, resolver.resolve(7L))
+
+        now += 2_000
+        resolver.pruneGraceCache()
+        assertNull(resolver.resolve(7L))
+        assertNotNull(resolver.resolve(8L))
+    }
+
+    @Test
+    fun `re-registering a deleted container makes it live again`() {
+        val resolver = CgroupResolver()
+        resolver.register(7L, PodInfo("uid", "c1"))
+        resolver.onPodDeleted(7L)
+        resolver.register(7L, PodInfo("uid", "c1", containerName = "app"))
+        assertEquals(1, resolver.size())
+        assertEquals("app", resolver.resolve(7L)?.containerName)
+
+        resolver.evict(7L)
+        assertNull(resolver.resolve(7L))
+        assertEquals(0, resolver.size())
+    }
+
+    @Test
+    fun `negative cache expires when a new container is registered`() {
+        val resolver = CgroupResolver()
+        resolver.register(1L, PodInfo("uid", "c1"))
+        assertNull(resolver.resolve(42L))
+        assertTrue(resolver.isKnownMiss(42L))
+        assertEquals(1, resolver.negativeCacheSize())
+
+        // Updating a known container keeps the generation
+        val generation = resolver.generation
+        resolver.register(1L, PodInfo("uid", "c1", containerName = "app"))
+        assertEquals(generation, resolver.generation)
+        assertTrue(resolver.isKnownMiss(42L))
+
+        resolver.register(42L, PodInfo("uid", "c2"))
+        assertFalse(resolver.isKnownMiss(42L))
+        assertEquals(0, resolver.negativeCacheSize())
+        assertEquals("c2", resolver.resolve(42L)?.containerId)
+    }
+
+    @Test
+    fun `negative cache is bounded`() {
+        val resolver = CgroupResolver()
+        for (id in 1L..200_000L) assertNull(resolver.resolve(id))
+        assertEquals(50_000, resolver.negativeCacheSize())
+        assertTrue(resolver.isKnownMiss(1L))
+    }
 }
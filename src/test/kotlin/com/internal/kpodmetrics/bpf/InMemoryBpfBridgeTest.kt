@@ -0,0 +1,140 @@
+package com.internal.kpodmetrics.bpf
+
+import org.junit.jupiter.api.Test
+import org.junit.jupiter.api.Assertions.*
+import org.junit.jupiter.api.assertThrows
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
+
+class InMemoryBpfBridgeTest {
+
+    private fun key(id: Long) = ByteBuffer.allocate(8).order(ByteOrder.LITTLE_ENDIAN).putLong(id).array()
+    private fun u32(i: Int) = ByteBuffer.allocate(4).order(ByteOrder.LITTLE_ENDIAN).putInt(i).array()
+    private fun u64(bytes: ByteArray, offset: Int = 0) =
+        ByteBuffer.wrap(bytes).order(ByteOrder.LITTLE_ENDIAN).getLong(offset)
+
+    private fun bridgeWith(program: String, definition: InMemoryBpfBridge.MapDefinition? = null): Pair<InMemoryBpfBridge, Long> {
+        val bridge = InMemoryBpfBridge(numCpus = 4)
+        if (definition != null) bridge.defineMap(program, "events", definition)
+        return bridge to bridge.openObject("/opt/bpf/core/$program.bpf.o")
+    }
+
+    @Test
+    fun `LRU map evicts least recently used entry when full`() {
+        val (bridge, _) = bridgeWith("p", InMemoryBpfBridge.MapDefinition(FakeMapType.LRU_HASH, 2))
+        val map = bridge.map("p", "events", 8, 8)
+
+        map.add(key(1), 0, 1)
+        map.add(key(2), 0, 1)
+        map.lookup(key(1))
+        map.add(key(3), 0, 1)
+
+        assertNotNull(map.lookup(key(1)))
+        assertNull(map.lookup(key(2)))
+        assertEquals(1, map.evictions.get())
+    }
+
+    @Test
+    fun `full HASH map rejects inserts and counts update errors in stats map`() {
+        val (bridge, handle) = bridgeWith("p", InMemoryBpfBridge.MapDefinition(FakeMapType.HASH, 1))
+        val map = bridge.map("p", "events", 8, 8)
+
+        assertTrue(map.add(key(1), 0, 1))
+        assertFalse(map.add(key(2), 0, 1))
+        assertThrows<BpfMapException> { bridge.mapUpdate(bridge.getMapFd(handle, "events"), key(3), ByteArray(8)) }
+
+        val statsFd = bridge.getMapFd(handle, "events_stats")
+        assertEquals(1L, bridge.mapLookupPercpuSum(statsFd, u32(0), 8))
+        assertEquals(1L, bridge.mapLookupPercpuSum(statsFd, u32(1), 8))
+    }
+
+    @Test
+    fun `batch drain returns at most maxEntries and removes them`() {
+        val (bridge, handle) = bridgeWith("p")
+        val map = bridge.map("p", "events", 8, 8)
+        for (id in 1L..5L) map.add(key(id), 0, id)
+        val fd = bridge.getMapFd(handle, "events")
+
+        val first = bridge.mapBatchLookupAndDelete(fd, 8, 8, 3)
+        val rest = bridge.mapBatchLookupAndDelete(fd, 8, 8, 3)
+
+        assertEquals(3, first.size)
+        assertEquals(2, rest.size)
+        assertEquals(0, map.size())
+        assertEquals(15L, (first + rest).sumOf { u64(it.second) })
+    }
+
+    @Test
+    fun `iterate drain sees every key once`() {
+        val (bridge, handle) = bridgeWith("p")
+        val map = bridge.map("p", "events", 8, 8)
+        for (id in 1L..4L) map.add(key(id), 0, 1)
+
+        val drained = bridge.mapIterateAndDelete(bridge.getMapFd(handle, "events"), 8, 8)
+
+        assertEquals(listOf(1L, 2L, 3L, 4L), drained.map { u64(it.first) })
+        assertEquals(0, map.size())
+    }
+
+    @Test
+    fun `per-CPU values are laid out per CPU and summed on lookup`() {
+        val (bridge, handle) = bridgeWith("p", InMemoryBpfBridge.MapDefinition(FakeMapType.PERCPU_ARRAY, 2, 4, 8))
+        val map = bridge.map("p", "events", 4, 8)
+        map.add(u32(1), 0, 5, cpu = 0)
+        map.add(u32(1), 0, 7, cpu = 3)
+
+        val fd = bridge.getMapFd(handle, "events")
+        assertEquals(32, bridge.mapLookup(fd, u32(1), 32)!!.size)
+        assertEquals(12L, bridge.mapLookupPercpuSum(fd, u32(1), 8))
+        assertEquals(0L, bridge.mapLookupPercpuSum(fd, u32(0), 8))
+    }
+
+    @Test
+    fun `lookup and update loops are offloaded as one native call`() {
+        val (bridge, handle) = bridgeWith("p", InMemoryBpfBridge.MapDefinition(FakeMapType.HASH, 16, 8, 8))
+        val fd = bridge.getMapFd(handle, "events")
+        val cost = NativeCallCost()
+
+        NativeCallCost.bind(cost) {
+            bridge.mapUpdateAll(fd, (1L..5L).map { key(it) to key(it * 10) })
+            val values = bridge.mapLookupAll(fd, listOf(key(1), key(5), key(9)), 8)
+            assertEquals(listOf(10L, 50L, null), values.map { it?.let { v -> u64(v) } })
+        }
+        assertEquals(2L, cost.calls)
+    }
+
+    @Test
+    fun `get_next_key restarts from first key when previous key is gone`() {
+        val (bridge, handle) = bridgeWith("p")
+        val map = bridge.map("p", "events", 8, 8)
+        map.add(key(1), 0, 1)
+        map.add(key(2), 0, 1)
+        val fd = bridge.getMapFd(handle, "events")
+
+        assertEquals(1L, u64(bridge.mapGetNextKey(fd, null, 8)!!))
+        assertEquals(2L, u64(bridge.mapGetNextKey(fd, key(1), 8)!!))
+        assertNull(bridge.mapGetNextKey(fd, key(2), 8))
+        assertEquals(1L, u64(bridge.mapGetNextKey(fd, key(99), 8)!!))
+    }
+
+    @Test
+    fun `untouched maps drain empty`() {
+        val (bridge, handle) = bridgeWith("p")
+        assertTrue(bridge.mapBatchLookupAndDelete(bridge.getMapFd(handle, "events"), 8, 8, 10).isEmpty())
+    }
+
+    @Test
+    fun `generator learns drained layouts and fills maps`() {
+        val (bridge, handle) = bridgeWith("p")
+        val fd = bridge.getMapFd(handle, "events")
+        val layouts = SyntheticLoadGenerator.learn(bridge) { bridge.mapBatchLookupAndDelete(fd, 16, 24, 10240) }
+        assertEquals(listOf(MapLayout("p", "events", 16, 24)), layouts)
+
+        val generator = SyntheticLoadGenerator(bridge, LoadProfile(pods = 10, eventsPerSecond = 1000, defaultCardinality = 50), layouts)
+        assertEquals(1000L, generator.tick(1.0))
+
+        val drained = bridge.mapBatchLookupAndDelete(fd, 16, 24, 10240)
+        assertTrue(drained.size in 1..50)
+        assertEquals(1000L, drained.sumOf { u64(it.second, 16) })
+    }
+}
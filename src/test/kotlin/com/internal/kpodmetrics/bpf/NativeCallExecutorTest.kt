@@ -0,0 +1,87 @@
+package com.internal.kpodmetrics.bpf
+
+import io.micrometer.core.instrument.simple.SimpleMeterRegistry
+import org.junit.jupiter.api.AfterEach
+import org.junit.jupiter.api.Test
+import java.util.concurrent.CountDownLatch
+import java.util.concurrent.TimeUnit
+import kotlin.test.assertEquals
+import kotlin.test.assertFailsWith
+import kotlin.test.assertFalse
+import kotlin.test.assertNotNull
+import kotlin.test.assertTrue
+
+class NativeCallExecutorTest {
+
+    private val registry = SimpleMeterRegistry()
+    private val executor = NativeCallExecutor(poolSize = 1, queueCapacity = 1, registry = registry)
+
+    @AfterEach
+    fun tearDown() {
+        executor.close()
+    }
+
+    private fun <T> onVirtualThread(block: () -> T): T {
+        var result: Result<T>? = null
+        Thread.ofVirtual().start { result = runCatching(block) }.join()
+        return result!!.getOrThrow()
+    }
+
+    @Test
+    fun `virtual thread callers run on a platform pool thread`() {
+        val thread = onVirtualThread { executor.call { Thread.currentThread() } }
+        assertFalse(thread.isVirtual)
+        assertTrue(thread.name.startsWith("bpf-native-"))
+    }
+
+    @Test
+    fun `platform thread callers run inline`() {
+        val caller = Thread.currentThread()
+        assertEquals(caller, executor.call { Thread.currentThread() })
+    }
+
+    @Test
+    fun `offloading platform threads run on a pool thread`() {
+        var thread: Thread? = null
+        NativeCallExecutor.offloadingThread({ thread = executor.call { Thread.currentThread() } }, "collector")
+            .apply { start() }.join()
+        assertTrue(thread!!.name.startsWith("bpf-native-"))
+        assertEquals(1L, registry.get("kpod.bpf.native.queue.wait").timer().count())
+    }
+
+    @Test
+    fun `exceptions are rethrown unwrapped`() {
+        assertFailsWith<BpfMapException> {
+            onVirtualThread { executor.call { throw BpfMapException("lookup failed") } }
+        }
+    }
+
+    @Test
+    fun `saturated pool runs inline and counts pinned call`() {
+        val release = CountDownLatch(1)
+        val started = CountDownLatch(1)
+        // Occupy the single worker and the single queue slot
+        val busy = Thread.ofVirtual().start {
+            executor.call { started.countDown(); release.await(5, TimeUnit.SECONDS) }
+        }
+        assertTrue(started.await(5, TimeUnit.SECONDS))
+        val queued = Thread.ofVirtual().start { executor.call { } }
+        while (registry.get("kpod.bpf.native.queue.depth").gauge().value() < 1.0) Thread.onSpinWait()
+
+        val thread = onVirtualThread { executor.call { Thread.currentThread() } }
+        assertTrue(thread.isVirtual)
+        assertEquals(1.0, registry.get("kpod.bpf.native.pinned.calls.total").counter().count())
+
+        release.countDown()
+        busy.join()
+        queued.join()
+    }
+
+    @Test
+    fun `registers queue and activity meters`() {
+        onVirtualThread { executor.call { } }
+        assertNotNull(registry.find("kpod.bpf.native.queue.depth").gauge())
+        assertNotNull(registry.find("kpod.bpf.native.active").gauge())
+        assertEquals(1L, registry.get("kpod.bpf.native.queue.wait").timer().count())
+    }
+}
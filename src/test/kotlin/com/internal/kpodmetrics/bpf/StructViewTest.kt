@@ -0,0 +1,65 @@
+package com.internal.kpodmetrics.bpf
+
+import org.junit.jupiter.api.Test
+import org.junit.jupiter.api.assertThrows
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
+import kotlin.test.assertEquals
+
+class StructViewTest {
+
+    /** Mirrors a generated view: u64 + u32 + u16 + u8 + s8 = 16 bytes. */
+    private class SampleView : StructView<SampleView>() {
+        override val size: Int get() = 16
+        val id: Long get() = u64(0)
+        val ip: Long get() = u32(8)
+        val port: Int get() = u16(12)
+        val flag: Int get() = u8(14)
+        val delta: Int get() = s8(15)
+    }
+
+    private fun encode(buf: ByteBuffer) {
+        buf.putLong(-2L).putInt(0xC0A80001.toInt()).putShort(0xFFFE.toShort()).put(0xAB.toByte()).put(-3)
+    }
+
+    @Test
+    fun `reads little-endian fields from a heap array`() {
+        val buf = ByteBuffer.allocate(16).order(ByteOrder.LITTLE_ENDIAN)
+        encode(buf)
+        val view = SampleView().wrap(buf.array())
+
+        assertEquals(-2L, view.id)
+        assertEquals(0xC0A80001L, view.ip)
+        assertEquals(0xFFFE, view.port)
+        assertEquals(0xAB, view.flag)
+        assertEquals(-3, view.delta)
+    }
+
+    @Test
+    fun `reads the same values from a direct buffer at an offset`() {
+        val buf = ByteBuffer.allocateDirect(32).order(ByteOrder.LITTLE_ENDIAN)
+        buf.position(16)
+        encode(buf)
+        val view = SampleView().wrap(buf, 16)
+
+        assertEquals(-2L, view.id)
+        assertEquals(0xC0A80001L, view.ip)
+        assertEquals(0xFFFE, view.port)
+        assertEquals(-3, view.delta)
+    }
+
+    @Test
+    fun `one view walks consecutive structs`() {
+        val bytes = ByteArray(32)
+        bytes[0] = 1
+        bytes[16] = 2
+        val view = SampleView()
+        assertEquals(listOf(1L, 2L), listOf(0, 16).map { view.wrap(bytes, it).id })
+    }
+
+    @Test
+    fun `rejects out-of-bounds and big-endian sources`() {
+        assertThrows<IllegalArgumentException> { SampleView().wrap(ByteArray(15)) }
+        assertThrows<IllegalArgumentException> { SampleView().wrap(ByteBuffer.allocate(16)) }
+    }
+}
@@ -91,8 +91,8 @@ class CpuSchedProgramTest {
         assertThat(c).contains("log2l")
         // Should lookup runq_latency map
         assertThat(c).contains("bpf_map_lookup_elem(&runq_latency")
-        // Should update runq_latency map (in else branch)
-        assertThat(c).contains("bpf_map_update_elem(&runq_latency")
+        // Should insert into runq_latency map (in else branch)
+        assertThat(c).contains("map_insert(&runq_latency, &runq_latency_stats, &")
     }
 
     @Test
@@ -103,6 +103,17 @@ class CpuSchedProgramTest {
         assertThat(c).contains("DEFINE_STATS_MAP(ctx_switches)")
     }
 
+    @Test
+    fun `new keys are inserted through map_insert with distinct variables`() {
+        val c = cpuSchedProgram.generateC()
+
+        assertThat(c).contains("map_insert(&ctx_switches, &ctx_switches_stats, &")
+        assertThat(c).contains("map_insert(&runq_latency, &runq_latency_stats, &")
+        assertThat(c).contains("_ins_ctx").contains("_ins_runq")
+        assertThat(Regex("""\b_ins\b""").findAll(c).count()).isZero()
+        assertThat(cpuSchedProgram.validate().errors).isEmpty()
+    }
+
     @Test
     fun `generated C has correct map and program counts`() {
         val c = cpuSchedProgram.generateC()
@@ -0,0 +1,120 @@
+package com.internal.kpodmetrics.bpf.programs
+
+import dev.ebpf.dsl.api.generateC
+import org.assertj.core.api.Assertions.assertThat
+import org.assertj.core.api.Assertions.assertThatThrownBy
+import org.junit.jupiter.api.Test
+import org.junit.jupiter.api.io.TempDir
+import java.io.File
+
+class FlyweightViewsTest {
+
+    @Test
+    fun `parses scalar and array fields with natural alignment`() {
+        val structs = parseCStructs(
+            """
+            struct tcp_peer_conn_key {
+                __u64 cgroup_id;
+                __u32 remote_ip4;
+                __u16 remote_port;
+                __u8 direction;
+                __u8 pad;
+            };
+            struct odd {
+                __u8 flag;
+                __u64 value;
+                __u16 slots[3];
+            };
+            """.trimIndent()
+        )
+
+        val conn = structs.single { it.name == "tcp_peer_conn_key" }
+        assertThat(conn.size).isEqualTo(16)
+        assertThat(conn.fields.map { it.offset }).containsExactly(0, 8, 12, 14, 15)
+
+        val odd = structs.single { it.name == "odd" }
+        assertThat(odd.fields.map { it.offset }).containsExactly(0, 8, 16)
+        assertThat(odd.size).isEqualTo(24)
+    }
+
+    @Test
+    fun `skips anonymous map definitions and structs with kernel types`() {
+        val structs = parseCStructs(
+            """
+            struct {
+                __uint(type, BPF_MAP_TYPE_LRU_HASH);
+            } events SEC(".maps");
+            struct with_ptr {
+                __u64 cgroup_id;
+                struct sock *sk;
+            };
+            """.trimIndent()
+        )
+        assertThat(structs).isEmpty()
+    }
+
+    @Test
+    fun `char arrays are byte arrays`() {
+        val exec = parseCStructs(
+            """
+            struct exec_event {
+                __u64 cgroup_id;
+                char comm[16];
+                __u32 pid;
+            };
+            """.trimIndent()
+        ).single()
+
+        assertThat(exec.fields.map { it.offset }).containsExactly(0, 8, 24)
+        assertThat(exec.fields[1].elemSize).isEqualTo(1)
+        assertThat(exec.size).isEqualTo(32)
+    }
+
+    @Test
+    fun `an unparsable map struct fails generation`(@TempDir dir: File) {
+        val c = """
+            struct flow_key {
+                __u64 cgroup_id;
+                __be32 daddr;
+            };
+            struct trace_ctx {
+                __u64 pad;
+                union { __u32 a; __u64 b; } u;
+            };
+            struct {
+                __uint(type, BPF_MAP_TYPE_HASH);
+                __type(key, struct flow_key);
+                __type(value, __u64);
+            } flows SEC(".maps");
+        """.trimIndent()
+
+        assertThat(unparsedCStructs(c)).containsExactly("flow_key", "trace_ctx")
+        assertThat(mapStructNames(c)).containsExactly("flow_key")
+        assertThatThrownBy { writeViews("flows", c, dir.path, "x.y") }
+            .hasMessageContaining("flow_key")
+            .hasMessageNotContaining("trace_ctx")
+        // Structs outside maps only warn
+        writeViews("ctx", c.substringBefore("struct {"), dir.path, "x.y")
+    }
+
+    @Test
+    fun `generated view exposes fields and hides padding`() {
+        val source = generateViews("tcp_peer", parseCStructs(tcpPeerProgram.generateC()), "x.y")
+
+        assertThat(source).contains("object TcpPeerViews {")
+        assertThat(source).contains("class TcpPeerConnKeyView : StructView<TcpPeerConnKeyView>()")
+        assertThat(source).contains("val cgroupId: Long get() = u64(0)")
+        assertThat(source).contains("val remotePort: Int get() = u16(12)")
+        assertThat(source).contains("fun slots(index: Int): Long = u64(0 + index * 8)")
+        assertThat(source).doesNotContain("val pad")
+    }
+
+    @Test
+    fun `c-only programs get views for their map structs`() {
+        val http = parseCStructs(httpProgram.generateC()).associateBy { it.name }
+
+        assertThat(http["http_event_key"]!!.size).isEqualTo(16)
+        assertThat(http["http_event_key"]!!.fields.first { it.name == "status_code" }.offset).isEqualTo(10)
+        assertThat(http["hist_value"]!!.size).isEqualTo(232)
+    }
+}
@@ -0,0 +1,51 @@
+package com.internal.kpodmetrics.bpf.programs
+
+import dev.ebpf.dsl.api.generateC
+import org.assertj.core.api.Assertions.assertThat
+import org.assertj.core.api.Assertions.assertThatThrownBy
+import org.junit.jupiter.api.Test
+
+class MetricSchemaTest {
+
+    private fun generate(schema: MetricSchema, c: String): String =
+        generateMetricSchema(schema, parseCStructs(c), "x.y")
+
+    @Test
+    fun `http schema resolves key offsets and label tables`() {
+        val source = generate(httpMetricSchema, httpProgram.generateC())
+
+        assertThat(source).contains("object HttpMetrics {")
+        assertThat(source).contains(
+            "val METHOD = LabelTable.dense(arrayOf(\"UNKNOWN\", \"GET\", \"POST\", \"PUT\", \"DELETE\", \"PATCH\", \"HEAD\"), \"UNKNOWN\")"
+        )
+        assertThat(source).contains("LabelSpec(\"status_code\", 10, 2, LabelTable.numeric())")
+        assertThat(source).contains("LabelSpec(\"direction\", 9, 1, DIRECTION)")
+        assertThat(source).contains("keySize = 16,")
+        assertThat(source).contains("keyView = { HttpViews.HttpEventKeyView() },")
+        assertThat(source).contains("valueView = { HttpViews.HistValueView() },")
+        assertThat(source).contains("kind = MetricKind.AVERAGE_LATENCY,")
+        assertThat(source).contains("countOffset = 216,")
+        assertThat(source).contains("sumOffset = 224,")
+        assertThat(source).contains("val ALL = listOf(HTTP_EVENTS, HTTP_LATENCY)")
+    }
+
+    @Test
+    fun `sparse tables keep their unknown format`() {
+        val source = generate(mysqlMetricSchema, mysqlProgram.generateC())
+
+        assertThat(source).contains("3 to \"COM_QUERY\"")
+        assertThat(source).contains("\"UNKNOWN(0x%x)\"")
+        assertThat(source).contains("emitUnresolved = true")
+    }
+
+    @Test
+    fun `unknown key fields fail generation`() {
+        val schema = metricSchema("redis") {
+            counter("kpod.redis.requests", "redis_events", key = "redis_event_key") {
+                label("verb")
+            }
+        }
+        assertThatThrownBy { generate(schema, redisProgram.generateC()) }
+            .hasMessageContaining("no scalar field verb")
+    }
+}
@@ -97,6 +97,24 @@ class NetProgramTest {
         assertThat(c).contains("DEFINE_STATS_MAP(rtt_hist)")
     }
 
+    @Test
+    fun `new keys are inserted through map_insert`() {
+        val c = netProgram.generateC()
+
+        assertThat(c).contains("map_insert(&tcp_stats_map, &tcp_stats_map_stats, &")
+        assertThat(c).contains("map_insert(&rtt_hist, &rtt_hist_stats, &")
+        assertThat(netProgram.validate().errors).isEmpty()
+    }
+
+    @Test
+    fun `map_insert does not count a racing insert as an update error`() {
+        val c = netProgram.generateC()
+        val mapInsert = c.substringAfter("long map_insert(").substringBefore("\n}")
+
+        assertThat(mapInsert).contains("if (ret == -EEXIST) return ret;")
+        assertThat(mapInsert.indexOf("-EEXIST")).isLessThan(mapInsert.indexOf("MAP_STAT_UPDATE_ERRORS"))
+    }
+
     @Test
     fun `generated C has correct map and program counts`() {
         val c = netProgram.generateC()
@@ -0,0 +1,115 @@
+package com.internal.kpodmetrics.cgroup
+
+import com.internal.kpodmetrics.bpf.BpfBridge
+import com.internal.kpodmetrics.model.CgroupVersion
+import io.micrometer.core.instrument.simple.SimpleMeterRegistry
+import io.mockk.every
+import io.mockk.mockk
+import io.mockk.verify
+import org.junit.jupiter.api.Assertions.*
+import org.junit.jupiter.api.Test
+import org.junit.jupiter.api.io.TempDir
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
+import java.nio.file.Path
+import kotlin.io.path.createDirectories
+import kotlin.io.path.writeText
+
+class CgroupIterStatsTest {
+    @TempDir
+    lateinit var tempDir: Path
+
+    private val registry = SimpleMeterRegistry()
+    private var now = 0L
+    private var records = ByteArray(0)
+    private val bridge = mockk<BpfBridge>().also { b ->
+        every { b.pageSize() } returns 4096
+        every { b.iterRead(5, any()) } answers {
+            val out = secondArg<ByteArray>()
+            if (records.size > out.size) -28 else {
+                records.copyInto(out)
+                records.size
+            }
+        }
+    }
+    private val ids = mutableMapOf("/cg/a" to 100L, "/cg/b" to 200L)
+    private val stats = CgroupIterStats(bridge, 5, registry, maxAgeMs = 1000, clock = { now }, cgroupIdOf = { ids[it] })
+
+    private fun pass(vararg recs: LongArray) {
+        val bb = ByteBuffer.allocate(recs.size * 48).order(ByteOrder.LITTLE_ENDIAN)
+        for (r in recs) {
+            bb.putLong(r[0]).putInt(r[1].toInt()).putInt(r[2].toInt())
+            for (i in 3 until 7) bb.putLong(r[i])
+        }
+        records = bb.array()
+    }
+
+    private fun memory(id: Long, usagePages: Long, peakPages: Long, swapPages: Long) =
+        longArrayOf(id, 1, 0, usagePages, peakPages, swapPages, 0)
+
+    private fun io(id: Long, major: Int, minor: Int, rbytes: Long, wbytes: Long, rios: Long, wios: Long) =
+        longArrayOf(id, 2, ((major shl 20) or minor).toLong(), rbytes, wbytes, rios, wios)
+
+    @Test
+    fun `one pass serves memory and io of every cgroup`() {
+        pass(
+            memory(100, 256, 512, 1), io(100, 8, 0, 4096, 1024, 2, 1), io(100, 259, 3, 8192, 0, 4, 0),
+            memory(200, 10, 10, 0)
+        )
+
+        assertEquals(IterMemoryStat(256 * 4096L, 512 * 4096L, 4096L), stats.memory("/cg/a"))
+        assertEquals(
+            listOf(DiskIOStat(8, 0, 4096, 1024, 2, 1), DiskIOStat(259, 3, 8192, 0, 4, 0)),
+            stats.diskIO("/cg/a")
+        )
+        // Walked but no io: empty rather than a fallback to io.stat
+        assertEquals(emptyList<DiskIOStat>(), stats.diskIO("/cg/b"))
+        assertEquals(2.0, registry.get("kpod.cgroup.iter.cgroups").gauge().value())
+        verify(exactly = 1) { bridge.iterRead(5, any()) }
+    }
+
+    @Test
+    fun `takes a new pass once the last one is stale`() {
+        pass(memory(100, 1, 1, 0))
+        assertEquals(4096L, stats.memory("/cg/a")!!.usageBytes)
+
+        pass(memory(100, 2, 2, 0))
+        now = 500
+        assertEquals(4096L, stats.memory("/cg/a")!!.usageBytes)
+        now = 1000
+        assertEquals(8192L, stats.memory("/cg/a")!!.usageBytes)
+    }
+
+    @Test
+    fun `grows its buffer for large passes`() {
+        pass(*Array(2000) { memory(100 + it.toLong(), 1, 1, 0) })
+        assertNotNull(stats.memory("/cg/a"))
+        assertEquals(2000.0, registry.get("kpod.cgroup.iter.cgroups").gauge().value())
+    }
+
+    @Test
+    fun `cgroups missing from the pass or a failed pass fall back to files`() {
+        pass(memory(100, 1, 1, 0))
+        assertNull(stats.memory("/cg/b"))
+        assertNull(stats.diskIO("/cg/unknown"))
+
+        every { bridge.iterRead(5, any()) } returns -9
+        now = 2000
+        assertNull(stats.memory("/cg/a"))
+        assertEquals(1.0, registry.counter("kpod.cgroup.iter.errors").count())
+    }
+
+    @Test
+    fun `reader uses the pass and reads only page cache from memory_stat`() {
+        val dir = tempDir.resolve("pod/c1").createDirectories()
+        dir.resolve("memory.stat").writeText("anon 100\ninactive_file 4096\nactive_file 8192\n")
+        dir.resolve("memory.current").writeText("1\n")
+        ids[dir.toString()] = 300L
+        pass(memory(300, 10, 20, 0), io(300, 8, 0, 512, 0, 1, 0))
+
+        val reader = CgroupReader(CgroupVersion.V2)
+        reader.setIterStats(stats)
+        assertEquals(MemoryStat(40960, 81920, 12288, 0), reader.readMemoryStats(dir.toString()))
+        assertEquals(listOf(DiskIOStat(8, 0, 512, 0, 1, 0)), reader.readDiskIO(dir.toString()))
+    }
+}
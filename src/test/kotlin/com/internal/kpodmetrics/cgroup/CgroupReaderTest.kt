@@ -78,6 +78,40 @@ class CgroupReaderTest {
         assertEquals(1L, eth0.txDrops)
     }
 
+    @Test
+    fun `v2 io_stat skips unknown keys and reflects updated contents`() {
+        val containerDir = tempDir.resolve("container7")
+        containerDir.createDirectories()
+        val ioStat = containerDir.resolve("io.stat")
+        ioStat.writeText("259:0 rbytes=10 wbytes=20 rios=1 wios=2 dbytes=0 dios=0 cost.usage=5\n")
+        val reader = CgroupReader(CgroupVersion.V2)
+        assertEquals(10L, reader.readDiskIO(containerDir.toString()).single().readBytes)
+
+        ioStat.writeText("259:0 rbytes=30 wbytes=40 rios=3 wios=4\n")
+        val stat = reader.readDiskIO(containerDir.toString()).single()
+        assertEquals(259, stat.major)
+        assertEquals(30L, stat.readBytes)
+        assertEquals(4L, stat.writes)
+    }
+
+    @Test
+    fun `reads proc net dev with wide counters`() {
+        val procDir = tempDir.resolve("321/net")
+        procDir.createDirectories()
+        procDir.resolve("dev").writeText(
+            "Inter-|   Receive |  Transmit\n" +
+            " face |bytes packets|bytes packets\n" +
+            "    lo:12 1 0 0 0 0 0 0 12 1 0 0 0 0 0 0\n" +
+            "eth0:123456789012 5 0 0 0 0 0 0 7 8 0 0 0 0 0 0\n"
+        )
+        val reader = CgroupReader(CgroupVersion.V2)
+        val stats = reader.readNetworkStats(tempDir.toString(), 321)
+        assertEquals(listOf("lo", "eth0"), stats.map { it.interfaceName })
+        assertEquals(123456789012L, stats[1].rxBytes)
+        assertEquals(8L, stats[1].txPackets)
+        assertSame(stats[1].interfaceName, reader.readNetworkStats(tempDir.toString(), 321)[1].interfaceName)
+    }
+
     @Test
     fun `v2 reads init pid from cgroup_procs`() {
         val containerDir = tempDir.resolve("container4")
@@ -0,0 +1,116 @@
+package com.internal.kpodmetrics.cgroup
+
+import com.internal.kpodmetrics.model.CgroupVersion
+import org.junit.jupiter.api.AfterEach
+import org.junit.jupiter.api.Assertions.*
+import org.junit.jupiter.api.Test
+import org.junit.jupiter.api.io.TempDir
+import java.io.IOException
+import java.nio.file.Files
+import java.nio.file.Path
+import java.nio.file.StandardWatchEventKinds.ENTRY_CREATE
+import java.nio.file.StandardWatchEventKinds.ENTRY_DELETE
+import java.util.concurrent.CopyOnWriteArrayList
+import kotlin.io.path.createDirectories
+import kotlin.io.path.deleteExisting
+
+class CgroupTreeWatcherTest {
+    @TempDir
+    lateinit var tempDir: Path
+
+    private var watcher: CgroupTreeWatcher? = null
+
+    @AfterEach
+    fun tearDown() {
+        watcher?.close()
+    }
+
+    private fun awaitTrue(condition: () -> Boolean) {
+        val deadline = System.currentTimeMillis() + 5000
+        while (!condition()) {
+            if (System.currentTimeMillis() > deadline) fail<Unit>("condition not met within 5s")
+            Thread.sleep(10)
+        }
+    }
+
+    @Test
+    fun `podUidOf parses systemd and cgroupfs pod directories`() {
+        assertEquals(
+            "12345678-1234-1234-1234-123456789abc",
+            CgroupTreeWatcher.podUidOf("kubepods-burstable-pod12345678_1234_1234_1234_123456789abc.slice")
+        )
+        assertEquals("abcd-ef01", CgroupTreeWatcher.podUidOf("kubepods-podabcd_ef01.slice"))
+        assertEquals("abcd-ef01", CgroupTreeWatcher.podUidOf("podabcd-ef01"))
+        assertNull(CgroupTreeWatcher.podUidOf("kubepods-burstable.slice"))
+        assertNull(CgroupTreeWatcher.podUidOf("cri-containerd-abc.scope"))
+    }
+
+    @Test
+    fun `loads existing tree on start`() {
+        val podDir = tempDir.resolve("kubepods.slice/kubepods-burstable.slice/kubepods-burstable-podaaaa_bbbb.slice")
+        podDir.resolve("cri-containerd-c1.scope").createDirectories()
+        podDir.resolve("cri-containerd-c2.scope").createDirectories()
+        Files.writeString(podDir.resolve("cgroup.procs"), "")
+
+        val w = CgroupTreeWatcher(tempDir.toString(), CgroupVersion.V2).also { watcher = it }
+        w.start()
+
+        assertTrue(w.ready)
+        assertEquals(podDir.toString(), w.podPath("aaaa-bbbb"))
+        assertEquals(setOf("c1", "c2"), w.containers("aaaa-bbbb").map { it.containerId }.toSet())
+        val node = w.findByContainerId("c1")!!
+        assertEquals(node, w.findByCgroupId(node.cgroupId))
+        assertEquals(Files.getAttribute(podDir.resolve("cri-containerd-c1.scope"), "unix:ino"), node.cgroupId)
+    }
+
+    @Test
+    fun `follows pod and container creation and removal`() {
+        val qos = tempDir.resolve("kubepods/besteffort").createDirectories()
+        val added = CopyOnWriteArrayList<ContainerCgroupNode>()
+        val removed = CopyOnWriteArrayList<ContainerCgroupNode>()
+        val w = CgroupTreeWatcher(tempDir.toString(), CgroupVersion.V2).also { watcher = it }
+        w.addListener(object : CgroupTreeWatcher.Listener {
+            override fun onContainerAdded(node: ContainerCgroupNode) { added.add(node) }
+            override fun onContainerRemoved(node: ContainerCgroupNode) { removed.add(node) }
+        })
+        w.start()
+        assertEquals(0, w.podCount())
+
+        val podDir = qos.resolve("pod1111-2222").createDirectories()
+        val container = podDir.resolve("abcdef").createDirectories()
+        awaitTrue { w.findByContainerId("abcdef") != null }
+        assertEquals("1111-2222", added.single().podUid)
+        assertEquals(container.toString(), added.single().path)
+
+        container.deleteExisting()
+        awaitTrue { w.findByContainerId("abcdef") == null }
+        assertEquals(added.single(), removed.single())
+
+        podDir.deleteExisting()
+        awaitTrue { w.podPath("1111-2222") == null }
+        assertEquals(0, w.containerCount())
+    }
+
+    @Test
+    fun `not ready without a kubepods directory`() {
+        val w = CgroupTreeWatcher(tempDir.toString(), CgroupVersion.V2).also { watcher = it }
+        w.start()
+        assertFalse(w.ready)
+        assertTrue(w.containers("any").isEmpty())
+    }
+
+    @Test
+    fun `lists a directory whose watch cannot be added`() {
+        val podDir = tempDir.resolve("kubepods.slice/kubepods-podcccc_dddd.slice")
+        podDir.resolve("cri-containerd-c3.scope").createDirectories()
+
+        val w = CgroupTreeWatcher(tempDir.toString(), CgroupVersion.V2, register = { dir, ws ->
+            if (dir == podDir) throw IOException("No space left on device")
+            dir.register(ws, ENTRY_CREATE, ENTRY_DELETE)
+        }).also { watcher = it }
+        w.start()
+
+        assertTrue(w.ready)
+        assertEquals(listOf("c3"), w.containers("cccc-dddd").map { it.containerId })
+    }
+}
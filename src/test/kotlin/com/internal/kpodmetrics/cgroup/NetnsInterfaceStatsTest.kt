@@ -0,0 +1,89 @@
+package com.internal.kpodmetrics.cgroup
+
+import com.internal.kpodmetrics.bpf.BpfBridge
+import com.internal.kpodmetrics.model.CgroupVersion
+import io.mockk.every
+import io.mockk.mockk
+import io.mockk.verify
+import org.junit.jupiter.api.Assertions.*
+import org.junit.jupiter.api.Test
+import org.junit.jupiter.api.io.TempDir
+import java.nio.file.Files
+import java.nio.file.Path
+import java.nio.file.Paths
+import kotlin.io.path.createDirectories
+import kotlin.io.path.writeText
+
+class NetnsInterfaceStatsTest {
+    @TempDir
+    lateinit var tempDir: Path
+
+    private val reader = CgroupReader(CgroupVersion.V2)
+
+    private fun pid(pid: Int, netns: Long?, rxBytes: Long = 0) {
+        val dir = tempDir.resolve("$pid").createDirectories()
+        if (netns != null) {
+            Files.createSymbolicLink(dir.resolve("ns").createDirectories().resolve("net"), Paths.get("net:[$netns]"))
+        }
+        dir.resolve("net").createDirectories().resolve("dev").writeText(
+            "Inter-|\n face |\n  eth0: $rxBytes 1 0 0 0 0 0 0 7 1 0 0 0 0 0 0\n"
+        )
+    }
+
+    private fun stat(rxBytes: Long) = NetworkStat("eth0", rxBytes, 1, 0, 0, 7, 1, 0, 0)
+
+    @Test
+    fun `reads each network namespace once per cycle`() {
+        pid(10, netns = 4026531992)
+        pid(11, netns = 4026531992)
+        pid(12, netns = 4026532500)
+        val bridge = mockk<BpfBridge>()
+        every { bridge.netnsLinkStats("$tempDir/10/ns/net") } returns listOf(stat(100))
+        every { bridge.netnsLinkStats("$tempDir/11/ns/net") } returns listOf(stat(110))
+        every { bridge.netnsLinkStats("$tempDir/12/ns/net") } returns listOf(stat(200))
+        val stats = NetnsInterfaceStats(tempDir.toString(), reader, bridge)
+
+        stats.beginCycle()
+        assertEquals(100L, stats.read(10).single().rxBytes)
+        assertEquals(100L, stats.read(11).single().rxBytes)
+        assertEquals(200L, stats.read(12).single().rxBytes)
+        assertEquals(2, stats.namespacesRead())
+        stats.beginCycle()
+        stats.read(11)
+
+        verify(exactly = 1) { bridge.netnsLinkStats("$tempDir/10/ns/net") }
+        verify(exactly = 1) { bridge.netnsLinkStats("$tempDir/11/ns/net") }
+    }
+
+    @Test
+    fun `falls back to proc net dev and stops trying netlink that never works`() {
+        for (p in 20..24) pid(p, netns = 4026533000L + p, rxBytes = p.toLong())
+        val bridge = mockk<BpfBridge>()
+        every { bridge.netnsLinkStats(any()) } returns null
+        val stats = NetnsInterfaceStats(tempDir.toString(), reader, bridge)
+
+        stats.beginCycle()
+        for (p in 20..24) assertEquals(p.toLong(), stats.read(p).single().rxBytes)
+
+        verify(exactly = 3) { bridge.netnsLinkStats(any()) }
+    }
+
+    @Test
+    fun `pid without a readable namespace is read directly`() {
+        pid(30, netns = null, rxBytes = 55)
+        val stats = NetnsInterfaceStats(tempDir.toString(), reader)
+
+        stats.beginCycle()
+        assertEquals(55L, stats.read(30).single().rxBytes)
+        assertEquals(0, stats.namespacesRead())
+    }
+
+    @Test
+    fun `parses the namespace inode from the link target`() {
+        pid(40, netns = 4026531840)
+        val stats = NetnsInterfaceStats(tempDir.toString(), reader)
+
+        assertEquals(4026531840L, stats.netnsInode(40))
+        assertNull(stats.netnsInode(41))
+    }
+}
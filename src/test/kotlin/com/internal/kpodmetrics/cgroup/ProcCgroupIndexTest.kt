@@ -0,0 +1,109 @@
+package com.internal.kpodmetrics.cgroup
+
+import org.junit.jupiter.api.Assertions.*
+import org.junit.jupiter.api.Test
+import org.junit.jupiter.api.io.TempDir
+import java.nio.file.Files
+import java.nio.file.Path
+import kotlin.io.path.createDirectories
+import kotlin.io.path.writeText
+
+class ProcCgroupIndexTest {
+    @TempDir
+    lateinit var tempDir: Path
+
+    private val proc by lazy { tempDir.resolve("proc").createDirectories() }
+    private val cgroupRoot by lazy { tempDir.resolve("cgroup").createDirectories() }
+    private var now = 0L
+
+    private fun index() = ProcCgroupIndex(proc, cgroupRoot, minRefreshMs = 1000, clock = { now })
+
+    private fun process(pid: Int, cgroupPath: String, startTime: Long = 1000L + pid) {
+        val dir = proc.resolve(pid.toString()).createDirectories()
+        dir.resolve("cgroup").writeText("0::$cgroupPath\n")
+        dir.resolve("stat").writeText("$pid (app) S 1 $pid $pid 0 -1 4194560 0 0 0 0 0 0 0 0 20 0 1 0 $startTime 0 0\n")
+        cgroupRoot.resolve(cgroupPath.removePrefix("/")).createDirectories()
+    }
+
+    private fun exit(pid: Int) {
+        val dir = proc.resolve(pid.toString())
+        Files.delete(dir.resolve("cgroup"))
+        Files.delete(dir.resolve("stat"))
+        Files.delete(dir)
+    }
+
+    private fun inode(cgroupPath: String): Long =
+        Files.getAttribute(cgroupRoot.resolve(cgroupPath.removePrefix("/")), "unix:ino") as Long
+
+    private val podA = "/kubepods.slice/kubepods-burstable.slice/kubepods-burstable-podaaa.slice"
+
+    @Test
+    fun `one pass indexes every container`() {
+        process(1, "/init.scope")
+        process(10, "$podA/cri-containerd-c1.scope")
+        process(11, "$podA/cri-containerd-c1.scope")
+        process(20, "$podA/cri-containerd-c2.scope")
+        val index = index()
+
+        assertEquals(inode("$podA/cri-containerd-c1.scope"), index.cgroupIdOf("c1"))
+        assertEquals(inode("$podA/cri-containerd-c2.scope"), index.cgroupIdOf("c2"))
+        assertEquals(2, index.size())
+    }
+
+    @Test
+    fun `misses rescan at most once per interval and only read new processes`() {
+        process(10, "$podA/cri-containerd-c1.scope")
+        val index = index()
+        assertNull(index.cgroupIdOf("c2"))
+
+        process(20, "$podA/cri-containerd-c2.scope")
+        // An already indexed process with changed content is not read again
+        proc.resolve("10/cgroup").writeText("0::/other\n")
+        now = 500
+        assertNull(index.cgroupIdOf("c2"))
+        now = 1000
+        assertNotNull(index.cgroupIdOf("c2"))
+        assertNotNull(index.cgroupIdOf("c1"))
+    }
+
+    @Test
+    fun `containers whose processes exited are dropped`() {
+        process(10, "$podA/cri-containerd-c1.scope")
+        process(20, "$podA/cri-containerd-c2.scope")
+        val index = index()
+        assertNotNull(index.cgroupIdOf("c1"))
+
+        exit(20)
+        now = 1000
+        assertNull(index.cgroupIdOf("c3"))
+        assertEquals(1, index.size())
+    }
+
+    @Test
+    fun `a reused pid is read again`() {
+        process(10, "$podA/cri-containerd-c1.scope")
+        val index = index()
+        assertNotNull(index.cgroupIdOf("c1"))
+
+        // pid 10 exited and was reused by a process of another container between passes
+        process(10, "$podA/cri-containerd-c2.scope", startTime = 9000)
+        now = 1000
+        assertEquals(inode("$podA/cri-containerd-c2.scope"), index.cgroupIdOf("c2"))
+        assertEquals(1, index.size())
+    }
+
+    @Test
+    fun `parses the start time after a command name with spaces`() {
+        assertEquals(12345L, ProcCgroupIndex.parseStartTime(
+            "42 (my (odd) cmd) S 1 42 42 0 -1 4194560 0 0 0 0 0 0 0 0 20 0 1 0 12345 0 0\n"
+        ))
+        assertNull(ProcCgroupIndex.parseStartTime("42 (cmd) S 1\n"))
+    }
+
+    @Test
+    fun `parses cgroup v1 content`() {
+        val content = "12:pids:/kubepods/burstable/podabc/def456\n0::/\n"
+        assertEquals("/kubepods/burstable/podabc/def456", ProcCgroupIndex.parseCgroupPath(content))
+        assertNull(ProcCgroupIndex.parseCgroupPath("0::/system.slice/sshd.service\n"))
+    }
+}
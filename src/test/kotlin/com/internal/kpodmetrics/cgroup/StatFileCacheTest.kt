@@ -0,0 +1,98 @@
+package com.internal.kpodmetrics.cgroup
+
+import org.junit.jupiter.api.AfterEach
+import org.junit.jupiter.api.Assertions.*
+import org.junit.jupiter.api.Test
+import org.junit.jupiter.api.io.TempDir
+import java.nio.file.Path
+import kotlin.io.path.createDirectories
+import kotlin.io.path.deleteExisting
+import kotlin.io.path.writeText
+
+class StatFileCacheTest {
+    @TempDir
+    lateinit var tempDir: Path
+
+    private var now = 0L
+    private val cache = StatFileCache(idleTimeoutMs = 300_000, clock = { now })
+
+    @AfterEach
+    fun tearDown() = cache.close()
+
+    private fun readLong(dir: Path, file: StatFile): Long? {
+        val scanner = cache.borrow()
+        try {
+            return if (cache.read(dir.toString(), file, scanner)) scanner.nextLong() else null
+        } finally {
+            cache.giveBack(scanner)
+        }
+    }
+
+    @Test
+    fun `re-reads the same open file`() {
+        val dir = tempDir.resolve("pod1").createDirectories()
+        dir.resolve("memory.current").writeText("100\n")
+
+        assertEquals(100L, readLong(dir, StatFile.MEMORY_CURRENT))
+        dir.resolve("memory.current").writeText("250\n")
+
+        assertEquals(250L, readLong(dir, StatFile.MEMORY_CURRENT))
+        assertEquals(1, cache.openFiles())
+    }
+
+    @Test
+    fun `missing file is remembered without opening anything`() {
+        val dir = tempDir.resolve("pod2").createDirectories()
+
+        assertNull(readLong(dir, StatFile.MEMORY_PEAK))
+        dir.resolve("memory.peak").writeText("7\n")
+
+        assertNull(readLong(dir, StatFile.MEMORY_PEAK))
+        assertEquals(0, cache.openFiles())
+    }
+
+    @Test
+    fun `missing directory is not cached`() {
+        val dir = tempDir.resolve("later")
+
+        assertNull(readLong(dir, StatFile.MEMORY_CURRENT))
+        dir.createDirectories().resolve("memory.current").writeText("5\n")
+
+        assertEquals(5L, readLong(dir, StatFile.MEMORY_CURRENT))
+    }
+
+    @Test
+    fun `closes directories that went idle`() {
+        val active = tempDir.resolve("active").createDirectories()
+        val gone = tempDir.resolve("gone").createDirectories()
+        active.resolve("memory.current").writeText("1\n")
+        gone.resolve("memory.current").writeText("2\n")
+        readLong(active, StatFile.MEMORY_CURRENT)
+        readLong(gone, StatFile.MEMORY_CURRENT)
+        gone.resolve("memory.current").deleteExisting()
+
+        now += 200_000
+        readLong(active, StatFile.MEMORY_CURRENT)
+        now += 200_000
+        readLong(active, StatFile.MEMORY_CURRENT)
+
+        assertEquals(1, cache.openFiles())
+    }
+
+    @Test
+    fun `grows the buffer for files larger than it`() {
+        val dir = tempDir.resolve("big").createDirectories()
+        val lines = (1..5000).joinToString("\n") { "$it" }
+        dir.resolve("cgroup.procs").writeText(lines)
+        val scanner = cache.borrow()
+
+        assertTrue(cache.read(dir.toString(), StatFile.CGROUP_PROCS, scanner))
+        var last = 0L
+        while (scanner.hasMore()) {
+            last = scanner.nextLong()
+            scanner.nextLine()
+        }
+        assertEquals(5000L, last)
+        assertTrue(scanner.buffer.capacity() > lines.length)
+    }
+}
@@ -0,0 +1,59 @@
+package com.internal.kpodmetrics.cgroup
+
+import org.junit.jupiter.api.Assertions.*
+import org.junit.jupiter.api.Test
+
+class StatScannerTest {
+
+    private fun scanner(text: String) = StatScanner(initialCapacity = 256).also {
+        val bytes = text.toByteArray()
+        it.buffer.clear()
+        it.buffer.put(bytes)
+        it.reset(bytes.size)
+    }
+
+    @Test
+    fun `scanKeyed fills slots by key index`() {
+        val s = scanner("anon 5\nactive_file 30\nfile 9\ninactive_file 20\n")
+
+        s.scanKeyed(StatScanner.keys("inactive_file", "active_file", "shmem"))
+
+        assertEquals(20L, s.values[0])
+        assertEquals(30L, s.values[1])
+        assertEquals(StatScanner.NO_VALUE, s.values[2])
+    }
+
+    @Test
+    fun `keys must match whole tokens`() {
+        val s = scanner("active_file_extra 1\nactive 2\n")
+
+        s.scanKeyed(StatScanner.keys("active_file", "active"))
+
+        assertEquals(StatScanner.NO_VALUE, s.values[0])
+        assertEquals(2L, s.values[1])
+    }
+
+    @Test
+    fun `non-numeric and overflowing values are not parsed`() {
+        val s = scanner("max 99999999999999999999 12x 42")
+
+        assertEquals(StatScanner.NO_VALUE, s.nextLong())
+        assertEquals(StatScanner.NO_VALUE, s.nextLong())
+        assertEquals(StatScanner.NO_VALUE, s.nextLong())
+        assertEquals(42L, s.nextLong())
+    }
+
+    @Test
+    fun `reads key=value pairs and device numbers`() {
+        val s = scanner("259:0 rbytes=10 wbytes=20\n")
+
+        assertEquals(259L, s.nextLong())
+        assertTrue(s.expect(':'))
+        assertEquals(0L, s.nextLong())
+        assertEquals(1, s.matchToken(StatScanner.keys("rios", "rbytes")))
+        assertTrue(s.expect('='))
+        assertEquals(10L, s.nextLong())
+        s.nextToken()
+        assertTrue(s.tokenEquals("wbytes"))
+    }
+}
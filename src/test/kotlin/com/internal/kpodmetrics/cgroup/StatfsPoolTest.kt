@@ -0,0 +1,65 @@
+package com.internal.kpodmetrics.cgroup
+
+import io.micrometer.core.instrument.simple.SimpleMeterRegistry
+import org.junit.jupiter.api.Assertions.*
+import org.junit.jupiter.api.Test
+import java.util.concurrent.ConcurrentHashMap
+import java.util.concurrent.CountDownLatch
+import java.util.concurrent.atomic.AtomicInteger
+
+class StatfsPoolTest {
+    private val registry = SimpleMeterRegistry()
+
+    @Test
+    fun `stats every filesystem once`() {
+        val calls = ConcurrentHashMap<String, AtomicInteger>()
+        StatfsPool(threads = 2, timeoutMs = 1000, registry = registry, stat = { path ->
+            calls.computeIfAbsent(path) { AtomicInteger() }.incrementAndGet()
+            FilesystemStat("", 100, 40, 60)
+        }).use { pool ->
+            val result = pool.statAll(mapOf("8:1" to "/a", "0:21" to "/b"))
+
+            assertEquals(setOf("8:1", "0:21"), result.keys)
+            assertEquals(60L, result["8:1"]!!.availableBytes)
+            assertEquals(1, calls["/a"]!!.get())
+            assertEquals(1, calls["/b"]!!.get())
+        }
+    }
+
+    @Test
+    fun `hung filesystem times out and is not resubmitted until it returns`() {
+        val release = CountDownLatch(1)
+        val hungCalls = AtomicInteger()
+        StatfsPool(threads = 2, timeoutMs = 100, registry = registry, stat = { path ->
+            if (path == "/nfs") {
+                hungCalls.incrementAndGet()
+                release.await()
+            }
+            FilesystemStat("", 100, 40, 60)
+        }).use { pool ->
+            val paths = mapOf("0:50" to "/nfs", "8:1" to "/local")
+
+            val first = pool.statAll(paths)
+            assertEquals(setOf("8:1"), first.keys)
+
+            val second = pool.statAll(paths)
+            assertEquals(setOf("8:1"), second.keys)
+            assertEquals(1, hungCalls.get())
+            assertEquals(2.0, registry.counter("kpod.fs.statfs.timeouts").count())
+
+            release.countDown()
+            Thread.sleep(50)
+            assertEquals(setOf("0:50", "8:1"), pool.statAll(paths).keys)
+            assertEquals(2, hungCalls.get())
+        }
+    }
+
+    @Test
+    fun `failed statfs is left out`() {
+        StatfsPool(registry = registry, stat = { path ->
+            if (path == "/gone") null else throw IllegalStateException("boom")
+        }).use { pool ->
+            assertTrue(pool.statAll(mapOf("0:1" to "/gone", "0:2" to "/broken")).isEmpty())
+        }
+    }
+}
@@ -2,14 +2,13 @@ package com.internal.kpodmetrics.collector
 
 import com.internal.kpodmetrics.bpf.BpfBridge
 import com.internal.kpodmetrics.bpf.BpfProgramManager
+import com.internal.kpodmetrics.bpf.DrainTally
 import io.micrometer.core.instrument.MeterRegistry
 import io.micrometer.core.instrument.simple.SimpleMeterRegistry
 import io.mockk.*
 import org.junit.jupiter.api.Assertions.*
 import org.junit.jupiter.api.BeforeEach
 import org.junit.jupiter.api.Test
-import java.nio.ByteBuffer
-import java.nio.ByteOrder
 
 class BpfMapStatsCollectorTest {
 
@@ -35,15 +34,9 @@ class BpfMapStatsCollectorTest {
         every { programManager.getMapFd("cpu_sched", "ctx_switches_stats") } returns 10
         every { programManager.getMapFd("cpu_sched", "runq_latency_stats") } returns 11
 
-        // entries stat (index 0)
-        val entriesKey = ByteBuffer.allocate(4).order(ByteOrder.LITTLE_ENDIAN).putInt(0).array()
-        every { bridge.mapLookupPercpuSum(10, entriesKey, 8) } returns 150L
-        every { bridge.mapLookupPercpuSum(11, entriesKey, 8) } returns 200L
-
-        // update errors stat (index 1)
-        val errorsKey = ByteBuffer.allocate(4).order(ByteOrder.LITTLE_ENDIAN).putInt(1).array()
-        every { bridge.mapLookupPercpuSum(10, errorsKey, 8) } returns 3L
-        every { bridge.mapLookupPercpuSum(11, errorsKey, 8) } returns 0L
+        // Both stats in one lookup: [entries (index 0), update errors (index 1)]
+        every { bridge.mapLookupPercpuSums(10, any(), 8) } returns listOf(150L, 3L)
+        every { bridge.mapLookupPercpuSums(11, any(), 8) } returns listOf(200L, 0L)
 
         collector.collect()
 
@@ -74,13 +67,8 @@ class BpfMapStatsCollectorTest {
         every { programManager.getMapFd("net", "tcp_stats_map_stats") } returns 20
         every { programManager.getMapFd("net", "rtt_hist_stats") } returns 21
 
-        val entriesKey = ByteBuffer.allocate(4).order(ByteOrder.LITTLE_ENDIAN).putInt(0).array()
-        every { bridge.mapLookupPercpuSum(20, entriesKey, 8) } returns 50L
-        every { bridge.mapLookupPercpuSum(21, entriesKey, 8) } returns 30L
-
-        val errorsKey = ByteBuffer.allocate(4).order(ByteOrder.LITTLE_ENDIAN).putInt(1).array()
-        every { bridge.mapLookupPercpuSum(20, errorsKey, 8) } returns 0L
-        every { bridge.mapLookupPercpuSum(21, errorsKey, 8) } returns 0L
+        every { bridge.mapLookupPercpuSums(20, any(), 8) } returns listOf(50L, 0L)
+        every { bridge.mapLookupPercpuSums(21, any(), 8) } returns listOf(30L, 0L)
 
         assertDoesNotThrow { collector.collect() }
 
@@ -89,4 +77,48 @@ class BpfMapStatsCollectorTest {
             it.id.name == "kpod.bpf.map.entries" && it.id.getTag("map") == "tcp_stats_map"
         })
     }
+
+    @Test
+    fun `infers evictions from inserts the drains never saw`() {
+        every { programManager.isProgramLoaded(any()) } returns false
+        every { programManager.isProgramLoaded("cpu_sched") } returns true
+        every { programManager.getMapFd("cpu_sched", "ctx_switches_stats") } returns 10
+        every { programManager.getMapFd("cpu_sched", "ctx_switches") } returns 30
+        every { programManager.getMapFd("cpu_sched", "runq_latency_stats") } throws RuntimeException("not loaded")
+
+        every { bridge.mapLookupPercpuSums(10, any(), 8) } returnsMany listOf(listOf(100L, 2L), listOf(150L, 2L))
+
+        val tally = DrainTally()
+        every { bridge.drainTally(30) } returns tally
+
+        collector.collect()
+        // 100 keys inserted before the first read, only 60 of them reach the drain
+        tally.record(60)
+        collector.collect()
+
+        val tags = arrayOf("map", "ctx_switches")
+        assertEquals(2.0, registry.find("kpod.bpf.map.update.errors.total").tags(*tags).counter()!!.count())
+        assertEquals(40.0, registry.find("kpod.bpf.map.evictions.total").tags(*tags).counter()!!.count())
+        assertEquals(42.0, registry.find("kpod.bpf.map.lost.updates.total").tags(*tags).counter()!!.count())
+        assertEquals(50.0, registry.find("kpod.bpf.map.entries").tags(*tags).gauge()!!.value())
+        assertEquals(60.0, registry.find("kpod.bpf.map.occupancy.high.water").tags(*tags).gauge()!!.value())
+    }
+
+    @Test
+    fun `update errors are counted once`() {
+        every { programManager.isProgramLoaded(any()) } returns false
+        every { programManager.isProgramLoaded("net") } returns true
+        every { programManager.getMapFd("net", "tcp_stats_map_stats") } returns 20
+        every { programManager.getMapFd("net", "rtt_hist_stats") } throws RuntimeException("not loaded")
+        every { bridge.drainTally(any()) } returns null
+
+        every { bridge.mapLookupPercpuSums(20, any(), 8) } returnsMany
+            listOf(listOf(10L, 3L), listOf(10L, 3L), listOf(10L, 5L))
+
+        repeat(3) { collector.collect() }
+
+        assertEquals(5.0, registry.find("kpod.bpf.map.update.errors.total").counter()!!.count())
+        assertEquals(5.0, registry.find("kpod.bpf.map.lost.updates.total").counter()!!.count())
+        assertNull(registry.find("kpod.bpf.map.evictions.total").counter())
+    }
 }
@@ -0,0 +1,77 @@
+package com.internal.kpodmetrics.collector
+
+import com.internal.kpodmetrics.bpf.BpfBridge
+import com.internal.kpodmetrics.bpf.BpfProgramManager
+import com.internal.kpodmetrics.bpf.BpfProgramStats
+import io.micrometer.core.instrument.simple.SimpleMeterRegistry
+import io.mockk.*
+import org.junit.jupiter.api.Assertions.*
+import org.junit.jupiter.api.BeforeEach
+import org.junit.jupiter.api.Test
+
+class BpfOverheadCollectorTest {
+
+    private lateinit var bridge: BpfBridge
+    private lateinit var programManager: BpfProgramManager
+    private lateinit var registry: SimpleMeterRegistry
+    private lateinit var collector: BpfOverheadCollector
+
+    @BeforeEach
+    fun setup() {
+        bridge = mockk(relaxed = true)
+        programManager = mockk(relaxed = true)
+        registry = SimpleMeterRegistry()
+        collector = BpfOverheadCollector(bridge, programManager, registry)
+        every { programManager.getLoadedProgramNames() } returns setOf("cpu_sched")
+        every { programManager.getHandle("cpu_sched") } returns 1L
+    }
+
+    private fun stats(switchNs: Long, switchCnt: Long, wakeupNs: Long, wakeupCnt: Long, misses: Long = 0) = listOf(
+        BpfProgramStats("handle_sched_switch", "tracepoint/sched/sched_switch", switchNs, switchCnt, misses),
+        BpfProgramStats("handle_sched_wakeup", "tracepoint/sched/sched_wakeup", wakeupNs, wakeupCnt, 0)
+    )
+
+    private fun hook(name: String, fn: String) = registry.find(name).tag("function", fn)
+
+    @Test
+    fun `emits per-hook counters and ns per event over the interval`() {
+        every { bridge.getProgramStats(1L) } returnsMany listOf(
+            stats(1_000, 10, 500, 10),
+            stats(5_000, 30, 700, 12, misses = 3)
+        )
+
+        collector.collect()
+        collector.collect()
+
+        assertEquals(5_000.0, hook("kpod.bpf.hook.run.time.ns", "handle_sched_switch").counter()!!.count())
+        assertEquals(30.0, hook("kpod.bpf.hook.run.count", "handle_sched_switch").counter()!!.count())
+        assertEquals(3.0, hook("kpod.bpf.hook.recursion.misses", "handle_sched_switch").counter()!!.count())
+        assertEquals(200.0, hook("kpod.bpf.hook.ns.per.event", "handle_sched_switch").gauge()!!.value())
+        assertEquals(100.0, hook("kpod.bpf.hook.ns.per.event", "handle_sched_wakeup").gauge()!!.value())
+        assertEquals("tracepoint/sched/sched_wakeup",
+            hook("kpod.bpf.hook.run.count", "handle_sched_wakeup").counter()!!.id.getTag("attach_point"))
+    }
+
+    @Test
+    fun `object totals are the sum of its programs`() {
+        every { bridge.getProgramStats(1L) } returns stats(1_000, 10, 500, 5)
+
+        collector.collect()
+
+        val tags = registry.find("kpod.bpf.program.run.time.ns").tag("program", "cpu_sched")
+        assertEquals(1_500.0, tags.counter()!!.count())
+        assertEquals(15.0, registry.find("kpod.bpf.program.run.count").counter()!!.count())
+        verify(exactly = 0) { bridge.getProgStats(any()) }
+    }
+
+    @Test
+    fun `falls back to object stats when per-program stats are unavailable`() {
+        every { bridge.getProgramStats(1L) } returns null
+        every { bridge.getProgStats(1L) } returns longArrayOf(2_000, 20)
+
+        collector.collect()
+
+        assertEquals(2_000.0, registry.find("kpod.bpf.program.run.time.ns").counter()!!.count())
+        assertNull(registry.find("kpod.bpf.hook.run.count").counter())
+    }
+}
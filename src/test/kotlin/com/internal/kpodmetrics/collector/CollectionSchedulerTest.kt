@@ -0,0 +1,184 @@
+package com.internal.kpodmetrics.collector
+
+import org.junit.jupiter.api.Test
+import org.junit.jupiter.api.io.TempDir
+import java.nio.file.Files
+import java.nio.file.Path
+import kotlin.test.assertEquals
+import kotlin.test.assertFalse
+import kotlin.test.assertNotEquals
+import kotlin.test.assertNull
+import kotlin.test.assertTrue
+
+class CollectionSchedulerTest {
+
+    private var cpuLoad = 0.1
+
+    private fun scheduler() = CollectionScheduler(
+        spreadWindowMs = 8000,
+        spreadSlots = 4,
+        cpuBudget = 0.8,
+        maxStretchFactor = 4,
+        cpuLoadSupplier = { cpuLoad }
+    )
+
+    @Test
+    fun `unknown collectors start immediately`() {
+        val s = scheduler()
+        s.beginCycle(listOf("cpu", "http"))
+        assertEquals(0L, s.offsetMs("cpu"))
+        assertEquals(0L, s.offsetMs("http"))
+    }
+
+    @Test
+    fun `expensive collectors are spread into different slots`() {
+        val s = scheduler()
+        s.recordCost("syscall", 400_000_000, -1, -1)
+        s.recordCost("http", 300_000_000, -1, -1)
+        s.recordCost("cpu", 1_000_000, -1, -1)
+        s.beginCycle(listOf("syscall", "http", "cpu"))
+
+        assertNotEquals(s.offsetMs("syscall"), s.offsetMs("http"))
+        assertTrue(s.offsetMs("syscall") < 8000)
+        assertTrue(s.offsetMs("http") < 8000)
+    }
+
+    @Test
+    fun `cpu pressure stretches the expensive low-volatility collector`() {
+        val s = scheduler()
+        s.recordCost("syscall", 400_000_000, -1, -1)
+        s.recordCost("cpu", 400_000_000, -1, -1)
+        // cpu output keeps changing, syscall output is static
+        repeat(5) {
+            s.recordActivity("cpu", 120)
+            s.recordActivity("syscall", 0)
+        }
+
+        cpuLoad = 0.95
+        s.beginCycle(listOf("syscall", "cpu"))
+
+        assertEquals(2, s.stretchFactor("syscall"))
+        assertEquals(1, s.stretchFactor("cpu"))
+    }
+
+    @Test
+    fun `stretch is capped and relaxed when load drops`() {
+        val s = scheduler()
+        s.recordCost("syscall", 400_000_000, -1, -1)
+        cpuLoad = 0.95
+        repeat(5) { s.beginCycle(listOf("syscall")) }
+        assertEquals(4, s.stretchFactor("syscall"))
+
+        cpuLoad = 0.7
+        s.beginCycle(listOf("syscall"))
+        assertEquals(4, s.stretchFactor("syscall"), "within hysteresis band, no change")
+
+        cpuLoad = 0.2
+        s.beginCycle(listOf("syscall"))
+        assertEquals(2, s.stretchFactor("syscall"))
+    }
+
+    @Test
+    fun `stretched collector is admitted every n-th cycle`() {
+        val s = scheduler()
+        s.recordCost("syscall", 400_000_000, -1, -1)
+        cpuLoad = 0.95
+        s.beginCycle(listOf("syscall"))
+        assertEquals(2, s.stretchFactor("syscall"))
+
+        val admitted = (1..6).map { s.admit("syscall") }
+        assertEquals(listOf(true, false, true, false, true, false), admitted)
+    }
+
+    @Test
+    fun `unavailable cpu load never stretches`() {
+        val s = scheduler()
+        s.recordCost("syscall", 400_000_000, -1, -1)
+        cpuLoad = -1.0
+        s.beginCycle(listOf("syscall"))
+        assertEquals(1, s.stretchFactor("syscall"))
+    }
+
+    @Test
+    fun `load against the container limit stretches a half-cpu agent`(@TempDir dir: Path) {
+        // 0.45 CPU used of a 0.5 CPU limit: 0.9 of the budget, though tiny against host CPUs
+        Files.writeString(dir.resolve("cpu.max"), "50000 100000\n")
+        var usageUs = 1_000_000L
+        var nowNs = 0L
+        fun writeUsage() = Files.writeString(dir.resolve("cpu.stat"), "usage_usec $usageUs\nuser_usec 0\n")
+        writeUsage()
+        val load = ContainerCpuLoad(dir, nanoTime = { nowNs }, hostLoad = { 0.007 })
+        val s = CollectionScheduler(spreadWindowMs = 0, cpuLoadSupplier = load::sample)
+        s.recordCost("syscall", 400_000_000, -1, -1)
+
+        s.beginCycle(listOf("syscall"))
+        assertEquals(1, s.stretchFactor("syscall"), "no load known before the second sample")
+        assertNull(s.snapshot()["cpuLoad"])
+
+        nowNs += 10_000_000_000
+        usageUs += 4_500_000
+        writeUsage()
+        s.beginCycle(listOf("syscall"))
+        assertEquals(0.9, s.snapshot()["cpuLoad"] as Double, 1e-9)
+        assertEquals(2, s.stretchFactor("syscall"))
+    }
+
+    @Test
+    fun `container load falls back to host load without a limit`(@TempDir dir: Path) {
+        Files.writeString(dir.resolve("cpu.max"), "max 100000\n")
+        Files.writeString(dir.resolve("cpu.stat"), "usage_usec 5\n")
+        val load = ContainerCpuLoad(dir, hostLoad = { 0.3 })
+        assertEquals(0.3, load.sample())
+        assertEquals(0.3, ContainerCpuLoad(null, hostLoad = { 0.3 }).sample())
+    }
+
+    @Test
+    fun `own cgroup is found below the mount or at its root`(@TempDir dir: Path) {
+        val procCgroup = dir.resolve("cgroup")
+        Files.writeString(procCgroup, "0::/kubepods/pod1/c1\n")
+        val nested = Files.createDirectories(dir.resolve("fs/kubepods/pod1/c1"))
+        Files.writeString(nested.resolve("cpu.stat"), "usage_usec 1\n")
+        assertEquals(nested, ContainerCpuLoad.ownCgroupDir(procCgroup, dir.resolve("fs")))
+
+        // A v1 mount of only the container's cgroup has it at the mount root
+        Files.writeString(procCgroup, "12:cpu,cpuacct:/kubepods/pod1/c1\n")
+        val v1 = Files.createDirectories(dir.resolve("v1/cpu,cpuacct"))
+        Files.writeString(v1.resolve("cpu.cfs_quota_us"), "-1\n")
+        assertEquals(v1, ContainerCpuLoad.ownCgroupDir(procCgroup, dir.resolve("v1")))
+    }
+
+    @Test
+    fun `runs without output lower volatility`() {
+        val s = scheduler()
+        // The first run only drains the backlog from before the agent started
+        s.recordActivity("syscall", 500)
+        repeat(10) { s.recordActivity("syscall", 0) }
+        s.recordActivity("cpu", 0)
+        repeat(10) { s.recordActivity("cpu", 3) }
+
+        @Suppress("UNCHECKED_CAST")
+        val collectors = s.snapshot()["collectors"] as Map<String, Map<String, Any?>>
+        assertTrue((collectors["syscall"]!!["volatility"] as Double) < 0.1)
+        assertEquals(1.0, collectors["cpu"]!!["volatility"] as Double, 1e-9)
+    }
+
+    @Test
+    fun `snapshot exposes budget and schedule`() {
+        val s = scheduler()
+        s.recordCost("cpu", 2_000_000, 1_000_000, 4096)
+        cpuLoad = 0.5
+        s.beginCycle(listOf("cpu"))
+
+        val snapshot = s.snapshot()
+        assertEquals(true, snapshot["enabled"])
+        assertEquals(0.8, snapshot["cpuBudget"])
+        assertEquals(0.5, snapshot["cpuLoad"])
+        assertFalse(snapshot["underPressure"] as Boolean)
+
+        @Suppress("UNCHECKED_CAST")
+        val cpu = (snapshot["collectors"] as Map<String, Map<String, Any?>>)["cpu"]!!
+        assertEquals(1, cpu["stretchFactor"])
+        assertEquals(1.0, cpu["avgCpuMs"])
+        assertEquals(4096L, cpu["avgAllocatedBytes"])
+    }
+}
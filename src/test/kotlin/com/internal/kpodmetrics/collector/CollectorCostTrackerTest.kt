@@ -0,0 +1,91 @@
+package com.internal.kpodmetrics.collector
+
+import com.internal.kpodmetrics.bpf.NativeCallCost
+import io.micrometer.core.instrument.simple.SimpleMeterRegistry
+import org.junit.jupiter.api.Assertions.*
+import org.junit.jupiter.api.Test
+import java.util.concurrent.Executors
+
+class CollectorCostTrackerTest {
+
+    private val registry = SimpleMeterRegistry()
+
+    private fun counter(name: String, collector: String) =
+        registry.find(name).tag("collector", collector).counter()!!.count()
+
+    @Test
+    fun `records jvm and jni cost as separate per-collector counters`() {
+        val tracker = CollectorCostTracker(registry)
+
+        tracker.record("http", CollectorCostTracker.Sample(
+            wallNs = 10_000_000, cpuNs = 4_000_000, allocatedBytes = 50_000,
+            jniWallNs = 6_000_000, jniCpuNs = 5_000_000, jniAllocatedBytes = 200_000, jniCalls = 3
+        ))
+
+        assertEquals(4_000_000.0, counter("kpod.collector.cpu.time.ns", "http"))
+        assertEquals(50_000.0, counter("kpod.collector.allocated.bytes", "http"))
+        assertEquals(6_000_000.0, counter("kpod.collector.jni.time.ns", "http"))
+        assertEquals(5_000_000.0, counter("kpod.collector.jni.cpu.time.ns", "http"))
+        assertEquals(200_000.0, counter("kpod.collector.jni.allocated.bytes", "http"))
+        assertEquals(3.0, counter("kpod.collector.jni.calls", "http"))
+    }
+
+    @Test
+    fun `unmeasurable jvm cost adds nothing while jni cost is still recorded`() {
+        val tracker = CollectorCostTracker(registry)
+
+        tracker.record("dns", CollectorCostTracker.Sample(1_000, -1, -1, 500, 300, 4_096, 1))
+
+        assertEquals(0.0, counter("kpod.collector.cpu.time.ns", "dns"))
+        assertEquals(4_096.0, counter("kpod.collector.jni.allocated.bytes", "dns"))
+    }
+
+    @Test
+    fun `native work on the collector thread is moved out of the thread totals`() {
+        val tracker = CollectorCostTracker(registry)
+        val native = NativeCallCost()
+        NativeCallCost.bind(native) { native.measure { ByteArray(1 shl 20) } }
+
+        tracker.record("cpu", 10_000_000, 2_000_000, 2_000_000, native)
+
+        assertEquals(1L, native.calls)
+        assertTrue(native.inlineAllocatedBytes >= 1 shl 20)
+        assertEquals(2_000_000.0 - native.inlineAllocatedBytes,
+            counter("kpod.collector.allocated.bytes", "cpu"))
+        assertEquals(native.allocatedBytes.toDouble(), counter("kpod.collector.jni.allocated.bytes", "cpu"))
+    }
+
+    @Test
+    fun `native work offloaded to another thread stays out of the inline share`() {
+        val native = NativeCallCost()
+        val pool = Executors.newSingleThreadExecutor()
+        try {
+            pool.submit { native.measure { ByteArray(1 shl 16) } }.get()
+        } finally {
+            pool.shutdown()
+        }
+
+        assertEquals(1L, native.calls)
+        assertEquals(0L, native.inlineAllocatedBytes)
+        assertTrue(native.allocatedBytes >= 1 shl 16)
+    }
+
+    @Test
+    fun `snapshot ranks collectors over a rolling window`() {
+        val tracker = CollectorCostTracker(window = 2, topN = 2)
+        tracker.record("cpu", CollectorCostTracker.Sample(0, 0, 1_000_000, 0, 0, 0, 0))
+        repeat(2) { tracker.record("cpu", CollectorCostTracker.Sample(0, 0, 10, 0, 0, 0, 0)) }
+        tracker.record("http", CollectorCostTracker.Sample(0, 9_000_000, 100, 0, 0, 900, 1))
+        tracker.record("dns", CollectorCostTracker.Sample(0, 1_000_000, 500, 0, 0, 0, 0))
+
+        val snapshot = tracker.snapshot()
+
+        @Suppress("UNCHECKED_CAST")
+        val byAlloc = snapshot["topByAllocation"] as List<Map<String, Any?>>
+        assertEquals(listOf("http", "dns"), byAlloc.map { it["collector"] })
+        @Suppress("UNCHECKED_CAST")
+        val byCpu = snapshot["topByCpu"] as List<Map<String, Any?>>
+        assertEquals("http", byCpu[0]["collector"])
+        assertEquals(9.0, byCpu[0]["avgCpuMs"])
+    }
+}
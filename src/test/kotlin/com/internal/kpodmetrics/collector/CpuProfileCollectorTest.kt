@@ -45,13 +45,13 @@ class CpuProfileCollectorTest {
         val stackVal2 = ByteBuffer.allocate(8).order(ByteOrder.LITTLE_ENDIAN)
             .putLong(0x0040_1000L).array()
 
-        every { bridge.mapLookup(11, any(), any()) } answers {
-            val keyArg = secondArg<ByteArray>()
-            val stackId = ByteBuffer.wrap(keyArg).order(ByteOrder.LITTLE_ENDIAN).int
-            when (stackId) {
-                1 -> stackVal1
-                2 -> stackVal2
-                else -> null
+        every { bridge.mapLookupAll(11, any(), any()) } answers {
+            secondArg<List<ByteArray>>().map { keyArg ->
+                when (ByteBuffer.wrap(keyArg).order(ByteOrder.LITTLE_ENDIAN).int) {
+                    1 -> stackVal1
+                    2 -> stackVal2
+                    else -> null
+                }
             }
         }
 
@@ -148,14 +148,16 @@ class CpuProfileCollectorTest {
 
         val stackIps = ByteBuffer.allocate(16).order(ByteOrder.LITTLE_ENDIAN)
             .putLong(0xC000_0001L).putLong(0L).array()
-        every { bridge.mapLookup(11, any(), any()) } returns stackIps
+        val keys = slot<List<ByteArray>>()
+        every { bridge.mapLookupAll(11, capture(keys), any()) } answers { keys.captured.map { stackIps } }
 
         val profiles = collector.collect()
 
         assertEquals(1, profiles.size)
         assertEquals(2, profiles.values.first().size)
-        // Stack 5 should only be looked up once due to caching
-        verify(exactly = 1) { bridge.mapLookup(11, any(), any()) }
+        // Stack 5 is looked up once, in the single lookup call for the cycle
+        verify(exactly = 1) { bridge.mapLookupAll(11, any(), any()) }
+        assertEquals(1, keys.captured.size)
     }
 
     @Test
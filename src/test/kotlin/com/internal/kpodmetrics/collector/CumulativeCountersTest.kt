@@ -0,0 +1,103 @@
+package com.internal.kpodmetrics.collector
+
+import io.micrometer.core.instrument.Tags
+import io.micrometer.core.instrument.simple.SimpleMeterRegistry
+import org.junit.jupiter.api.Assertions.*
+import org.junit.jupiter.api.Test
+
+class CumulativeCountersTest {
+    private val registry = SimpleMeterRegistry()
+    private val counters = CumulativeCounters<String>(registry, listOf("test.bytes", "test.ops"), maxIdleCycles = 2, initialSlots = 1)
+
+    private fun record(key: String, generation: String, bytes: Long, ops: Long) {
+        var slot = counters.slotOf(key)
+        if (slot < 0) slot = counters.add(key, Tags.of("series", key))
+        counters.values[0] = bytes
+        counters.values[1] = ops
+        counters.record(slot, generation)
+    }
+
+    private fun bytes(key: String) = registry.get("test.bytes").tag("series", key).counter().count()
+    private fun ops(key: String) = registry.get("test.ops").tag("series", key).counter().count()
+
+    @Test
+    fun `first sample counts in full and later samples add the difference`() {
+        counters.beginCycle()
+        record("a", "/cg/a", 1000, 10)
+        counters.beginCycle()
+        record("a", "/cg/a", 1500, 10)
+        counters.beginCycle()
+        record("a", "/cg/a", 1700, 12)
+
+        assertEquals(1700.0, bytes("a"))
+        assertEquals(12.0, ops("a"))
+    }
+
+    @Test
+    fun `recreated cgroup resets the series instead of going negative`() {
+        counters.beginCycle()
+        record("a", "/cg/old", 5000, 50)
+        // Same pod and container name, new cgroup: its counters restart from zero
+        counters.beginCycle()
+        record("a", "/cg/new", 300, 3)
+        assertEquals(5300.0, bytes("a"))
+        assertEquals(53.0, ops("a"))
+
+        // A counter going backwards under the same cgroup is a reset as well
+        counters.beginCycle()
+        record("a", "/cg/new", 100, 4)
+        assertEquals(5400.0, bytes("a"))
+        assertEquals(57.0, ops("a"))
+    }
+
+    @Test
+    fun `counts the series that moved each cycle`() {
+        counters.beginCycle()
+        record("a", "/cg/a", 10, 1)
+        record("b", "/cg/b", 10, 1)
+        assertEquals(2, counters.changedSeries())
+
+        counters.beginCycle()
+        record("a", "/cg/a", 10, 1)
+        record("b", "/cg/b", 20, 1)
+        assertEquals(1, counters.changedSeries())
+    }
+
+    @Test
+    fun `slots grow, go idle and are reused`() {
+        counters.beginCycle()
+        for (key in listOf("a", "b", "c")) record(key, "/cg/$key", 10, 1)
+        assertEquals(3, counters.size())
+
+        repeat(3) {
+            counters.beginCycle()
+            record("a", "/cg/a", 10, 1)
+            counters.endCycle()
+        }
+        assertEquals(1, counters.size())
+        assertEquals(-1, counters.slotOf("b"))
+
+        counters.removeWhere { it == "a" }
+        assertEquals(0, counters.size())
+        counters.beginCycle()
+        record("d", "/cg/d", 7, 1)
+        assertEquals(7.0, bytes("d"))
+        assertTrue(counters.slotOf("d") in 0..2)
+    }
+
+    @Test
+    fun `idle series is unregistered and counts once when it returns`() {
+        counters.beginCycle()
+        record("a", "/cg/a", 1000, 10)
+        repeat(3) {
+            counters.beginCycle()
+            counters.endCycle()
+        }
+        assertNull(registry.find("test.bytes").tag("series", "a").counter())
+
+        counters.beginCycle()
+        record("a", "/cg/a", 1200, 12)
+        assertEquals(1200.0, bytes("a"))
+        assertEquals(12.0, ops("a"))
+    }
+}
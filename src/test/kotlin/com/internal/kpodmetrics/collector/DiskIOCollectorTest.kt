@@ -79,4 +79,20 @@ class DiskIOCollectorTest {
         assertNotNull(readBytes)
         assertEquals(1000.0, readBytes?.count())
     }
+
+    @Test
+    fun `cumulative io_stat values are counted once across cycles`() {
+        val containerDir = tempDir.resolve("container3").createDirectories()
+        val ioStat = containerDir.resolve("io.stat")
+        val collector = DiskIOCollector(CgroupReader(CgroupVersion.V2), registry)
+        val targets = listOf(PodCgroupTarget("db", "default", "postgres", containerDir.toString(), "test-node"))
+
+        ioStat.writeText("8:0 rbytes=4096 wbytes=0 rios=1 wios=0 dbytes=0 dios=0\n")
+        collector.collect(targets)
+        ioStat.writeText("8:0 rbytes=6144 wbytes=0 rios=2 wios=0 dbytes=0 dios=0\n")
+        collector.collect(targets)
+
+        assertEquals(6144.0, registry.get("kpod.disk.read.bytes").tag("pod", "db").counter().count())
+        assertEquals(2.0, registry.get("kpod.disk.reads").tag("pod", "db").counter().count())
+    }
 }
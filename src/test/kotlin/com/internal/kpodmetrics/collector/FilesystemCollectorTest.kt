@@ -1,6 +1,8 @@
 package com.internal.kpodmetrics.collector
 
 import com.internal.kpodmetrics.cgroup.CgroupReader
+import com.internal.kpodmetrics.cgroup.FilesystemStat
+import com.internal.kpodmetrics.cgroup.StatfsPool
 import com.internal.kpodmetrics.model.CgroupVersion
 import com.internal.kpodmetrics.model.PodCgroupTarget
 import io.micrometer.core.instrument.simple.SimpleMeterRegistry
@@ -9,6 +11,7 @@ import org.junit.jupiter.api.BeforeEach
 import org.junit.jupiter.api.Test
 import org.junit.jupiter.api.io.TempDir
 import java.nio.file.Path
+import java.util.concurrent.atomic.AtomicInteger
 import kotlin.io.path.createDirectories
 import kotlin.io.path.writeText
 
@@ -56,4 +59,35 @@ class FilesystemCollectorTest {
         collector.collect(targets)
         assertNull(registry.find("kpod.fs.capacity.bytes").tag("pod", "no-pid-pod").gauge())
     }
+
+    @Test
+    fun `statfs runs once per filesystem shared by containers`() {
+        val targets = listOf(42, 43).map { pid ->
+            val containerDir = tempDir.resolve("cgroup/c$pid")
+            containerDir.createDirectories()
+            containerDir.resolve("cgroup.procs").writeText("$pid\n")
+            val procDir = tempDir.resolve("proc/$pid")
+            procDir.resolve("root").createDirectories()
+            procDir.resolve("mountinfo").writeText(
+                "${pid * 10} 1 0:$pid / / rw,relatime - overlay overlay rw\n" +
+                "${pid * 10 + 1} 22 8:1 /var/lib/kubelet/pods/x /data rw,relatime - ext4 /dev/sda1 rw\n"
+            )
+            PodCgroupTarget("pod-$pid", "default", "app", containerDir.toString(), "test-node")
+        }
+        val calls = AtomicInteger()
+        val statfs = StatfsPool(registry = registry, stat = {
+            calls.incrementAndGet()
+            FilesystemStat("", 1000, 400, 600)
+        })
+
+        FilesystemCollector(CgroupReader(CgroupVersion.V2), tempDir.resolve("proc").toString(), registry, statfs)
+            .use { it.collect(targets) }
+
+        // Two overlay roots plus one shared ext4 volume
+        assertEquals(3, calls.get())
+        for (pod in listOf("pod-42", "pod-43")) {
+            val data = registry.find("kpod.fs.available.bytes").tag("pod", pod).tag("mountpoint", "/data").gauge()
+            assertEquals(600.0, data!!.value())
+        }
+    }
 }
@@ -8,7 +8,9 @@ import org.junit.jupiter.api.Assertions.*
 import org.junit.jupiter.api.BeforeEach
 import org.junit.jupiter.api.Test
 import org.junit.jupiter.api.io.TempDir
+import java.nio.file.Files
 import java.nio.file.Path
+import java.nio.file.Paths
 import kotlin.io.path.createDirectories
 import kotlin.io.path.writeText
 
@@ -49,6 +51,52 @@ class InterfaceNetworkCollectorTest {
         assertEquals(3333.0, txPackets.count())
     }
 
+    @Test
+    fun `containers sharing a network namespace get the same stats from one read`() {
+        val procRoot = tempDir.resolve("proc")
+        for ((container, pid) in listOf("app" to 50, "sidecar" to 51)) {
+            val dir = tempDir.resolve("cgroup/$container").createDirectories()
+            dir.resolve("cgroup.procs").writeText("$pid\n")
+            val nsDir = procRoot.resolve("$pid/ns").createDirectories()
+            Files.createSymbolicLink(nsDir.resolve("net"), Paths.get("net:[4026532100]"))
+        }
+        // Only the first pid has a readable net/dev; the second must come from the shared read
+        procRoot.resolve("50/net").createDirectories().resolve("dev").writeText(
+            "Inter-|\n face |\n  eth0: 4096 4 0 0 0 0 0 0 2048 2 0 0 0 0 0 0\n"
+        )
+        val collector = InterfaceNetworkCollector(CgroupReader(CgroupVersion.V2), procRoot.toString(), registry)
+        collector.collect(listOf("app", "sidecar").map {
+            PodCgroupTarget("web", "default", it, tempDir.resolve("cgroup/$it").toString(), "test-node")
+        })
+
+        for (container in listOf("app", "sidecar")) {
+            val rx = registry.find("kpod.net.iface.rx.bytes").tag("container", container).counter()
+            assertEquals(4096.0, rx!!.count(), container)
+        }
+    }
+
+    @Test
+    fun `recreated network namespace under the same cgroup resets the series`() {
+        val dir = tempDir.resolve("cgroup/app").createDirectories()
+        dir.resolve("cgroup.procs").writeText("60\n")
+        val procRoot = tempDir.resolve("proc")
+        val nsLink = procRoot.resolve("60/ns").createDirectories().resolve("net")
+        val dev = procRoot.resolve("60/net").createDirectories().resolve("dev")
+        val collector = InterfaceNetworkCollector(CgroupReader(CgroupVersion.V2), procRoot.toString(), registry)
+        val targets = listOf(PodCgroupTarget("web", "default", "app", dir.toString(), "test-node"))
+
+        Files.createSymbolicLink(nsLink, Paths.get("net:[4026532200]"))
+        dev.writeText("Inter-|\n face |\n  eth0: 1000 1 0 0 0 0 0 0 0 0 0 0 0 0 0 0\n")
+        collector.collect(targets)
+        // New namespace whose counters restarted and already passed the old value
+        Files.delete(nsLink)
+        Files.createSymbolicLink(nsLink, Paths.get("net:[4026532201]"))
+        dev.writeText("Inter-|\n face |\n  eth0: 1500 2 0 0 0 0 0 0 0 0 0 0 0 0 0 0\n")
+        collector.collect(targets)
+
+        assertEquals(2500.0, registry.find("kpod.net.iface.rx.bytes").tag("container", "app").counter()!!.count())
+    }
+
     @Test
     fun `skips container when PID not found`() {
         val containerDir = tempDir.resolve("cgroup/container2")
@@ -0,0 +1,148 @@
+package com.internal.kpodmetrics.collector
+
+import com.internal.kpodmetrics.bpf.BpfBridge
+import com.internal.kpodmetrics.bpf.BpfProgramManager
+import com.internal.kpodmetrics.bpf.CgroupResolver
+import com.internal.kpodmetrics.bpf.PodInfo
+import com.internal.kpodmetrics.bpf.generated.RedisViews
+import com.internal.kpodmetrics.model.MetricLabels
+import io.micrometer.core.instrument.simple.SimpleMeterRegistry
+import io.mockk.every
+import io.mockk.mockk
+import org.junit.jupiter.api.BeforeEach
+import org.junit.jupiter.api.Test
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
+import kotlin.test.assertEquals
+import kotlin.test.assertNull
+import kotlin.test.assertSame
+
+class MapMetricEmitterTest {
+
+    private lateinit var bridge: BpfBridge
+    private lateinit var programManager: BpfProgramManager
+    private lateinit var cgroupResolver: CgroupResolver
+    private lateinit var registry: SimpleMeterRegistry
+    private lateinit var emitter: MapMetricEmitter
+
+    private val command = LabelTable.dense(arrayOf("UNKNOWN", "GET", "SET"), "UNKNOWN")
+    private val direction = LabelTable.dense(arrayOf("client", "server"), "unknown")
+
+    // struct { __u64 cgroup_id; __u8 command; __u8 direction; __u16 pad1; __u32 pad2; }
+    private val events = MapMetricSpec(
+        program = "redis", map = "redis_events",
+        keyView = { RedisViews.RedisEventKeyView() }, valueView = { RedisViews.CounterValueView() },
+        keySize = 16, valueSize = 8,
+        cgroupIdOffset = 0, metric = "kpod.redis.requests", kind = MetricKind.COUNTER,
+        labels = listOf(LabelSpec("command", 8, 1, command), LabelSpec("direction", 9, 1, direction)),
+        countOffset = 0, emitUnresolved = true
+    )
+
+    // hist_value: 27 u64 slots, then count at 216 and sum_ns at 224
+    private val latency = MapMetricSpec(
+        program = "redis", map = "redis_latency",
+        keyView = { RedisViews.RedisLatencyKeyView() }, valueView = { RedisViews.HistValueView() },
+        keySize = 16, valueSize = 232,
+        cgroupIdOffset = 0, metric = "kpod.redis.request.duration", kind = MetricKind.AVERAGE_LATENCY,
+        labels = listOf(LabelSpec("command", 8, 1, command)),
+        countOffset = 216, sumOffset = 224, sumScale = 1e-9
+    )
+
+    @BeforeEach
+    fun setup() {
+        bridge = mockk()
+        programManager = mockk()
+        cgroupResolver = mockk()
+        registry = SimpleMeterRegistry()
+        emitter = MapMetricEmitter(bridge, programManager, cgroupResolver, registry, "node-1")
+
+        every { programManager.getMapFd("redis", "redis_events") } returns 10
+        every { programManager.getMapFd("redis", "redis_latency") } returns 11
+        every { cgroupResolver.resolve(100L) } returns PodInfo("uid", "cid", "default", "api-0", "app")
+        every { cgroupResolver.resolve(200L) } returns null
+        every { cgroupResolver.generation } returns 0
+    }
+
+    private fun key(cgroupId: Long, command: Int, direction: Int): ByteArray =
+        ByteBuffer.allocate(16).order(ByteOrder.LITTLE_ENDIAN)
+            .putLong(cgroupId).put(command.toByte()).put(direction.toByte()).array()
+
+    private fun count(n: Long): ByteArray =
+        ByteBuffer.allocate(8).order(ByteOrder.LITTLE_ENDIAN).putLong(n).array()
+
+    private fun hist(count: Long, sumNs: Long): ByteArray =
+        ByteBuffer.allocate(232).order(ByteOrder.LITTLE_ENDIAN).putLong(216, count).putLong(224, sumNs).array()
+
+    @Test
+    fun `counter entries are decoded into labelled counters`() {
+        every { bridge.mapIterateAndDelete(10, 16, 8) } returns listOf(
+            key(100L, 1, 0) to count(5),
+            key(100L, 2, 1) to count(3)
+        )
+
+        emitter.collect(events)
+
+        val get = registry.find("kpod.redis.requests")
+            .tags("namespace", "default", "pod", "api-0", "container", "app", "node", "node-1")
+            .tags("command", "GET", "direction", "client").counter()
+        assertEquals(5.0, get!!.count())
+        val set = registry.find("kpod.redis.requests").tags("command", "SET", "direction", "server").counter()
+        assertEquals(3.0, set!!.count())
+    }
+
+    @Test
+    fun `unresolved cgroups are emitted only when the spec asks for it`() {
+        every { bridge.mapIterateAndDelete(10, 16, 8) } returns listOf(key(200L, 1, 0) to count(2))
+
+        emitter.collect(events)
+        val unresolved = registry.find("kpod.redis.requests").tags("pod", MetricLabels.UNRESOLVED).counter()
+        assertEquals(2.0, unresolved!!.count())
+
+        emitter.collect(events.copy(emitUnresolved = false, metric = "kpod.redis.skipped"))
+        assertNull(registry.find("kpod.redis.skipped").counter())
+    }
+
+    @Test
+    fun `dropped entries are emitted next cycle once their pod is registered`() {
+        val skipped = events.copy(emitUnresolved = false)
+        every { bridge.mapIterateAndDelete(10, 16, 8) } returnsMany listOf(
+            listOf(key(200L, 1, 0) to count(2)),
+            listOf(key(200L, 1, 0) to count(3))
+        )
+
+        emitter.collect(skipped)
+        assertNull(registry.find("kpod.redis.requests").counter())
+
+        every { cgroupResolver.generation } returns 1
+        every { cgroupResolver.resolve(200L) } returns PodInfo("uid-2", "cid-2", "default", "api-1", "app")
+        emitter.collect(skipped)
+        val counter = registry.find("kpod.redis.requests").tags("pod", "api-1", "command", "GET").counter()
+        assertEquals(5.0, counter!!.count())
+    }
+
+    @Test
+    fun `latency maps record the average in seconds and skip empty histograms`() {
+        every { bridge.mapIterateAndDelete(11, 16, 232) } returns listOf(
+            key(100L, 1, 0) to hist(4, 2_000_000_000),
+            key(100L, 2, 0) to hist(0, 0)
+        )
+
+        emitter.collect(latency)
+
+        val summary = registry.find("kpod.redis.request.duration").tags("command", "GET").summary()
+        assertEquals(1L, summary!!.count())
+        assertEquals(0.5, summary.totalAmount(), 1e-9)
+        assertNull(registry.find("kpod.redis.request.duration").tags("command", "SET").summary())
+    }
+
+    @Test
+    fun `label tables fall back to a cached rendering of unknown values`() {
+        val sparse = LabelTable.sparse(mapOf(0x03 to "COM_QUERY"), "UNKNOWN(0x%x)")
+        assertEquals("COM_QUERY", sparse.name(0x03))
+        assertEquals("UNKNOWN(0xff)", sparse.name(0xff))
+        assertSame(sparse.name(0xff), sparse.name(0xff))
+
+        assertEquals("unknown", direction.name(7))
+        assertEquals("404", LabelTable.numeric().name(404))
+    }
+}
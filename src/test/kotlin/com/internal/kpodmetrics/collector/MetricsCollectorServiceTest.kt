@@ -1,5 +1,8 @@
 package com.internal.kpodmetrics.collector
 
+import com.internal.kpodmetrics.bpf.BpfBridge
+import com.internal.kpodmetrics.bpf.DrainSpec
+import com.internal.kpodmetrics.bpf.NativeCallExecutor
 import com.internal.kpodmetrics.config.CollectorIntervals
 import com.internal.kpodmetrics.config.CollectorOverrides
 import com.internal.kpodmetrics.discovery.PodCgroupMapper
@@ -286,6 +289,148 @@ class MetricsCollectorServiceTest {
         intervalService.close()
     }
 
+    @Test
+    fun `adaptive scheduler skips stretched collector and records cost`() {
+        var load = 0.95
+        val scheduler = CollectionScheduler(
+            spreadWindowMs = 0,
+            cpuLoadSupplier = { load }
+        )
+        val schedService = MetricsCollectorService(
+            cpuCollector, netCollector, syscallCollector,
+            biolatencyCollector, cachestatCollector,
+            tcpdropCollector, hardirqsCollector, softirqsCollector, execsnoopCollector,
+            dnsCollector, tcpPeerCollector, httpCollector, redisCollector, mysqlCollector,
+            kafkaCollector, mongoCollector,
+            registry = registry,
+            scheduler = scheduler
+        )
+        every { syscallCollector.collect() } answers {
+            // Busy-wait so the cost shows up as both wall and CPU time
+            val end = System.nanoTime() + 20_000_000
+            while (System.nanoTime() < end) { /* spin */ }
+        }
+
+        // First cycle: no cost samples yet, everything runs
+        schedService.collect()
+        verify(exactly = 1) { syscallCollector.collect() }
+
+        // Second cycle: under CPU pressure the slowest collector is stretched to every 2nd cycle
+        schedService.collect()
+        kotlin.test.assertEquals(2, scheduler.stretchFactor("syscall"))
+        load = 0.7
+        schedService.collect()
+        verify(exactly = 2) { syscallCollector.collect() }
+        verify(exactly = 3) { cpuCollector.collect() }
+        schedService.close()
+    }
+
+    @Test
+    fun `collector cost is measured on the threads collectors run on`() {
+        val costService = MetricsCollectorService(
+            cpuCollector, netCollector, syscallCollector,
+            biolatencyCollector, cachestatCollector,
+            tcpdropCollector, hardirqsCollector, softirqsCollector, execsnoopCollector,
+            dnsCollector, tcpPeerCollector, httpCollector, redisCollector, mysqlCollector,
+            kafkaCollector, mongoCollector,
+            registry = registry,
+            costTracker = CollectorCostTracker(registry)
+        )
+        var collectorThread: Thread? = null
+        every { syscallCollector.collect() } answers {
+            collectorThread = Thread.currentThread()
+            retained = List(1000) { ByteArray(1024) }
+            val end = System.nanoTime() + 20_000_000
+            while (System.nanoTime() < end) { /* spin */ }
+        }
+
+        costService.collect()
+
+        kotlin.test.assertFalse(collectorThread!!.isVirtual)
+        val cpu = registry.get("kpod.collector.cpu.time.ns").tag("collector", "syscall").counter().count()
+        val alloc = registry.get("kpod.collector.allocated.bytes").tag("collector", "syscall").counter().count()
+        assertTrue(cpu > 0.0, "cpu time $cpu")
+        assertTrue(alloc >= 1_000_000.0, "allocated $alloc")
+        costService.close()
+    }
+
+    @Test
+    fun `collector drains still go through the native call pool`() {
+        val executor = NativeCallExecutor(poolSize = 1, registry = registry)
+        var drainThread: Thread? = null
+        var activeDuringDrain = 0.0
+        val bridge = object : BpfBridge(executor) {
+            override fun fetch(spec: DrainSpec): List<Pair<ByteArray, ByteArray>> {
+                drainThread = Thread.currentThread()
+                activeDuringDrain = registry.get("kpod.bpf.native.active").gauge().value()
+                return emptyList()
+            }
+        }
+        var collectorThread: Thread? = null
+        every { syscallCollector.collect() } answers {
+            collectorThread = Thread.currentThread()
+            bridge.mapBatchLookupAndDelete(3, 8, 8, 16)
+        }
+
+        service.collect()
+        executor.close()
+
+        kotlin.test.assertFalse(collectorThread!!.isVirtual)
+        assertTrue(drainThread!!.name.startsWith("bpf-native-"), "drained on ${drainThread!!.name}")
+        kotlin.test.assertEquals(1.0, activeDuringDrain)
+        kotlin.test.assertEquals(1L, registry.get("kpod.bpf.native.queue.wait").timer().count())
+        kotlin.test.assertEquals(0.0, registry.get("kpod.bpf.native.pinned.calls.total").counter().count())
+    }
+
+    // Keeps the test collector's allocation reachable so it cannot be optimized away
+    @Volatile private var retained: Any? = null
+
+    @Test
+    fun `scheduler volatility follows the entries each collector drains`() {
+        val scheduler = CollectionScheduler(spreadWindowMs = 0, cpuLoadSupplier = { 0.1 })
+        val schedService = MetricsCollectorService(
+            cpuCollector, netCollector, syscallCollector,
+            biolatencyCollector, cachestatCollector,
+            tcpdropCollector, hardirqsCollector, softirqsCollector, execsnoopCollector,
+            dnsCollector, tcpPeerCollector, httpCollector, redisCollector, mysqlCollector,
+            kafkaCollector, mongoCollector,
+            registry = registry,
+            scheduler = scheduler
+        )
+        // syscall drains entries every run; cpu finds its maps empty
+        every { syscallCollector.collect() } answers {
+            com.internal.kpodmetrics.bpf.NativeCallCost.current()!!.addDrained(5)
+        }
+        repeat(8) { schedService.collect() }
+
+        @Suppress("UNCHECKED_CAST")
+        val collectors = scheduler.snapshot()["collectors"] as Map<String, Map<String, Any?>>
+        kotlin.test.assertEquals(1.0, collectors["syscall"]!!["volatility"] as Double, 1e-9)
+        assertTrue((collectors["cpu"]!!["volatility"] as Double) < 0.1)
+        schedService.close()
+    }
+
+    @Test
+    fun `burst samples the pressured pod on every tick`() {
+        val monitor = mockk<PressureMonitor>(relaxed = true)
+        val event = PressureEvent(1L, "default", "web", "cpu")
+        val bursting = MetricsCollectorService(
+            cpuCollector, netCollector, syscallCollector,
+            biolatencyCollector, cachestatCollector,
+            tcpdropCollector, hardirqsCollector, softirqsCollector, execsnoopCollector,
+            dnsCollector, tcpPeerCollector, httpCollector, redisCollector, mysqlCollector,
+            kafkaCollector, mongoCollector,
+            registry = registry,
+            pressureMonitor = monitor
+        )
+
+        bursting.requestBurst(listOf("cpu"), durationMs = 200, intervalMs = 20, event = event)
+
+        verify(timeout = 2000, atLeast = 3) { monitor.sample(event) }
+        verify(timeout = 2000, atLeast = 3) { cpuCollector.collect() }
+        verify(exactly = 0) { syscallCollector.collect() }
+    }
+
     @Test
     fun `collector failure records last error`() {
         every { netCollector.collect() } throws RuntimeException("boom")
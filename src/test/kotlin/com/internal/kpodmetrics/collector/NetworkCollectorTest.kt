@@ -85,6 +85,31 @@ class NetworkCollectorTest {
         })
     }
 
+    @Test
+    fun `entries from a pod registered late are counted on the next cycle`() {
+        every { programManager.getMapFd("net", "tcp_stats_map") } returns 10
+
+        val keyBytes = ByteBuffer.allocate(8).order(ByteOrder.LITTLE_ENDIAN)
+            .putLong(999L).array()
+        every { bridge.mapBatchLookupAndDelete(10, 8, 48, any()) } returnsMany listOf(
+            listOf(keyBytes to buildTcpStatsValue(100, 200, 2, 1, 1000, 1)),
+            emptyList()
+        )
+
+        collector.collect()
+        assertTrue(registry.meters.none { it.id.getTag("pod") == "late-pod" })
+
+        cgroupResolver.register(999L, PodInfo(
+            podUid = "uid-2", containerId = "cid-2",
+            namespace = "default", podName = "late-pod", containerName = "app"
+        ))
+        collector.collect()
+
+        val retransmits = registry.counter("kpod.net.tcp.retransmits",
+            "namespace", "default", "pod", "late-pod", "container", "app", "node", "test-node")
+        assertEquals(2.0, retransmits.count())
+    }
+
     @Test
     fun `collect skips rtt when rtt count is zero`() {
         every { programManager.getMapFd("net", "tcp_stats_map") } returns 10
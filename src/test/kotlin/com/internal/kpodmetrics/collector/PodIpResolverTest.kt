@@ -1,100 +1,154 @@
 package com.internal.kpodmetrics.collector
 
 import io.fabric8.kubernetes.api.model.*
+import io.fabric8.kubernetes.api.model.discovery.v1.Endpoint
+import io.fabric8.kubernetes.api.model.discovery.v1.EndpointSlice
 import io.fabric8.kubernetes.client.KubernetesClient
-import io.fabric8.kubernetes.client.dsl.MixedOperation
-import io.fabric8.kubernetes.client.dsl.NonNamespaceOperation
-import io.fabric8.kubernetes.client.dsl.PodResource
-import io.fabric8.kubernetes.client.dsl.ServiceResource
+import io.fabric8.kubernetes.client.informers.SharedIndexInformer
+import io.micrometer.core.instrument.simple.SimpleMeterRegistry
 import io.mockk.*
 import org.junit.jupiter.api.Assertions.*
-import org.junit.jupiter.api.BeforeEach
 import org.junit.jupiter.api.Test
+import java.time.Instant
+import java.util.concurrent.TimeUnit
 
 class PodIpResolverTest {
 
-    private lateinit var client: KubernetesClient
-    private lateinit var resolver: PodIpResolver
-
-    @BeforeEach
-    fun setup() {
-        client = mockk(relaxed = true)
-        resolver = PodIpResolver(client)
-
-        val pod = Pod().apply {
-            metadata = ObjectMeta().apply {
-                name = "my-pod"
-                namespace = "default"
-            }
-            status = PodStatus().apply {
-                podIP = "10.0.0.1"
-            }
-        }
+    private val registry = SimpleMeterRegistry()
+    private val now = Instant.parse("2026-01-01T00:00:10Z").toEpochMilli()
+    private val resolver = PodIpResolver(mockk<KubernetesClient>(relaxed = true), registry, clock = { now })
 
-        val podList = PodList().apply {
-            items = listOf(pod)
+    private fun pod(name: String, vararg ips: String) = Pod().apply {
+        metadata = ObjectMeta().apply {
+            this.name = name
+            namespace = "default"
+        }
+        status = PodStatus().apply {
+            podIP = ips.firstOrNull()
+            podIPs = ips.map { PodIP(it) }
         }
+    }
 
-        val svc = Service().apply {
-            metadata = ObjectMeta().apply {
-                name = "my-svc"
-                namespace = "default"
-            }
-            spec = ServiceSpec().apply {
-                clusterIP = "10.96.0.1"
-            }
+    private fun service(name: String, clusterIP: String) = Service().apply {
+        metadata = ObjectMeta().apply {
+            this.name = name
+            namespace = "default"
         }
+        spec = ServiceSpec().apply { this.clusterIP = clusterIP }
+    }
 
-        val svcList = ServiceList().apply {
-            items = listOf(svc)
+    private fun slice(
+        service: String, vararg addresses: String, triggerTime: String? = null, name: String = "$service-abcde"
+    ) = EndpointSlice().apply {
+        metadata = ObjectMeta().apply {
+            this.name = name
+            namespace = "default"
+            labels = mapOf("kubernetes.io/service-name" to service)
+            if (triggerTime != null) annotations = mapOf("endpoints.kubernetes.io/last-change-trigger-time" to triggerTime)
         }
+        endpoints = addresses.map { Endpoint().apply { this.addresses = listOf(it) } }
+    }
 
-        val podOp = mockk<MixedOperation<Pod, PodList, PodResource>>(relaxed = true)
-        val podNsOp = mockk<NonNamespaceOperation<Pod, PodList, PodResource>>(relaxed = true)
-        every { client.pods() } returns podOp
-        every { podOp.inAnyNamespace() } returns podNsOp
-        every { podNsOp.list() } returns podList
-
-        val svcOp = mockk<MixedOperation<Service, ServiceList, ServiceResource<Service>>>(relaxed = true)
-        val svcNsOp = mockk<NonNamespaceOperation<Service, ServiceList, ServiceResource<Service>>>(relaxed = true)
-        every { client.services() } returns svcOp
-        every { svcOp.inAnyNamespace() } returns svcNsOp
-        every { svcNsOp.list() } returns svcList
+    @Test
+    fun `resolves pod IPs and service cluster IPs from watch events`() {
+        resolver.podHandler.onAdd(pod("my-pod", "10.0.0.1", "fd00::1"))
+        resolver.serviceHandler.onAdd(service("my-svc", "10.96.0.1"))
+
+        assertEquals(PeerInfo(podName = "my-pod", namespace = "default"), resolver.resolve("10.0.0.1"))
+        assertEquals("my-pod", resolver.resolve("fd00::1")?.podName)
+        assertEquals(PeerInfo(namespace = "default", serviceName = "my-svc"), resolver.resolve("10.96.0.1"))
+        assertNull(resolver.resolve("192.168.1.1"))
+        assertNull(resolver.resolve("None"))
     }
 
     @Test
-    fun `resolve returns PeerInfo for known pod IP after refresh`() {
-        resolver.refresh()
-
-        val result = resolver.resolve("10.0.0.1")
-        assertNotNull(result)
-        assertEquals("my-pod", result!!.podName)
-        assertEquals("default", result.namespace)
-        assertNull(result.serviceName)
+    fun `applies updates and deletes as deltas`() {
+        val old = pod("my-pod", "10.0.0.1")
+        resolver.podHandler.onAdd(old)
+        val moved = pod("my-pod", "10.0.0.2")
+        resolver.podHandler.onUpdate(old, moved)
+        assertNull(resolver.resolve("10.0.0.1"))
+        assertEquals("my-pod", resolver.resolve("10.0.0.2")?.podName)
+
+        // A deleted pod does not take an IP that was reassigned to another pod
+        resolver.podHandler.onAdd(pod("other", "10.0.0.2"))
+        resolver.podHandler.onDelete(moved, false)
+        assertEquals("other", resolver.resolve("10.0.0.2")?.podName)
+
+        val svc = service("my-svc", "10.96.0.1")
+        resolver.serviceHandler.onAdd(svc)
+        resolver.serviceHandler.onDelete(svc, false)
+        assertNull(resolver.resolve("10.96.0.1"))
     }
 
     @Test
-    fun `resolve returns null for unknown IP`() {
-        resolver.refresh()
+    fun `pod IPs carry the service of their endpoint slice`() {
+        resolver.podHandler.onAdd(pod("web-1", "10.0.0.1"))
+        resolver.podHandler.onAdd(pod("web-2", "10.0.0.2"))
+        resolver.endpointSliceHandler.onAdd(slice("web", "10.0.0.1", "10.0.0.2"))
+        assertEquals(PeerInfo("web-1", "default", "web"), resolver.resolve("10.0.0.1"))
+        assertEquals("web", resolver.resolve("10.0.0.2")?.serviceName)
+
+        // The reduced informer store hands back the old slice without endpoints
+        val stored = slice("web")
+        resolver.endpointSliceHandler.onUpdate(stored, slice("web", "10.0.0.2"))
+        assertNull(resolver.resolve("10.0.0.1")?.serviceName)
+        assertEquals("web", resolver.resolve("10.0.0.2")?.serviceName)
+
+        resolver.endpointSliceHandler.onDelete(stored, false)
+        assertEquals(PeerInfo("web-2", "default"), resolver.resolve("10.0.0.2"))
+
+        assertEquals(2.0, registry.get("kpod.peer.index.size").tag("index", "pod").gauge().value())
+        assertEquals(0.0, registry.get("kpod.peer.index.size").tag("index", "endpoint").gauge().value())
+    }
 
-        val result = resolver.resolve("192.168.1.1")
-        assertNull(result)
+    @Test
+    fun `an IP listed by several services carries the lowest name`() {
+        resolver.podHandler.onAdd(pod("web-1", "10.0.0.1"))
+        resolver.endpointSliceHandler.onAdd(slice("web", "10.0.0.1"))
+        resolver.endpointSliceHandler.onAdd(slice("api", "10.0.0.1"))
+        resolver.endpointSliceHandler.onAdd(slice("zeta", "10.0.0.1"))
+        assertEquals("api", resolver.resolve("10.0.0.1")?.serviceName)
+
+        // Dropping the chosen service falls back to the next one, not to none
+        resolver.endpointSliceHandler.onDelete(slice("api"), false)
+        assertEquals("web", resolver.resolve("10.0.0.1")?.serviceName)
+        // A second slice of the same service keeps it after the first drops the IP
+        resolver.endpointSliceHandler.onAdd(slice("web", "10.0.0.1", name = "web-fghij"))
+        resolver.endpointSliceHandler.onUpdate(slice("web"), slice("web"))
+        assertEquals("web", resolver.resolve("10.0.0.1")?.serviceName)
     }
 
     @Test
-    fun `resolve returns PeerInfo for service ClusterIP after refresh`() {
-        resolver.refresh()
-
-        val result = resolver.resolve("10.96.0.1")
-        assertNotNull(result)
-        assertEquals("my-svc", result!!.serviceName)
-        assertEquals("default", result.namespace)
-        assertNull(result.podName)
+    fun `watch lag is taken from synced updates whose trigger time changed`() {
+        val informer = mockk<SharedIndexInformer<EndpointSlice>>()
+        every { informer.hasSynced() } returns false
+        resolver.sliceInformer = informer
+        val stored = slice("web")
+
+        // Initial list, and updates before the informer synced
+        resolver.endpointSliceHandler.onAdd(slice("web", "10.0.0.1", triggerTime = "2026-01-01T00:00:01Z"))
+        resolver.endpointSliceHandler.onUpdate(stored, slice("web", "10.0.0.1", triggerTime = "2026-01-01T00:00:02Z"))
+        every { informer.hasSynced() } returns true
+        // Same trigger time again, e.g. a relist replaying the object
+        resolver.endpointSliceHandler.onUpdate(stored, slice("web", "10.0.0.1", triggerTime = "2026-01-01T00:00:02Z"))
+        resolver.endpointSliceHandler.onUpdate(stored, slice("web", "10.0.0.2", triggerTime = "2026-01-01T00:00:08Z"))
+
+        val lag = registry.get("kpod.peer.watch.lag").timer()
+        assertEquals(1, lag.count())
+        assertEquals(2000.0, lag.totalTime(TimeUnit.MILLISECONDS))
     }
 
     @Test
-    fun `resolve returns null before refresh is called`() {
-        val result = resolver.resolve("10.0.0.1")
-        assertNull(result)
+    fun `starts informers once and not before a collector needs them`() {
+        val client = mockk<KubernetesClient>(relaxed = true)
+        val lazy = PodIpResolver(client)
+        assertNull(lazy.resolve("10.0.0.1"))
+        verify(exactly = 0) { client.pods() }
+
+        lazy.ensureWatching()
+        lazy.ensureWatching()
+        verify(exactly = 1) { client.pods() }
+        verify(exactly = 1) { client.services() }
     }
 }
@@ -0,0 +1,132 @@
+package com.internal.kpodmetrics.collector
+
+import com.internal.kpodmetrics.bpf.BpfBridge
+import com.internal.kpodmetrics.model.PodCgroupTarget
+import io.micrometer.core.instrument.simple.SimpleMeterRegistry
+import io.mockk.every
+import io.mockk.mockk
+import io.mockk.verify
+import org.junit.jupiter.api.AfterEach
+import org.junit.jupiter.api.Assertions.*
+import org.junit.jupiter.api.Test
+import java.util.concurrent.CopyOnWriteArrayList
+import java.util.concurrent.LinkedBlockingQueue
+import java.util.concurrent.TimeUnit
+import java.util.concurrent.atomic.AtomicInteger
+
+class PressureMonitorTest {
+    private val registry = SimpleMeterRegistry()
+    private val events = LinkedBlockingQueue<IntArray>()
+    private val nextFd = AtomicInteger(100)
+    private val armedPaths = CopyOnWriteArrayList<String>()
+    private val bridge = mockk<BpfBridge>(relaxed = true).also { b ->
+        every { b.psiEpollCreate() } returns 7
+        every { b.psiTriggerAdd(7, any(), "some 150000 1000000") } answers {
+            armedPaths.add(secondArg())
+            nextFd.getAndIncrement()
+        }
+        every { b.psiWait(7, any(), any()) } answers {
+            val pair = events.poll(20, TimeUnit.MILLISECONDS)
+            if (pair == null) 0 else {
+                pair.copyInto(secondArg<IntArray>())
+                1
+            }
+        }
+    }
+    private val pressureFiles = HashMap<String, String>()
+    private val monitor = PressureMonitor(
+        bridge, registry, resources = listOf("cpu", "memory"), clock = { 1_700_000_000_123L },
+        readFile = { pressureFiles[it] }
+    )
+
+    @AfterEach
+    fun tearDown() = monitor.close()
+
+    private fun target(pod: String, container: String) = PodCgroupTarget(
+        pod, "default", container, "/sys/fs/cgroup/kubepods.slice/kubepods-pod$pod.slice/$container.scope", "node-1"
+    )
+
+    private fun awaitTrue(condition: () -> Boolean) {
+        val deadline = System.currentTimeMillis() + 5000
+        while (!condition()) {
+            if (System.currentTimeMillis() > deadline) fail<Unit>("condition not met within 5s")
+            Thread.sleep(10)
+        }
+    }
+
+    @Test
+    fun `arms one trigger per resource on each pod cgroup`() {
+        assertTrue(monitor.start())
+        monitor.sync(listOf(target("a", "c1"), target("a", "c2"), target("b", "c1")))
+
+        assertEquals(
+            setOf(
+                "/sys/fs/cgroup/kubepods.slice/kubepods-poda.slice/cpu.pressure",
+                "/sys/fs/cgroup/kubepods.slice/kubepods-poda.slice/memory.pressure",
+                "/sys/fs/cgroup/kubepods.slice/kubepods-podb.slice/cpu.pressure",
+                "/sys/fs/cgroup/kubepods.slice/kubepods-podb.slice/memory.pressure"
+            ),
+            armedPaths.toSet()
+        )
+        assertEquals(4.0, registry.get("kpod.psi.triggers.armed").gauge().value())
+
+        // Pod b gone: its two triggers are closed
+        monitor.sync(listOf(target("a", "c1")))
+        verify(exactly = 2) { bridge.closeFd(match { it >= 100 }) }
+        assertEquals(2.0, registry.get("kpod.psi.triggers.armed").gauge().value())
+    }
+
+    @Test
+    fun `trigger firing is counted, timestamped and passed to the callback`() {
+        val fired = CopyOnWriteArrayList<PressureEvent>()
+        monitor.setOnPressureCallback { fired.add(it) }
+        monitor.start()
+        monitor.sync(listOf(target("a", "c1")))
+
+        events.add(intArrayOf(101, 0x002)) // memory.pressure, EPOLLPRI
+        awaitTrue { fired.isNotEmpty() }
+
+        assertEquals(PressureEvent(1_700_000_000_123L, "default", "a", "memory"), fired.single())
+        assertEquals(1.0, registry.get("kpod.psi.trigger.events").tag("pod", "a").tag("resource", "memory").counter().count())
+        assertEquals(1_700_000_000.123,
+            registry.get("kpod.psi.last.event.timestamp.seconds").tag("resource", "memory").gauge().value(), 1e-6)
+        assertEquals(fired, monitor.recentEvents())
+    }
+
+    @Test
+    fun `removed cgroup disarms the pod`() {
+        monitor.start()
+        monitor.sync(listOf(target("a", "c1")))
+
+        events.add(intArrayOf(100, 0x008)) // EPOLLERR
+        awaitTrue { registry.get("kpod.psi.triggers.armed").gauge().value() == 0.0 }
+        verify { bridge.closeFd(100) }
+        verify { bridge.closeFd(101) }
+    }
+
+    @Test
+    fun `failed arm is counted and not retried every cycle`() {
+        every { bridge.psiTriggerAdd(7, any(), any()) } returns -22
+        monitor.start()
+        monitor.sync(listOf(target("a", "c1")))
+        monitor.sync(listOf(target("a", "c1")))
+        assertEquals(2.0, registry.counter("kpod.psi.trigger.errors").count())
+    }
+
+    @Test
+    fun `burst samples read the pressured pod's stall totals`() {
+        monitor.start()
+        monitor.sync(listOf(target("a", "c1"), target("b", "c1")))
+        pressureFiles["/sys/fs/cgroup/kubepods.slice/kubepods-poda.slice/memory.pressure"] =
+            "some avg10=12.50 avg60=3.10 avg300=0.80 total=420000\nfull avg10=4.00 avg60=1.00 avg300=0.20 total=150000\n"
+
+        val sample = monitor.sample(PressureEvent(1L, "default", "a", "memory"))
+
+        assertEquals(PressureSample(1_700_000_000_123L, "default", "a", "memory", 12.5, 420_000L, 150_000L), sample)
+        assertEquals(listOf(sample), monitor.recentSamples())
+        // Unreadable pressure file, and a pod that is not armed
+        assertNull(monitor.sample(PressureEvent(1L, "default", "b", "memory")))
+        assertNull(monitor.sample(PressureEvent(1L, "default", "gone", "memory")))
+        assertEquals(1, monitor.recentSamples().size)
+    }
+}
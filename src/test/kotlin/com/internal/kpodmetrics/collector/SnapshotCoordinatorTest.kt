@@ -0,0 +1,134 @@
+package com.internal.kpodmetrics.collector
+
+import com.internal.kpodmetrics.bpf.BpfBridge
+import com.internal.kpodmetrics.bpf.DrainMode
+import com.internal.kpodmetrics.bpf.DrainSpec
+import com.internal.kpodmetrics.bpf.MapDrainSnapshot
+import io.micrometer.core.instrument.simple.SimpleMeterRegistry
+import io.mockk.every
+import io.mockk.mockk
+import io.mockk.slot
+import io.mockk.verify
+import org.junit.jupiter.api.BeforeEach
+import org.junit.jupiter.api.Test
+import kotlin.test.assertEquals
+import kotlin.test.assertNotNull
+import kotlin.test.assertNull
+
+class SnapshotCoordinatorTest {
+
+    private lateinit var bridge: BpfBridge
+    private lateinit var registry: SimpleMeterRegistry
+    private lateinit var coordinator: SnapshotCoordinator
+
+    private val httpEvents = DrainSpec(10, 16, 8, 0, DrainMode.ITERATE)
+    private val tcpStats = DrainSpec(11, 8, 40, 10240, DrainMode.BATCH)
+    private var installed: MapDrainSnapshot? = null
+
+    @BeforeEach
+    fun setup() {
+        bridge = mockk(relaxed = true)
+        registry = SimpleMeterRegistry()
+        coordinator = SnapshotCoordinator(bridge, registry)
+
+        val specsSlot = slot<Collection<DrainSpec>>()
+        every { bridge.drainAll(capture(specsSlot)) } answers {
+            MapDrainSnapshot(1_000L, specsSlot.captured.associateWith {
+                listOf(ByteArray(it.keySize) to ByteArray(it.valueSize))
+            })
+        }
+        every { bridge.installSnapshot(any()) } answers { installed = firstArg() }
+    }
+
+    /** Simulates a collector that drains [specs] while the coordinator records. */
+    private fun runCollector(name: String, vararg specs: DrainSpec) {
+        val listener = slot<(DrainSpec) -> Unit>()
+        every { bridge.recordDrains(capture(listener), any<() -> Unit>()) } answers {
+            specs.forEach { listener.captured(it); installed?.take(it) }
+            secondArg<() -> Unit>()()
+        }
+        coordinator.collect(name) { }
+    }
+
+    @Test
+    fun `first cycle has no plan and drains live`() {
+        assertNull(coordinator.beginCycle(listOf("http")))
+        verify(exactly = 0) { bridge.drainAll(any()) }
+    }
+
+    @Test
+    fun `recorded drains are pre-drained in the next cycle`() {
+        runCollector("http", httpEvents)
+        runCollector("network", tcpStats)
+        coordinator.endCycle()
+
+        val snapshot = assertNotNull(coordinator.beginCycle(listOf("http", "network")))
+        assertEquals(2, snapshot.mapCount)
+        verify { bridge.drainAll(match { it.toSet() == setOf(httpEvents, tcpStats) }) }
+        verify { bridge.installSnapshot(snapshot) }
+    }
+
+    @Test
+    fun `only due collectors are included in the snapshot`() {
+        runCollector("http", httpEvents)
+        runCollector("network", tcpStats)
+
+        val snapshot = assertNotNull(coordinator.beginCycle(listOf("network")))
+        assertEquals(1, snapshot.mapCount)
+        assertNotNull(snapshot.take(tcpStats))
+        assertNull(snapshot.take(httpEvents))
+    }
+
+    @Test
+    fun `unconsumed maps are dropped from the plan`() {
+        runCollector("http", httpEvents)
+        val snapshot = assertNotNull(coordinator.beginCycle(listOf("http")))
+        // Collector ran but never read the snapshot back
+        runCollector("http")
+        coordinator.endCycle()
+
+        verify { bridge.installSnapshot(null) }
+        assertEquals(1.0, registry.get("kpod.collection.snapshot.unconsumed.total").counter().count())
+        assertEquals(1, snapshot.unconsumed().size)
+        assertNull(coordinator.beginCycle(listOf("http")))
+    }
+
+    @Test
+    fun `entries of a collector that did not finish are served next cycle`() {
+        runCollector("http", httpEvents)
+        coordinator.endCycle()
+        assertNotNull(coordinator.beginCycle(listOf("http")))
+        // The collector threw (or timed out) before reading its map
+        coordinator.endCycle()
+        assertEquals(1.0, registry.get("kpod.collection.snapshot.carried.entries.total").counter().count())
+
+        val next = assertNotNull(coordinator.beginCycle(listOf("http")))
+        assertEquals(2, next.take(httpEvents)!!.size)
+        assertEquals(0.0, registry.get("kpod.collection.snapshot.unconsumed.total").counter().count())
+    }
+
+    @Test
+    fun `carried entries wait for their collector's next run`() {
+        runCollector("http", httpEvents)
+        runCollector("network", tcpStats)
+        coordinator.beginCycle(listOf("http", "network"))
+        runCollector("network", tcpStats)
+        coordinator.endCycle()
+
+        // http is not due this cycle: its carried entries stay aside
+        val networkOnly = assertNotNull(coordinator.beginCycle(listOf("network")))
+        assertNull(networkOnly.take(httpEvents))
+        coordinator.endCycle()
+
+        val withHttp = assertNotNull(coordinator.beginCycle(listOf("http")))
+        assertEquals(2, withHttp.take(httpEvents)!!.size)
+    }
+
+    @Test
+    fun `snapshot entries are served once`() {
+        val snapshot = MapDrainSnapshot(0L, mapOf(tcpStats to emptyList()))
+        assertNotNull(snapshot.take(tcpStats))
+        assertNull(snapshot.take(tcpStats))
+        assertEquals(emptySet(), snapshot.unconsumed())
+    }
+}
@@ -0,0 +1,69 @@
+package com.internal.kpodmetrics.collector
+
+import com.internal.kpodmetrics.bpf.CgroupResolver
+import com.internal.kpodmetrics.bpf.PodInfo
+import org.junit.jupiter.api.Assertions.*
+import org.junit.jupiter.api.Test
+
+class UnresolvedBufferTest {
+
+    private val resolver = CgroupResolver()
+    private val buffer = UnresolvedBuffer<String>(resolver, capacity = 2)
+    private val pod = PodInfo("uid-1", "cid-1", "default", "web", "app")
+
+    private fun replayed(includeUnresolved: Boolean = false): List<Pair<String?, String>> {
+        val out = ArrayList<Pair<String?, String>>()
+        buffer.replay(includeUnresolved) { podInfo, entry -> out.add(podInfo?.podName to entry) }
+        return out
+    }
+
+    @Test
+    fun `entries resolve retroactively once their pod is registered`() {
+        assertNull(resolver.resolve(100L))
+        assertTrue(buffer.hold(100L, "a"))
+        assertTrue(buffer.hold(200L, "b"))
+
+        resolver.register(100L, pod)
+        assertEquals(listOf("web" to "a"), replayed())
+        assertEquals(0, buffer.size())
+        assertTrue(replayed().isEmpty())
+    }
+
+    @Test
+    fun `entries are kept for one cycle only`() {
+        buffer.hold(100L, "a")
+        assertTrue(replayed().isEmpty())
+        resolver.register(100L, pod)
+        assertTrue(replayed().isEmpty())
+    }
+
+    @Test
+    fun `nothing is looked up when no pod was registered in between`() {
+        resolver.register(300L, pod)
+        assertNull(resolver.resolve(100L))
+        buffer.hold(100L, "a")
+        assertTrue(resolver.isKnownMiss(100L))
+        assertEquals(listOf(null to "a"), replayed(includeUnresolved = true))
+    }
+
+    @Test
+    fun `resolveOrHold holds misses and replayResolved hands them over with their pod`() {
+        assertNull(buffer.resolveOrHold(100L, "a"))
+        assertEquals(1, buffer.size())
+
+        resolver.register(100L, pod)
+        assertEquals("web", buffer.resolveOrHold(100L, "b")?.podName)
+        val out = ArrayList<Pair<String, String>>()
+        buffer.replayResolved { podInfo, entry -> out.add(podInfo.podName to entry) }
+        assertEquals(listOf("web" to "a"), out)
+        assertEquals(0, buffer.size())
+    }
+
+    @Test
+    fun `holds at most capacity entries`() {
+        assertTrue(buffer.hold(1L, "a"))
+        assertTrue(buffer.hold(2L, "b"))
+        assertFalse(buffer.hold(3L, "c"))
+        assertEquals(2, buffer.size())
+    }
+}
@@ -0,0 +1,106 @@
+package com.internal.kpodmetrics.discovery
+
+import com.internal.kpodmetrics.model.QosClass
+import org.junit.jupiter.api.Assertions.*
+import org.junit.jupiter.api.Test
+
+class KubeletPodListParserTest {
+
+    private val parser = KubeletPodListParser()
+
+    private fun item(
+        uid: String,
+        rv: String,
+        restarts: Int = 0,
+        phase: String = "Running",
+        source: String = "api",
+        labels: String = """{"app": "$uid"}"""
+    ) = """
+        {
+          "kind": "Pod",
+          "metadata": {
+            "name": "pod-$uid", "namespace": "ns", "uid": "$uid", "resourceVersion": "$rv",
+            "labels": $labels,
+            "annotations": {"kubernetes.io/config.source": "$source", "other": "x"},
+            "ownerReferences": [{"kind": "ReplicaSet", "name": "rs"}]
+          },
+          "spec": {"containers": [{"name": "app", "image": "nginx", "args": ["a", {"b": 1}]}]},
+          "status": {
+            "phase": "$phase",
+            "conditions": [{"type": "Ready", "status": "True"}],
+            "containerStatuses": [
+              {"name": "app", "state": {"running": {}}, "containerID": "containerd://c-$uid", "restartCount": $restarts}
+            ],
+            "qosClass": "Guaranteed"
+          }
+        }
+    """.trimIndent()
+
+    private fun parse(vararg items: String) =
+        parser.parse("""{"kind": "PodList", "metadata": {}, "items": [${items.joinToString(",")}]}""".byteInputStream())
+
+    @Test
+    fun `extracts the fields the agent uses and skips the rest`() {
+        val pods = parse(item("a", "1", restarts = 3))!!
+        val pod = pods["a"]!!
+        assertEquals("pod-a", pod.name)
+        assertEquals("ns", pod.namespace)
+        assertEquals(QosClass.GUARANTEED, pod.qosClass)
+        assertEquals(mapOf("app" to "a"), pod.labels)
+        assertEquals(1, pod.containers.size)
+        assertEquals("c-a", pod.containers[0].containerId)
+        assertEquals(3, pod.containers[0].restartCount)
+    }
+
+    @Test
+    fun `returns null when no resourceVersion changed`() {
+        assertNotNull(parse(item("a", "1"), item("b", "5")))
+        assertNull(parse(item("a", "1"), item("b", "5")))
+
+        val changed = parse(item("a", "2", restarts = 1), item("b", "5"))!!
+        assertEquals(1, changed["a"]!!.containers[0].restartCount)
+        assertEquals("pod-b", changed["b"]!!.name)
+    }
+
+    @Test
+    fun `pods appearing or going away are changes`() {
+        parse(item("a", "1"), item("b", "5"))
+        assertEquals(setOf("a"), parse(item("a", "1"))!!.keys)
+        assertEquals(setOf("a", "c"), parse(item("a", "1"), item("c", "1"))!!.keys)
+    }
+
+    @Test
+    fun `an unchanged pod keeps its previous fields`() {
+        val first = parse(item("a", "1", restarts = 2))!!
+        // Same version: the labels are not read again
+        val pods = parse(item("a", "1", restarts = 2, labels = """{"app": "other"}"""), item("b", "1"))!!
+        assertSame(first["a"], pods["a"])
+        assertEquals(mapOf("app" to "a"), pods["a"]!!.labels)
+    }
+
+    @Test
+    fun `status changes without a new resourceVersion are picked up`() {
+        parse(item("a", "1", restarts = 2))
+        // The kubelet overlays container restarts and phase without bumping the version
+        val restarted = parse(item("a", "1", restarts = 3))!!
+        assertEquals(3, restarted["a"]!!.containers[0].restartCount)
+        assertEquals(mapOf("app" to "a"), restarted["a"]!!.labels)
+
+        assertEquals(emptySet<String>(), parse(item("a", "1", restarts = 3, phase = "Failed"))!!.keys)
+        assertNull(parse(item("a", "1", restarts = 3, phase = "Failed")))
+    }
+
+    @Test
+    fun `static pods are parsed on every poll`() {
+        parse(item("s", "1", restarts = 0, source = "file"))
+        val pods = parse(item("s", "1", restarts = 4, source = "file"))!!
+        assertEquals(4, pods["s"]!!.containers[0].restartCount)
+        assertEquals(mapOf("app" to "s"), pods["s"]!!.labels)
+    }
+
+    @Test
+    fun `finished pods are left out`() {
+        val pods = parse(item("a", "1", phase = "Succeeded"), item("b", "1", phase = "Failed"), item("c", "1"))!!
+        assertEquals(setOf("c"), pods.keys)
+    }
+}
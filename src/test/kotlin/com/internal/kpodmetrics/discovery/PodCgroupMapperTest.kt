@@ -1,11 +1,15 @@
 package com.internal.kpodmetrics.discovery
 
 import com.internal.kpodmetrics.cgroup.CgroupPathResolver
+import com.internal.kpodmetrics.cgroup.CgroupTreeWatcher
 import com.internal.kpodmetrics.model.*
 import org.junit.jupiter.api.Assertions.*
 import org.junit.jupiter.api.Test
 import org.junit.jupiter.api.io.TempDir
+import java.io.IOException
 import java.nio.file.Path
+import java.nio.file.StandardWatchEventKinds.ENTRY_CREATE
+import java.nio.file.StandardWatchEventKinds.ENTRY_DELETE
 import kotlin.io.path.createDirectories
 
 class PodCgroupMapperTest {
@@ -130,4 +134,59 @@ class PodCgroupMapperTest {
         assertEquals(1, targets.size)
         assertEquals("app", targets[0].containerName)
     }
+
+    @Test
+    fun `uses watched cgroup tree instead of resolving pod directories`() {
+        val uid = "12121212-3434-5656-7878-909090909090"
+        val podDir = tempDir.resolve("cgroup/kubepods.slice/kubepods-pod${uid.replace("-", "_")}.slice")
+        podDir.resolve("cri-containerd-feed1234.scope").createDirectories()
+
+        // The path resolver looks elsewhere, so only the tree can find the container
+        val resolver = CgroupPathResolver(tempDir.resolve("missing").toString(), CgroupVersion.V2)
+        val tree = CgroupTreeWatcher(tempDir.resolve("cgroup").toString(), CgroupVersion.V2)
+        tree.start()
+        try {
+            val provider = object : PodProvider {
+                override fun getDiscoveredPods(): Map<String, DiscoveredPod> = mapOf(
+                    uid to DiscoveredPod(uid, "api-pod", "default", QosClass.GUARANTEED,
+                        listOf(ContainerInfo("api", "feed1234")))
+                )
+            }
+            val targets = PodCgroupMapper(provider, resolver, "test-node", cgroupTree = tree).resolve()
+            assertEquals(1, targets.size)
+            assertEquals(podDir.resolve("cri-containerd-feed1234.scope").toString(), targets[0].cgroupPath)
+        } finally {
+            tree.close()
+        }
+    }
+
+    @Test
+    fun `lists the pod directory when the watched tree has no containers for it`() {
+        val uid = "abababab-cdcd-efef-0101-232323232323"
+        val podDir = tempDir.resolve("kubepods.slice/kubepods-pod${uid.replace("-", "_")}.slice").createDirectories()
+
+        val resolver = CgroupPathResolver(tempDir.toString(), CgroupVersion.V2)
+        val tree = CgroupTreeWatcher(tempDir.toString(), CgroupVersion.V2, register = { dir, ws ->
+            if (dir == podDir) throw IOException("No space left on device")
+            dir.register(ws, ENTRY_CREATE, ENTRY_DELETE)
+        })
+        tree.start()
+        try {
+            // Created after start in an unwatched pod directory, so the tree never sees it
+            val container = podDir.resolve("cri-containerd-beef5678.scope").createDirectories()
+            assertTrue(tree.containers(uid).isEmpty())
+
+            val provider = object : PodProvider {
+                override fun getDiscoveredPods(): Map<String, DiscoveredPod> = mapOf(
+                    uid to DiscoveredPod(uid, "web-pod", "default", QosClass.GUARANTEED,
+                        listOf(ContainerInfo("web", "beef5678")))
+                )
+            }
+            val targets = PodCgroupMapper(provider, resolver, "test-node", cgroupTree = tree).resolve()
+            assertEquals(1, targets.size)
+            assertEquals(container.toString(), targets[0].cgroupPath)
+        } finally {
+            tree.close()
+        }
+    }
 }
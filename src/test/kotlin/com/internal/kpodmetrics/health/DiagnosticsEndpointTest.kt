@@ -226,4 +226,67 @@ class DiagnosticsEndpointTest {
         val recs = result["recommendations"] as List<String>
         assertTrue(recs.any { it.contains("syscall") })
     }
+
+    @Test
+    fun `scheduler section reflects adaptive scheduler state`() {
+        every { service.getLastSuccessfulCycle() } returns Instant.now()
+        every { service.isShuttingDown() } returns false
+        every { service.getEnabledCollectorCount() } returns 1
+        every { service.getLastCollectorErrors() } returns emptyMap()
+
+        val config = ResolvedConfig(
+            cpu = CpuProperties(),
+            network = NetworkProperties(),
+            syscall = SyscallProperties()
+        )
+
+        val withoutScheduler = DiagnosticsEndpoint(service, null, config).diagnostics()
+        @Suppress("UNCHECKED_CAST")
+        val disabled = withoutScheduler["scheduler"] as Map<String, Any?>
+        assertEquals(false, disabled["enabled"])
+
+        val scheduler = com.internal.kpodmetrics.collector.CollectionScheduler(
+            spreadWindowMs = 5000, cpuLoadSupplier = { 0.3 }
+        )
+        scheduler.recordCost("cpu", 1_000_000, -1, -1)
+        scheduler.beginCycle(listOf("cpu"))
+        val result = DiagnosticsEndpoint(service, null, config, scheduler = scheduler).diagnostics()
+
+        @Suppress("UNCHECKED_CAST")
+        val section = result["scheduler"] as Map<String, Any?>
+        assertEquals(true, section["enabled"])
+        assertEquals(0.3, section["cpuLoad"])
+        @Suppress("UNCHECKED_CAST")
+        val collectors = section["collectors"] as Map<String, Any?>
+        assertTrue(collectors.containsKey("cpu"))
+    }
+
+    @Test
+    fun `collector cost section lists the costliest collectors`() {
+        every { service.getLastSuccessfulCycle() } returns Instant.now()
+        every { service.isShuttingDown() } returns false
+        every { service.getEnabledCollectorCount() } returns 2
+        every { service.getLastCollectorErrors() } returns emptyMap()
+
+        val config = ResolvedConfig(
+            cpu = CpuProperties(),
+            network = NetworkProperties(),
+            syscall = SyscallProperties()
+        )
+        val tracker = com.internal.kpodmetrics.collector.CollectorCostTracker(topN = 1)
+        tracker.record("cpu", com.internal.kpodmetrics.collector.CollectorCostTracker.Sample(
+            1_000_000, 500_000, 1_000, 0, 0, 0, 0))
+        tracker.record("http", com.internal.kpodmetrics.collector.CollectorCostTracker.Sample(
+            5_000_000, 2_000_000, 64_000, 3_000_000, 1_000_000, 2_000_000, 4))
+
+        val result = DiagnosticsEndpoint(service, null, config, costTracker = tracker).diagnostics()
+
+        @Suppress("UNCHECKED_CAST")
+        val section = result["collectorCost"] as Map<String, Any?>
+        @Suppress("UNCHECKED_CAST")
+        val top = section["topByAllocation"] as List<Map<String, Any?>>
+        assertEquals(1, top.size)
+        assertEquals("http", top[0]["collector"])
+        assertEquals(2_000_000L, top[0]["avgJniAllocatedBytes"])
+    }
 }
@@ -0,0 +1,44 @@
+package com.internal.kpodmetrics.jfr
+
+import org.junit.jupiter.api.Assertions.*
+import org.junit.jupiter.api.Test
+import org.springframework.mock.web.MockFilterChain
+import org.springframework.mock.web.MockHttpServletRequest
+import org.springframework.mock.web.MockHttpServletResponse
+
+class SelfProfileAuthFilterTest {
+
+    private val filter = SelfProfileAuthFilter("s3cret")
+
+    private fun call(authorization: String?): Pair<MockHttpServletResponse, MockFilterChain> {
+        val request = MockHttpServletRequest("GET", "/actuator/kpodProfile")
+        authorization?.let { request.addHeader("Authorization", it) }
+        val response = MockHttpServletResponse()
+        val chain = MockFilterChain()
+        filter.doFilter(request, response, chain)
+        return response to chain
+    }
+
+    @Test
+    fun `valid bearer token passes through`() {
+        val (response, chain) = call("Bearer s3cret")
+
+        assertEquals(200, response.status)
+        assertNotNull(chain.request)
+    }
+
+    @Test
+    fun `missing or wrong token is rejected`() {
+        for (header in listOf(null, "Bearer wrong", "Basic s3cret", "Bearer s3cret-and-more")) {
+            val (response, chain) = call(header)
+
+            assertEquals(401, response.status, "header=$header")
+            assertNull(chain.request)
+        }
+    }
+
+    @Test
+    fun `blank token is refused at construction`() {
+        assertThrows(IllegalArgumentException::class.java) { SelfProfileAuthFilter(" ") }
+    }
+}
@@ -0,0 +1,100 @@
+package com.internal.kpodmetrics.jfr
+
+import org.junit.jupiter.api.AfterEach
+import org.junit.jupiter.api.Assertions.*
+import org.junit.jupiter.api.Test
+import org.junit.jupiter.api.io.TempDir
+import java.nio.file.Files
+import java.nio.file.Path
+import java.time.Duration
+
+class SelfProfilerTest {
+
+    @TempDir
+    lateinit var dir: Path
+
+    private val profiler by lazy { SelfProfiler(Duration.ofSeconds(60), 8L * 1024 * 1024, dir) }
+
+    @AfterEach
+    fun tearDown() = profiler.close()
+
+    private fun emitCollectorRun(name: String) {
+        val event = CollectorRunEvent()
+        event.begin()
+        Thread.sleep(2)
+        event.collector = name
+        event.commit()
+    }
+
+    @Test
+    fun `caps the session duration and refuses a second session`() {
+        val status = profiler.start(Duration.ofHours(1))
+
+        assertEquals("RUNNING", status["state"])
+        assertEquals(60L, status["durationSeconds"])
+        assertThrows(IllegalStateException::class.java) { profiler.start(Duration.ofSeconds(5)) }
+    }
+
+    @Test
+    fun `summarizes kpod events per collector`() {
+        profiler.start(Duration.ofSeconds(30))
+        repeat(3) { emitCollectorRun("cpu") }
+        emitCollectorRun("dns")
+        assertTrue(profiler.stop())
+
+        val summary = profiler.summary()
+
+        assertEquals(true, summary["available"])
+        @Suppress("UNCHECKED_CAST")
+        val events = summary["kpodEvents"] as List<Map<String, Any?>>
+        val cpu = events.single { it["event"] == "kpod.CollectorRun" && it["key"] == "cpu" }
+        assertEquals(3L, cpu["count"])
+        assertTrue((cpu["maxMs"] as Double) >= 1.0)
+        assertEquals(1L, events.single { it["key"] == "dns" }["count"])
+    }
+
+    @Test
+    fun `running session is dumped without stopping it`() {
+        profiler.start(Duration.ofSeconds(30))
+        emitCollectorRun("http")
+
+        profiler.dump()!!.use { dump ->
+            assertTrue(Files.size(dump.path) > 0)
+        }
+        assertTrue(profiler.isRunning())
+    }
+
+    @Test
+    fun `every reader gets its own dump, deleted when it is done`() {
+        profiler.start(Duration.ofSeconds(30))
+        emitCollectorRun("http")
+
+        val first = profiler.dump()!!
+        val second = profiler.dump()!!
+        assertNotEquals(first.path, second.path)
+        first.close()
+        assertFalse(Files.exists(first.path))
+        assertTrue(Files.size(second.path) > 0)
+        second.close()
+    }
+
+    @Test
+    fun `summary of a finished session is computed once`() {
+        profiler.start(Duration.ofSeconds(30))
+        emitCollectorRun("cpu")
+        profiler.stop()
+
+        val summary = profiler.summary(5)
+        assertSame(summary, profiler.summary(5))
+        assertNotSame(summary, profiler.summary(10))
+        // Each summary's dump is gone once it has been read
+        assertEquals(1L, Files.list(dir).use { files -> files.count() })
+    }
+
+    @Test
+    fun `nothing to summarize before the first session`() {
+        assertEquals(false, profiler.summary()["available"])
+        assertNull(profiler.dump())
+        assertFalse(profiler.stop())
+    }
+}
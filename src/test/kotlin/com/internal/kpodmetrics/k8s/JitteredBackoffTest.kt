@@ -0,0 +1,39 @@
+package com.internal.kpodmetrics.k8s
+
+import org.junit.jupiter.api.Assertions.*
+import org.junit.jupiter.api.Test
+import kotlin.random.Random
+
+class JitteredBackoffTest {
+
+    @Test
+    fun `delays stay within a window that doubles up to the cap`() {
+        val backoff = JitteredBackoff(baseMs = 100, maxMs = 1000, random = Random(42))
+        val caps = listOf(100L, 200L, 400L, 800L, 1000L, 1000L)
+        for (cap in caps) {
+            val delay = backoff.nextDelayMs()
+            assertTrue(delay in 0..cap) { "delay $delay outside [0, $cap]" }
+        }
+    }
+
+    @Test
+    fun `reset starts over from the base window`() {
+        val backoff = JitteredBackoff(baseMs = 100, maxMs = 60_000, random = Random(7))
+        repeat(10) { backoff.nextDelayMs() }
+        backoff.reset()
+        assertTrue(backoff.nextDelayMs() <= 100)
+    }
+
+    @Test
+    fun `delays are spread across the window`() {
+        val delays = (1..200).map { JitteredBackoff(baseMs = 1000, random = Random(it)).nextDelayMs() }
+        assertTrue(delays.min() < 200)
+        assertTrue(delays.max() > 800)
+    }
+
+    @Test
+    fun `many attempts do not overflow`() {
+        val backoff = JitteredBackoff(baseMs = 1000, maxMs = 60_000)
+        repeat(100) { assertTrue(backoff.nextDelayMs() in 0..60_000) }
+    }
+}
@@ -0,0 +1,211 @@
+package com.internal.kpodmetrics.k8s
+
+import com.internal.kpodmetrics.bpf.CgroupResolver
+import com.internal.kpodmetrics.cgroup.CgroupTreeWatcher
+import com.internal.kpodmetrics.cgroup.ContainerCgroupNode
+import com.internal.kpodmetrics.cgroup.ProcCgroupIndex
+import com.internal.kpodmetrics.config.MetricsProperties
+import com.sun.net.httpserver.HttpExchange
+import com.sun.net.httpserver.HttpServer
+import io.fabric8.kubernetes.client.Config
+import io.fabric8.kubernetes.client.ConfigBuilder
+import io.fabric8.kubernetes.client.KubernetesClient
+import io.fabric8.kubernetes.client.KubernetesClientBuilder
+import io.micrometer.core.instrument.simple.SimpleMeterRegistry
+import io.mockk.every
+import io.mockk.mockk
+import org.junit.jupiter.api.AfterEach
+import org.junit.jupiter.api.Assertions.*
+import org.junit.jupiter.api.Test
+import java.net.InetSocketAddress
+import java.net.URLDecoder
+import java.util.concurrent.CopyOnWriteArrayList
+import java.util.concurrent.Executors
+import java.util.concurrent.atomic.AtomicInteger
+
+/**
+ * Many agents against one fake API server that restarts: dropped watches resume from
+ * the last bookmark without a relist, and an expired resourceVersion relists once per
+ * agent, spread out by the jittered backoff.
+ */
+class PodWatcherRelistStormTest {
+
+    /** Serves the node-scoped pod list and watch the way the API server does. */
+    private class FakeApiServer : AutoCloseable {
+        private val server = HttpServer.create(InetSocketAddress("127.0.0.1", 0), 0)
+        private val openWatches = CopyOnWriteArrayList<HttpExchange>()
+        val lists = AtomicInteger()
+        val listTimesMs = CopyOnWriteArrayList<Long>()
+        // resourceVersion of every watch request, in arrival order
+        val watchVersions = CopyOnWriteArrayList<String>()
+        @Volatile var listVersion = 100
+        @Volatile var bookmarkVersion = 150
+        // Watches from an older resourceVersion get 410 Gone
+        @Volatile var compactedBelow = 0
+        // Pod objects served by the list, paged by limit/continue
+        @Volatile var pods: List<String> = emptyList()
+        val listQueries = CopyOnWriteArrayList<Map<String, String>>()
+
+        val url: String get() = "http://127.0.0.1:${server.address.port}"
+
+        init {
+            server.executor = Executors.newCachedThreadPool()
+            server.createContext("/api/v1/pods") { handle(it) }
+            server.start()
+        }
+
+        private fun handle(exchange: HttpExchange) {
+            val query = (exchange.requestURI.rawQuery ?: "").split('&').filter { it.contains('=') }
+                .associate { it.substringBefore('=') to URLDecoder.decode(it.substringAfter('='), Charsets.UTF_8) }
+            if (query["watch"] != "true") {
+                listQueries.add(query)
+                val from = query["continue"]?.toInt() ?: 0
+                if (from == 0) {
+                    lists.incrementAndGet()
+                    listTimesMs.add(System.currentTimeMillis())
+                }
+                val to = minOf(pods.size, from + (query["limit"]?.toInt() ?: pods.size))
+                val next = if (to < pods.size) ",\"continue\":\"$to\"" else ""
+                respond(
+                    exchange, 200,
+                    """{"kind":"PodList","apiVersion":"v1","metadata":{"resourceVersion":"$listVersion"$next},""" +
+                        """"items":[${pods.subList(from, to).joinToString(",")}]}"""
+                )
+                return
+            }
+            if (exchange.requestHeaders.getFirst("Upgrade") != null) {
+                // No websockets here; the client falls back to a streaming GET
+                respond(exchange, 503, "")
+                return
+            }
+            val version = query["resourceVersion"] ?: ""
+            watchVersions.add(version)
+            exchange.responseHeaders.add("Content-Type", "application/json")
+            exchange.sendResponseHeaders(200, 0)
+            val out = exchange.responseBody
+            if ((version.toIntOrNull() ?: 0) < compactedBelow) {
+                out.write(event("ERROR", """{"kind":"Status","apiVersion":"v1","status":"Failure","message":"too old resource version","reason":"Expired","code":410}"""))
+                exchange.close()
+                return
+            }
+            out.write(event("BOOKMARK", """{"kind":"Pod","apiVersion":"v1","metadata":{"resourceVersion":"$bookmarkVersion"}}"""))
+            out.flush()
+            openWatches.add(exchange)
+        }
+
+        private fun event(type: String, obj: String) = """{"type":"$type","object":$obj}""".plus("\n").toByteArray()
+
+        private fun respond(exchange: HttpExchange, status: Int, body: String) {
+            val bytes = body.toByteArray()
+            exchange.responseHeaders.add("Content-Type", "application/json")
+            exchange.sendResponseHeaders(status, if (bytes.isEmpty()) -1 else bytes.size.toLong())
+            if (bytes.isNotEmpty()) exchange.responseBody.write(bytes)
+            exchange.close()
+        }
+
+        /** Ends every open watch stream, as an API server restart does. */
+        fun restart() {
+            for (exchange in openWatches) exchange.close()
+            openWatches.clear()
+        }
+
+        override fun close() {
+            restart()
+            server.stop(0)
+        }
+    }
+
+    private val agents = 20
+    private val server = FakeApiServer()
+    private val client: KubernetesClient = KubernetesClientBuilder()
+        .withConfig(ConfigBuilder(Config.empty()).withMasterUrl(server.url).withWatchReconnectInterval(10).build())
+        .build()
+    private val registry = SimpleMeterRegistry()
+    private val watchers = (1..agents).map { i ->
+        PodWatcher(
+            client, CgroupResolver(), MetricsProperties(nodeName = "node-$i"), registry,
+            backoff = JitteredBackoff(baseMs = 200, maxMs = 1000)
+        )
+    }
+
+    @AfterEach
+    fun tearDown() {
+        watchers.forEach { it.stop() }
+        client.close()
+        server.close()
+    }
+
+    private fun awaitTrue(message: String, condition: () -> Boolean) {
+        val deadline = System.currentTimeMillis() + 10_000
+        while (!condition()) {
+            if (System.currentTimeMillis() > deadline) fail<Unit>("$message within 10s")
+            Thread.sleep(10)
+        }
+    }
+
+    private fun pod(i: Int) =
+        """{"kind":"Pod","apiVersion":"v1","metadata":{"name":"pod-$i","namespace":"default","uid":"uid-$i",""" +
+            """"resourceVersion":"100"},"status":{"qosClass":"Burstable","containerStatuses":""" +
+            """[{"name":"app","containerID":"containerd://c-$i","restartCount":0}]}}"""
+
+    private fun watchesFrom(version: Int) = server.watchVersions.count { it == version.toString() }
+
+    @Test
+    fun `dropped watches resume from the last bookmark without relisting`() {
+        watchers.forEach { it.start() }
+        assertEquals(agents, server.lists.get())
+        awaitTrue("every agent watching from the list's version") { watchesFrom(100) >= agents }
+
+        server.restart()
+        awaitTrue("every agent resuming from the bookmark") { watchesFrom(150) >= agents }
+        assertEquals(agents, server.lists.get())
+        assertEquals(0.0, registry.counter("kpod.pod.watch.reconnects", "mode", "relist").count())
+    }
+
+    @Test
+    fun `an expired resourceVersion relists once per agent spread over the backoff window`() {
+        watchers.forEach { it.start() }
+        awaitTrue("every agent watching") { watchesFrom(100) >= agents }
+
+        server.listVersion = 1000
+        server.bookmarkVersion = 1000
+        server.compactedBelow = 1000
+        server.restart()
+
+        awaitTrue("every agent relisting") { server.lists.get() >= 2 * agents }
+        awaitTrue("every agent watching from the new list") { watchesFrom(1000) >= agents }
+        Thread.sleep(300)
+        assertEquals(2 * agents, server.lists.get())
+        assertEquals(agents.toDouble(), registry.counter("kpod.pod.watch.reconnects", "mode", "relist").count())
+
+        val relistTimes = server.listTimesMs.drop(agents)
+        assertTrue(relistTimes.max() - relistTimes.min() >= 20) {
+            "relists were not spread: ${relistTimes.max() - relistTimes.min()} ms"
+        }
+    }
+
+    @Test
+    fun `the pod list is paged and every page is registered`() {
+        server.pods = (1..250).map { pod(it) }
+        val cgroupTree = mockk<CgroupTreeWatcher>(relaxed = true)
+        every { cgroupTree.findByContainerId(any()) } answers {
+            val id = firstArg<String>().removePrefix("c-").toLong()
+            ContainerCgroupNode("uid-$id", firstArg(), "/kubepods/pod-$id/${firstArg<String>()}", 1000L + id)
+        }
+        val resolver = CgroupResolver()
+        val watcher = PodWatcher(
+            client, resolver, MetricsProperties(nodeName = "node-1"), registry, cgroupTree,
+            ProcCgroupIndex(procRoot = null)
+        )
+        try {
+            watcher.start()
+            assertEquals(250, watcher.getDiscoveredPods().size)
+            assertEquals("pod-250", resolver.resolve(1250L)?.podName)
+            assertEquals(listOf(null, "100", "200"), server.listQueries.map { it["continue"] })
+            assertTrue(server.listQueries.all { it["limit"] == "100" })
+            awaitTrue("watching from the list's version") { watchesFrom(100) >= 1 }
+        } finally {
+            watcher.stop()
+        }
+    }
+}
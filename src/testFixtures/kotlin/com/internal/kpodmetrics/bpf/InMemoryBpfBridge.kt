@@ -0,0 +1,346 @@
+package com.internal.kpodmetrics.bpf
+
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
+import java.util.concurrent.ConcurrentHashMap
+import java.util.concurrent.atomic.AtomicInteger
+import java.util.concurrent.atomic.AtomicLong
+
+enum class FakeMapType(val lru: Boolean = false, val percpu: Boolean = false, val array: Boolean = false) {
+    HASH,
+    LRU_HASH(lru = true),
+    PERCPU_HASH(percpu = true),
+    LRU_PERCPU_HASH(lru = true, percpu = true),
+    ARRAY(array = true),
+    PERCPU_ARRAY(percpu = true, array = true)
+}
+
+/**
+ * One in-memory BPF map with kernel semantics: bounded capacity, LRU eviction of the
+ * least recently used entry (lookups and updates both count as use), `get_next_key`
+ * iteration that restarts from the first key when the previous key is gone, and
+ * per-CPU values laid out as `numCpus` consecutive `valueSize` slots as libbpf
+ * returns them. Array maps are pre-populated with zeroed values and reject deletes.
+ *
+ * Writes through [add] / [put] model the BPF program side; the [InMemoryBpfBridge]
+ * overrides model the user-space syscalls the collectors make.
+ */
+class FakeBpfMap(
+    val name: String,
+    val type: FakeMapType,
+    val maxEntries: Int,
+    val keySize: Int,
+    val valueSize: Int,
+    val numCpus: Int,
+    /** Companion `DEFINE_STATS_MAP` array updated on program-side inserts, if any. */
+    private val stats: FakeBpfMap? = null
+) {
+    private val entries = LinkedHashMap<ByteBuffer, ByteArray>(16, 0.75f, type.lru)
+
+    val evictions = AtomicLong()
+    val updateErrors = AtomicLong()
+
+    /** Bytes returned by a lookup: one slot per CPU for per-CPU maps. */
+    val storedValueSize: Int get() = if (type.percpu) valueSize * numCpus else valueSize
+
+    init {
+        if (type.array) {
+            for (i in 0 until maxEntries) {
+                entries[keyOf(ByteBuffer.allocate(4).order(ByteOrder.LITTLE_ENDIAN).putInt(i).array())] =
+                    ByteArray(storedValueSize)
+            }
+        }
+    }
+
+    private fun keyOf(key: ByteArray): ByteBuffer {
+        require(key.size == keySize) { "$name: key is ${key.size} bytes, map key_size is $keySize" }
+        return ByteBuffer.wrap(key.copyOf())
+    }
+
+    @Synchronized
+    fun size(): Int = entries.size
+
+    @Synchronized
+    fun lookup(key: ByteArray): ByteArray? = entries[keyOf(key)]?.copyOf()
+
+    /** Kernel `bpf_map_update_elem`; flags are BPF_ANY (0), BPF_NOEXIST (1), BPF_EXIST (2). */
+    @Synchronized
+    fun update(key: ByteArray, value: ByteArray, flags: Long = 0L) {
+        require(value.size == storedValueSize) { "$name: value is ${value.size} bytes, expected $storedValueSize" }
+        val k = keyOf(key)
+        val exists = entries.containsKey(k)
+        when {
+            flags == 1L && exists -> throw BpfMapException("$name: key exists (EEXIST)")
+            flags == 2L && !exists -> throw BpfMapException("$name: key not found (ENOENT)")
+            type.array && !exists -> throw BpfMapException("$name: index out of range (E2BIG)")
+        }
+        if (!exists && !makeRoom()) throw BpfMapException("$name: map full (E2BIG)")
+        entries[k] = value.copyOf()
+    }
+
+    @Synchronized
+    fun delete(key: ByteArray): Boolean {
+        if (type.array) throw BpfMapException("$name: delete on array map (EINVAL)")
+        return entries.remove(keyOf(key)) != null
+    }
+
+    @Synchronized
+    fun nextKey(key: ByteArray?): ByteArray? {
+        val it = entries.keys.iterator()
+        if (key != null) {
+            val k = keyOf(key)
+            if (entries.containsKey(k)) {
+                while (it.hasNext()) {
+                    if (it.next() == k) break
+                }
+            }
+        }
+        return if (it.hasNext()) it.next().array().copyOf() else null
+    }
+
+    /** `BPF_MAP_LOOKUP_AND_DELETE_BATCH`: up to [max] entries in iteration order. */
+    @Synchronized
+    fun batchLookupAndDelete(max: Int): List<Pair<ByteArray, ByteArray>> {
+        if (type.array) throw BpfMapException("$name: lookup_and_delete_batch on array map (EINVAL)")
+        val out = ArrayList<Pair<ByteArray, ByteArray>>(minOf(max, entries.size))
+        val it = entries.entries.iterator()
+        while (out.size < max && it.hasNext()) {
+            val (k, v) = it.next()
+            out.add(k.array().copyOf() to v)
+            it.remove()
+        }
+        return out
+    }
+
+    /**
+     * Program-side `lookup_elem` + `__sync_fetch_and_add` on the u64 at [offset],
+     * inserting a zeroed value first (BPF_NOEXIST) when the key is absent. For per-CPU
+     * maps the add lands in [cpu]'s slot. Returns false when the insert failed.
+     */
+    @Synchronized
+    fun add(key: ByteArray, offset: Int, delta: Long, cpu: Int = 0): Boolean {
+        val value = valueForUpdate(key, cpu) ?: return false
+        val buf = ByteBuffer.wrap(value).order(ByteOrder.LITTLE_ENDIAN)
+        val base = slot(cpu) + offset
+        buf.putLong(base, buf.getLong(base) + delta)
+        return true
+    }
+
+    /** [add] of [delta] to every u64 word of the value: one event on a counter/histogram struct. */
+    @Synchronized
+    fun addAll(key: ByteArray, delta: Long, cpu: Int = 0): Boolean {
+        val value = valueForUpdate(key, cpu) ?: return false
+        val buf = ByteBuffer.wrap(value).order(ByteOrder.LITTLE_ENDIAN)
+        val base = slot(cpu)
+        for (off in base until base + valueSize - 7 step 8) buf.putLong(off, buf.getLong(off) + delta)
+        return true
+    }
+
+    private fun slot(cpu: Int): Int = if (type.percpu) cpu % numCpus * valueSize else 0
+
+    private fun valueForUpdate(key: ByteArray, cpu: Int): ByteArray? {
+        val k = keyOf(key)
+        entries[k]?.let { return it }
+        if (!makeRoom()) {
+            updateErrors.incrementAndGet()
+            stats?.add(STATS_KEYS[1], 0, 1, cpu)
+            return null
+        }
+        stats?.add(STATS_KEYS[0], 0, 1, cpu)
+        return ByteArray(storedValueSize).also { entries[k] = it }
+    }
+
+    private fun makeRoom(): Boolean {
+        if (entries.size < maxEntries) return true
+        if (!type.lru) return false
+        val eldest = entries.keys.iterator()
+        eldest.next()
+        eldest.remove()
+        evictions.incrementAndGet()
+        return true
+    }
+
+    companion object {
+        private val STATS_KEYS = Array(2) { i -> ByteBuffer.allocate(4).order(ByteOrder.LITTLE_ENDIAN).putInt(i).array() }
+    }
+}
+
+/**
+ * [BpfBridge] backed by [FakeBpfMap]s instead of libbpf, for load harnesses and
+ * tests that need real map behaviour rather than call-by-call mocks.
+ *
+ * Programs "load" from any path (the program name is the file name without
+ * `.bpf.o`). Map fds are handed out by [getMapFd]; the map behind an fd is created
+ * on first write from its [defineMap] declaration or, failing that, [defaultMap],
+ * so a map nothing has written to drains empty just like a fresh kernel map.
+ * The drain, snapshot and offload paths are the production ones from [BpfBridge];
+ * only the kernel primitives are replaced.
+ */
+class InMemoryBpfBridge(
+    private val numCpus: Int = 4,
+    nativeExecutor: NativeCallExecutor? = null
+) : BpfBridge(nativeExecutor) {
+
+    data class MapDefinition(
+        val type: FakeMapType,
+        val maxEntries: Int,
+        val keySize: Int? = null,
+        val valueSize: Int? = null
+    )
+
+    private data class Declared(val program: String, val map: String)
+
+    private val nextHandle = AtomicLong(1)
+    private val nextFd = AtomicInteger(100)
+    private val programsByHandle = ConcurrentHashMap<Long, String>()
+    private val fdsByName = ConcurrentHashMap<Declared, Int>()
+    private val mapsByFd = ConcurrentHashMap<Int, FakeBpfMap>()
+    private val pendingDefinitions = ConcurrentHashMap<Declared, MapDefinition>()
+    private val namesByFd = ConcurrentHashMap<Int, Declared>()
+    private val progStats = ConcurrentHashMap<String, LongArray>()
+
+    /** Every program gets this unless declared otherwise (kpod maps are 10240-entry LRU hashes). */
+    var defaultMap = MapDefinition(FakeMapType.LRU_HASH, 10240)
+
+    /** When true, batch drains report "not supported" so the legacy iterate path runs. */
+    @Volatile var batchUnsupported = false
+
+    fun defineMap(program: String, map: String, definition: MapDefinition) {
+        pendingDefinitions[Declared(program, map)] = definition
+    }
+
+    /** The map behind ([program], [map]), creating it with the given sizes if needed. */
+    fun map(program: String, map: String, keySize: Int, valueSize: Int): FakeBpfMap =
+        bind(reserve(program, map), keySize, valueSize)
+
+    fun maps(): Map<String, FakeBpfMap> = mapsByFd.entries.associate { (fd, m) ->
+        val name = namesByFd.getValue(fd)
+        "${name.program}/${name.map}" to m
+    }
+
+    /** "program/map" for an fd handed out by [getMapFd]. */
+    fun nameOf(mapFd: Int): String? = namesByFd[mapFd]?.let { "${it.program}/${it.map}" }
+
+    /** Adds to the cumulative `[run_time_ns, run_cnt]` reported by [getProgStats]. */
+    fun recordProgramRun(program: String, runTimeNs: Long, runCount: Long) {
+        progStats.compute(program) { _, prev ->
+            val s = prev ?: LongArray(2)
+            s[0] += runTimeNs
+            s[1] += runCount
+            s
+        }
+    }
+
+    /** Hands out the fd for ([program], [map]); the map itself is created by [bind]. */
+    private fun reserve(program: String, map: String): Int =
+        fdsByName.computeIfAbsent(Declared(program, map)) { declared ->
+            nextFd.getAndIncrement().also { namesByFd[it] = declared }
+        }
+
+    /**
+     * Creates the map behind [fd] on first use. Sizes come from [defineMap] when
+     * declared, otherwise from the first caller, as libbpf would read them from BTF.
+     */
+    @Synchronized
+    private fun bind(fd: Int, keySize: Int, valueSize: Int): FakeBpfMap {
+        mapsByFd[fd]?.let { return it }
+        val declared = namesByFd[fd] ?: throw BpfMapException("bad map fd $fd (EBADF)")
+        val isStats = declared.map.endsWith("_stats")
+        val def = pendingDefinitions[declared]
+            ?: if (isStats) MapDefinition(FakeMapType.PERCPU_ARRAY, 2, 4, 8) else defaultMap
+        val stats = if (isStats) null else map(declared.program, "${declared.map}_stats", 4, 8)
+        val created = FakeBpfMap(
+            declared.map, def.type, def.maxEntries,
+            def.keySize ?: keySize, def.valueSize ?: valueSize, numCpus, stats
+        )
+        mapsByFd[fd] = created
+        return created
+    }
+
+    // --- Objects ---
+
+    override fun openObject(path: String): Long {
+        val handle = nextHandle.getAndIncrement()
+        programsByHandle[handle] = path.substringAfterLast('/').removeSuffix(".bpf.o")
+        return handle
+    }
+
+    override fun loadObject(handle: Long): Int = if (programsByHandle.containsKey(handle)) 0
+        else throw BpfHandleException("Invalid handle: $handle")
+
+    override fun attachAll(handle: Long): Int = loadObject(handle)
+
+    override fun destroyObject(handle: Long) {
+        programsByHandle.remove(handle) ?: throw BpfHandleException("Invalid handle: $handle")
+    }
+
+    override fun getMapFd(handle: Long, mapName: String): Int {
+        val program = programsByHandle[handle] ?: throw BpfHandleException("Invalid handle: $handle")
+        return reserve(program, mapName)
+    }
+
+    override fun getProgStats(handle: Long): LongArray? {
+        val program = programsByHandle[handle] ?: throw BpfHandleException("Invalid handle: $handle")
+        return progStats[program]?.copyOf() ?: longArrayOf(0, 0)
+    }
+
+    /** One program per object, named after it, attached at `fake/<program>`. */
+    override fun getProgramStats(handle: Long): List<BpfProgramStats>? {
+        val program = programsByHandle[handle] ?: throw BpfHandleException("Invalid handle: $handle")
+        val s = progStats[program] ?: LongArray(2)
+        return listOf(BpfProgramStats(program, "fake/$program", s[0], s[1], 0))
+    }
+
+    override fun enableStats(): Int = nextFd.getAndIncrement()
+
+    override fun closeStatsFd(fd: Int) {}
+
+    override fun perfEventAttach(handle: Long, progName: String, sampleFreq: Int): Int {
+        loadObject(handle)
+        return numCpus
+    }
+
+    override fun getNumPossibleCpus(): Int = numCpus
+
+    // --- Maps (user-space side) ---
+
+    override fun lookupElem(mapFd: Int, key: ByteArray, valueSize: Int): ByteArray? =
+        mapsByFd[mapFd]?.lookup(key)
+
+    override fun nextKey(mapFd: Int, key: ByteArray?, keySize: Int): ByteArray? =
+        mapsByFd[mapFd]?.nextKey(key)
+
+    override fun deleteElem(mapFd: Int, key: ByteArray) {
+        mapsByFd[mapFd]?.delete(key)
+    }
+
+    override fun updateElem(mapFd: Int, key: ByteArray, value: ByteArray, flags: Long) {
+        val m = mapsByFd[mapFd] ?: bind(mapFd, key.size, value.size)
+        m.update(key, value, flags)
+    }
+
+    override fun fetch(spec: DrainSpec): List<Pair<ByteArray, ByteArray>> {
+        val m = mapsByFd[spec.mapFd] ?: return emptyList()
+        require(m.keySize == spec.keySize && m.storedValueSize == spec.valueSize) {
+            "${m.name}: drained as ${spec.keySize}/${spec.valueSize}, map is ${m.keySize}/${m.storedValueSize}"
+        }
+        if (spec.mode == DrainMode.BATCH && !batchUnsupported) return m.batchLookupAndDelete(spec.maxEntries)
+        // Legacy path: collect keys, then lookup+delete each, as BpfBridge does.
+        val keys = ArrayList<ByteArray>()
+        var prev: ByteArray? = null
+        while (true) {
+            val next = m.nextKey(prev) ?: break
+            keys.add(next)
+            prev = next
+        }
+        return keys.mapNotNull { k -> m.lookup(k)?.let { v -> m.delete(k); k to v } }
+    }
+
+    // --- Ring buffers are not modelled ---
+
+    override fun ringBufNew(mapFd: Int): Long = 0L
+
+    override fun ringBufPoll(rbPtr: Long, maxEvents: Int, eventSize: Int): ByteArray? = null
+
+    override fun ringBufFree(rbPtr: Long) {}
+}
@@ -0,0 +1,119 @@
+package com.internal.kpodmetrics.bpf
+
+import java.util.Random
+
+/**
+ * Shape of the node being simulated. [cardinality] is the number of distinct keys
+ * the BPF programs write per map, keyed by program name ("http") or by
+ * "program/map" ("tcp_peer/tcp_peer_rtt"); everything else gets [defaultCardinality].
+ * Distinct keys above a map's capacity are subject to its eviction policy, exactly
+ * as on a busy node.
+ */
+data class LoadProfile(
+    val pods: Int = 1000,
+    val eventsPerSecond: Long = 100_000,
+    val cardinality: Map<String, Int> = mapOf("http" to 50_000, "tcp_peer" to 10_000),
+    val defaultCardinality: Int = 2_000,
+    /** Share of keys whose cgroup belongs to no known pod (host processes, churned pods). */
+    val unresolvedFraction: Double = 0.05,
+    val seed: Long = 42
+)
+
+/** A map as a collector drains it, learned with [SyntheticLoadGenerator.learn]. */
+data class MapLayout(val program: String, val map: String, val keySize: Int, val valueSize: Int)
+
+/**
+ * Plays the kernel side of a simulated node against an [InMemoryBpfBridge]: a fixed
+ * key population per map (cgroup_id at offset 0, as in every kpod key, followed by
+ * small enum-like label bytes) and, per [tick], `eventsPerSecond × seconds` updates
+ * spread over the maps in proportion to their cardinality. Each event bumps every
+ * u64 of the value, so counters, histogram slots and sums all move.
+ */
+class SyntheticLoadGenerator(
+    private val bridge: InMemoryBpfBridge,
+    private val profile: LoadProfile,
+    layouts: Collection<MapLayout>
+) {
+    private class Target(val map: FakeBpfMap, val keys: Array<ByteArray>)
+
+    private val random = Random(profile.seed)
+    private val targets: List<Target>
+    private val cumulativeWeights: LongArray
+
+    init {
+        targets = layouts.map { layout ->
+            val n = profile.cardinality["${layout.program}/${layout.map}"]
+                ?: profile.cardinality[layout.program]
+                ?: profile.defaultCardinality
+            Target(
+                bridge.map(layout.program, layout.map, layout.keySize, layout.valueSize),
+                Array(n) { i -> key(i, layout.keySize) }
+            )
+        }
+        var total = 0L
+        cumulativeWeights = LongArray(targets.size) { i -> total += targets[i].keys.size; total }
+    }
+
+    val distinctKeys: Int get() = targets.sumOf { it.keys.size }
+
+    /** Writes the events for [seconds] of wall time; returns how many were written. */
+    fun tick(seconds: Double): Long {
+        if (targets.isEmpty()) return 0
+        val events = (profile.eventsPerSecond * seconds).toLong()
+        val total = cumulativeWeights.last()
+        val cpus = bridge.getNumPossibleCpus()
+        for (e in 0 until events) {
+            val r = (random.nextDouble() * total).toLong()
+            var t = 0
+            while (cumulativeWeights[t] <= r) t++
+            val target = targets[t]
+            target.map.addAll(target.keys[random.nextInt(target.keys.size)], 1, random.nextInt(cpus))
+        }
+        return events
+    }
+
+    /**
+     * Key number [i]: pods are cycled first so every pod gets keys, the remaining
+     * bytes count up in base 8 so keys stay distinct while label fields stay in the
+     * small ranges the collectors' label tables resolve.
+     */
+    private fun key(i: Int, keySize: Int): ByteArray {
+        val key = ByteArray(keySize)
+        val unresolved = random.nextDouble() < profile.unresolvedFraction
+        val cgroupId = FIRST_CGROUP_ID + if (unresolved) profile.pods + i % 1000 else i % profile.pods
+        for (b in 0 until minOf(8, keySize)) key[b] = (cgroupId ushr (b * 8)).toByte()
+        var rest = i / profile.pods
+        for (b in 8 until keySize) {
+            key[b] = (rest and 7).toByte()
+            rest = rest ushr 3
+        }
+        return key
+    }
+
+    companion object {
+        /** Cgroup id of the first synthetic pod; see [registerPods]. */
+        const val FIRST_CGROUP_ID = 10_000L
+
+        fun registerPods(resolver: CgroupResolver, pods: Int) {
+            for (i in 0 until pods) {
+                resolver.register(
+                    FIRST_CGROUP_ID + i,
+                    PodInfo("uid-$i", "cid-$i", "ns-${i % 20}", "pod-$i", "app")
+                )
+            }
+        }
+
+        /**
+         * Runs [collect] once against [bridge] and returns the layout of every map it
+         * drained. Maps nothing has written to drain empty, so this is side-effect free.
+         */
+        fun learn(bridge: InMemoryBpfBridge, collect: () -> Unit): List<MapLayout> {
+            val specs = LinkedHashSet<DrainSpec>()
+            bridge.recordDrains({ specs.add(it) }) { collect() }
+            return specs.mapNotNull { spec ->
+                val (program, map) = bridge.nameOf(spec.mapFd)?.split('/', limit = 2) ?: return@mapNotNull null
+                MapLayout(program, map, spec.keySize, spec.valueSize)
+            }.distinct()
+        }
+    }
+}